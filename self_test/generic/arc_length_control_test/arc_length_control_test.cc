@@ -0,0 +1,294 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the curvature-based control of the arc-length step: Follow the
+//solution branches u^2+lambda^2=1 (a unit circle in the (lambda,u)-plane,
+//whose curvature in the arc-length metric is one) and u=2 lambda (a
+//straight line) by arc-length continuation:
+//- On the circle the estimated curvature must be one (to within the
+//  difference between the pseudo-arc-length, i.e. the projection of the
+//  step onto the tangent, and the arc-length), and the steps must
+//  approach the desired angle between successive tangents.
+//- On the straight line the estimated curvature must vanish, and the
+//  steps must only be controlled by the number of Newton iterations.
+
+//Generic routines
+#include "generic.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for the continuation parameter
+//=====================================================================
+namespace Global_Parameters
+{
+
+ /// Continuation parameter
+ double Lambda=0.0;
+
+} // end of namespace
+
+
+
+//====== start_of_element_class========================================
+/// Element whose residual for the value in its internal Data is
+/// u^2+lambda^2-1 (circle) or u-2 lambda (straight line). The Jacobian
+/// is computed by finite differences.
+//====================================================================
+class BranchElement : public GeneralisedElement
+{
+
+public:
+
+ /// Constructor: Pass the flag that indicates if the branch is a circle
+ BranchElement(const bool& circle) : Circle(circle)
+  {
+   add_internal_data(new Data(1));
+  }
+
+ /// Residual
+ void fill_in_contribution_to_residuals(Vector<double>& residuals)
+  {
+   int local_eqn=internal_local_eqn(0,0);
+   if (local_eqn>=0)
+    {
+     double u=internal_data_pt(0)->value(0);
+     double lambda=Global_Parameters::Lambda;
+     if (Circle)
+      {
+       residuals[local_eqn]+=u*u+lambda*lambda-1.0;
+      }
+     else
+      {
+       residuals[local_eqn]+=u-2.0*lambda;
+      }
+    }
+  }
+
+private:
+
+ /// Is the branch a circle?
+ bool Circle;
+
+}; // end of element class
+
+
+
+//====== start_of_problem_class=======================================
+/// Problem that follows the branch by arc-length continuation
+//====================================================================
+class BranchProblem : public Problem
+{
+
+public:
+
+ /// Constructor: Pass the flag that indicates if the branch is a circle
+ BranchProblem(const bool& circle);
+
+ /// Destructor: Clean up
+ ~BranchProblem()
+  {
+   delete mesh_pt();
+  }
+
+ /// Take n_step arc-length steps, starting with the step ds, and
+ /// document the estimated curvature and the steps
+ void follow_branch(const unsigned& n_step, double ds,
+                    Vector<double>& curvature, Vector<double>& step);
+
+}; // end of problem class
+
+
+
+//=====start_of_constructor===============================================
+/// Constructor
+//========================================================================
+BranchProblem::BranchProblem(const bool& circle)
+{
+ mesh_pt()=new Mesh;
+ mesh_pt()->add_element_pt(new BranchElement(circle));
+
+ // Start at lambda=0
+ Global_Parameters::Lambda=0.0;
+ if (circle)
+  {
+   mesh_pt()->element_pt(0)->internal_data_pt(0)->set_value(0,1.0);
+  }
+ else
+  {
+   mesh_pt()->element_pt(0)->internal_data_pt(0)->set_value(0,0.0);
+  }
+
+ // Use the unscaled arc-length metric so that the branch is measured
+ // in the (lambda,u)-plane
+ Scale_arc_length=false;
+ Theta_squared=1.0;
+
+ // Never let the number of Newton iterations limit the step
+ Desired_newton_iterations_ds=100;
+
+ newton_solver_tolerance()=1.0e-12;
+
+ // Setup equation numbering scheme
+ assign_eqn_numbers();
+
+} // end of constructor
+
+
+
+//=====start_of_follow_branch=============================================
+/// Take n_step arc-length steps, starting with the step ds, and document
+/// the estimated curvature and the steps
+//========================================================================
+void BranchProblem::follow_branch(const unsigned& n_step, double ds,
+                                  Vector<double>& curvature,
+                                  Vector<double>& step)
+{
+ curvature.resize(n_step);
+ step.resize(n_step);
+ for (unsigned i=0;i<n_step;i++)
+  {
+   step[i]=ds;
+   ds=arc_length_step_solve(&Global_Parameters::Lambda,ds);
+   curvature[i]=continuation_curvature();
+   oomph_info << "Step " << i << ": ds " << step[i] << "; lambda "
+              << Global_Parameters::Lambda << "; estimated curvature "
+              << curvature[i] << std::endl;
+  }
+}
+
+
+
+//===== start_of_main=====================================================
+/// Driver: Check the estimated curvature and the step control on a
+/// circle and a straight line
+//========================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ // Desired angle between successive tangents
+ double desired_angle=0.1;
+
+ // Circle
+ {
+  BranchProblem problem(true);
+  problem.enable_curvature_based_arc_length_control(desired_angle);
+  unsigned n_step=30;
+  Vector<double> curvature;
+  Vector<double> step;
+  problem.follow_branch(n_step,0.02,curvature,step);
+
+  // No estimate after the first step (there is no previous tangent)
+  if (curvature[0]<0.0)
+   {
+    trace_file << "1" << std::endl;
+   }
+  else
+   {
+    trace_file << "0" << std::endl;
+   }
+
+  // Estimated curvature in the remaining steps: A step with
+  // pseudo-arc-length ds turns the tangent by asin(ds)
+  double max_curvature_error=0.0;
+  for (unsigned i=1;i<n_step;i++)
+   {
+    max_curvature_error=std::max(max_curvature_error,
+                                 std::fabs(curvature[i]-1.0));
+   }
+  if (max_curvature_error<0.01)
+   {
+    trace_file << "1" << std::endl;
+   }
+  else
+   {
+    trace_file << "0" << std::endl;
+   }
+  // The step can at most double, so the angle between successive
+  // tangents reaches the desired one after a few steps
+  double angle=curvature[n_step-1]*std::fabs(step[n_step-1]);
+  oomph_info << "Final angle: " << angle << std::endl;
+  if (std::fabs(angle-desired_angle)<1.0e-6*desired_angle)
+   {
+    trace_file << "1" << std::endl;
+   }
+  else
+   {
+    trace_file << "0" << std::endl;
+   }
+
+  // The continuation must have passed the fold at lambda=1 (after an
+  // angle of about pi/2)
+  oomph_info << "Final lambda: " << Global_Parameters::Lambda << std::endl;
+  if (Global_Parameters::Lambda<0.5)
+   {
+    trace_file << "1" << std::endl;
+   }
+  else
+   {
+    trace_file << "0" << std::endl;
+   }
+ }
+
+ // Straight line: The step grows by a factor of 1.5 in every step
+ {
+  BranchProblem problem(false);
+  problem.enable_curvature_based_arc_length_control(desired_angle);
+  unsigned n_step=5;
+  Vector<double> curvature;
+  Vector<double> step;
+  problem.follow_branch(n_step,0.02,curvature,step);
+
+  double max_curvature=0.0;
+  for (unsigned i=1;i<n_step;i++)
+   {
+    max_curvature=std::max(max_curvature,std::fabs(curvature[i]));
+   }
+  if (max_curvature<1.0e-6)
+   {
+    trace_file << "1" << std::endl;
+   }
+  else
+   {
+    trace_file << "0" << std::endl;
+   }
+  if (std::fabs(step[n_step-1]/step[n_step-2]-1.5)<1.0e-12)
+   {
+    trace_file << "1" << std::endl;
+   }
+  else
+   {
+    trace_file << "0" << std::endl;
+   }
+ }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
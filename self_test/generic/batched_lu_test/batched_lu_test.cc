@@ -0,0 +1,441 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the batched LU decomposition of small dense matrices: Compare
+//the solutions with those obtained by DenseLU for random matrices and
+//for matrices that can only be factorised with pivoting, and check
+//the signs of the determinants. Then compare the inverse mass matrix
+//times the residuals in a discontinuous Galerkin mesh when the mass
+//matrices are factorised element by element and in a batch.
+
+//Generic routines
+#include "generic.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for a simple random number generator (so that the
+/// test doesn't depend on the implementation of rand())
+//=====================================================================
+namespace RandomNumbers
+{
+
+ /// State of the generator
+ unsigned long State=12345;
+
+ /// Return a pseudo-random number between -1 and 1
+ double random_number()
+ {
+  State=(1103515245*State+12345)%2147483648UL;
+  return 2.0*double(State)/2147483648.0-1.0;
+ }
+
+} // end of namespace
+
+
+
+//====== start_of_compare_with_dense_lu================================
+/// Factorise the matrices in a batch (via both interfaces) and
+/// compare the solutions of a system with each one with those
+/// obtained by DenseLU; return the max. difference
+//=====================================================================
+double compare_with_dense_lu(const Vector<DenseDoubleMatrix*>& matrix_pt)
+{
+ const unsigned n_matrix=matrix_pt.size();
+ const unsigned n=matrix_pt[0]->nrow();
+
+ // Factorise the matrices from the vector of matrices...
+ Vector<DenseMatrix<double>*> dense_matrix_pt(n_matrix);
+ for (unsigned m=0;m<n_matrix;m++)
+  {
+   dense_matrix_pt[m]=matrix_pt[m];
+  }
+ BatchedDenseLU batched_lu;
+ batched_lu.factorise(dense_matrix_pt);
+
+ // ...and from contiguous storage
+ Vector<double> values(n*n*n_matrix);
+ for (unsigned m=0;m<n_matrix;m++)
+  {
+   for (unsigned i=0;i<n;i++)
+    {
+     for (unsigned j=0;j<n;j++)
+      {
+       values[n*n*m+n*i+j]=(*matrix_pt[m])(i,j);
+      }
+    }
+  }
+ BatchedDenseLU contiguous_batched_lu;
+ contiguous_batched_lu.factorise(n,n_matrix,&values[0]);
+
+ // Right-hand sides
+ Vector<double> all_rhs(n*n_matrix);
+ for (unsigned k=0;k<n*n_matrix;k++)
+  {
+   all_rhs[k]=RandomNumbers::random_number();
+  }
+
+ // Solve all systems at once
+ Vector<double> all_x(all_rhs);
+ contiguous_batched_lu.solve_all(&all_x[0]);
+
+ double max_diff=0.0;
+ DenseLU dense_lu;
+ for (unsigned m=0;m<n_matrix;m++)
+  {
+   Vector<double> rhs(n);
+   for (unsigned i=0;i<n;i++)
+    {
+     rhs[i]=all_rhs[n*m+i];
+    }
+
+   // Reference solution
+   Vector<double> x_ref(n);
+   dense_lu.solve(matrix_pt[m],rhs,x_ref);
+
+   // Batched solution
+   Vector<double> x(rhs);
+   batched_lu.solve(m,x);
+
+   for (unsigned i=0;i<n;i++)
+    {
+     max_diff=std::max(max_diff,std::fabs(x[i]-x_ref[i]));
+     max_diff=std::max(max_diff,std::fabs(all_x[n*m+i]-x_ref[i]));
+    }
+
+   // The two batches must agree on the signs of the determinants
+   if (batched_lu.sign_of_determinant(m)!=
+       contiguous_batched_lu.sign_of_determinant(m))
+    {
+     max_diff+=1.0;
+    }
+  }
+ return max_diff;
+}
+
+
+
+//====== start_of_element_class========================================
+/// A one-dimensional discontinuous Galerkin element with a single
+/// value per node, whose mass matrix is weighted by (1+x), so that it
+/// differs from element to element. The residuals are the projection
+/// of sin(x) onto the shape functions.
+//=====================================================================
+class WeightedMassDGElement : public virtual QElement<1,3>,
+                              public DGElement
+{
+
+public:
+
+ /// Constructor
+ WeightedMassDGElement() : QElement<1,3>(), DGElement() {}
+
+ /// One value per node
+ unsigned required_nvalue(const unsigned& n) const {return 1;}
+
+ /// No faces are needed
+ void build_all_faces() {}
+
+ /// Compute the residuals
+ void fill_in_contribution_to_residuals(Vector<double>& residuals)
+  {
+   DenseMatrix<double> dummy;
+   fill_in_generic_contribution(residuals,dummy,false);
+  }
+
+ /// Compute the residuals and the mass matrix
+ void fill_in_contribution_to_mass_matrix(Vector<double>& residuals,
+                                          DenseMatrix<double>& mass_matrix)
+  {
+   fill_in_generic_contribution(residuals,mass_matrix,true);
+  }
+
+private:
+
+ /// Compute the residuals and, if flag is true, the mass matrix
+ void fill_in_generic_contribution(Vector<double>& residuals,
+                                   DenseMatrix<double>& mass_matrix,
+                                   const bool& flag)
+  {
+   const unsigned n_node=nnode();
+   Shape psi(n_node);
+   Vector<double> s(1);
+   const unsigned n_intpt=integral_pt()->nweight();
+   for (unsigned ipt=0;ipt<n_intpt;ipt++)
+    {
+     s[0]=integral_pt()->knot(ipt,0);
+     const double w=integral_pt()->weight(ipt)*J_eulerian(s);
+     shape(s,psi);
+     const double x=interpolated_x(s,0);
+     for (unsigned l=0;l<n_node;l++)
+      {
+       const int local_eqn=nodal_local_eqn(l,0);
+       if (local_eqn>=0)
+        {
+         residuals[local_eqn]+=sin(x)*psi[l]*w;
+         if (flag)
+          {
+           for (unsigned l2=0;l2<n_node;l2++)
+            {
+             const int local_unknown=nodal_local_eqn(l2,0);
+             if (local_unknown>=0)
+              {
+               mass_matrix(local_eqn,local_unknown)+=
+                (1.0+x)*psi[l]*psi[l2]*w;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+}; // end of element class
+
+
+
+//====== start_of_mesh_class==========================================
+/// A mesh of discontinuous elements on the unit interval (each
+/// element has its own nodes)
+//====================================================================
+class WeightedMassDGMesh : public DGMesh
+{
+
+public:
+
+ /// Constructor: Pass the number of elements
+ WeightedMassDGMesh(const unsigned& n_element)
+  {
+   for (unsigned e=0;e<n_element;e++)
+    {
+     WeightedMassDGElement* el_pt=new WeightedMassDGElement;
+     Element_pt.push_back(el_pt);
+     for (unsigned l=0;l<3;l++)
+      {
+       Node* nod_pt=el_pt->construct_node(l);
+       nod_pt->x(0)=(double(e)+0.5*double(l))/double(n_element);
+       Node_pt.push_back(nod_pt);
+      }
+    }
+  }
+
+}; // end of mesh class
+
+
+
+//====== start_of_problem_class=======================================
+/// Problem that holds the mesh of discontinuous elements
+//====================================================================
+class WeightedMassDGProblem : public Problem
+{
+
+public:
+
+ /// Constructor: Pass the number of elements
+ WeightedMassDGProblem(const unsigned& n_element)
+  {
+   mesh_pt()=new WeightedMassDGMesh(n_element);
+   oomph_info << "Number of equations: " << assign_eqn_numbers()
+              << std::endl;
+   enable_discontinuous_formulation();
+  }
+
+ /// Destructor: Clean up
+ ~WeightedMassDGProblem()
+  {
+   delete mesh_pt();
+  }
+
+ /// The mesh
+ WeightedMassDGMesh* dg_mesh_pt()
+  {
+   return dynamic_cast<WeightedMassDGMesh*>(mesh_pt());
+  }
+
+}; // end of problem class
+
+
+
+//====== start_of_main================================================
+/// Driver: Test the batched LU decomposition
+//=====================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ // Random matrices
+ //----------------
+ {
+  const unsigned n=7;
+  const unsigned n_matrix=50;
+  Vector<DenseDoubleMatrix*> matrix_pt(n_matrix);
+  for (unsigned m=0;m<n_matrix;m++)
+   {
+    matrix_pt[m]=new DenseDoubleMatrix(n,n);
+    for (unsigned i=0;i<n;i++)
+     {
+      for (unsigned j=0;j<n;j++)
+       {
+        (*matrix_pt[m])(i,j)=RandomNumbers::random_number();
+       }
+     }
+   }
+  const double max_diff=compare_with_dense_lu(matrix_pt);
+  oomph_info << "Max. difference for random matrices: " << max_diff
+             << std::endl;
+  if (max_diff<1.0e-10)
+   {
+    trace_file << "1" << std::endl;
+   }
+  else
+   {
+    trace_file << "0" << std::endl;
+   }
+  for (unsigned m=0;m<n_matrix;m++)
+   {
+    delete matrix_pt[m];
+   }
+ }
+
+ // Matrices that require pivoting: Row permutations of diagonally
+ // dominant matrices with positive diagonals and zeros where the
+ // diagonal entries of the permuted matrices end up
+ //-----------------------------------------------------------------
+ {
+  const unsigned n=5;
+  const unsigned n_matrix=n;
+  Vector<DenseDoubleMatrix*> matrix_pt(n_matrix);
+
+  // Sign of the permutation that moves row i to row (i+m)%n
+  Vector<int> expected_sign(n_matrix);
+  for (unsigned m=0;m<n_matrix;m++)
+   {
+    matrix_pt[m]=new DenseDoubleMatrix(n,n,0.0);
+    for (unsigned i=0;i<n;i++)
+     {
+      for (unsigned j=0;j<n;j++)
+       {
+        if (i==j)
+         {
+          (*matrix_pt[m])((i+m)%n,j)=10.0+double(i);
+         }
+        else if ((i+m)%n!=j)
+         {
+          (*matrix_pt[m])((i+m)%n,j)=0.5*RandomNumbers::random_number();
+         }
+       }
+     }
+    // A cyclic shift by m is a product of m*(n-1) transpositions
+    expected_sign[m]=((m*(n-1))%2==0) ? 1 : -1;
+   }
+  double max_diff=compare_with_dense_lu(matrix_pt);
+
+  BatchedDenseLU batched_lu;
+  Vector<DenseMatrix<double>*> dense_matrix_pt(n_matrix);
+  for (unsigned m=0;m<n_matrix;m++)
+   {
+    dense_matrix_pt[m]=matrix_pt[m];
+   }
+  batched_lu.factorise(dense_matrix_pt);
+  unsigned n_correct_sign=0;
+  for (unsigned m=0;m<n_matrix;m++)
+   {
+    if (batched_lu.sign_of_determinant(m)==expected_sign[m])
+     {
+      n_correct_sign++;
+     }
+   }
+  oomph_info << "Max. difference for pivoted matrices: " << max_diff
+             << std::endl;
+  oomph_info << "Correct signs of the determinants: " << n_correct_sign
+             << " of " << n_matrix << std::endl;
+  if (max_diff<1.0e-10)
+   {
+    trace_file << "1" << std::endl;
+   }
+  else
+   {
+    trace_file << "0" << std::endl;
+   }
+  trace_file << n_correct_sign << std::endl;
+  for (unsigned m=0;m<n_matrix;m++)
+   {
+    delete matrix_pt[m];
+   }
+ }
+
+ // Inverse mass matrices in a discontinuous Galerkin mesh
+ //-------------------------------------------------------
+ {
+  WeightedMassDGProblem problem(20);
+
+  // Factorise the mass matrices element by element...
+  DoubleVector minv_res;
+  problem.get_inverse_mass_matrix_times_residuals(minv_res);
+
+  // ...and in a batch
+  problem.dg_mesh_pt()->pre_compute_batched_mass_matrices();
+  DoubleVector minv_res_batched;
+  problem.get_inverse_mass_matrix_times_residuals(minv_res_batched);
+
+  // Once the mass matrix reuse is enabled the elements compute their
+  // own mass matrices again
+  problem.enable_mass_matrix_reuse();
+  DoubleVector minv_res_reused;
+  problem.get_inverse_mass_matrix_times_residuals(minv_res_reused);
+
+  double max_diff=0.0;
+  const unsigned n_dof=problem.ndof();
+  for (unsigned i=0;i<n_dof;i++)
+   {
+    max_diff=std::max(max_diff,std::fabs(minv_res_batched[i]-minv_res[i]));
+    max_diff=std::max(max_diff,std::fabs(minv_res_reused[i]-minv_res[i]));
+   }
+  oomph_info << "Max. difference between the inverse mass matrices "
+             << "times the residuals: " << max_diff << std::endl;
+  if (max_diff<1.0e-12)
+   {
+    trace_file << "1" << std::endl;
+   }
+  else
+   {
+    trace_file << "0" << std::endl;
+   }
+
+  // Document a few values (approximately sin(x)/(1+x))
+  trace_file.precision(10);
+  for (unsigned i=0;i<n_dof;i+=10)
+   {
+    trace_file << minv_res_batched[i] << std::endl;
+   }
+ }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
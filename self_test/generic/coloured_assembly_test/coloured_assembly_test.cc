@@ -0,0 +1,329 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the coloured (and, if the library is built with OpenMP,
+//threaded) assembly of the residuals and the Jacobian against the
+//serial assembly, for a chain of nonlinear springs that is split
+//between two sub-meshes. The residuals are also documented to full
+//precision so that validate.sh can check that they don't depend on the
+//number of threads.
+
+//Generic routines
+#include "generic.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for the parameters of the problem
+//=====================================================================
+namespace GlobalParameters
+{
+
+ /// Stiffness of the springs
+ double K=1.0;
+
+ /// Coefficient of the cubic term in the springs' force
+ double C=0.5;
+
+ /// Load on the nodes
+ double F=0.01;
+
+} // end of namespace
+
+
+
+//====== start_of_element_class========================================
+/// Nonlinear spring that connects two nodal Data (stored as external
+/// Data). The force is K d + C d^3 where d is the difference between
+/// the two values; in addition, the element applies half the nodal
+/// load F to each of its nodes. The Jacobian is computed by finite
+/// differences, so the assembly perturbs the (shared) nodal Data.
+//=====================================================================
+class NonlinearSpringElement : public GeneralisedElement
+{
+
+public:
+
+ /// Constructor: Pass the pointers to the nodal Data at the two ends
+ NonlinearSpringElement(Data* const& left_data_pt,
+                        Data* const& right_data_pt)
+  {
+   add_external_data(left_data_pt);
+   add_external_data(right_data_pt);
+  }
+
+ /// Compute the residuals
+ void fill_in_contribution_to_residuals(Vector<double>& residuals)
+  {
+   const double d=external_data_pt(1)->value(0)-external_data_pt(0)->value(0);
+   const double force=GlobalParameters::K*d+GlobalParameters::C*d*d*d;
+   for (unsigned j=0;j<2;j++)
+    {
+     const int local_eqn=external_local_eqn(j,0);
+     if (local_eqn>=0)
+      {
+       const double sign=(j==0) ? -1.0 : 1.0;
+       residuals[local_eqn]+=sign*force-0.5*GlobalParameters::F;
+      }
+    }
+  }
+
+}; // end of element class
+
+
+
+//====== start_of_problem_class=======================================
+/// Chain of nonlinear springs; the nodal Data are global Data, the
+/// first one is pinned. The first half of the springs is stored in
+/// the first sub-mesh, the second half in the second one.
+//====================================================================
+class SpringChainProblem : public Problem
+{
+
+public:
+
+ /// Constructor: Pass the number of springs
+ SpringChainProblem(const unsigned& n_spring)
+  {
+   // Create the nodal Data
+   for (unsigned i=0;i<=n_spring;i++)
+    {
+     add_global_data(new Data(1));
+    }
+   global_data_pt(0)->pin(0);
+
+   // Create the springs
+   for (unsigned m=0;m<2;m++)
+    {
+     Spring_mesh_pt[m]=new Mesh;
+    }
+   for (unsigned i=0;i<n_spring;i++)
+    {
+     const unsigned m=(2*i<n_spring) ? 0 : 1;
+     Spring_mesh_pt[m]->add_element_pt(
+      new NonlinearSpringElement(global_data_pt(i),global_data_pt(i+1)));
+    }
+   for (unsigned m=0;m<2;m++)
+    {
+     add_sub_mesh(Spring_mesh_pt[m]);
+    }
+   build_global_mesh();
+
+   oomph_info << "Number of equations: " << assign_eqn_numbers()
+              << std::endl;
+
+   // Keep the output short
+   Shut_up_in_newton_solve=true;
+   linear_solver_pt()->disable_doc_time();
+  }
+
+ /// Destructor: Clean up (the global mesh is deleted by the
+ /// Problem's destructor)
+ ~SpringChainProblem()
+  {
+   for (unsigned m=0;m<2;m++)
+    {
+     const unsigned n_element=Spring_mesh_pt[m]->nelement();
+     for (unsigned e=0;e<n_element;e++)
+      {
+       delete Spring_mesh_pt[m]->element_pt(e);
+      }
+     Spring_mesh_pt[m]->flush_element_and_node_storage();
+     delete Spring_mesh_pt[m];
+    }
+   const unsigned n_data=nglobal_data();
+   for (unsigned i=0;i<n_data;i++)
+    {
+     delete global_data_pt(i);
+    }
+  }
+
+ /// Assemble the residuals and the Jacobian
+ void assemble(DoubleVector& residuals, CRDoubleMatrix& jacobian)
+  {
+   get_jacobian(residuals,jacobian);
+  }
+
+private:
+
+ /// Pointers to the two sub-meshes
+ Mesh* Spring_mesh_pt[2];
+
+}; // end of problem class
+
+
+
+//===== start_of_max_difference=======================================
+/// Maximum difference between the entries of two residual vectors and
+/// two Jacobians (which must have the same sparsity pattern; the
+/// entries within each row may be stored in different orders)
+//====================================================================
+double max_difference(DoubleVector& residuals_1, CRDoubleMatrix& jacobian_1,
+                      DoubleVector& residuals_2, CRDoubleMatrix& jacobian_2)
+{
+ double max_diff=0.0;
+ const unsigned n_row=residuals_1.nrow();
+ for (unsigned i=0;i<n_row;i++)
+  {
+   max_diff=std::max(max_diff,std::fabs(residuals_1[i]-residuals_2[i]));
+  }
+ const unsigned n_nz=jacobian_1.nnz();
+ if (jacobian_2.nnz()!=n_nz)
+  {
+   oomph_info << "Jacobians have different numbers of nonzeros: "
+              << n_nz << " " << jacobian_2.nnz() << std::endl;
+   return 1.0;
+  }
+ jacobian_1.sort_entries();
+ jacobian_2.sort_entries();
+ for (unsigned k=0;k<n_nz;k++)
+  {
+   if (jacobian_1.column_index()[k]!=jacobian_2.column_index()[k])
+    {
+     oomph_info << "Jacobians have different sparsity patterns"
+                << std::endl;
+     return 1.0;
+    }
+   max_diff=std::max(max_diff,std::fabs(jacobian_1.value()[k]-
+                                        jacobian_2.value()[k]));
+  }
+ return max_diff;
+}
+
+
+
+//====== start_of_main================================================
+/// Driver: Compare the coloured assembly with the serial one and
+/// solve the problem with both
+//=====================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+ trace_file.precision(10);
+
+ // Number of springs
+ const unsigned n_spring=100;
+
+ SpringChainProblem problem(n_spring);
+
+ // Start from a non-trivial state
+ const unsigned n_dof=problem.ndof();
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   problem.dof(i)=0.01*double(i+1)*sin(double(i));
+  }
+
+ // Serial assembly
+ DoubleVector residuals_serial;
+ CRDoubleMatrix jacobian_serial;
+ problem.assemble(residuals_serial,jacobian_serial);
+
+ // Coloured assembly
+ problem.enable_coloured_assembly();
+ DoubleVector residuals_coloured;
+ CRDoubleMatrix jacobian_coloured;
+ problem.assemble(residuals_coloured,jacobian_coloured);
+ DoubleVector residuals_only;
+ problem.get_residuals(residuals_only);
+
+ // Document the residuals to full precision: Runs with different
+ // numbers of threads must produce identical files
+ ofstream residuals_file("RESLT/coloured_residuals.dat");
+ residuals_file.precision(17);
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   residuals_file << residuals_only[i] << std::endl;
+  }
+ residuals_file.close();
+
+ oomph_info << "Number of colours: " << problem.ncolour_for_assembly()
+            << std::endl;
+ trace_file << problem.ncolour_for_assembly() << std::endl;
+
+ // Differences should be at the level of roundoff (the contributions
+ // are added in a different order)
+ double max_diff=max_difference(residuals_serial,jacobian_serial,
+                                residuals_coloured,jacobian_coloured);
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   max_diff=std::max(max_diff,
+                     std::fabs(residuals_only[i]-residuals_coloured[i]));
+  }
+ oomph_info << "Max. difference between serial and coloured assembly: "
+            << max_diff << std::endl;
+ if (max_diff<1.0e-12)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ // Solve with the coloured assembly...
+ problem.newton_solve();
+ Vector<double> solution_coloured(n_dof);
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   solution_coloured[i]=problem.dof(i);
+  }
+
+ // ...and, from the same initial guess, with the serial one
+ problem.disable_coloured_assembly();
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   problem.dof(i)=0.01*double(i+1)*sin(double(i));
+  }
+ problem.newton_solve();
+
+ max_diff=0.0;
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   max_diff=std::max(max_diff,std::fabs(problem.dof(i)-solution_coloured[i]));
+  }
+ oomph_info << "Max. difference between solutions: " << max_diff
+            << std::endl;
+ if (max_diff<1.0e-10)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ // Document every tenth displacement
+ for (unsigned i=0;i<n_dof;i+=10)
+  {
+   trace_file << solution_coloured[i] << std::endl;
+  }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
@@ -0,0 +1,80 @@
+#! /bin/sh
+
+# Get the OOPMH-LIB root directory from a makefile
+OOMPH_ROOT_DIR=$(make -s --no-print-directory print-top_builddir)
+
+
+#Set the number of tests to be checked
+NUM_TESTS=2
+
+
+# Setup validation directory
+#---------------------------
+touch Validation
+rm -r -f Validation
+mkdir Validation
+
+# Validation for the coloured assembly of residuals and Jacobian
+#--------------------------------------------------------------
+cd Validation
+
+echo "Running coloured assembly test "
+mkdir RESLT
+OMP_NUM_THREADS=1 ../coloured_assembly_test > OUTPUT_coloured_assembly_test
+echo "done"
+echo " " >> validation.log
+echo "Coloured assembly test" >> validation.log
+echo "----------------------" >> validation.log
+echo " " >> validation.log
+echo "Validation directory: " >> validation.log
+echo " " >> validation.log
+echo "  " `pwd` >> validation.log
+echo " " >> validation.log
+cat RESLT/trace.dat > coloured_assembly_results.dat
+
+if test "$1" = "no_fpdiff"; then
+  echo "dummy [OK] -- Can't run fpdiff.py because we don't have python or validata" >> validation.log
+else
+../../../../bin/fpdiff.py \
+    ../validata/coloured_assembly_results.dat.gz   \
+    coloured_assembly_results.dat  >> validation.log
+fi
+
+# Repeat the run with two threads (if the library is built with OpenMP):
+# The coloured assembly must produce bitwise-identical residuals
+cat RESLT/coloured_residuals.dat > coloured_residuals_one_thread.dat
+rm -r -f RESLT
+mkdir RESLT
+echo "Running coloured assembly test with two threads "
+OMP_NUM_THREADS=2 ../coloured_assembly_test \
+ > OUTPUT_coloured_assembly_test_two_threads
+echo "done"
+echo " " >> validation.log
+if cmp -s coloured_residuals_one_thread.dat RESLT/coloured_residuals.dat; then
+      echo "   [OK] -- for identical residuals with one and two threads" >> validation.log
+else
+      echo "   [FAILED] -- residuals differ between one and two threads" >> validation.log
+fi
+
+
+# Append output to global validation log file
+#--------------------------------------------
+cat validation.log >> ../../../../validation.log
+
+
+cd ..
+
+
+
+#######################################################################
+
+
+#Check that we get the correct number of OKs
+# validate_ok_count will exit with status
+# 0 if all tests has passed.
+# 1 if some tests failed.
+# 2 if there are more 'OK' than expected.
+. $OOMPH_ROOT_DIR/bin/validate_ok_count
+
+# Never get here
+exit 10
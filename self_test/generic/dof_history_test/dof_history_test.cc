@@ -0,0 +1,279 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test that Problem::dof_pt(t,i) addresses the history values of the
+//dofs through the history index of the Data that stores them: Store
+//the history values of global Data, nodal values, nodal positions,
+//internal Data and spine heights in a ring buffer, rotate it, and
+//compare the values addressed by the problem with those of the Data.
+
+//Generic routines
+#include "generic.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//====== start_of_element_class========================================
+/// An element that only has internal Data
+//====================================================================
+class DofHistoryElement : public GeneralisedElement
+{
+
+public:
+
+ /// Constructor: Pass the timestepper for the internal Data
+ DofHistoryElement(TimeStepper* const& time_stepper_pt)
+  {
+   add_internal_data(new Data(time_stepper_pt,3));
+  }
+
+}; // end of element class
+
+
+
+//====== start_of_mesh_class==========================================
+/// A mesh that contains a few nodes and solid nodes, an element with
+/// internal Data and a spine
+//====================================================================
+class DofHistoryMesh : public SpineMesh
+{
+
+public:
+
+ /// Constructor: Pass the timestepper
+ DofHistoryMesh(TimeStepper* const& time_stepper_pt)
+  {
+   // Nodes with two values
+   for (unsigned n=0;n<2;n++)
+    {
+     Node_pt.push_back(new Node(time_stepper_pt,1,1,2));
+    }
+
+   // A solid node with one value and a variable position
+   SolidNode* solid_node_pt=new SolidNode(time_stepper_pt,1,1,1,1,1);
+   solid_node_pt->unpin_position(0);
+   Node_pt.push_back(solid_node_pt);
+
+   // An element with internal Data
+   Element_pt.push_back(new DofHistoryElement(time_stepper_pt));
+
+   // A spine whose height evolves in time
+   Spine* spine_pt=new Spine(1.0);
+   spine_pt->spine_height_pt()->set_time_stepper(time_stepper_pt,false);
+   add_spine_pt(spine_pt);
+  }
+
+ /// There are no spine nodes to update
+ void spine_node_update(SpineNode* spine_node_pt) {}
+
+}; // end of mesh class
+
+
+
+//====== start_of_problem_class=======================================
+/// Problem whose history values are stored in a ring buffer
+//====================================================================
+class DofHistoryProblem : public Problem
+{
+
+public:
+
+ /// Constructor
+ DofHistoryProblem();
+
+ /// Destructor: Clean up
+ ~DofHistoryProblem()
+  {
+   delete mesh_pt();
+   delete Global_data_pt;
+   delete time_stepper_pt();
+  }
+
+ /// Give all history values distinct values
+ void set_history_values();
+
+ /// Compare the history values addressed by dof_pt(t,i) with those
+ /// of the Data that store the dofs; return the max. difference
+ double compare_history_values();
+
+private:
+
+ /// Collect all Data that store dofs
+ void get_all_data(Vector<Data*>& all_data_pt);
+
+ /// Global Data
+ Data* Global_data_pt;
+
+}; // end of problem class
+
+
+
+//=====start_of_constructor===============================================
+/// Constructor
+//========================================================================
+DofHistoryProblem::DofHistoryProblem()
+{
+ // Store the history values of the BDF timestepper in a ring buffer
+ add_time_stepper_pt(new BDF<2>);
+ time_stepper_pt()->enable_indexed_history();
+
+ mesh_pt()=new DofHistoryMesh(time_stepper_pt());
+
+ Global_data_pt=new Data(time_stepper_pt(),2);
+ add_global_data(Global_data_pt);
+
+ // Setup equation numbering scheme
+ oomph_info << "Number of equations: " << assign_eqn_numbers() << std::endl;
+
+} // end of constructor
+
+
+
+//=====start_of_get_all_data==============================================
+/// Collect all Data that store dofs
+//========================================================================
+void DofHistoryProblem::get_all_data(Vector<Data*>& all_data_pt)
+{
+ all_data_pt.clear();
+ all_data_pt.push_back(Global_data_pt);
+ unsigned n_node=mesh_pt()->nnode();
+ for (unsigned n=0;n<n_node;n++)
+  {
+   Node* nod_pt=mesh_pt()->node_pt(n);
+   all_data_pt.push_back(nod_pt);
+   SolidNode* solid_nod_pt=dynamic_cast<SolidNode*>(nod_pt);
+   if (solid_nod_pt!=0)
+    {
+     all_data_pt.push_back(solid_nod_pt->variable_position_pt());
+    }
+  }
+ all_data_pt.push_back(mesh_pt()->element_pt(0)->internal_data_pt(0));
+ all_data_pt.push_back(dynamic_cast<DofHistoryMesh*>(mesh_pt())->
+                       spine_pt(0)->spine_height_pt());
+}
+
+
+
+//=====start_of_set_history_values========================================
+/// Give all history values distinct values
+//========================================================================
+void DofHistoryProblem::set_history_values()
+{
+ Vector<Data*> all_data_pt;
+ get_all_data(all_data_pt);
+ unsigned n_data=all_data_pt.size();
+ unsigned n_tstorage=time_stepper_pt()->ntstorage();
+ for (unsigned d=0;d<n_data;d++)
+  {
+   unsigned n_value=all_data_pt[d]->nvalue();
+   for (unsigned j=0;j<n_value;j++)
+    {
+     for (unsigned t=0;t<n_tstorage;t++)
+      {
+       all_data_pt[d]->set_value(t,j,double(100*d+10*j+t));
+      }
+    }
+  }
+}
+
+
+
+//=====start_of_compare_history_values====================================
+/// Compare the history values addressed by dof_pt(t,i) with those
+/// of the Data that store the dofs; return the max. difference
+//========================================================================
+double DofHistoryProblem::compare_history_values()
+{
+ Vector<Data*> all_data_pt;
+ get_all_data(all_data_pt);
+ unsigned n_data=all_data_pt.size();
+ unsigned n_tstorage=time_stepper_pt()->ntstorage();
+ unsigned n_dof_checked=0;
+ double max_diff=0.0;
+ for (unsigned d=0;d<n_data;d++)
+  {
+   unsigned n_value=all_data_pt[d]->nvalue();
+   for (unsigned j=0;j<n_value;j++)
+    {
+     long eqn_number=all_data_pt[d]->eqn_number(j);
+     if (eqn_number>=0)
+      {
+       n_dof_checked++;
+       for (unsigned t=0;t<n_tstorage;t++)
+        {
+         max_diff=std::max(max_diff,
+                           std::fabs(*dof_pt(t,eqn_number)-
+                                     all_data_pt[d]->value(t,j)));
+        }
+      }
+    }
+  }
+
+ // All dofs must have been checked
+ if (n_dof_checked!=ndof())
+  {
+   max_diff+=1.0;
+  }
+ return max_diff;
+}
+
+
+
+//===== start_of_main=====================================================
+/// Driver: Rotate the ring buffer of the history values and compare the
+/// history values addressed by the problem with those of the Data.
+//========================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ DofHistoryProblem problem;
+ trace_file << problem.ndof() << std::endl;
+ problem.set_history_values();
+
+ // Check the addresses for every rotation of the ring
+ unsigned n_rotation=problem.time_stepper_pt()->nprev_values()+1;
+ for (unsigned r=0;r<n_rotation;r++)
+  {
+   double max_diff=problem.compare_history_values();
+   oomph_info << "Max. difference after " << r << " rotations: "
+              << max_diff << std::endl;
+   if (max_diff==0.0)
+    {
+     trace_file << "1" << std::endl;
+    }
+   else
+    {
+     trace_file << "0" << std::endl;
+    }
+   problem.time_stepper_pt()->rotate_history();
+  }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
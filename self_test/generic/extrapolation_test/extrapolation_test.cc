@@ -0,0 +1,295 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the extrapolation of the initial guess for the Newton iteration
+//from the history values: If the history values (at non-uniformly
+//spaced times) are samples of a polynomial of degree d, the extrapolating
+//polynomial of degree d (interpolating or least-squares) must reproduce
+//the polynomial's value at the new time to within roundoff, for global
+//Data, nodal values, nodal positions and internal Data. Pinned values
+//must not be changed.
+
+//Generic routines
+#include "generic.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for the polynomial that is sampled by the history values
+//=====================================================================
+namespace Polynomial
+{
+
+ /// Degree of the polynomial
+ unsigned Degree=3;
+
+ /// Value of the polynomial (which depends on the index of the Data d
+ /// and the value j) at time t
+ double value(const unsigned& d, const unsigned& j, const double& t)
+ {
+  double p=0.0;
+  double t_power=1.0;
+  for (unsigned k=0;k<=Degree;k++)
+   {
+    p+=cos(double(1+d+3*j+7*k))*t_power;
+    t_power*=t;
+   }
+  return p;
+ }
+
+} // end of namespace
+
+
+
+//====== start_of_element_class========================================
+/// An element that only has internal Data
+//====================================================================
+class ExtrapolationElement : public GeneralisedElement
+{
+
+public:
+
+ /// Constructor: Pass the timestepper for the internal Data
+ ExtrapolationElement(TimeStepper* const& time_stepper_pt)
+  {
+   add_internal_data(new Data(time_stepper_pt,2));
+  }
+
+}; // end of element class
+
+
+
+//====== start_of_problem_class=======================================
+/// Problem that contains a few Data objects
+//====================================================================
+class ExtrapolationProblem : public Problem
+{
+
+public:
+
+ /// Constructor
+ ExtrapolationProblem();
+
+ /// Destructor: Clean up
+ ~ExtrapolationProblem()
+  {
+   delete mesh_pt();
+   delete Global_data_pt;
+   delete time_stepper_pt();
+  }
+
+ /// Set the history values to the polynomial at the (non-uniformly
+ /// spaced) previous times, advance the time and set the present
+ /// values to nonsense
+ void setup_history();
+
+ /// Extrapolate and return the max. error in the unknowns; the return
+ /// value is negative if a pinned value has been changed.
+ double extrapolation_error();
+
+private:
+
+ /// Collect all Data
+ void get_all_data(Vector<Data*>& all_data_pt);
+
+ /// Global Data
+ Data* Global_data_pt;
+
+}; // end of problem class
+
+
+
+//=====start_of_constructor===============================================
+/// Constructor
+//========================================================================
+ExtrapolationProblem::ExtrapolationProblem()
+{
+ // Timestepper that stores four previous values
+ add_time_stepper_pt(new VariableOrderBDF(4));
+
+ mesh_pt()=new Mesh;
+
+ // Nodes with two values
+ for (unsigned n=0;n<2;n++)
+  {
+   mesh_pt()->add_node_pt(new Node(time_stepper_pt(),1,1,2));
+  }
+
+ // A solid node with an unknown position
+ SolidNode* solid_node_pt=new SolidNode(time_stepper_pt(),1,1,1,1,1);
+ solid_node_pt->unpin_position(0);
+ mesh_pt()->add_node_pt(solid_node_pt);
+
+ // An element with internal Data
+ mesh_pt()->add_element_pt(new ExtrapolationElement(time_stepper_pt()));
+
+ // Global Data; the second value is pinned
+ Global_data_pt=new Data(time_stepper_pt(),2);
+ Global_data_pt->pin(1);
+ add_global_data(Global_data_pt);
+
+ // Setup equation numbering scheme
+ oomph_info << "Number of equations: " << assign_eqn_numbers() << std::endl;
+
+} // end of constructor
+
+
+
+//=====start_of_get_all_data==============================================
+/// Collect all Data
+//========================================================================
+void ExtrapolationProblem::get_all_data(Vector<Data*>& all_data_pt)
+{
+ all_data_pt.clear();
+ all_data_pt.push_back(Global_data_pt);
+ unsigned n_node=mesh_pt()->nnode();
+ for (unsigned n=0;n<n_node;n++)
+  {
+   Node* nod_pt=mesh_pt()->node_pt(n);
+   all_data_pt.push_back(nod_pt);
+   SolidNode* solid_nod_pt=dynamic_cast<SolidNode*>(nod_pt);
+   if (solid_nod_pt!=0)
+    {
+     all_data_pt.push_back(solid_nod_pt->variable_position_pt());
+    }
+  }
+ all_data_pt.push_back(mesh_pt()->element_pt(0)->internal_data_pt(0));
+}
+
+
+
+//=====start_of_setup_history=============================================
+/// Set the history values to the polynomial at the (non-uniformly
+/// spaced) previous times, advance the time and set the present values
+/// to nonsense
+//========================================================================
+void ExtrapolationProblem::setup_history()
+{
+ // Timesteps: dt(0) is the present one
+ time_pt()->dt(0)=0.1;
+ time_pt()->dt(1)=0.13;
+ time_pt()->dt(2)=0.07;
+ time_pt()->dt(3)=0.11;
+ time_pt()->time()=1.0;
+
+ Vector<Data*> all_data_pt;
+ get_all_data(all_data_pt);
+ unsigned n_data=all_data_pt.size();
+ unsigned n_prev=time_stepper_pt()->nprev_values();
+ for (unsigned d=0;d<n_data;d++)
+  {
+   unsigned n_value=all_data_pt[d]->nvalue();
+   for (unsigned j=0;j<n_value;j++)
+    {
+     all_data_pt[d]->set_value(0,j,99.0);
+     for (unsigned t=1;t<=n_prev;t++)
+      {
+       all_data_pt[d]->set_value(
+        t,j,Polynomial::value(d,j,time_pt()->time(t)));
+      }
+    }
+  }
+}
+
+
+
+//=====start_of_extrapolation_error=======================================
+/// Extrapolate and return the max. error in the unknowns; the return
+/// value is negative if a pinned value has been changed.
+//========================================================================
+double ExtrapolationProblem::extrapolation_error()
+{
+ extrapolate_initial_guess();
+
+ Vector<Data*> all_data_pt;
+ get_all_data(all_data_pt);
+ unsigned n_data=all_data_pt.size();
+ double max_error=0.0;
+ for (unsigned d=0;d<n_data;d++)
+  {
+   unsigned n_value=all_data_pt[d]->nvalue();
+   for (unsigned j=0;j<n_value;j++)
+    {
+     if (all_data_pt[d]->is_pinned(j))
+      {
+       if (all_data_pt[d]->value(j)!=99.0)
+        {
+         return -1.0;
+        }
+      }
+     else
+      {
+       max_error=std::max(max_error,
+                          std::fabs(all_data_pt[d]->value(j)-
+                                    Polynomial::value(d,j,
+                                                      time_pt()->time())));
+      }
+    }
+  }
+ return max_error;
+}
+
+
+
+//===== start_of_main=====================================================
+/// Driver: Extrapolate polynomial time histories with polynomials of the
+/// same degree
+//========================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ ExtrapolationProblem problem;
+
+ // Degree of the polynomial and number of previous values used by the
+ // extrapolation (zero: the polynomial interpolates degree+1 values)
+ const unsigned n_case=5;
+ unsigned degree[n_case]={1,2,3,1,2};
+ unsigned n_prev_value[n_case]={0,0,0,4,4};
+ for (unsigned i=0;i<n_case;i++)
+  {
+   Polynomial::Degree=degree[i];
+   problem.enable_extrapolated_initial_guess(degree[i],n_prev_value[i]);
+   problem.setup_history();
+   double error=problem.extrapolation_error();
+   oomph_info << "Degree " << degree[i] << " with " << n_prev_value[i]
+              << " previous values: error " << error << std::endl;
+   if ((error>=0.0) && (error<1.0e-10))
+    {
+     trace_file << "1" << std::endl;
+    }
+   else
+    {
+     trace_file << "0" << std::endl;
+    }
+  }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
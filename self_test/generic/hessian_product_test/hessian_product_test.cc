@@ -0,0 +1,333 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the threaded computation of the analytic Hessian-vector products
+//for a chain of nonlinear springs: The products must be bitwise
+//identical to the ones computed serially, and agree with the ones
+//computed by finite differences.
+
+//Generic routines
+#include "generic.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for the parameters of the problem
+//=====================================================================
+namespace GlobalParameters
+{
+
+ /// Stiffness of the springs
+ double K=1.0;
+
+ /// Coefficient of the cubic term in the springs' force
+ double C=0.5;
+
+} // end of namespace
+
+
+
+//====== start_of_element_class========================================
+/// Nonlinear spring that connects two nodal Data (stored as external
+/// Data). The force is K d + C d^3 where d is the difference between
+/// the two values. The Jacobian and the Hessian-vector products are
+/// computed analytically.
+//=====================================================================
+class NonlinearSpringElement : public GeneralisedElement
+{
+
+public:
+
+ /// Constructor: Pass the pointers to the nodal Data at the two ends
+ NonlinearSpringElement(Data* const& left_data_pt,
+                        Data* const& right_data_pt)
+  {
+   add_external_data(left_data_pt);
+   add_external_data(right_data_pt);
+  }
+
+ /// Compute the residuals
+ void fill_in_contribution_to_residuals(Vector<double>& residuals)
+  {
+   const double d=extension();
+   const double force=GlobalParameters::K*d+GlobalParameters::C*d*d*d;
+   for (unsigned j=0;j<2;j++)
+    {
+     const int local_eqn=external_local_eqn(j,0);
+     if (local_eqn>=0)
+      {
+       residuals[local_eqn]+=sign(j)*force;
+      }
+    }
+  }
+
+ /// Compute the residuals and the Jacobian
+ void fill_in_contribution_to_jacobian(Vector<double>& residuals,
+                                       DenseMatrix<double>& jacobian)
+  {
+   fill_in_contribution_to_residuals(residuals);
+   const double d=extension();
+   const double stiffness=GlobalParameters::K+3.0*GlobalParameters::C*d*d;
+   for (unsigned j=0;j<2;j++)
+    {
+     const int local_eqn=external_local_eqn(j,0);
+     if (local_eqn>=0)
+      {
+       for (unsigned k=0;k<2;k++)
+        {
+         const int local_unknown=external_local_eqn(k,0);
+         if (local_unknown>=0)
+          {
+           jacobian(local_eqn,local_unknown)+=sign(j)*sign(k)*stiffness;
+          }
+        }
+      }
+    }
+  }
+
+ /// Compute the products of the Hessian with Y and the vectors C
+ void fill_in_contribution_to_hessian_vector_products(
+  Vector<double> const& Y, DenseMatrix<double> const& C,
+  DenseMatrix<double>& product)
+  {
+   // Hessian: d^2 r_j/du_k du_l = sign(j) sign(k) sign(l) 6 C d
+   const double d=extension();
+   const double curvature=6.0*GlobalParameters::C*d;
+   double sign_dot_y=0.0;
+   for (unsigned k=0;k<2;k++)
+    {
+     const int local_unknown=external_local_eqn(k,0);
+     if (local_unknown>=0)
+      {
+       sign_dot_y+=sign(k)*Y[local_unknown];
+      }
+    }
+   const unsigned n_vec=C.nrow();
+   for (unsigned i=0;i<n_vec;i++)
+    {
+     double sign_dot_c=0.0;
+     for (unsigned l=0;l<2;l++)
+      {
+       const int local_unknown=external_local_eqn(l,0);
+       if (local_unknown>=0)
+        {
+         sign_dot_c+=sign(l)*C(i,local_unknown);
+        }
+      }
+     for (unsigned j=0;j<2;j++)
+      {
+       const int local_eqn=external_local_eqn(j,0);
+       if (local_eqn>=0)
+        {
+         product(i,local_eqn)+=sign(j)*curvature*sign_dot_y*sign_dot_c;
+        }
+      }
+    }
+  }
+
+private:
+
+ /// Extension of the spring
+ double extension()
+  {
+   return external_data_pt(1)->value(0)-external_data_pt(0)->value(0);
+  }
+
+ /// Sign of the force on the j-th end
+ double sign(const unsigned& j)
+  {
+   return (j==0) ? -1.0 : 1.0;
+  }
+
+}; // end of element class
+
+
+
+//====== start_of_problem_class=======================================
+/// Chain of nonlinear springs; the nodal Data are global Data, the
+/// first one is pinned.
+//====================================================================
+class SpringChainProblem : public Problem
+{
+
+public:
+
+ /// Constructor: Pass the number of springs
+ SpringChainProblem(const unsigned& n_spring)
+  {
+   // Create the nodal Data
+   for (unsigned i=0;i<=n_spring;i++)
+    {
+     add_global_data(new Data(1));
+    }
+   global_data_pt(0)->pin(0);
+
+   // Create the springs
+   mesh_pt()=new Mesh;
+   for (unsigned i=0;i<n_spring;i++)
+    {
+     mesh_pt()->add_element_pt(
+      new NonlinearSpringElement(global_data_pt(i),global_data_pt(i+1)));
+    }
+
+   oomph_info << "Number of equations: " << assign_eqn_numbers()
+              << std::endl;
+  }
+
+ /// Destructor: Clean up
+ ~SpringChainProblem()
+  {
+   delete mesh_pt();
+   const unsigned n_data=nglobal_data();
+   for (unsigned i=0;i<n_data;i++)
+    {
+     delete global_data_pt(i);
+    }
+  }
+
+}; // end of problem class
+
+
+
+//===== start_of_max_difference=======================================
+/// Maximum difference between the entries of two sets of vectors
+//====================================================================
+double max_difference(Vector<DoubleVectorWithHaloEntries>& product_1,
+                      Vector<DoubleVectorWithHaloEntries>& product_2)
+{
+ double max_diff=0.0;
+ const unsigned n_vec=product_1.size();
+ for (unsigned i=0;i<n_vec;i++)
+  {
+   const unsigned n_row=product_1[i].nrow_local();
+   for (unsigned n=0;n<n_row;n++)
+    {
+     max_diff=std::max(max_diff,std::fabs(product_1[i][n]-product_2[i][n]));
+    }
+  }
+ return max_diff;
+}
+
+
+
+//====== start_of_main================================================
+/// Driver: Compare the threaded, the serial and the finite-difference
+/// Hessian-vector products
+//=====================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ // Number of springs: More than the number of elements that are
+ // processed in one go
+ const unsigned n_spring=3000;
+
+ SpringChainProblem problem(n_spring);
+
+ // Start from a non-trivial state
+ const unsigned n_dof=problem.ndof();
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   problem.dof(i)=0.01*double(i+1)*sin(double(i));
+  }
+
+ // Vectors Y and C
+ LinearAlgebraDistribution dist(problem.communicator_pt(),n_dof,false);
+ DoubleVectorWithHaloEntries Y(&dist);
+ const unsigned n_vec=2;
+ Vector<DoubleVectorWithHaloEntries> C(n_vec);
+ for (unsigned i=0;i<n_vec;i++)
+  {
+   C[i].build(&dist);
+  }
+ for (unsigned n=0;n<n_dof;n++)
+  {
+   Y[n]=cos(double(n));
+   for (unsigned i=0;i<n_vec;i++)
+    {
+     C[i][n]=sin(double((i+2)*n));
+    }
+  }
+
+ // Serial analytic products
+ problem.set_analytic_hessian_products();
+ Vector<DoubleVectorWithHaloEntries> product_serial(n_vec);
+ problem.get_hessian_vector_products(Y,C,product_serial);
+
+ // Threaded analytic products
+ problem.enable_threaded_hessian_products();
+ Vector<DoubleVectorWithHaloEntries> product_threaded(n_vec);
+ problem.get_hessian_vector_products(Y,C,product_threaded);
+ problem.disable_threaded_hessian_products();
+
+ // Finite-difference products
+ problem.unset_analytic_hessian_products();
+ Vector<DoubleVectorWithHaloEntries> product_fd(n_vec);
+ problem.get_hessian_vector_products(Y,C,product_fd);
+
+ double max_product=0.0;
+ for (unsigned i=0;i<n_vec;i++)
+  {
+   for (unsigned n=0;n<n_dof;n++)
+    {
+     max_product=std::max(max_product,std::fabs(product_serial[i][n]));
+    }
+  }
+ double threaded_diff=max_difference(product_threaded,product_serial);
+ double fd_diff=max_difference(product_fd,product_serial);
+ oomph_info << "Max. entry of the products: " << max_product << std::endl;
+ oomph_info << "Max. difference between threaded and serial products: "
+            << threaded_diff << std::endl;
+ oomph_info << "Max. difference between finite-difference and analytic "
+            << "products: " << fd_diff << std::endl;
+
+ // Threaded and serial products must be bitwise identical
+ if (threaded_diff==0.0)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ // Finite-difference products must agree to within the finite-difference
+ // error
+ if (fd_diff<1.0e-5*max_product)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
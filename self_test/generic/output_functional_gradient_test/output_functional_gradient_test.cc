@@ -0,0 +1,251 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented, 
+//LIC// multi-physics finite-element library, available 
+//LIC// at http://www.oomph-lib.org.
+//LIC// 
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC// 
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC// 
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC// 
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC// 
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC// 
+//LIC//====================================================================
+//Driver for a simple 2D poisson problem
+//Test the adjoint-based gradient of an output functional against
+//finite differences, with and without re-use of the Jacobian
+
+//Generic routines
+#include "generic.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for the parameters of the problem
+//=====================================================================
+namespace GlobalParameters
+{
+
+ /// Coefficient of the cubic term
+ double A=1.0;
+
+ /// Amplitude of the forcing
+ double B=1.0;
+
+ /// Coefficient of the (non-symmetric) first-difference term
+ double C=0.7;
+
+} // end of namespace
+
+
+
+//====== start_of_element_class========================================
+/// Element that represents the discrete nonlinear system
+/// 2 u_i - u_{i-1} - u_{i+1} + C (u_{i+1}-u_{i-1})/2 + A u_i^3 
+///  = B sin(i+1), i=0,...,n-1, with u_{-1}=u_n=0. 
+/// The unknowns are stored as internal Data; the Jacobian is
+/// computed by finite differences.
+//=====================================================================
+class NonlinearAlgebraicElement : public GeneralisedElement
+{
+
+public:
+
+ /// Constructor: Pass the number of unknowns
+ NonlinearAlgebraicElement(const unsigned& n)
+  {
+   add_internal_data(new Data(n));
+  }
+
+ /// Compute the residuals
+ void fill_in_contribution_to_residuals(Vector<double>& residuals)
+  {
+   Data* const data_pt=internal_data_pt(0);
+   const unsigned n=data_pt->nvalue();
+   for (unsigned i=0;i<n;i++)
+    {
+     double u_left=0.0;
+     if (i>0) {u_left=data_pt->value(i-1);}
+     double u_right=0.0;
+     if (i<n-1) {u_right=data_pt->value(i+1);}
+     double u=data_pt->value(i);
+     residuals[i]+=2.0*u-u_left-u_right+
+      0.5*GlobalParameters::C*(u_right-u_left)+
+      GlobalParameters::A*u*u*u-GlobalParameters::B*sin(double(i+1));
+    }
+  }
+
+}; // end of element class
+
+
+
+//====== start_of_problem_class=======================================
+/// Problem that solves the nonlinear system and whose output
+/// functional is F = sum_i u_i^2/(i+1) + A u_0
+//====================================================================
+class NonlinearAlgebraicProblem : public Problem
+{
+
+public:
+
+ /// Constructor: Pass the number of unknowns
+ NonlinearAlgebraicProblem(const unsigned& n)
+  {
+   Problem::mesh_pt()=new Mesh;
+   mesh_pt()->add_element_pt(new NonlinearAlgebraicElement(n));
+
+   // The parameters with respect to which the gradient is computed
+   add_sensitivity_parameter(&GlobalParameters::A);
+   add_sensitivity_parameter(&GlobalParameters::B);
+
+   oomph_info << "Number of equations: " << assign_eqn_numbers() 
+              << std::endl;
+
+   // Converge tightly so that the finite-difference gradient is accurate
+   newton_solver_tolerance()=1.0e-13;
+   max_newton_iterations()=100;
+
+   // Keep the output short
+   Shut_up_in_newton_solve=true;
+  }
+
+ /// Destructor: Clean up
+ ~NonlinearAlgebraicProblem()
+  {
+   delete mesh_pt()->element_pt(0);
+   mesh_pt()->flush_element_and_node_storage();
+   delete mesh_pt();
+  }
+
+ /// The output functional
+ double output_functional()
+  {
+   double functional=GlobalParameters::A*dof(0);
+   const unsigned n=ndof();
+   for (unsigned i=0;i<n;i++)
+    {
+     functional+=dof(i)*dof(i)/double(i+1);
+    }
+   return functional;
+  }
+
+ /// Compute the gradient of the output functional by central finite
+ /// differences (re-solving the problem for each perturbed parameter)
+ void get_output_functional_gradient_by_fd(Vector<double>& gradient)
+  {
+   const double fd_step=1.0e-5;
+   const unsigned n_param=nsensitivity_parameter();
+   gradient.resize(n_param);
+   Vector<double*> parameter_pt(n_param);
+   parameter_pt[0]=&GlobalParameters::A;
+   parameter_pt[1]=&GlobalParameters::B;
+   for (unsigned p=0;p<n_param;p++)
+    {
+     const double backup=*parameter_pt[p];
+     *parameter_pt[p]=backup+fd_step;
+     newton_solve();
+     const double functional_plus=output_functional();
+     *parameter_pt[p]=backup-fd_step;
+     newton_solve();
+     const double functional_minus=output_functional();
+     gradient[p]=(functional_plus-functional_minus)/(2.0*fd_step);
+     *parameter_pt[p]=backup;
+     newton_solve();
+    }
+  }
+
+ /// Compare the adjoint and the finite-difference gradient and
+ /// document them in the trace file, followed by a flag that indicates
+ /// if they agree to within the finite-difference error
+ void doc_gradient(const std::string& label, ofstream& trace_file)
+  {
+   Vector<double> gradient;
+   get_output_functional_gradient(gradient);
+
+   Vector<double> gradient_fd;
+   get_output_functional_gradient_by_fd(gradient_fd);
+
+   bool gradients_agree=true;
+   const unsigned n_param=gradient.size();
+   for (unsigned p=0;p<n_param;p++)
+    {
+     const double difference=std::fabs(gradient[p]-gradient_fd[p]);
+     oomph_info << label << ": dF/dp_" << p << " adjoint: " << gradient[p]
+                << " finite differences: " << gradient_fd[p] 
+                << " difference: " << difference << std::endl;
+     trace_file << gradient[p] << " " << gradient_fd[p] << " ";
+     if (difference>1.0e-6*(1.0+std::fabs(gradient_fd[p])))
+      {
+       gradients_agree=false;
+      }
+    }
+   trace_file << std::endl;
+   if (gradients_agree)
+    {
+     trace_file << "1" << std::endl;
+    }
+   else
+    {
+     oomph_info << label << ": Adjoint and finite-difference gradients "
+                << "differ!" << std::endl;
+     trace_file << "0" << std::endl;
+    }
+  }
+
+}; // end of problem class
+
+
+
+//====== start_of_main================================================
+/// Driver: Compare the gradient of the output functional from the
+/// adjoint method with finite differences
+//=====================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+ trace_file.precision(10);
+
+ NonlinearAlgebraicProblem problem(20);
+ problem.linear_solver_pt()->disable_doc_time();
+
+ // Without Jacobian re-use and without resolve the Jacobian is 
+ // factorised for the adjoint problem
+ problem.newton_solve();
+ problem.doc_gradient("No reuse", trace_file);
+
+ // With resolve enabled, the factorisation from the last Newton 
+ // iteration is re-used
+ problem.linear_solver_pt()->enable_resolve();
+ GlobalParameters::B=1.5;
+ problem.newton_solve();
+ problem.doc_gradient("Resolve", trace_file);
+ problem.linear_solver_pt()->disable_resolve();
+
+ // With Jacobian re-use, the factorisation stems from the first Newton
+ // iteration of the solve (and, here, from the solve at the previous
+ // parameter values), so the Jacobian has to be factorised afresh
+ problem.enable_jacobian_reuse();
+ problem.newton_solve();
+ GlobalParameters::A=2.0;
+ problem.newton_solve();
+ problem.doc_gradient("Jacobian reuse", trace_file);
+
+ trace_file.close();
+ return 0;
+
+} // end of main
@@ -0,0 +1,330 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the pipelined preconditioner setup in Newton's method: Solve a
+//chain of nonlinear springs with GMRES and an ILU(0) preconditioner,
+//with and without the pipelined setup, and check that the solutions
+//agree. (If the library is built with OpenMP and more than one thread
+//is available, the Krylov solves then use the preconditioner that was
+//set up from the previous Jacobian while the other one is set up
+//concurrently; otherwise the pipelined setup falls back to ordinary
+//linear solves.)
+
+//Generic routines
+#include "generic.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for the parameters of the problem
+//=====================================================================
+namespace GlobalParameters
+{
+
+ /// Stiffness of the springs
+ double K=1.0;
+
+ /// Coefficient of the cubic term in the springs' force
+ double C=0.5;
+
+ /// Load on the nodes
+ double F=0.001;
+
+} // end of namespace
+
+
+
+//====== start_of_element_class========================================
+/// Nonlinear spring that connects two nodal Data (stored as external
+/// Data). The force is K d + C d^3 where d is the difference between
+/// the two values; in addition, the element applies half the nodal
+/// load F to each of its nodes. The Jacobian is computed by finite
+/// differences.
+//=====================================================================
+class NonlinearSpringElement : public GeneralisedElement
+{
+
+public:
+
+ /// Constructor: Pass the pointers to the nodal Data at the two ends
+ NonlinearSpringElement(Data* const& left_data_pt,
+                        Data* const& right_data_pt)
+  {
+   add_external_data(left_data_pt);
+   add_external_data(right_data_pt);
+  }
+
+ /// Compute the residuals
+ void fill_in_contribution_to_residuals(Vector<double>& residuals)
+  {
+   const double d=external_data_pt(1)->value(0)-external_data_pt(0)->value(0);
+   const double force=GlobalParameters::K*d+GlobalParameters::C*d*d*d;
+   for (unsigned j=0;j<2;j++)
+    {
+     const int local_eqn=external_local_eqn(j,0);
+     if (local_eqn>=0)
+      {
+       const double sign=(j==0) ? -1.0 : 1.0;
+       residuals[local_eqn]+=sign*force-0.5*GlobalParameters::F;
+      }
+    }
+  }
+
+}; // end of element class
+
+
+
+//====== start_of_preconditioner_class=================================
+/// ILU(0) preconditioner that counts how often it has been set up and
+/// documents each setup (the pipelined setup must suppress this output
+/// while the setup runs concurrently with the Krylov solve)
+//=====================================================================
+class CountingILUZeroPreconditioner :
+ public ILUZeroPreconditioner<CRDoubleMatrix>
+{
+
+public:
+
+ /// Constructor: Initialise the counter
+ CountingILUZeroPreconditioner() : Nsetup(0) {}
+
+ /// Make the setup function that takes the matrix visible
+ using Preconditioner::setup;
+
+ /// Set up the preconditioner and count the setups
+ void setup()
+  {
+   oomph_info << "Setting up the ILU(0) preconditioner" << std::endl;
+   ILUZeroPreconditioner<CRDoubleMatrix>::setup();
+   Nsetup++;
+  }
+
+ /// Number of setups
+ unsigned nsetup() const {return Nsetup;}
+
+private:
+
+ /// Number of setups
+ unsigned Nsetup;
+
+}; // end of preconditioner class
+
+
+
+//====== start_of_problem_class=======================================
+/// Chain of nonlinear springs; the nodal Data are global Data, the
+/// first one is pinned. Solved with GMRES and ILU(0).
+//====================================================================
+class SpringChainProblem : public Problem
+{
+
+public:
+
+ /// Constructor: Pass the number of springs
+ SpringChainProblem(const unsigned& n_spring);
+
+ /// Destructor: Clean up
+ ~SpringChainProblem();
+
+ /// Set the initial guess
+ void set_initial_guess()
+  {
+   const unsigned n_dof=ndof();
+   for (unsigned i=0;i<n_dof;i++)
+    {
+     dof(i)=0.0;
+    }
+  }
+
+ /// The linear solver's own preconditioner
+ CountingILUZeroPreconditioner* Preconditioner_pt;
+
+ /// The second preconditioner for the pipelined setup
+ CountingILUZeroPreconditioner* Second_preconditioner_pt;
+
+}; // end of problem class
+
+
+
+//=====start_of_constructor===============================================
+/// Constructor: Pass the number of springs
+//========================================================================
+SpringChainProblem::SpringChainProblem(const unsigned& n_spring)
+{
+ // Create the nodal Data
+ for (unsigned i=0;i<=n_spring;i++)
+  {
+   add_global_data(new Data(1));
+  }
+ global_data_pt(0)->pin(0);
+
+ // Create the springs
+ mesh_pt()=new Mesh;
+ for (unsigned i=0;i<n_spring;i++)
+  {
+   mesh_pt()->add_element_pt(
+    new NonlinearSpringElement(global_data_pt(i),global_data_pt(i+1)));
+  }
+
+ oomph_info << "Number of equations: " << assign_eqn_numbers()
+            << std::endl;
+
+ // GMRES with ILU(0)
+ GMRES<CRDoubleMatrix>* solver_pt=new GMRES<CRDoubleMatrix>;
+ solver_pt->tolerance()=1.0e-12;
+ solver_pt->disable_doc_time();
+ Preconditioner_pt=new CountingILUZeroPreconditioner;
+ solver_pt->preconditioner_pt()=Preconditioner_pt;
+ linear_solver_pt()=solver_pt;
+ Second_preconditioner_pt=new CountingILUZeroPreconditioner;
+
+} // end of constructor
+
+
+
+//=====start_of_destructor================================================
+/// Destructor: Clean up
+//========================================================================
+SpringChainProblem::~SpringChainProblem()
+{
+ disable_pipelined_preconditioner_setup();
+ delete linear_solver_pt();
+ linear_solver_pt()=0;
+ delete Preconditioner_pt;
+ delete Second_preconditioner_pt;
+ const unsigned n_data=nglobal_data();
+ for (unsigned i=0;i<n_data;i++)
+  {
+   delete global_data_pt(i);
+  }
+}
+
+
+
+//====== start_of_main================================================
+/// Driver: Solve the problem with and without the pipelined
+/// preconditioner setup and compare the solutions
+//=====================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+ trace_file.precision(10);
+
+ // Number of springs
+ const unsigned n_spring=200;
+
+ SpringChainProblem problem(n_spring);
+ const unsigned n_dof=problem.ndof();
+
+ // Solve with the ordinary preconditioner setup...
+ problem.set_initial_guess();
+ problem.newton_solve();
+ Vector<double> solution(n_dof);
+ double max_displacement=0.0;
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   solution[i]=problem.dof(i);
+   max_displacement=std::max(max_displacement,std::fabs(solution[i]));
+  }
+ const unsigned n_setup=problem.Preconditioner_pt->nsetup();
+ oomph_info << "Number of preconditioner setups without pipelining: "
+            << n_setup << std::endl;
+
+ // ...and, from the same initial guess, with the pipelined one
+ problem.enable_pipelined_preconditioner_setup(
+  problem.Second_preconditioner_pt);
+ problem.set_initial_guess();
+ problem.newton_solve();
+ const unsigned n_setup_pipelined=
+  problem.Preconditioner_pt->nsetup()-n_setup+
+  problem.Second_preconditioner_pt->nsetup();
+ oomph_info << "Number of preconditioner setups with pipelining: "
+            << n_setup_pipelined << std::endl;
+
+ // The solutions must agree to within the Newton tolerance
+ double max_diff=0.0;
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   max_diff=std::max(max_diff,std::fabs(problem.dof(i)-solution[i]));
+  }
+ oomph_info << "Max. difference between the solutions: " << max_diff
+            << " (max. displacement: " << max_displacement << ")"
+            << std::endl;
+ if (max_diff<1.0e-8*max_displacement)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ // The preconditioners must have been set up in each Newton
+ // iteration, with and without pipelining
+ if ((n_setup>0)&&(n_setup_pipelined>0))
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ // Solve again with the pipelined setup, now starting from a perturbed
+ // solution, so that the preconditioners are reused across solves
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   problem.dof(i)=solution[i]*(1.0+0.1*sin(double(i)));
+  }
+ problem.newton_solve();
+ max_diff=0.0;
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   max_diff=std::max(max_diff,std::fabs(problem.dof(i)-solution[i]));
+  }
+ oomph_info << "Max. difference after the restart: " << max_diff
+            << std::endl;
+ if (max_diff<1.0e-8*max_displacement)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ // Document every twentieth displacement
+ for (unsigned i=0;i<n_dof;i+=20)
+  {
+   trace_file << solution[i] << std::endl;
+  }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
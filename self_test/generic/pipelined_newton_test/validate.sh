@@ -0,0 +1,83 @@
+#! /bin/sh
+
+# Get the OOPMH-LIB root directory from a makefile
+OOMPH_ROOT_DIR=$(make -s --no-print-directory print-top_builddir)
+
+
+#Set the number of tests to be checked
+NUM_TESTS=2
+
+
+# Setup validation directory
+#---------------------------
+touch Validation
+rm -r -f Validation
+mkdir Validation
+
+# Validation for the pipelined preconditioner setup in Newton's method
+#--------------------------------------------------------------------
+cd Validation
+
+echo "Running pipelined Newton test "
+mkdir RESLT
+OMP_NUM_THREADS=1 ../pipelined_newton_test > OUTPUT_pipelined_newton_test
+echo "done"
+echo " " >> validation.log
+echo "Pipelined Newton test" >> validation.log
+echo "---------------------" >> validation.log
+echo " " >> validation.log
+echo "Validation directory: " >> validation.log
+echo " " >> validation.log
+echo "  " `pwd` >> validation.log
+echo " " >> validation.log
+cat RESLT/trace.dat > pipelined_newton_results.dat
+
+if test "$1" = "no_fpdiff"; then
+  echo "dummy [OK] -- Can't run fpdiff.py because we don't have python or validata" >> validation.log
+else
+../../../../bin/fpdiff.py \
+    ../validata/pipelined_newton_results.dat.gz   \
+    pipelined_newton_results.dat  >> validation.log
+fi
+
+# Repeat the run with two threads (if the library is built with OpenMP,
+# the preconditioner setup then overlaps with the Krylov solve)
+rm -r -f RESLT
+mkdir RESLT
+echo "Running pipelined Newton test with two threads "
+OMP_NUM_THREADS=2 ../pipelined_newton_test \
+ > OUTPUT_pipelined_newton_test_two_threads
+echo "done"
+echo " " >> validation.log
+cat RESLT/trace.dat > pipelined_newton_results_two_threads.dat
+
+if test "$1" = "no_fpdiff"; then
+  echo "dummy [OK] -- Can't run fpdiff.py because we don't have python or validata" >> validation.log
+else
+../../../../bin/fpdiff.py \
+    ../validata/pipelined_newton_results.dat.gz   \
+    pipelined_newton_results_two_threads.dat  >> validation.log
+fi
+
+
+# Append output to global validation log file
+#--------------------------------------------
+cat validation.log >> ../../../../validation.log
+
+
+cd ..
+
+
+
+#######################################################################
+
+
+#Check that we get the correct number of OKs
+# validate_ok_count will exit with status
+# 0 if all tests has passed.
+# 1 if some tests failed.
+# 2 if there are more 'OK' than expected.
+. $OOMPH_ROOT_DIR/bin/validate_ok_count
+
+# Never get here
+exit 10
@@ -0,0 +1,321 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the SDIRK timesteppers on a system of smooth ODEs whose unknowns
+//are stored in global Data, in an element's internal Data and at a node
+//(dx/dt = -x, dy/dt = cos(t) y and dz/dt = -2 t z with x(0)=y(0)=z(0)=1):
+//- With fixed timesteps the max. error in 0<t<=1 must decrease like
+//  dt^3 for SDIRK3 and like dt^4 for SDIRK4.
+//- With adaptive timestepping the error must remain small.
+
+//Generic routines
+#include "generic.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for the exact solution
+//=====================================================================
+namespace ExactSolution
+{
+
+ /// Exact solution for the i-th unknown at time t
+ double u(const unsigned& i, const double& t)
+ {
+  if (i==0)
+   {
+    return exp(-t);
+   }
+  else if (i==1)
+   {
+    return exp(sin(t));
+   }
+  else
+   {
+    return exp(-t*t);
+   }
+ }
+
+ /// Right-hand side of the ODE for the i-th unknown
+ double rhs(const unsigned& i, const double& t, const double& u)
+ {
+  if (i==0)
+   {
+    return -u;
+   }
+  else if (i==1)
+   {
+    return cos(t)*u;
+   }
+  else
+   {
+    return -2.0*t*u;
+   }
+ }
+
+} // end of namespace
+
+
+
+//====== start_of_element_class========================================
+/// Element that represents the three ODEs. The unknowns are stored
+/// in the element's external Data (the global Data), its internal Data
+/// and its second external Data (the node). The Jacobian is computed by
+/// finite differences.
+//====================================================================
+class ODEElement : public GeneralisedElement
+{
+
+public:
+
+ /// Constructor: Pass the global Data, the node and the timestepper
+ /// for the internal Data
+ ODEElement(Data* const& global_data_pt, Node* const& node_pt,
+            TimeStepper* const& time_stepper_pt)
+  {
+   add_external_data(global_data_pt);
+   add_internal_data(new Data(time_stepper_pt,1));
+   add_external_data(node_pt);
+  }
+
+ /// The Data that stores the i-th unknown
+ Data* unknown_data_pt(const unsigned& i)
+  {
+   if (i==1)
+    {
+     return internal_data_pt(0);
+    }
+   else
+    {
+     return external_data_pt(i/2);
+    }
+  }
+
+ /// Residuals
+ void fill_in_contribution_to_residuals(Vector<double>& residuals)
+  {
+   for (unsigned i=0;i<3;i++)
+    {
+     int local_eqn=(i==1) ? internal_local_eqn(0,0) :
+      external_local_eqn(i/2,0);
+     if (local_eqn>=0)
+      {
+       Data* data_pt=unknown_data_pt(i);
+       TimeStepper* time_stepper_pt=data_pt->time_stepper_pt();
+       double t=time_stepper_pt->time_pt()->time();
+       residuals[local_eqn]+=time_stepper_pt->time_derivative(1,data_pt,0)-
+        ExactSolution::rhs(i,t,data_pt->value(0));
+      }
+    }
+  }
+
+}; // end of element class
+
+
+
+//====== start_of_problem_class=======================================
+/// Problem that solves the ODEs
+//====================================================================
+class ODEProblem : public Problem
+{
+
+public:
+
+ /// Constructor: Pass the timestepper
+ ODEProblem(TimeStepper* const& time_stepper_pt);
+
+ /// Destructor: Clean up
+ ~ODEProblem()
+  {
+   delete mesh_pt();
+   delete global_data_pt(0);
+   delete time_stepper_pt();
+  }
+
+ /// The Data that stores the i-th unknown
+ Data* unknown_data_pt(const unsigned& i)
+  {
+   return dynamic_cast<ODEElement*>(mesh_pt()->element_pt(0))->
+    unknown_data_pt(i);
+  }
+
+ /// Error norm for adaptive timestepping
+ double global_temporal_error_norm()
+  {
+   double error=0.0;
+   for (unsigned i=0;i<3;i++)
+    {
+     error=std::max(error,std::fabs(
+                     time_stepper_pt()->temporal_error_in_value(
+                      unknown_data_pt(i),0)));
+    }
+   return error;
+  }
+
+ /// Max. error of the unknowns at the present time
+ double error()
+  {
+   double error=0.0;
+   double t=time_pt()->time();
+   for (unsigned i=0;i<3;i++)
+    {
+     error=std::max(error,std::fabs(unknown_data_pt(i)->value(0)-
+                                    ExactSolution::u(i,t)));
+    }
+   return error;
+  }
+
+ /// Set the initial conditions at t=0
+ void set_initial_condition(const double& dt)
+  {
+   initialise_dt(dt);
+   time_pt()->time()=0.0;
+   for (unsigned i=0;i<3;i++)
+    {
+     unknown_data_pt(i)->set_value(0,ExactSolution::u(i,0.0));
+    }
+   assign_initial_values_impulsive();
+  }
+
+}; // end of problem class
+
+
+
+//=====start_of_constructor===============================================
+/// Constructor
+//========================================================================
+ODEProblem::ODEProblem(TimeStepper* const& time_stepper_pt)
+{
+ add_time_stepper_pt(time_stepper_pt);
+
+ add_global_data(new Data(time_stepper_pt,1));
+
+ mesh_pt()=new Mesh;
+ Node* node_pt=new Node(time_stepper_pt,1,1,1);
+ mesh_pt()->add_node_pt(node_pt);
+ mesh_pt()->add_element_pt(new ODEElement(global_data_pt(0),node_pt,
+                                          time_stepper_pt));
+
+ newton_solver_tolerance()=1.0e-12;
+
+ // Setup equation numbering scheme
+ assign_eqn_numbers();
+
+} // end of constructor
+
+
+
+//===== start_of_fixed_step_error========================================
+/// Max. error in 0<t<=1 for the given timestepper and number of
+/// timesteps
+//========================================================================
+double fixed_step_error(TimeStepper* const& time_stepper_pt,
+                        const unsigned& n_step)
+{
+ ODEProblem problem(time_stepper_pt);
+ double dt=1.0/double(n_step);
+ problem.set_initial_condition(dt);
+ double max_error=0.0;
+ for (unsigned i=0;i<n_step;i++)
+  {
+   problem.unsteady_newton_solve(dt);
+   max_error=std::max(max_error,problem.error());
+  }
+ return max_error;
+}
+
+
+
+//===== start_of_check_rate===============================================
+/// Document a flag that indicates if the convergence rate of the
+/// timestepper agrees with its order
+//========================================================================
+void check_rate(TimeStepper* const& coarse_time_stepper_pt,
+                TimeStepper* const& fine_time_stepper_pt,
+                ofstream& trace_file)
+{
+ unsigned order=coarse_time_stepper_pt->order();
+ double error_coarse=fixed_step_error(coarse_time_stepper_pt,10);
+ double error_fine=fixed_step_error(fine_time_stepper_pt,20);
+ double rate=log(error_coarse/error_fine)/log(2.0);
+ oomph_info << "Order " << order << ": errors " << error_coarse << " "
+            << error_fine << "; convergence rate " << rate << std::endl;
+ if (std::fabs(rate-double(order))<0.3)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+}
+
+
+
+//===== start_of_main=====================================================
+/// Driver: Check the convergence rates of the SDIRK schemes and the
+/// error of the adaptive scheme
+//========================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ // Convergence rates with fixed timesteps (the problems delete the
+ // timesteppers)
+ check_rate(new SDIRK3,new SDIRK3,trace_file);
+ check_rate(new SDIRK4,new SDIRK4,trace_file);
+
+ // Adaptive timestepping
+ ODEProblem problem(new SDIRK4(true));
+ double dt=1.0e-2;
+ problem.set_initial_condition(dt);
+ double epsilon=1.0e-6;
+ problem.target_error_safety_factor()=0.5;
+ double max_error=0.0;
+ unsigned n_step=0;
+ while (problem.time_pt()->time()<2.0)
+  {
+   dt=problem.adaptive_unsteady_newton_solve(dt,epsilon);
+   max_error=std::max(max_error,problem.error());
+   n_step++;
+  }
+ oomph_info << "Adaptive: " << n_step << " timesteps; max. error "
+            << max_error << std::endl;
+ if (max_error<1.0e-5)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
@@ -0,0 +1,331 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the dof-based temporal error norm: Compare it with the norm
+//computed directly from the Data that store the dofs (global Data,
+//nodal values, nodal positions, internal Data and spine heights), with
+//different weights for the different kinds of values. Every dof must
+//contribute.
+
+//Generic routines
+#include "generic.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for the parameters of the error norm
+//=====================================================================
+namespace ErrorNormParameters
+{
+
+ /// Absolute tolerance
+ double Absolute_tolerance=1.0e-3;
+
+ /// Relative tolerance
+ double Relative_tolerance=1.0e-2;
+
+ /// Weight of the second nodal value
+ double Nodal_value_weight=0.5;
+
+ /// Weight of the nodal positions
+ double Position_weight=2.0;
+
+ /// Weight of the values in global and internal Data and of the
+ /// spine heights
+ double Non_nodal_value_weight=3.0;
+
+} // end of namespace
+
+
+
+//====== start_of_element_class========================================
+/// An element that only has internal Data
+//====================================================================
+class ErrorNormElement : public GeneralisedElement
+{
+
+public:
+
+ /// Constructor: Pass the timestepper for the internal Data
+ ErrorNormElement(TimeStepper* const& time_stepper_pt)
+  {
+   add_internal_data(new Data(time_stepper_pt,3));
+  }
+
+}; // end of element class
+
+
+
+//====== start_of_mesh_class==========================================
+/// A mesh that contains a few nodes and solid nodes, an element with
+/// internal Data and a spine
+//====================================================================
+class ErrorNormMesh : public SpineMesh
+{
+
+public:
+
+ /// Constructor: Pass the timestepper
+ ErrorNormMesh(TimeStepper* const& time_stepper_pt)
+  {
+   // Nodes with two values
+   for (unsigned n=0;n<2;n++)
+    {
+     Node_pt.push_back(new Node(time_stepper_pt,1,1,2));
+    }
+
+   // A solid node with one value and a variable position
+   SolidNode* solid_node_pt=new SolidNode(time_stepper_pt,1,1,1,1,1);
+   solid_node_pt->unpin_position(0);
+   Node_pt.push_back(solid_node_pt);
+
+   // An element with internal Data
+   Element_pt.push_back(new ErrorNormElement(time_stepper_pt));
+
+   // A spine whose height evolves in time
+   Spine* spine_pt=new Spine(1.0);
+   spine_pt->spine_height_pt()->set_time_stepper(time_stepper_pt,false);
+   add_spine_pt(spine_pt);
+  }
+
+ /// There are no spine nodes to update
+ void spine_node_update(SpineNode* spine_node_pt) {}
+
+}; // end of mesh class
+
+
+
+//====== start_of_problem_class=======================================
+/// Problem whose dofs are stored in all kinds of Data
+//====================================================================
+class ErrorNormProblem : public Problem
+{
+
+public:
+
+ /// Constructor
+ ErrorNormProblem();
+
+ /// Destructor: Clean up
+ ~ErrorNormProblem()
+  {
+   delete mesh_pt();
+   delete Global_data_pt;
+   delete time_stepper_pt();
+  }
+
+ /// Give all values distinct values and set up the error weights
+ void set_values();
+
+ /// Compute the error norm directly from the Data
+ double direct_temporal_error_norm();
+
+private:
+
+ /// Add the contribution of the values in the Data to the sum of the
+ /// squared weighted errors and to the number of dofs. The weight of
+ /// the j-th value is weight[j] (or weight[0] if there is only one
+ /// weight).
+ void add_contribution(Data* const& data_pt, const Vector<double>& weight,
+                       double& sum, unsigned& n_dof);
+
+ /// Global Data
+ Data* Global_data_pt;
+
+}; // end of problem class
+
+
+
+//=====start_of_constructor===============================================
+/// Constructor
+//========================================================================
+ErrorNormProblem::ErrorNormProblem()
+{
+ add_time_stepper_pt(new BDF<2>(true));
+
+ mesh_pt()=new ErrorNormMesh(time_stepper_pt());
+
+ Global_data_pt=new Data(time_stepper_pt(),2);
+ add_global_data(Global_data_pt);
+
+ // Pin one of the nodal values: It must not contribute
+ mesh_pt()->node_pt(0)->pin(0);
+
+ // Setup equation numbering scheme
+ oomph_info << "Number of equations: " << assign_eqn_numbers() << std::endl;
+
+ // Use the dof-based error norm with different weights
+ enable_dof_based_temporal_error_norm(
+  ErrorNormParameters::Absolute_tolerance,
+  ErrorNormParameters::Relative_tolerance);
+ set_temporal_error_weight_for_nodal_value(
+  1,ErrorNormParameters::Nodal_value_weight);
+ set_temporal_error_weight_for_positions(
+  ErrorNormParameters::Position_weight);
+ set_temporal_error_weight_for_non_nodal_values(
+  ErrorNormParameters::Non_nodal_value_weight);
+
+} // end of constructor
+
+
+
+//=====start_of_set_values================================================
+/// Give all values distinct values and set up the error weights
+//========================================================================
+void ErrorNormProblem::set_values()
+{
+ initialise_dt(0.1);
+
+ // Collect all Data
+ Vector<Data*> all_data_pt;
+ all_data_pt.push_back(Global_data_pt);
+ unsigned n_node=mesh_pt()->nnode();
+ for (unsigned n=0;n<n_node;n++)
+  {
+   all_data_pt.push_back(mesh_pt()->node_pt(n));
+  }
+ all_data_pt.push_back(dynamic_cast<SolidNode*>(mesh_pt()->node_pt(2))->
+                       variable_position_pt());
+ all_data_pt.push_back(mesh_pt()->element_pt(0)->internal_data_pt(0));
+ all_data_pt.push_back(dynamic_cast<ErrorNormMesh*>(mesh_pt())->
+                       spine_pt(0)->spine_height_pt());
+
+ unsigned n_data=all_data_pt.size();
+ unsigned n_tstorage=time_stepper_pt()->ntstorage();
+ for (unsigned d=0;d<n_data;d++)
+  {
+   unsigned n_value=all_data_pt[d]->nvalue();
+   for (unsigned j=0;j<n_value;j++)
+    {
+     for (unsigned t=0;t<n_tstorage;t++)
+      {
+       all_data_pt[d]->set_value(t,j,sin(double(1+100*d+10*j+t)));
+      }
+    }
+  }
+ time_stepper_pt()->set_error_weights();
+}
+
+
+
+//=====start_of_add_contribution==========================================
+/// Add the contribution of the values in the Data to the sum of the
+/// squared weighted errors and to the number of dofs
+//========================================================================
+void ErrorNormProblem::add_contribution(Data* const& data_pt,
+                                        const Vector<double>& weight,
+                                        double& sum, unsigned& n_dof)
+{
+ unsigned n_value=data_pt->nvalue();
+ for (unsigned j=0;j<n_value;j++)
+  {
+   if (data_pt->eqn_number(j)>=0)
+    {
+     double w=(weight.size()==1) ? weight[0] : weight[j];
+     double error=
+      w*data_pt->time_stepper_pt()->temporal_error_in_value(data_pt,j);
+     double scale=ErrorNormParameters::Absolute_tolerance+
+      ErrorNormParameters::Relative_tolerance*std::fabs(data_pt->value(j));
+     sum+=(error/scale)*(error/scale);
+     n_dof++;
+    }
+  }
+}
+
+
+
+//=====start_of_direct_temporal_error_norm================================
+/// Compute the error norm directly from the Data
+//========================================================================
+double ErrorNormProblem::direct_temporal_error_norm()
+{
+ double sum=0.0;
+ unsigned n_dof=0;
+
+ Vector<double> non_nodal_weight(1,
+                                 ErrorNormParameters::Non_nodal_value_weight);
+ Vector<double> position_weight(1,ErrorNormParameters::Position_weight);
+ Vector<double> nodal_weight(2,1.0);
+ nodal_weight[1]=ErrorNormParameters::Nodal_value_weight;
+
+ add_contribution(Global_data_pt,non_nodal_weight,sum,n_dof);
+ unsigned n_node=mesh_pt()->nnode();
+ for (unsigned n=0;n<n_node;n++)
+  {
+   add_contribution(mesh_pt()->node_pt(n),nodal_weight,sum,n_dof);
+  }
+ add_contribution(dynamic_cast<SolidNode*>(mesh_pt()->node_pt(2))->
+                  variable_position_pt(),position_weight,sum,n_dof);
+ add_contribution(mesh_pt()->element_pt(0)->internal_data_pt(0),
+                  non_nodal_weight,sum,n_dof);
+ add_contribution(dynamic_cast<ErrorNormMesh*>(mesh_pt())->
+                  spine_pt(0)->spine_height_pt(),non_nodal_weight,
+                  sum,n_dof);
+
+ // All dofs must have been visited
+ if (n_dof!=ndof())
+  {
+   oomph_info << "Only " << n_dof << " of " << ndof()
+              << " dofs have been visited" << std::endl;
+   return -1.0;
+  }
+ return sqrt(sum/double(n_dof));
+}
+
+
+
+//===== start_of_main=====================================================
+/// Driver: Compare the dof-based temporal error norm with the one
+/// computed directly from the Data
+//========================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ ErrorNormProblem problem;
+ trace_file << problem.ndof() << std::endl;
+ problem.set_values();
+
+ double norm=problem.dof_based_temporal_error_norm();
+ double direct_norm=problem.direct_temporal_error_norm();
+ oomph_info << "Dof-based temporal error norm: " << norm << std::endl;
+ oomph_info << "Temporal error norm computed from the Data: "
+            << direct_norm << std::endl;
+ if (std::fabs(norm-direct_norm)<1.0e-12*direct_norm)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
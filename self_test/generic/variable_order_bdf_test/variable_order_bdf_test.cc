@@ -0,0 +1,273 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the variable-order BDF timestepper on the smooth ODE
+//dy/dt = cos(t) y with y(0)=1 (so y = exp(sin(t))):
+//- For fixed orders k=1,...,5 (started from the exact time history)
+//  the max. error in 0<t<=1 must decrease like dt^k.
+//- With adaptive timestepping the order must rise from one to the
+//  maximum order, and the error must remain small.
+
+//Generic routines
+#include "generic.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for the exact solution
+//=====================================================================
+namespace ExactSolution
+{
+
+ /// Exact solution at time t
+ double y(const double& t)
+ {
+  return exp(sin(t));
+ }
+
+} // end of namespace
+
+
+
+//====== start_of_element_class========================================
+/// Element that represents the ODE dy/dt = cos(t) y for the value
+/// stored in its internal Data
+//====================================================================
+class ODEElement : public GeneralisedElement
+{
+
+public:
+
+ /// Constructor: Pass the timestepper for the internal Data
+ ODEElement(TimeStepper* const& time_stepper_pt)
+  {
+   add_internal_data(new Data(time_stepper_pt,1));
+  }
+
+ /// Residual
+ void fill_in_contribution_to_residuals(Vector<double>& residuals)
+  {
+   fill_in_generic_residual_contribution(residuals,
+                                         GeneralisedElement::Dummy_matrix,0);
+  }
+
+ /// Residual and Jacobian
+ void fill_in_contribution_to_jacobian(Vector<double>& residuals,
+                                       DenseMatrix<double>& jacobian)
+  {
+   fill_in_generic_residual_contribution(residuals,jacobian,1);
+  }
+
+private:
+
+ /// Residual and (if flag=1) Jacobian
+ void fill_in_generic_residual_contribution(Vector<double>& residuals,
+                                            DenseMatrix<double>& jacobian,
+                                            const unsigned& flag)
+  {
+   Data* data_pt=internal_data_pt(0);
+   TimeStepper* time_stepper_pt=data_pt->time_stepper_pt();
+   double t=time_stepper_pt->time_pt()->time();
+   int local_eqn=internal_local_eqn(0,0);
+   if (local_eqn>=0)
+    {
+     // Time derivative
+     double dydt=0.0;
+     unsigned n_tstorage=time_stepper_pt->ntstorage();
+     for (unsigned l=0;l<n_tstorage;l++)
+      {
+       dydt+=time_stepper_pt->weight(1,l)*data_pt->value(l,0);
+      }
+     residuals[local_eqn]+=dydt-cos(t)*data_pt->value(0);
+     if (flag)
+      {
+       jacobian(local_eqn,local_eqn)+=
+        time_stepper_pt->weight(1,0)-cos(t);
+      }
+    }
+  }
+
+}; // end of element class
+
+
+
+//====== start_of_problem_class=======================================
+/// Problem that solves the ODE
+//====================================================================
+class ODEProblem : public Problem
+{
+
+public:
+
+ /// Constructor: Pass the maximum order and the flag that indicates
+ /// if the timestepper is adaptive
+ ODEProblem(const unsigned& max_order, const bool& adaptive);
+
+ /// Destructor: Clean up
+ ~ODEProblem()
+  {
+   delete mesh_pt();
+   delete time_stepper_pt();
+  }
+
+ /// The timestepper
+ VariableOrderBDF* bdf_pt()
+  {
+   return dynamic_cast<VariableOrderBDF*>(time_stepper_pt());
+  }
+
+ /// The unknown
+ Data* data_pt()
+  {
+   return mesh_pt()->element_pt(0)->internal_data_pt(0);
+  }
+
+ /// Error norm for adaptive timestepping
+ double global_temporal_error_norm()
+  {
+   return std::fabs(time_stepper_pt()->temporal_error_in_value(data_pt(),0));
+  }
+
+ /// Start with the given timestep at t=0, with the exact solution as the
+ /// history values
+ void set_exact_history(const double& dt)
+  {
+   initialise_dt(dt);
+   time_pt()->time()=0.0;
+   unsigned n_prev=time_stepper_pt()->nprev_values();
+   for (unsigned t=0;t<=n_prev;t++)
+    {
+     data_pt()->set_value(t,0,ExactSolution::y(-double(t)*dt));
+    }
+  }
+
+}; // end of problem class
+
+
+
+//=====start_of_constructor===============================================
+/// Constructor
+//========================================================================
+ODEProblem::ODEProblem(const unsigned& max_order, const bool& adaptive)
+{
+ add_time_stepper_pt(new VariableOrderBDF(max_order,adaptive));
+
+ mesh_pt()=new Mesh;
+ mesh_pt()->add_element_pt(new ODEElement(time_stepper_pt()));
+
+ newton_solver_tolerance()=1.0e-10;
+
+ // Setup equation numbering scheme
+ assign_eqn_numbers();
+
+} // end of constructor
+
+
+
+//===== start_of_fixed_order_error=======================================
+/// Max. error in 0<t<=1 for the given fixed order and number of timesteps
+//========================================================================
+double fixed_order_error(const unsigned& order, const unsigned& n_step)
+{
+ ODEProblem problem(order,false);
+ problem.bdf_pt()->set_order(order);
+ double dt=1.0/double(n_step);
+ problem.set_exact_history(dt);
+ double max_error=0.0;
+ for (unsigned i=0;i<n_step;i++)
+  {
+   problem.unsteady_newton_solve(dt);
+   max_error=std::max(max_error,
+                      std::fabs(problem.data_pt()->value(0)-
+                                ExactSolution::y(problem.time_pt()->time())));
+  }
+ return max_error;
+}
+
+
+
+//===== start_of_main=====================================================
+/// Driver: Check the convergence rates of the fixed-order schemes and
+/// the order reached by the adaptive scheme
+//========================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ // Convergence rates of the fixed-order schemes
+ for (unsigned order=1;order<=5;order++)
+  {
+   double error_coarse=fixed_order_error(order,40);
+   double error_fine=fixed_order_error(order,80);
+   double rate=log(error_coarse/error_fine)/log(2.0);
+   oomph_info << "Order " << order << ": errors " << error_coarse << " "
+              << error_fine << "; convergence rate " << rate << std::endl;
+   if (std::fabs(rate-double(order))<0.3)
+    {
+     trace_file << "1" << std::endl;
+    }
+   else
+    {
+     trace_file << "0" << std::endl;
+    }
+  }
+
+ // Adaptive timestepping with order adaptation
+ ODEProblem problem(5,true);
+ problem.data_pt()->set_value(0,ExactSolution::y(0.0));
+ problem.assign_initial_values_impulsive(1.0e-3);
+ double epsilon=1.0e-8;
+ double dt=1.0e-3;
+ unsigned max_order=0;
+ double max_error=0.0;
+ unsigned n_step=0;
+ while (problem.time_pt()->time()<10.0)
+  {
+   dt=problem.adaptive_unsteady_newton_solve(dt,epsilon);
+   max_order=std::max(max_order,problem.bdf_pt()->order());
+   max_error=std::max(max_error,
+                      std::fabs(problem.data_pt()->value(0)-
+                                ExactSolution::y(problem.time_pt()->time())));
+   n_step++;
+  }
+ oomph_info << "Adaptive: " << n_step << " timesteps; max. order "
+            << max_order << "; max. error " << max_error << std::endl;
+ trace_file << max_order << std::endl;
+ if (max_error<1.0e-5)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
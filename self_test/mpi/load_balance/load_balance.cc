@@ -0,0 +1,316 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the load balancing of a distributed, non-uniformly refined
+//quad mesh whose base elements carry refinement trees with up to
+//three levels: The number of elements and dofs and the nodal values
+//(which represent a field that is interpolated exactly) must be
+//preserved when the elements (and their refinement patterns) are
+//moved between processors, and the mesh must remain refineable.
+
+//Generic routines
+#include "generic.h"
+
+// Poisson elements
+#include "poisson.h"
+
+// The mesh
+#include "meshes/rectangular_quadmesh.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for the field that is stored in the nodal values
+//=====================================================================
+namespace FieldFunction
+{
+
+ /// Biquadratic field (interpolated exactly by the elements, also at
+ /// the hanging nodes)
+ double u(const Vector<double>& x)
+ {
+  return 1.0+x[0]-2.0*x[1]+0.5*x[0]*x[0]+x[0]*x[1];
+ }
+
+} // end of namespace
+
+
+
+//====== start_of_error_estimator_class================================
+/// "Error estimator" that flags the elements in the lower left quarter
+/// of the unit square for refinement
+//=====================================================================
+class LowerLeftQuarterErrorEstimator : public ErrorEstimator
+{
+
+public:
+
+ /// Constructor
+ LowerLeftQuarterErrorEstimator() {}
+
+ /// Assign an "error" of 1 to the elements whose centres are in the
+ /// lower left quarter and of 0.1 to all others
+ void get_element_errors(Mesh*& mesh_pt,
+                         Vector<double>& elemental_error,
+                         DocInfo& doc_info)
+  {
+   Vector<double> s(2,0.0);
+   Vector<double> x(2);
+   const unsigned n_element=mesh_pt->nelement();
+   elemental_error.resize(n_element);
+   for (unsigned e=0;e<n_element;e++)
+    {
+     mesh_pt->finite_element_pt(e)->interpolated_x(s,x);
+     if ((x[0]<0.5)&&(x[1]<0.5))
+      {
+       elemental_error[e]=1.0;
+      }
+     else
+      {
+       elemental_error[e]=0.1;
+      }
+    }
+  }
+
+}; // end of error estimator class
+
+
+
+//====== start_of_problem_class=======================================
+/// Problem on a refineable quad mesh that is used to test the load
+/// balancing. The Poisson elements are only used to provide the
+/// nodal values; no equations are solved.
+//====================================================================
+template<class ELEMENT>
+class LoadBalanceProblem : public Problem
+{
+
+public:
+
+ /// Constructor
+ LoadBalanceProblem()
+  {
+   // Create the error estimator
+   Error_estimator_pt=new LowerLeftQuarterErrorEstimator;
+
+   // Create the mesh
+   build_mesh();
+
+   // Setup equation numbering scheme
+   assign_eqn_numbers();
+  }
+
+ /// Destructor: Clean up
+ ~LoadBalanceProblem()
+  {
+   delete Problem::mesh_pt();
+   delete Error_estimator_pt;
+  }
+
+ /// Build the (coarse) mesh; also called by load_balance()
+ void build_mesh()
+  {
+   Problem::mesh_pt()=
+    new RefineableRectangularQuadMesh<ELEMENT>(4,4,1.0,1.0);
+
+   // Refine the elements in the lower left quarter, never unrefine
+   mesh_pt()->spatial_error_estimator_pt()=Error_estimator_pt;
+   mesh_pt()->max_permitted_error()=0.5;
+   mesh_pt()->min_permitted_error()=0.0;
+  }
+
+ /// Overloaded version of the problem's access function to
+ /// the mesh. Recasts the pointer to the base Mesh object to
+ /// the actual mesh type.
+ RefineableRectangularQuadMesh<ELEMENT>* mesh_pt()
+  {
+   return dynamic_cast<RefineableRectangularQuadMesh<ELEMENT>*>(
+    Problem::mesh_pt());
+  }
+
+ /// Set the nodal values to the field specified in the namespace
+ void set_field()
+  {
+   Vector<double> x(2);
+   const unsigned n_node=mesh_pt()->nnode();
+   for (unsigned j=0;j<n_node;j++)
+    {
+     Node* nod_pt=mesh_pt()->node_pt(j);
+     x[0]=nod_pt->x(0);
+     x[1]=nod_pt->x(1);
+     nod_pt->set_value(0,FieldFunction::u(x));
+    }
+  }
+
+ /// Doc the (global) numbers of elements and dofs, a flag that
+ /// indicates if the elements are balanced (no processor holds more
+ /// than 25% above the average number) and a flag that indicates if
+ /// the nodal values still represent the field
+ void doc_stats(ofstream& trace_file)
+  {
+   // Count the non-halo elements
+   unsigned n_element_local=0;
+   const unsigned n_element=mesh_pt()->nelement();
+   for (unsigned e=0;e<n_element;e++)
+    {
+     if (!mesh_pt()->element_pt(e)->is_halo())
+      {
+       n_element_local++;
+      }
+    }
+
+   // Check the nodal values (including those of the halo nodes)
+   double max_error=0.0;
+   Vector<double> x(2);
+   const unsigned n_node=mesh_pt()->nnode();
+   for (unsigned j=0;j<n_node;j++)
+    {
+     Node* nod_pt=mesh_pt()->node_pt(j);
+     x[0]=nod_pt->x(0);
+     x[1]=nod_pt->x(1);
+     max_error=std::max(max_error,
+                        std::fabs(nod_pt->value(0)-FieldFunction::u(x)));
+    }
+
+   // Combine the contributions from all processors
+   MPI_Comm comm=communicator_pt()->mpi_comm();
+   unsigned n_element_total=0;
+   unsigned n_element_max=0;
+   unsigned n_element_min=0;
+   double max_error_global=0.0;
+   MPI_Allreduce(&n_element_local,&n_element_total,1,MPI_UNSIGNED,
+                 MPI_SUM,comm);
+   MPI_Allreduce(&n_element_local,&n_element_max,1,MPI_UNSIGNED,
+                 MPI_MAX,comm);
+   MPI_Allreduce(&n_element_local,&n_element_min,1,MPI_UNSIGNED,
+                 MPI_MIN,comm);
+   MPI_Allreduce(&max_error,&max_error_global,1,MPI_DOUBLE,MPI_MAX,comm);
+
+   oomph_info << "Number of elements: " << n_element_total
+              << " (between " << n_element_min << " and "
+              << n_element_max << " per processor); number of dofs: "
+              << ndof() << "; max. error in the nodal values: "
+              << max_error_global << std::endl;
+
+   trace_file << n_element_total << std::endl;
+   trace_file << ndof() << std::endl;
+   const unsigned n_proc=communicator_pt()->nproc();
+   if (4*n_proc*n_element_max<=5*n_element_total)
+    {
+     trace_file << "1" << std::endl;
+    }
+   else
+    {
+     trace_file << "0" << std::endl;
+    }
+   if (max_error_global<1.0e-12)
+    {
+     trace_file << "1" << std::endl;
+    }
+   else
+    {
+     trace_file << "0" << std::endl;
+    }
+  }
+
+private:
+
+ /// Pointer to the error estimator
+ ErrorEstimator* Error_estimator_pt;
+
+}; // end of problem class
+
+
+
+//====== start_of_main================================================
+/// Driver: Distribute the problem, refine it non-uniformly so that
+/// the load is imbalanced, then balance the load and check that the
+/// mesh and the nodal values are preserved
+//=====================================================================
+int main(int argc, char **argv)
+{
+ // Initialise MPI
+ MPI_Helpers::init(argc,argv);
+
+ // Only output the trace from the root processor
+ ofstream trace_file;
+ if (MPI_Helpers::communicator_pt()->my_rank()==0)
+  {
+   trace_file.open("RESLT/trace.dat");
+  }
+ else
+  {
+   trace_file.open("/dev/null");
+  }
+
+ LoadBalanceProblem<RefineableQPoissonElement<2,3> > problem;
+
+ // Distribute the base elements in columns so that the left half of
+ // the domain is on the first processor(s)
+ const unsigned n_proc=MPI_Helpers::communicator_pt()->nproc();
+ const unsigned n_element=problem.mesh_pt()->nelement();
+ Vector<unsigned> element_partition(n_element);
+ for (unsigned e=0;e<n_element;e++)
+  {
+   element_partition[e]=((e%4)*n_proc)/4;
+  }
+ problem.distribute(element_partition);
+
+ // Refine uniformly, then refine the lower left quarter twice more
+ // so that the first processor holds most of the elements
+ problem.refine_uniformly();
+ for (unsigned i=0;i<2;i++)
+  {
+   problem.adapt();
+  }
+ problem.set_field();
+
+ oomph_info << "Before load balancing:" << std::endl;
+ problem.doc_stats(trace_file);
+
+ // Balance the load
+ problem.load_balance();
+
+ oomph_info << "After load balancing:" << std::endl;
+ problem.doc_stats(trace_file);
+
+ // The refinement patterns of the migrated elements must still allow
+ // further refinement
+ problem.refine_uniformly();
+
+ oomph_info << "After uniform refinement:" << std::endl;
+ problem.doc_stats(trace_file);
+
+ trace_file.close();
+
+ // Shut down MPI
+ MPI_Helpers::finalize();
+
+ return 0;
+
+} // end of main
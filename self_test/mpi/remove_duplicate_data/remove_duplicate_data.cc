@@ -0,0 +1,549 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the removal of duplicate external halo nodes in a distributed
+//multi-domain problem: The source in a Poisson equation is given by
+//the solution at the mirror image of the integration point, which is
+//found in a second mesh whose elements share the nodes of the
+//Poisson elements. The mirror images of the integration points of the
+//elements on one processor are located in elements on the other
+//processor, so the external halo elements include copies of nodes that
+//are already stored locally. These duplicates must be replaced by the
+//local nodes, and the residuals must agree with those of the
+//undistributed problem.
+
+//Generic routines
+#include "generic.h"
+
+// Poisson elements
+#include "poisson.h"
+
+// The mesh
+#include "meshes/rectangular_quadmesh.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for the parameters of the problem
+//=====================================================================
+namespace GlobalParameters
+{
+
+ /// Strength of the coupling to the solution at the mirror image
+ double Lambda=5.0;
+
+} // end of namespace
+
+
+
+//====== start_of_field_element_class==================================
+/// Element that provides the solution at the mirror images of the
+/// integration points of the Poisson elements. It shares its nodes with
+/// a Poisson element and doesn't contribute to the residuals.
+//=====================================================================
+class SourceFieldElement : public virtual QPoissonElement<2,3>
+{
+
+public:
+
+ /// Constructor
+ SourceFieldElement() : QPoissonElement<2,3>() {}
+
+ /// No contribution to the residuals
+ void fill_in_contribution_to_residuals(Vector<double>& residuals) {}
+
+ /// No contribution to the residuals and the Jacobian
+ void fill_in_contribution_to_jacobian(Vector<double>& residuals,
+                                       DenseMatrix<double>& jacobian) {}
+
+}; // end of field element class
+
+
+
+//====== start_of_poisson_element_class================================
+/// Poisson element whose source is Lambda times the solution at the
+/// mirror image (about x_0=1/2) of the integration point, plus one.
+/// The mirror images are the element's zeta coordinates, so the
+/// multi-domain machinery locates the external (source field) elements
+/// there.
+//=====================================================================
+class MirroredSourcePoissonElement :
+ public virtual QPoissonElement<2,3>,
+ public virtual ElementWithExternalElement
+{
+
+public:
+
+ /// Constructor: There is one interaction; the positions of the
+ /// source field elements are fixed
+ MirroredSourcePoissonElement() : QPoissonElement<2,3>(),
+                                  ElementWithExternalElement()
+  {
+   this->set_ninteraction(1);
+   this->ignore_external_geometric_data();
+  }
+
+ /// The zeta coordinates are the mirror images of the nodal positions
+ double zeta_nodal(const unsigned& n, const unsigned& k,
+                   const unsigned& i) const
+  {
+   if (i==0)
+    {
+     return 1.0-this->nodal_position_gen(n,k,i);
+    }
+   else
+    {
+     return this->nodal_position_gen(n,k,i);
+    }
+  }
+
+ /// Source: Lambda times the solution in the external element, plus one
+ void get_source_poisson(const unsigned& ipt, const Vector<double>& x,
+                         double& source) const
+  {
+   SourceFieldElement* field_el_pt=dynamic_cast<SourceFieldElement*>(
+    external_element_pt(0,ipt));
+   source=1.0+GlobalParameters::Lambda*field_el_pt->interpolated_u_poisson(
+    external_element_local_coord(0,ipt));
+  }
+
+ /// Residuals and Jacobian: The derivatives with respect to the
+ /// external Data are computed by finite differences
+ void fill_in_contribution_to_jacobian(Vector<double>& residuals,
+                                       DenseMatrix<double>& jacobian)
+  {
+   QPoissonElement<2,3>::fill_in_contribution_to_jacobian(residuals,
+                                                          jacobian);
+   this->fill_in_jacobian_from_external_interaction_by_fd(residuals,
+                                                          jacobian);
+  }
+
+}; // end of poisson element class
+
+
+
+//====== start_of_problem_class=======================================
+/// Poisson problem on the unit square whose source is determined by
+/// the solution at the mirror image of the integration point. The
+/// source field elements are rebuilt (from the non-halo Poisson
+/// elements) when the problem is distributed.
+//====================================================================
+class MirroredSourceProblem : public Problem
+{
+
+public:
+
+ /// Constructor
+ MirroredSourceProblem();
+
+ /// Destructor: Clean up
+ ~MirroredSourceProblem()
+  {
+   delete_field_elements();
+   delete Field_mesh_pt;
+   delete Poisson_mesh_pt;
+  }
+
+ /// Doc the number of external halo elements, a flag that indicates
+ /// if some of their nodes are nodes of the local field elements, and
+ /// a flag that indicates if no two of these nodes share a global
+ /// equation number
+ void check_external_halo_nodes(ofstream& trace_file);
+
+ /// Set the nodal values to a field that varies in space (and
+ /// synchronise the values of the halo and external halo nodes)
+ void set_field();
+
+ /// Store the residuals in a map, keyed by the positions of the nodes
+ /// whose values they are associated with
+ void get_residuals_by_position(map<pair<double,double>,double>& residuals_map);
+
+ /// The field elements share the nodes of the Poisson elements: Delete
+ /// them before the problem is distributed
+ void actions_before_distribute()
+  {
+   delete_field_elements();
+   rebuild_global_mesh();
+  }
+
+ /// Rebuild the field elements and set up the interaction
+ void actions_after_distribute()
+  {
+   create_field_elements();
+   rebuild_global_mesh();
+   setup_interaction();
+  }
+
+private:
+
+ /// Create a field element for each non-halo Poisson element
+ void create_field_elements();
+
+ /// Delete the field elements
+ void delete_field_elements();
+
+ /// Locate the external elements
+ void setup_interaction()
+  {
+   Multi_domain_functions::setup_multi_domain_interaction<SourceFieldElement>(
+    this,Poisson_mesh_pt,Field_mesh_pt);
+  }
+
+ /// Mesh of Poisson elements
+ RectangularQuadMesh<MirroredSourcePoissonElement>* Poisson_mesh_pt;
+
+ /// Mesh of field elements
+ Mesh* Field_mesh_pt;
+
+}; // end of problem class
+
+
+
+//=====start_of_constructor===============================================
+/// Constructor
+//========================================================================
+MirroredSourceProblem::MirroredSourceProblem()
+{
+ // Build the Poisson mesh and pin the nodes on its boundaries
+ unsigned n_x=8;
+ unsigned n_y=4;
+ Poisson_mesh_pt=
+  new RectangularQuadMesh<MirroredSourcePoissonElement>(n_x,n_y,1.0,1.0);
+ const unsigned n_bound=Poisson_mesh_pt->nboundary();
+ for (unsigned b=0;b<n_bound;b++)
+  {
+   const unsigned n_node=Poisson_mesh_pt->nboundary_node(b);
+   for (unsigned j=0;j<n_node;j++)
+    {
+     Poisson_mesh_pt->boundary_node_pt(b,j)->pin(0);
+    }
+  }
+
+ // Build the field elements
+ Field_mesh_pt=new Mesh;
+ create_field_elements();
+
+ add_sub_mesh(Poisson_mesh_pt);
+ add_sub_mesh(Field_mesh_pt);
+ build_global_mesh();
+
+ setup_interaction();
+
+ // Setup equation numbering scheme
+ oomph_info << "Number of equations: " << assign_eqn_numbers() << std::endl;
+
+} // end of constructor
+
+
+
+//=====start_of_create_field_elements=====================================
+/// Create a field element for each non-halo Poisson element; it
+/// shares the Poisson element's nodes
+//========================================================================
+void MirroredSourceProblem::create_field_elements()
+{
+ const unsigned n_element=Poisson_mesh_pt->nelement();
+ for (unsigned e=0;e<n_element;e++)
+  {
+   FiniteElement* poisson_el_pt=Poisson_mesh_pt->finite_element_pt(e);
+   if (!poisson_el_pt->is_halo())
+    {
+     SourceFieldElement* field_el_pt=new SourceFieldElement;
+     const unsigned n_node=poisson_el_pt->nnode();
+     for (unsigned j=0;j<n_node;j++)
+      {
+       field_el_pt->node_pt(j)=poisson_el_pt->node_pt(j);
+      }
+     Field_mesh_pt->add_element_pt(field_el_pt);
+    }
+  }
+}
+
+
+
+//=====start_of_delete_field_elements=====================================
+/// Delete the field elements (but not their nodes)
+//========================================================================
+void MirroredSourceProblem::delete_field_elements()
+{
+ const unsigned n_element=Field_mesh_pt->nelement();
+ for (unsigned e=0;e<n_element;e++)
+  {
+   delete Field_mesh_pt->element_pt(e);
+  }
+ Field_mesh_pt->flush_element_and_node_storage();
+}
+
+
+
+//=====start_of_check_external_halo_nodes=================================
+/// Doc the number of external halo elements, a flag that indicates if
+/// some of their nodes are nodes of the local field elements (i.e.
+/// duplicates have been removed), and a flag that indicates if no two
+/// of these nodes share a global equation number. (Duplicates are only
+/// removed within the mesh that holds the external halo elements, so
+/// the Poisson elements' halo nodes aren't considered.)
+//========================================================================
+void MirroredSourceProblem::check_external_halo_nodes(ofstream& trace_file)
+{
+ // The nodes of the local field elements
+ set<Node*> local_node_pt;
+ const unsigned n_local_element=Field_mesh_pt->nelement();
+ for (unsigned e=0;e<n_local_element;e++)
+  {
+   FiniteElement* el_pt=Field_mesh_pt->finite_element_pt(e);
+   const unsigned n_node=el_pt->nnode();
+   for (unsigned j=0;j<n_node;j++)
+    {
+     local_node_pt.insert(el_pt->node_pt(j));
+    }
+  }
+
+ // All nodes, keyed by their (first) global equation number
+ map<long,Node*> node_with_eqn_number;
+ unsigned n_clash=0;
+ for (set<Node*>::iterator it=local_node_pt.begin();
+      it!=local_node_pt.end();it++)
+  {
+   const long eqn_number=(*it)->eqn_number(0);
+   if (eqn_number>=0)
+    {
+     node_with_eqn_number[eqn_number]=*it;
+    }
+  }
+
+ // Loop over the external halo elements
+ unsigned n_external_halo=0;
+ unsigned n_local_node_in_external_halo=0;
+ const unsigned n_proc=communicator_pt()->nproc();
+ for (unsigned p=0;p<n_proc;p++)
+  {
+   const unsigned n_element=Field_mesh_pt->nexternal_halo_element(p);
+   n_external_halo+=n_element;
+   for (unsigned e=0;e<n_element;e++)
+    {
+     FiniteElement* el_pt=dynamic_cast<FiniteElement*>(
+      Field_mesh_pt->external_halo_element_pt(p,e));
+     const unsigned n_el_node=el_pt->nnode();
+     for (unsigned j=0;j<n_el_node;j++)
+      {
+       Node* nod_pt=el_pt->node_pt(j);
+       if (local_node_pt.count(nod_pt)!=0)
+        {
+         n_local_node_in_external_halo++;
+        }
+       const long eqn_number=nod_pt->eqn_number(0);
+       if (eqn_number>=0)
+        {
+         map<long,Node*>::iterator node_it=
+          node_with_eqn_number.find(eqn_number);
+         if (node_it==node_with_eqn_number.end())
+          {
+           node_with_eqn_number[eqn_number]=nod_pt;
+          }
+         else if (node_it->second!=nod_pt)
+          {
+           n_clash++;
+          }
+        }
+      }
+    }
+  }
+
+ // Combine the contributions from all processors
+ MPI_Comm comm=communicator_pt()->mpi_comm();
+ unsigned n_external_halo_total=0;
+ unsigned n_local_node_in_external_halo_total=0;
+ unsigned n_clash_total=0;
+ MPI_Allreduce(&n_external_halo,&n_external_halo_total,1,MPI_UNSIGNED,
+               MPI_SUM,comm);
+ MPI_Allreduce(&n_local_node_in_external_halo,
+               &n_local_node_in_external_halo_total,1,MPI_UNSIGNED,
+               MPI_SUM,comm);
+ MPI_Allreduce(&n_clash,&n_clash_total,1,MPI_UNSIGNED,MPI_SUM,comm);
+
+ oomph_info << "Number of external halo elements: " << n_external_halo_total
+            << "; number of their nodes that are local nodes: "
+            << n_local_node_in_external_halo_total
+            << "; number of nodes that share an equation number: "
+            << n_clash_total << std::endl;
+
+ trace_file << n_external_halo_total << std::endl;
+ if (n_local_node_in_external_halo_total>0)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+ if (n_clash_total==0)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+}
+
+
+
+//=====start_of_set_field================================================
+/// Set the unknown nodal values to a field that varies in space; the
+/// values of the halo and external halo nodes are then overwritten by
+/// those on the processors that hold the non-halo counterparts
+//========================================================================
+void MirroredSourceProblem::set_field()
+{
+ const unsigned n_node=Poisson_mesh_pt->nnode();
+ for (unsigned j=0;j<n_node;j++)
+  {
+   Node* nod_pt=Poisson_mesh_pt->node_pt(j);
+   if (!nod_pt->is_pinned(0))
+    {
+     nod_pt->set_value(0,sin(3.0*nod_pt->x(0))*(1.0+2.0*nod_pt->x(1)));
+    }
+  }
+ if (problem_has_been_distributed())
+  {
+   synchronise_all_dofs();
+  }
+}
+
+
+
+//=====start_of_get_residuals_by_position======================================
+/// Store the residuals in a map, keyed by the positions of the nodes
+/// whose values they are associated with
+//========================================================================
+void MirroredSourceProblem::get_residuals_by_position(
+ map<pair<double,double>,double>& residuals_map)
+{
+ // Get the (distributed) residuals and make them available on every
+ // processor
+ DoubleVector residuals;
+ get_residuals(residuals);
+ LinearAlgebraDistribution global_dist(communicator_pt(),ndof(),false);
+ residuals.redistribute(&global_dist);
+
+ const unsigned n_node=Poisson_mesh_pt->nnode();
+ for (unsigned j=0;j<n_node;j++)
+  {
+   Node* nod_pt=Poisson_mesh_pt->node_pt(j);
+   const long eqn_number=nod_pt->eqn_number(0);
+   if (eqn_number>=0)
+    {
+     residuals_map[make_pair(nod_pt->x(0),nod_pt->x(1))]=
+      residuals[eqn_number];
+    }
+  }
+}
+
+
+
+//====== start_of_main================================================
+/// Driver: Compute the residuals of the undistributed problem, then
+/// distribute it so that the two halves of the domain are on different
+/// processors, check the external halo nodes and compare the residuals
+//=====================================================================
+int main(int argc, char **argv)
+{
+ // Initialise MPI
+ MPI_Helpers::init(argc,argv);
+
+ // Only output the trace from the root processor
+ ofstream trace_file;
+ if (MPI_Helpers::communicator_pt()->my_rank()==0)
+  {
+   trace_file.open("RESLT/trace.dat");
+  }
+ else
+  {
+   trace_file.open("/dev/null");
+  }
+
+ // Get the residuals of the undistributed problem
+ map<pair<double,double>,double> residuals_undistributed;
+ {
+  MirroredSourceProblem problem;
+  problem.set_field();
+  problem.get_residuals_by_position(residuals_undistributed);
+ }
+ trace_file << residuals_undistributed.size() << std::endl;
+
+ // Distribute the problem in columns so that the left half of the
+ // domain is on the first processor(s); the field elements (which come
+ // after the Poisson elements in the global mesh) are deleted before
+ // the problem is distributed
+ MirroredSourceProblem problem;
+ const unsigned n_proc=MPI_Helpers::communicator_pt()->nproc();
+ const unsigned n_element=problem.mesh_pt()->nelement();
+ Vector<unsigned> element_partition(n_element);
+ for (unsigned e=0;e<n_element;e++)
+  {
+   element_partition[e]=((e%8)*n_proc)/8;
+  }
+ problem.distribute(element_partition);
+
+ problem.check_external_halo_nodes(trace_file);
+
+ // Compare the residuals (at the nodes that are stored locally)
+ problem.set_field();
+ map<pair<double,double>,double> residuals_distributed;
+ problem.get_residuals_by_position(residuals_distributed);
+ double max_diff=0.0;
+ for (map<pair<double,double>,double>::iterator it=
+       residuals_distributed.begin();it!=residuals_distributed.end();it++)
+  {
+   max_diff=std::max(max_diff,std::fabs(
+                      it->second-residuals_undistributed[it->first]));
+  }
+ double max_diff_global=0.0;
+ MPI_Allreduce(&max_diff,&max_diff_global,1,MPI_DOUBLE,MPI_MAX,
+               MPI_Helpers::communicator_pt()->mpi_comm());
+ oomph_info << "Max. difference between the residuals of the distributed "
+            << "and the undistributed problem: " << max_diff_global
+            << std::endl;
+ if (max_diff_global<1.0e-12)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ trace_file.close();
+
+ // Shut down MPI
+ MPI_Helpers::finalize();
+
+ return 0;
+
+} // end of main
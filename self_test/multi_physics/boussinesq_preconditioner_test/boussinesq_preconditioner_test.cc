@@ -0,0 +1,319 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the field-split preconditioner for Boussinesq problems:
+//Compute the steady convection in a differentially heated cavity
+//with GMRES, preconditioned by the BoussinesqPreconditioner with the
+//various outer iterations (and as a subsidiary preconditioner of
+//another field-split preconditioner) and check that the solutions
+//agree with the one obtained with SuperLU
+
+//Generic routines
+#include "generic.h"
+
+// The equations
+#include "navier_stokes.h"
+#include "advection_diffusion.h"
+#include "multi_physics.h"
+
+// The mesh
+#include "meshes/rectangular_quadmesh.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//==start_of_namespace====================================================
+/// Namespace for physical parameters
+//========================================================================
+namespace Global_Physical_Variables
+{
+
+ /// Peclet number (identically one from our non-dimensionalisation)
+ double Peclet=1.0;
+
+ /// Reynolds number (identically one from our non-dimensionalisation)
+ double Reynolds=1.0;
+
+ /// Rayleigh number
+ double Rayleigh=1000.0;
+
+ /// Gravity vector
+ Vector<double> Direction_of_gravity(2,0.0);
+
+} // end_of_namespace
+
+
+
+//==start_of_problem_class================================================
+/// Steady convection in a differentially heated cavity
+//========================================================================
+class ConvectionProblem : public Problem
+{
+
+public:
+
+ /// Element type
+ typedef BuoyantQCrouzeixRaviartElement<2> ELEMENT;
+
+ /// Constructor: Pass the number of elements in each direction
+ ConvectionProblem(const unsigned& n_element);
+
+ /// Destructor: Clean up the mesh
+ ~ConvectionProblem()
+  {
+   delete mesh_pt();
+  }
+
+ /// Record the number of GMRES iterations (if GMRES is used)
+ void actions_after_newton_step()
+  {
+   IterativeLinearSolver* iterative_solver_pt=
+    dynamic_cast<IterativeLinearSolver*>(linear_solver_pt());
+   if (iterative_solver_pt!=0)
+    {
+     Max_gmres_iterations=std::max(Max_gmres_iterations,
+                                   iterative_solver_pt->iterations());
+    }
+  }
+
+ /// Reset the unknowns to zero (the initial guess) and the iteration
+ /// count, then solve
+ void solve_from_zero()
+  {
+   unsigned n_dof=ndof();
+   for (unsigned i=0;i<n_dof;i++)
+    {
+     dof(i)=0.0;
+    }
+   Max_gmres_iterations=0;
+   newton_solve();
+  }
+
+ /// Maximum number of GMRES iterations per Newton step
+ unsigned max_gmres_iterations() const {return Max_gmres_iterations;}
+
+private:
+
+ /// Maximum number of GMRES iterations per Newton step
+ unsigned Max_gmres_iterations;
+
+}; // end of ConvectionProblem
+
+
+
+//==start_of_constructor==================================================
+/// Constructor for the convection problem
+//========================================================================
+ConvectionProblem::ConvectionProblem(const unsigned& n_element)
+ : Max_gmres_iterations(0)
+{
+ // Gravity acts in the negative y-direction
+ Global_Physical_Variables::Direction_of_gravity[1]=-1.0;
+
+ // Build the mesh
+ mesh_pt()=new RectangularQuadMesh<ELEMENT>(n_element,n_element,1.0,1.0);
+
+ // No slip on all walls; the left wall is hot, the right one cold and
+ // the others are insulated
+ unsigned n_bound=mesh_pt()->nboundary();
+ for (unsigned b=0;b<n_bound;b++)
+  {
+   unsigned n_node=mesh_pt()->nboundary_node(b);
+   for (unsigned n=0;n<n_node;n++)
+    {
+     Node* nod_pt=mesh_pt()->boundary_node_pt(b,n);
+     nod_pt->pin(0);
+     nod_pt->pin(1);
+     if (b==1)
+      {
+       nod_pt->pin(2);
+       nod_pt->set_value(2,-0.5);
+      }
+     else if (b==3)
+      {
+       nod_pt->pin(2);
+       nod_pt->set_value(2,0.5);
+      }
+    }
+  }
+
+ // Complete the build of the elements
+ unsigned n_el=mesh_pt()->nelement();
+ for (unsigned e=0;e<n_el;e++)
+  {
+   ELEMENT* el_pt=dynamic_cast<ELEMENT*>(mesh_pt()->element_pt(e));
+   el_pt->pe_pt()=&Global_Physical_Variables::Peclet;
+   el_pt->re_pt()=&Global_Physical_Variables::Reynolds;
+   el_pt->ra_pt()=&Global_Physical_Variables::Rayleigh;
+   el_pt->g_pt()=&Global_Physical_Variables::Direction_of_gravity;
+  }
+
+ // Fix the pressure in the enclosed flow
+ dynamic_cast<ELEMENT*>(mesh_pt()->element_pt(0))->fix_pressure(0,0.0);
+
+ // Setup equation numbering scheme
+ oomph_info << "Number of equations: " << assign_eqn_numbers() << std::endl;
+
+} // end of constructor
+
+
+
+//==start_of_solve_and_compare============================================
+/// Solve with GMRES, preconditioned by prec_pt, and document a flag
+/// that indicates if GMRES converged within max_iter iterations in every
+/// Newton step and a flag that indicates if the solution agrees with
+/// the reference solution.
+//========================================================================
+void solve_and_compare(ConvectionProblem& problem,
+                       Preconditioner* const& prec_pt,
+                       const unsigned& max_iter,
+                       const Vector<double>& reference_dofs,
+                       ofstream& trace_file)
+{
+ // Keep track of the current (direct) linear solver
+ LinearSolver* const direct_solver_pt=problem.linear_solver_pt();
+
+ GMRES<CRDoubleMatrix> gmres;
+ gmres.tolerance()=1.0e-12;
+ gmres.max_iter()=200;
+ gmres.preconditioner_pt()=prec_pt;
+ problem.linear_solver_pt()=&gmres;
+
+ problem.solve_from_zero();
+
+ double max_diff=0.0;
+ unsigned n_dof=problem.ndof();
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   max_diff=std::max(max_diff,std::fabs(problem.dof(i)-reference_dofs[i]));
+  }
+ oomph_info << "Max. number of GMRES iterations per Newton step: "
+            << problem.max_gmres_iterations() << std::endl;
+ oomph_info << "Max. difference from the direct solution: "
+            << max_diff << std::endl;
+
+ if (problem.max_gmres_iterations()<max_iter)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+ if (max_diff<1.0e-8)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ // Reset the direct linear solver
+ problem.linear_solver_pt()=direct_solver_pt;
+
+} // end of solve_and_compare
+
+
+
+//==start_of_main=========================================================
+/// Driver: Compare the solutions obtained with the Boussinesq
+/// preconditioner and with SuperLU
+//========================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ ConvectionProblem problem(6);
+ problem.newton_solver_tolerance()=1.0e-11;
+
+ // Reference solution with SuperLU
+ problem.solve_from_zero();
+ unsigned n_dof=problem.ndof();
+ Vector<double> reference_dofs(n_dof);
+ double max_velocity=0.0;
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   reference_dofs[i]=problem.dof(i);
+  }
+ unsigned n_node=problem.mesh_pt()->nnode();
+ for (unsigned n=0;n<n_node;n++)
+  {
+   max_velocity=std::max(max_velocity,
+                         std::fabs(problem.mesh_pt()->node_pt(n)->value(1)));
+  }
+ oomph_info << "Max. vertical velocity: " << max_velocity << std::endl;
+ trace_file << n_dof << std::endl;
+ trace_file << max_velocity << std::endl;
+
+ // Block Gauss-Seidel (default). Specifying the mesh twice must not
+ // duplicate it.
+ {
+  BoussinesqPreconditioner prec(&problem);
+  prec.set_navier_stokes_mesh(problem.mesh_pt());
+  prec.set_navier_stokes_mesh(problem.mesh_pt());
+  solve_and_compare(problem,&prec,30,reference_dofs,trace_file);
+ }
+
+ // Two block Jacobi sweeps
+ {
+  BoussinesqPreconditioner prec(&problem);
+  prec.set_navier_stokes_mesh(problem.mesh_pt());
+  prec.use_block_jacobi();
+  prec.n_outer_sweep()=2;
+  solve_and_compare(problem,&prec,60,reference_dofs,trace_file);
+ }
+
+ // Symmetric block Gauss-Seidel
+ {
+  BoussinesqPreconditioner prec(&problem);
+  prec.set_navier_stokes_mesh(problem.mesh_pt());
+  prec.use_symmetric_block_gauss_seidel();
+  solve_and_compare(problem,&prec,30,reference_dofs,trace_file);
+ }
+
+ // The Boussinesq preconditioner as the subsidiary preconditioner
+ // for the only field of another field-split preconditioner: Its dof
+ // types (and those of its own subsidiary Navier-Stokes preconditioner)
+ // are then relative to the master preconditioner.
+ {
+  BoussinesqPreconditioner* boussinesq_prec_pt=
+   new BoussinesqPreconditioner(&problem);
+  boussinesq_prec_pt->set_navier_stokes_mesh(problem.mesh_pt());
+
+  FieldSplitPreconditioner<CRDoubleMatrix> prec;
+  prec.add_mesh(problem.mesh_pt());
+  Vector<unsigned> dof_to_block_map(4,0);
+  prec.set_dof_to_block_map(dof_to_block_map);
+  prec.set_subsidiary_preconditioner_pt(boussinesq_prec_pt,0);
+  solve_and_compare(problem,&prec,30,reference_dofs,trace_file);
+ }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
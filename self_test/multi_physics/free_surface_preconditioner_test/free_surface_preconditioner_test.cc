@@ -0,0 +1,511 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the block preconditioner for free-surface problems: Relax a
+//perturbed free surface on a 2D fluid layer whose nodes are moved
+//either by spines or by a pseudo-solid node update and check that
+//GMRES, preconditioned by the FreeSurfacePreconditioner, converges
+//quickly and reproduces the solution obtained with SuperLU
+
+//Generic routines
+#include "generic.h"
+
+// The equations
+#include "navier_stokes.h"
+#include "fluid_interface.h"
+#include "solid.h"
+#include "constitutive.h"
+#include "multi_physics.h"
+
+// The meshes
+#include "meshes/single_layer_spine_mesh.h"
+#include "meshes/rectangular_quadmesh.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//==start_of_namespace====================================================
+/// Namespace for physical parameters
+//========================================================================
+namespace Global_Physical_Variables
+{
+
+ /// Reynolds number
+ double Re=5.0;
+
+ /// Womersley number
+ double ReSt=5.0;
+
+ /// Capillary number
+ double Ca=1.0;
+
+ /// Poisson ratio for the pseudo-solid node update
+ double Nu=0.1;
+
+ /// Pseudo-solid constitutive law
+ ConstitutiveLaw* Constitutive_law_pt=0;
+
+ /// Amplitude of the initial perturbation of the free surface
+ double Epsilon=0.1;
+
+ /// Initial height of the free surface at horizontal position x
+ double initial_height(const double& x)
+ {
+  return 1.0+Epsilon*cos(MathematicalConstants::Pi*x);
+ }
+
+} // end_of_namespace
+
+
+
+//==start_of_problem_class================================================
+/// Base class for the free-surface problems: Stores the linear solver
+/// and documents the maximum number of GMRES iterations per Newton step
+/// when the block preconditioner is used.
+//========================================================================
+class FreeSurfaceTestProblem : public Problem
+{
+
+public:
+
+ /// Constructor: Initialise the pointers and the iteration count
+ FreeSurfaceTestProblem() : Solver_pt(0), Prec_pt(0), Max_gmres_iterations(0)
+  {}
+
+ /// Destructor: Clean up the solver
+ virtual ~FreeSurfaceTestProblem()
+  {
+   delete Solver_pt;
+   delete Prec_pt;
+  }
+
+ /// Use GMRES, preconditioned by the free-surface preconditioner,
+ /// as the linear solver: Pass the meshes that contain the bulk fluid
+ /// and the interface elements
+ void use_block_preconditioner(Mesh* const& bulk_mesh_pt,
+                               Mesh* const& interface_mesh_pt)
+  {
+   Prec_pt=new FreeSurfacePreconditioner(this);
+   Prec_pt->set_bulk_fluid_mesh(bulk_mesh_pt,3);
+   Prec_pt->set_interface_mesh(interface_mesh_pt);
+
+   GMRES<CRDoubleMatrix>* gmres_pt=new GMRES<CRDoubleMatrix>;
+   gmres_pt->tolerance()=1.0e-12;
+   gmres_pt->max_iter()=100;
+   gmres_pt->preconditioner_pt()=Prec_pt;
+   Solver_pt=gmres_pt;
+   linear_solver_pt()=Solver_pt;
+  }
+
+ /// Record the number of GMRES iterations (if GMRES is used)
+ void actions_after_newton_step()
+  {
+   IterativeLinearSolver* iterative_solver_pt=
+    dynamic_cast<IterativeLinearSolver*>(linear_solver_pt());
+   if (iterative_solver_pt!=0)
+    {
+     Max_gmres_iterations=std::max(Max_gmres_iterations,
+                                   iterative_solver_pt->iterations());
+    }
+  }
+
+ /// Maximum number of GMRES iterations per Newton step
+ unsigned max_gmres_iterations() const {return Max_gmres_iterations;}
+
+protected:
+
+ /// Pointer to the iterative linear solver (if any)
+ IterativeLinearSolver* Solver_pt;
+
+ /// Pointer to the block preconditioner (if any)
+ FreeSurfacePreconditioner* Prec_pt;
+
+ /// Maximum number of GMRES iterations per Newton step
+ unsigned Max_gmres_iterations;
+
+}; // end of FreeSurfaceTestProblem
+
+
+
+//==start_of_spine_problem================================================
+/// Relaxation of the free surface of a fluid layer whose nodes are
+/// moved along spines.
+//========================================================================
+class SpineFreeSurfaceProblem : public FreeSurfaceTestProblem
+{
+
+public:
+
+ /// Bulk element type
+ typedef SpineElement<QCrouzeixRaviartElement<2> > ELEMENT;
+
+ /// Constructor: Pass the number of elements in the two coordinate
+ /// directions and a flag that indicates if the block preconditioner
+ /// is to be used
+ SpineFreeSurfaceProblem(const unsigned& nx, const unsigned& ny,
+                         const bool& use_preconditioner);
+
+ /// Destructor: Clean up the interface elements and the meshes
+ ~SpineFreeSurfaceProblem()
+  {
+   Interface_mesh_pt->flush_element_and_node_storage();
+   unsigned n_interface=Interface_element_pt.size();
+   for (unsigned e=0;e<n_interface;e++)
+    {
+     delete Interface_element_pt[e];
+    }
+   delete Interface_mesh_pt;
+   delete Bulk_mesh_pt;
+   delete time_stepper_pt();
+  }
+
+ /// Update the spine mesh after every Newton step
+ void actions_before_newton_convergence_check()
+  {
+   Bulk_mesh_pt->node_update();
+  }
+
+private:
+
+ /// Pointer to the bulk mesh
+ SingleLayerSpineMesh<ELEMENT>* Bulk_mesh_pt;
+
+ /// Pointer to the mesh that contains the interface elements
+ Mesh* Interface_mesh_pt;
+
+ /// Storage for the interface elements
+ Vector<GeneralisedElement*> Interface_element_pt;
+
+}; // end of SpineFreeSurfaceProblem
+
+
+
+//==start_of_constructor==================================================
+/// Constructor for the spine-based free-surface problem
+//========================================================================
+SpineFreeSurfaceProblem::SpineFreeSurfaceProblem(
+ const unsigned& nx, const unsigned& ny, const bool& use_preconditioner)
+{
+ // Timestepper
+ add_time_stepper_pt(new BDF<2>);
+
+ // Build the bulk mesh
+ Bulk_mesh_pt=new SingleLayerSpineMesh<ELEMENT>(nx,ny,1.0,1.0,
+                                                time_stepper_pt());
+
+ // Build the interface elements on the upper boundary
+ Interface_mesh_pt=new Mesh;
+ unsigned n_interface=Bulk_mesh_pt->nboundary_element(2);
+ for (unsigned e=0;e<n_interface;e++)
+  {
+   SpineLineFluidInterfaceElement<ELEMENT>* el_pt=
+    new SpineLineFluidInterfaceElement<ELEMENT>(
+     Bulk_mesh_pt->boundary_element_pt(2,e),
+     Bulk_mesh_pt->face_index_at_boundary(2,e));
+   el_pt->ca_pt()=&Global_Physical_Variables::Ca;
+   Interface_element_pt.push_back(el_pt);
+   Interface_mesh_pt->add_element_pt(el_pt);
+  }
+
+ // Combine the meshes
+ add_sub_mesh(Bulk_mesh_pt);
+ add_sub_mesh(Interface_mesh_pt);
+ build_global_mesh();
+
+ // No slip on the bottom, symmetry at the sides
+ unsigned n_node=Bulk_mesh_pt->nboundary_node(0);
+ for (unsigned n=0;n<n_node;n++)
+  {
+   Bulk_mesh_pt->boundary_node_pt(0,n)->pin(0);
+   Bulk_mesh_pt->boundary_node_pt(0,n)->pin(1);
+  }
+ for (unsigned b=1;b<4;b+=2)
+  {
+   n_node=Bulk_mesh_pt->nboundary_node(b);
+   for (unsigned n=0;n<n_node;n++)
+    {
+     Bulk_mesh_pt->boundary_node_pt(b,n)->pin(0);
+    }
+  }
+
+ // Complete the build of the bulk elements
+ unsigned n_bulk=Bulk_mesh_pt->nelement();
+ for (unsigned e=0;e<n_bulk;e++)
+  {
+   ELEMENT* el_pt=dynamic_cast<ELEMENT*>(Bulk_mesh_pt->element_pt(e));
+   el_pt->re_pt()=&Global_Physical_Variables::Re;
+   el_pt->re_st_pt()=&Global_Physical_Variables::ReSt;
+  }
+
+ // Perturb the free surface (the nodes on a spine all have the same
+ // horizontal position)
+ n_node=Bulk_mesh_pt->nnode();
+ for (unsigned n=0;n<n_node;n++)
+  {
+   SpineNode* nod_pt=Bulk_mesh_pt->node_pt(n);
+   nod_pt->spine_pt()->height()=
+    Global_Physical_Variables::initial_height(nod_pt->x(0));
+  }
+ Bulk_mesh_pt->node_update();
+
+ // Choose the linear solver
+ if (use_preconditioner)
+  {
+   use_block_preconditioner(Bulk_mesh_pt,Interface_mesh_pt);
+  }
+
+ // Setup equation numbering scheme
+ oomph_info << "Number of equations (spine node update): "
+            << assign_eqn_numbers() << std::endl;
+
+} // end of constructor
+
+
+
+//==start_of_elastic_problem==============================================
+/// Relaxation of the free surface of a fluid layer whose nodes are
+/// moved by a pseudo-solid node update.
+//========================================================================
+class ElasticFreeSurfaceProblem : public FreeSurfaceTestProblem
+{
+
+public:
+
+ /// Bulk element type
+ typedef PseudoSolidNodeUpdateElement<QCrouzeixRaviartElement<2>,
+                                      QPVDElement<2,3> > ELEMENT;
+
+ /// Constructor: Pass the number of elements in the two coordinate
+ /// directions and a flag that indicates if the block preconditioner
+ /// is to be used
+ ElasticFreeSurfaceProblem(const unsigned& nx, const unsigned& ny,
+                           const bool& use_preconditioner);
+
+ /// Destructor: Clean up the interface elements and the meshes
+ ~ElasticFreeSurfaceProblem()
+  {
+   Interface_mesh_pt->flush_element_and_node_storage();
+   unsigned n_interface=Interface_element_pt.size();
+   for (unsigned e=0;e<n_interface;e++)
+    {
+     delete Interface_element_pt[e];
+    }
+   delete Interface_mesh_pt;
+   delete Bulk_mesh_pt;
+   delete time_stepper_pt();
+  }
+
+private:
+
+ /// Pointer to the bulk mesh
+ ElasticRectangularQuadMesh<ELEMENT>* Bulk_mesh_pt;
+
+ /// Pointer to the mesh that contains the interface elements
+ Mesh* Interface_mesh_pt;
+
+ /// Storage for the interface elements
+ Vector<GeneralisedElement*> Interface_element_pt;
+
+}; // end of ElasticFreeSurfaceProblem
+
+
+
+//==start_of_constructor==================================================
+/// Constructor for the pseudo-solid free-surface problem
+//========================================================================
+ElasticFreeSurfaceProblem::ElasticFreeSurfaceProblem(
+ const unsigned& nx, const unsigned& ny, const bool& use_preconditioner)
+{
+ // Timestepper
+ add_time_stepper_pt(new BDF<2>);
+
+ // Build the bulk mesh
+ Bulk_mesh_pt=new ElasticRectangularQuadMesh<ELEMENT>(nx,ny,1.0,1.0,
+                                                      time_stepper_pt());
+
+ // Perturb the free surface and make the perturbed configuration
+ // the stress-free one
+ unsigned n_node=Bulk_mesh_pt->nnode();
+ for (unsigned n=0;n<n_node;n++)
+  {
+   Node* nod_pt=Bulk_mesh_pt->node_pt(n);
+   nod_pt->x(1)*=Global_Physical_Variables::initial_height(nod_pt->x(0));
+  }
+ Bulk_mesh_pt->set_lagrangian_nodal_coordinates();
+
+ // Build the interface elements on the upper boundary
+ Interface_mesh_pt=new Mesh;
+ unsigned n_interface=Bulk_mesh_pt->nboundary_element(2);
+ for (unsigned e=0;e<n_interface;e++)
+  {
+   ElasticLineFluidInterfaceElement<ELEMENT>* el_pt=
+    new ElasticLineFluidInterfaceElement<ELEMENT>(
+     Bulk_mesh_pt->boundary_element_pt(2,e),
+     Bulk_mesh_pt->face_index_at_boundary(2,e));
+   el_pt->ca_pt()=&Global_Physical_Variables::Ca;
+   Interface_element_pt.push_back(el_pt);
+   Interface_mesh_pt->add_element_pt(el_pt);
+  }
+
+ // Combine the meshes
+ add_sub_mesh(Bulk_mesh_pt);
+ add_sub_mesh(Interface_mesh_pt);
+ build_global_mesh();
+
+ // No slip and no displacement on the bottom, symmetry and no
+ // horizontal displacement at the sides
+ n_node=Bulk_mesh_pt->nboundary_node(0);
+ for (unsigned n=0;n<n_node;n++)
+  {
+   SolidNode* nod_pt=Bulk_mesh_pt->boundary_node_pt(0,n);
+   nod_pt->pin(0);
+   nod_pt->pin(1);
+   nod_pt->pin_position(0);
+   nod_pt->pin_position(1);
+  }
+ for (unsigned b=1;b<4;b+=2)
+  {
+   n_node=Bulk_mesh_pt->nboundary_node(b);
+   for (unsigned n=0;n<n_node;n++)
+    {
+     SolidNode* nod_pt=Bulk_mesh_pt->boundary_node_pt(b,n);
+     nod_pt->pin(0);
+     nod_pt->pin_position(0);
+    }
+  }
+
+ // Complete the build of the bulk elements
+ unsigned n_bulk=Bulk_mesh_pt->nelement();
+ for (unsigned e=0;e<n_bulk;e++)
+  {
+   ELEMENT* el_pt=dynamic_cast<ELEMENT*>(Bulk_mesh_pt->element_pt(e));
+   el_pt->re_pt()=&Global_Physical_Variables::Re;
+   el_pt->re_st_pt()=&Global_Physical_Variables::ReSt;
+   el_pt->constitutive_law_pt()=
+    Global_Physical_Variables::Constitutive_law_pt;
+  }
+
+ // Choose the linear solver
+ if (use_preconditioner)
+  {
+   use_block_preconditioner(Bulk_mesh_pt,Interface_mesh_pt);
+  }
+
+ // Setup equation numbering scheme
+ oomph_info << "Number of equations (pseudo-solid node update): "
+            << assign_eqn_numbers() << std::endl;
+
+} // end of constructor
+
+
+
+//==start_of_compare_solutions============================================
+/// Take a timestep with SuperLU and with the block-preconditioned GMRES
+/// solver and document: the number of unknowns, a flag that indicates
+/// if GMRES converged within 20 iterations in every Newton step and a
+/// flag that indicates if the two solutions agree.
+//========================================================================
+void compare_solutions(FreeSurfaceTestProblem* const& direct_problem_pt,
+                       FreeSurfaceTestProblem* const& gmres_problem_pt,
+                       ofstream& trace_file)
+{
+ // Take one timestep with each solver
+ double dt=0.01;
+ direct_problem_pt->newton_solver_tolerance()=1.0e-11;
+ gmres_problem_pt->newton_solver_tolerance()=1.0e-11;
+ direct_problem_pt->assign_initial_values_impulsive(dt);
+ gmres_problem_pt->assign_initial_values_impulsive(dt);
+ direct_problem_pt->unsteady_newton_solve(dt);
+ gmres_problem_pt->unsteady_newton_solve(dt);
+
+ // Compare the solutions
+ unsigned n_dof=direct_problem_pt->ndof();
+ double max_diff=0.0;
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   max_diff=std::max(max_diff,std::fabs(direct_problem_pt->dof(i)-
+                                        gmres_problem_pt->dof(i)));
+  }
+ oomph_info << "Max. number of GMRES iterations per Newton step: "
+            << gmres_problem_pt->max_gmres_iterations() << std::endl;
+ oomph_info << "Max. difference between the solutions: "
+            << max_diff << std::endl;
+
+ trace_file << n_dof << std::endl;
+ if (gmres_problem_pt->max_gmres_iterations()<20)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+ if ((gmres_problem_pt->ndof()==n_dof)&&(max_diff<1.0e-8))
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+} // end of compare_solutions
+
+
+
+//==start_of_main=========================================================
+/// Driver: Compare the block-preconditioned and the direct solutions
+/// for the spine-based and the pseudo-solid free-surface problems
+//========================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ // Spine node update: No mesh-motion block
+ {
+  SpineFreeSurfaceProblem direct_problem(4,4,false);
+  SpineFreeSurfaceProblem gmres_problem(4,4,true);
+  compare_solutions(&direct_problem,&gmres_problem,trace_file);
+ }
+
+ // Pseudo-solid node update: Mesh-motion block driven by the interface
+ {
+  Global_Physical_Variables::Constitutive_law_pt=
+   new GeneralisedHookean(&Global_Physical_Variables::Nu);
+
+  ElasticFreeSurfaceProblem direct_problem(4,4,false);
+  ElasticFreeSurfaceProblem gmres_problem(4,4,true);
+  compare_solutions(&direct_problem,&gmres_problem,trace_file);
+
+  delete Global_Physical_Variables::Constitutive_law_pt;
+  Global_Physical_Variables::Constitutive_law_pt=0;
+ }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
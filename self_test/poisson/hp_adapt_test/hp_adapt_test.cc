@@ -0,0 +1,311 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the hp-adaptation: Solve a 1D Poisson problem whose exact
+//solution is smooth, apart from a steep front, with p-refineable
+//elements and hp-adapt the mesh a few times. The elements near the
+//front must be h-refined, those in the smooth part of the domain
+//p-refined, and the error must decrease.
+
+//Generic routines
+#include "generic.h"
+
+// Poisson elements
+#include "poisson.h"
+
+// The mesh
+#include "meshes/one_d_mesh.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for the exact solution and the source function
+//=====================================================================
+namespace FrontSolution
+{
+
+ /// Steepness of the front
+ double Alpha=50.0;
+
+ /// Position of the front
+ double X_front=0.75;
+
+ /// Exact solution: sin(pi x) plus a tanh profile
+ void get_exact_u(const Vector<double>& x, Vector<double>& u)
+ {
+  u[0]=sin(MathematicalConstants::Pi*x[0])+tanh(Alpha*(x[0]-X_front));
+ }
+
+ /// Source function that makes the exact solution satisfy the
+ /// Poisson equation u''=f
+ void source_function(const Vector<double>& x, double& source)
+ {
+  const double pi=MathematicalConstants::Pi;
+  const double t=tanh(Alpha*(x[0]-X_front));
+  source=-pi*pi*sin(pi*x[0])-2.0*Alpha*Alpha*t*(1.0-t*t);
+ }
+
+} // end of namespace
+
+
+
+//====== start_of_problem_class=======================================
+/// 1D Poisson problem, discretised with p-refineable elements
+//====================================================================
+class HpAdaptProblem : public Problem
+{
+
+public:
+
+ /// Constructor
+ HpAdaptProblem();
+
+ /// Destructor: Clean up
+ ~HpAdaptProblem()
+  {
+   delete mesh_pt()->spatial_error_estimator_pt();
+   delete mesh_pt();
+  }
+
+ /// Set the boundary conditions from the exact solution
+ void actions_before_newton_solve()
+  {
+   Vector<double> x(1), u(1);
+   for (unsigned b=0;b<2;b++)
+    {
+     Node* nod_pt=mesh_pt()->boundary_node_pt(b,0);
+     x[0]=nod_pt->x(0);
+     FrontSolution::get_exact_u(x,u);
+     nod_pt->set_value(0,u[0]);
+    }
+  }
+
+ /// Complete the build of the new elements
+ void actions_after_adapt()
+  {
+   complete_problem_setup();
+  }
+
+ /// Max. difference between the nodal values and the exact solution
+ double max_nodal_error();
+
+ /// Document the numbers of h-refined and p-refined elements and
+ /// flags that indicate whether they are where they should be
+ void doc_refinement(ofstream& trace_file);
+
+ /// The mesh
+ RefineableOneDMesh<PRefineableQPoissonElement<1> >* mesh_pt()
+  {
+   return dynamic_cast<RefineableOneDMesh<PRefineableQPoissonElement<1> >*>(
+    Problem::mesh_pt());
+  }
+
+private:
+
+ /// Pin the boundary values and pass the source function to the
+ /// elements
+ void complete_problem_setup();
+
+}; // end of problem class
+
+
+
+//=====start_of_constructor===============================================
+/// Constructor
+//========================================================================
+HpAdaptProblem::HpAdaptProblem()
+{
+ Problem::mesh_pt()=
+  new RefineableOneDMesh<PRefineableQPoissonElement<1> >(8,1.0);
+
+ // Error estimator and targets
+ mesh_pt()->spatial_error_estimator_pt()=new Z2ErrorEstimator;
+ mesh_pt()->max_permitted_error()=1.0e-3;
+ mesh_pt()->min_permitted_error()=1.0e-6;
+ mesh_pt()->enable_p_adaptation();
+
+ complete_problem_setup();
+
+ // Start with quadratic elements, so that the smoothness of the
+ // solution can be assessed
+ mesh_pt()->p_refine_uniformly();
+ complete_problem_setup();
+
+ // Setup equation numbering scheme
+ oomph_info << "Number of equations: " << assign_eqn_numbers() << std::endl;
+
+} // end of constructor
+
+
+
+//=====start_of_complete_problem_setup====================================
+/// Pin the boundary values and pass the source function to the elements
+//========================================================================
+void HpAdaptProblem::complete_problem_setup()
+{
+ for (unsigned b=0;b<2;b++)
+  {
+   mesh_pt()->boundary_node_pt(b,0)->pin(0);
+  }
+ const unsigned n_element=mesh_pt()->nelement();
+ for (unsigned e=0;e<n_element;e++)
+  {
+   dynamic_cast<PRefineableQPoissonElement<1>*>(mesh_pt()->element_pt(e))->
+    source_fct_pt()=&FrontSolution::source_function;
+  }
+}
+
+
+
+//=====start_of_max_nodal_error===========================================
+/// Max. difference between the nodal values and the exact solution
+//========================================================================
+double HpAdaptProblem::max_nodal_error()
+{
+ double max_error=0.0;
+ Vector<double> x(1), u(1);
+ const unsigned n_node=mesh_pt()->nnode();
+ for (unsigned j=0;j<n_node;j++)
+  {
+   Node* nod_pt=mesh_pt()->node_pt(j);
+   x[0]=nod_pt->x(0);
+   FrontSolution::get_exact_u(x,u);
+   max_error=std::max(max_error,std::fabs(nod_pt->value(0)-u[0]));
+  }
+ return max_error;
+}
+
+
+
+//=====start_of_doc_refinement============================================
+/// Document the numbers of h-refined and p-refined elements and flags
+/// that indicate whether the h-refined elements are close to the front
+/// and all elements in the smooth part of the solution (away from the
+/// front) have been p-refined only
+//========================================================================
+void HpAdaptProblem::doc_refinement(ofstream& trace_file)
+{
+ unsigned n_h_refined=0;
+ unsigned n_p_refined=0;
+ bool h_refined_near_front=true;
+ bool p_refined_away_from_front=true;
+ const double front_width=0.125;
+ const unsigned n_element=mesh_pt()->nelement();
+ for (unsigned e=0;e<n_element;e++)
+  {
+   PRefineableQPoissonElement<1>* el_pt=
+    dynamic_cast<PRefineableQPoissonElement<1>*>(mesh_pt()->element_pt(e));
+   const double x_left=el_pt->node_pt(0)->x(0);
+   const double x_right=el_pt->node_pt(el_pt->nnode()-1)->x(0);
+   const double distance=std::max(0.0,
+                                  std::max(x_left-FrontSolution::X_front,
+                                           FrontSolution::X_front-x_right));
+   if (el_pt->refinement_level()>0)
+    {
+     n_h_refined++;
+     if (distance>front_width)
+      {
+       h_refined_near_front=false;
+      }
+    }
+   if (el_pt->p_order()>3)
+    {
+     n_p_refined++;
+    }
+   else if (distance>front_width)
+    {
+     p_refined_away_from_front=false;
+    }
+  }
+ oomph_info << "Number of h-refined and p-refined elements: "
+            << n_h_refined << " " << n_p_refined << std::endl;
+ trace_file << n_element << std::endl;
+
+ // Both kinds of refinement must have taken place, in the right places
+ if ((n_h_refined>0)&&(n_p_refined>0))
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+ if (h_refined_near_front&&p_refined_away_from_front)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+}
+
+
+
+//====== start_of_main================================================
+/// Driver: Solve and hp-adapt a few times
+//=====================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ HpAdaptProblem problem;
+ problem.newton_solve();
+ double error=problem.max_nodal_error();
+ oomph_info << "Max. nodal error on the initial mesh: " << error
+            << std::endl;
+
+ const unsigned n_adapt=4;
+ for (unsigned i=0;i<n_adapt;i++)
+  {
+   problem.hp_adapt();
+   problem.newton_solve();
+   const double new_error=problem.max_nodal_error();
+   oomph_info << "Max. nodal error after " << i+1 << " hp-adaptations: "
+              << new_error << std::endl;
+   error=new_error;
+  }
+
+ // Both kinds of refinement, in the right places?
+ problem.doc_refinement(trace_file);
+
+ // The error must have been reduced substantially
+ oomph_info << "Final max. nodal error: " << error << std::endl;
+ if (error<1.0e-3)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
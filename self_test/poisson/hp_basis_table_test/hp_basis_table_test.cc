@@ -0,0 +1,244 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the shared tables of the shape functions of p-refineable
+//Q-elements: p-refine 1D, 2D and 3D meshes of p-refineable Poisson
+//elements step by step and compare the shape functions and their
+//derivatives at the knots, as copied from the tables, with those
+//evaluated directly. Repeat with a (non Gauss-Lobatto-Legendre)
+//integration scheme for which no table applies.
+
+//Generic routines
+#include "generic.h"
+
+// Poisson elements
+#include "poisson.h"
+
+// The meshes
+#include "meshes/one_d_mesh.h"
+#include "meshes/rectangular_quadmesh.h"
+#include "meshes/simple_cubic_mesh.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_compare_with_direct_evaluation=======================
+/// Compare the shape functions and their derivatives at the knots of
+/// the elements' integration schemes, obtained from shape_at_knot()
+/// and dshape_local_at_knot(), with those evaluated directly at the
+/// knots. Return the max. difference and the number of elements whose
+/// integration scheme is compatible with the table for their p-order
+/// (in which case the table itself is also compared).
+//=====================================================================
+template<unsigned DIM>
+double compare_with_direct_evaluation(Mesh* const& mesh_pt,
+                                      unsigned& n_compatible)
+{
+ double max_diff=0.0;
+ n_compatible=0;
+ const unsigned n_element=mesh_pt->nelement();
+ for (unsigned e=0;e<n_element;e++)
+  {
+   PRefineableQElement<DIM>* el_pt=
+    dynamic_cast<PRefineableQElement<DIM>*>(mesh_pt->element_pt(e));
+   const unsigned n_node=el_pt->nnode();
+   Shape psi(n_node), psi_ref(n_node);
+   DShape dpsids(n_node,DIM), dpsids_ref(n_node,DIM);
+   Vector<double> s(DIM);
+
+   // Is there a table for the element's p-order and integration scheme?
+   const PRefineableQElementBasisTable<DIM>* table_pt=
+    PRefineableQElementBasisTable<DIM>::table_pt(el_pt->p_order());
+   const bool compatible=(table_pt!=0) &&
+    table_pt->is_compatible(el_pt->integral_pt());
+   if (compatible)
+    {
+     n_compatible++;
+     if (table_pt->nnode()!=n_node)
+      {
+       max_diff+=1.0;
+      }
+    }
+
+   const unsigned n_intpt=el_pt->integral_pt()->nweight();
+   for (unsigned ipt=0;ipt<n_intpt;ipt++)
+    {
+     for (unsigned i=0;i<DIM;i++)
+      {
+       s[i]=el_pt->integral_pt()->knot(ipt,i);
+      }
+     el_pt->dshape_local(s,psi_ref,dpsids_ref);
+
+     // Via the element (from the table, if there is one)
+     el_pt->shape_at_knot(ipt,psi);
+     for (unsigned l=0;l<n_node;l++)
+      {
+       max_diff=std::max(max_diff,std::fabs(psi[l]-psi_ref[l]));
+      }
+     el_pt->dshape_local_at_knot(ipt,psi,dpsids);
+     for (unsigned l=0;l<n_node;l++)
+      {
+       max_diff=std::max(max_diff,std::fabs(psi[l]-psi_ref[l]));
+       for (unsigned i=0;i<DIM;i++)
+        {
+         max_diff=std::max(max_diff,std::fabs(dpsids(l,i)-dpsids_ref(l,i)));
+        }
+      }
+
+     // Directly from the table
+     if (compatible)
+      {
+       table_pt->dshape_local(ipt,psi,dpsids);
+       for (unsigned l=0;l<n_node;l++)
+        {
+         max_diff=std::max(max_diff,std::fabs(psi[l]-psi_ref[l]));
+         for (unsigned i=0;i<DIM;i++)
+          {
+           max_diff=std::max(max_diff,
+                             std::fabs(dpsids(l,i)-dpsids_ref(l,i)));
+          }
+        }
+      }
+    }
+  }
+ return max_diff;
+
+} // end of compare_with_direct_evaluation
+
+
+
+//===== start_of_p_refine_and_compare=================================
+/// p-refine the mesh up to the max. p-order and compare the tabulated
+/// and the directly evaluated shape functions after each step; then
+/// switch the elements to a Gauss scheme (for which no table applies)
+/// and compare again.
+//=====================================================================
+template<unsigned DIM>
+void p_refine_and_compare(TreeBasedRefineableMeshBase* const& mesh_pt,
+                          ofstream& trace_file)
+{
+ const unsigned max_p_order=7;
+ unsigned p_order=
+  dynamic_cast<PRefineableQElement<DIM>*>(mesh_pt->element_pt(0))->
+  p_order();
+ while (true)
+  {
+   unsigned n_compatible=0;
+   const double max_diff=
+    compare_with_direct_evaluation<DIM>(mesh_pt,n_compatible);
+   oomph_info << "p-order " << p_order
+              << ": Max. difference between tabulated and direct shape "
+              << "functions: " << max_diff << " (" << n_compatible
+              << " of " << mesh_pt->nelement() << " elements tabulated)"
+              << std::endl;
+
+   // All elements must use the table
+   if ((max_diff<1.0e-12)&&(n_compatible==mesh_pt->nelement()))
+    {
+     trace_file << "1" << std::endl;
+    }
+   else
+    {
+     trace_file << "0" << std::endl;
+    }
+
+   if (p_order==max_p_order) break;
+   mesh_pt->p_refine_uniformly();
+   p_order=dynamic_cast<PRefineableQElement<DIM>*>(mesh_pt->element_pt(0))->
+    p_order();
+  }
+
+ // A Gauss scheme: No table applies (the p-refined elements own
+ // their integration schemes)
+ const unsigned n_element=mesh_pt->nelement();
+ for (unsigned e=0;e<n_element;e++)
+  {
+   FiniteElement* el_pt=dynamic_cast<FiniteElement*>(mesh_pt->element_pt(e));
+   Integral* old_integral_pt=el_pt->integral_pt();
+   el_pt->set_integration_scheme(new Gauss<DIM,3>);
+   delete old_integral_pt;
+  }
+ unsigned n_compatible=0;
+ const double max_diff=
+  compare_with_direct_evaluation<DIM>(mesh_pt,n_compatible);
+ oomph_info << "Gauss scheme: Max. difference between the shape "
+            << "functions: " << max_diff << " (" << n_compatible
+            << " elements tabulated)" << std::endl;
+ if ((max_diff<1.0e-12)&&(n_compatible==0))
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+} // end of p_refine_and_compare
+
+
+
+//====== start_of_main================================================
+/// Driver: Compare the tabulated and the directly evaluated shape
+/// functions of p-refineable Q-elements in 1D, 2D and 3D
+//=====================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ // 1D
+ {
+  oomph_info << "1D mesh:" << std::endl;
+  RefineableOneDMesh<PRefineableQPoissonElement<1> >* mesh_pt=
+   new RefineableOneDMesh<PRefineableQPoissonElement<1> >(3,1.0);
+  p_refine_and_compare<1>(mesh_pt,trace_file);
+  delete mesh_pt;
+ }
+
+ // 2D
+ {
+  oomph_info << "Quad mesh:" << std::endl;
+  RefineableRectangularQuadMesh<PRefineableQPoissonElement<2> >* mesh_pt=
+   new RefineableRectangularQuadMesh<PRefineableQPoissonElement<2> >(
+    3,2,1.5,1.0);
+  p_refine_and_compare<2>(mesh_pt,trace_file);
+  delete mesh_pt;
+ }
+
+ // 3D
+ {
+  oomph_info << "Brick mesh:" << std::endl;
+  RefineableSimpleCubicMesh<PRefineableQPoissonElement<3> >* mesh_pt=
+   new RefineableSimpleCubicMesh<PRefineableQPoissonElement<3> >(
+    2,2,2,1.0,1.0,1.0);
+  p_refine_and_compare<3>(mesh_pt,trace_file);
+  delete mesh_pt;
+ }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
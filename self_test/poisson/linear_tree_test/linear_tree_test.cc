@@ -0,0 +1,370 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the Morton keys of the LinearTreeForest: Check that the levels
+//and (integer) coordinates decoded from the keys of the leaves of
+//refined line, quad and brick meshes are consistent with the
+//greater-or-equal-sized neighbours found by the pointer-based trees,
+//and that a mesh refined according to the keys of the leaves of
+//another one is identical to it.
+
+//Generic routines
+#include "generic.h"
+
+// Poisson elements
+#include "poisson.h"
+
+// The meshes
+#include "meshes/one_d_mesh.h"
+#include "meshes/rectangular_quadmesh.h"
+#include "meshes/simple_cubic_mesh.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_gteq_neighbour=======================================
+/// Get the greater-or-equal-sized neighbour of the tree node in
+/// coordinate direction s_axis, on the side specified by the sign of
+/// sign, from the pointer-based BinaryTree, QuadTree or OcTree.
+//=====================================================================
+Tree* gteq_neighbour(Tree* const& tree_pt, const unsigned& dim,
+                     const unsigned& s_axis, const int& sign,
+                     int& diff_level, bool& in_neighbouring_tree)
+{
+ int edge=0;
+ if (dim==1)
+  {
+   using namespace BinaryTreeNames;
+   Vector<double> s_in_neighbour(1);
+   const int direction=(sign<0) ? L : R;
+   return dynamic_cast<BinaryTree*>(tree_pt)->
+    gteq_edge_neighbour(direction,s_in_neighbour,edge,diff_level,
+                        in_neighbouring_tree);
+  }
+ else if (dim==2)
+  {
+   using namespace QuadTreeNames;
+   Vector<unsigned> translate_s(2);
+   Vector<double> s_lo(2), s_hi(2);
+   const int direction[2][2]={{W,E},{S,N}};
+   return dynamic_cast<QuadTree*>(tree_pt)->
+    gteq_edge_neighbour(direction[s_axis][sign>0],translate_s,s_lo,s_hi,
+                        edge,diff_level,in_neighbouring_tree);
+  }
+ else
+  {
+   using namespace OcTreeNames;
+   Vector<unsigned> translate_s(3);
+   Vector<double> s_sw(3), s_ne(3);
+   const int direction[3][2]={{L,R},{D,U},{B,F}};
+   return dynamic_cast<OcTree*>(tree_pt)->
+    gteq_face_neighbour(direction[s_axis][sign>0],translate_s,s_sw,s_ne,
+                        edge,diff_level,in_neighbouring_tree);
+  }
+
+} // end of gteq_neighbour
+
+
+
+//===== start_of_check_keys===========================================
+/// Check the keys of the leaves of the mesh: Document the number of
+/// leaves and flags that indicate if the keys stored in the
+/// LinearTreeForest are those of the leaves, if the levels decoded
+/// from them are those of the leaves, and if the integer coordinates
+/// decoded from them are consistent with the neighbours found by the
+/// pointer-based trees: A neighbour in the same root must contain the
+/// node that is shifted by one in the given direction; if there's no
+/// neighbour in the same root, the node must be on the boundary of its
+/// root.
+//=====================================================================
+void check_keys(TreeBasedRefineableMeshBase* const& mesh_pt,
+                ofstream& trace_file)
+{
+ TreeForest* forest_pt=mesh_pt->forest_pt();
+ const unsigned dim=forest_pt->tree_pt(0)->object_pt()->dim();
+ LinearTreeForest linear_forest(forest_pt);
+
+ bool keys_ok=true;
+ bool levels_ok=true;
+ bool neighbours_ok=true;
+ unsigned n_leaf_total=0;
+ unsigned n_neighbour_in_root=0;
+ const unsigned n_root=forest_pt->ntree();
+ for (unsigned i_root=0;i_root<n_root;i_root++)
+  {
+   Vector<Tree*> leaf_pt;
+   forest_pt->tree_pt(i_root)->stick_leaves_into_vector(leaf_pt);
+   const unsigned n_leaf=leaf_pt.size();
+   n_leaf_total+=n_leaf;
+   if (linear_forest.nleaf(i_root)!=n_leaf)
+    {
+     keys_ok=false;
+     continue;
+    }
+
+   for (unsigned i_leaf=0;i_leaf<n_leaf;i_leaf++)
+    {
+     // Key and level of the leaf
+     const LinearTreeForest::Key key=LinearTreeForest::key(leaf_pt[i_leaf]);
+     if (linear_forest.leaf_key(i_root,i_leaf)!=key)
+      {
+       keys_ok=false;
+      }
+     const unsigned level=LinearTreeForest::level(key,dim);
+     if (int(level)!=leaf_pt[i_leaf]->level())
+      {
+       levels_ok=false;
+      }
+
+     // The key of a son is obtained from that of its father
+     if (leaf_pt[i_leaf]->father_pt()!=0)
+      {
+       if (LinearTreeForest::son_key(
+            LinearTreeForest::key(leaf_pt[i_leaf]->father_pt()),
+            leaf_pt[i_leaf]->son_type(),dim)!=key)
+        {
+         keys_ok=false;
+        }
+      }
+
+     Vector<unsigned long> coordinate;
+     LinearTreeForest::get_coordinates(key,dim,coordinate);
+     const unsigned long n_node_1d=1ul<<level;
+
+     // Compare with the neighbours in all directions
+     for (unsigned s_axis=0;s_axis<dim;s_axis++)
+      {
+       for (int sign=-1;sign<=1;sign+=2)
+        {
+         int diff_level=0;
+         bool in_neighbouring_tree=false;
+         Tree* neighbour_pt=gteq_neighbour(leaf_pt[i_leaf],dim,s_axis,sign,
+                                           diff_level,in_neighbouring_tree);
+
+         // Is the shifted node outside the root?
+         const bool on_root_boundary=
+          (sign<0) ? (coordinate[s_axis]==0) :
+          (coordinate[s_axis]+1==n_node_1d);
+
+         if ((neighbour_pt==0)||in_neighbouring_tree)
+          {
+           if (!on_root_boundary)
+            {
+             neighbours_ok=false;
+            }
+           continue;
+          }
+         n_neighbour_in_root++;
+         if (on_root_boundary)
+          {
+           neighbours_ok=false;
+           continue;
+          }
+
+         // The neighbour's coordinates must be those of the shifted node,
+         // coarsened to the neighbour's level (diff_level is the
+         // neighbour's level minus the node's level, i.e. <=0)
+         const LinearTreeForest::Key neighbour_key=
+          LinearTreeForest::key(neighbour_pt);
+         if (int(LinearTreeForest::level(neighbour_key,dim))!=
+             int(level)+diff_level)
+          {
+           neighbours_ok=false;
+           continue;
+          }
+         Vector<unsigned long> neighbour_coordinate;
+         LinearTreeForest::get_coordinates(neighbour_key,dim,
+                                           neighbour_coordinate);
+         for (unsigned i=0;i<dim;i++)
+          {
+           unsigned long shifted=coordinate[i];
+           if (i==s_axis)
+            {
+             shifted=(sign<0) ? shifted-1 : shifted+1;
+            }
+           if ((shifted>>(-diff_level))!=neighbour_coordinate[i])
+            {
+             neighbours_ok=false;
+            }
+          }
+        }
+      }
+    }
+  }
+
+ oomph_info << "Number of leaves: " << n_leaf_total
+            << "; number of neighbours within the same root: "
+            << n_neighbour_in_root << std::endl;
+ oomph_info << "Keys, levels and neighbours ok: " << keys_ok << " "
+            << levels_ok << " " << neighbours_ok << std::endl;
+
+ trace_file << n_leaf_total << std::endl;
+ trace_file << n_neighbour_in_root << std::endl;
+ trace_file << keys_ok << std::endl;
+ trace_file << levels_ok << std::endl;
+ trace_file << neighbours_ok << std::endl;
+
+} // end of check_keys
+
+
+
+//===== start_of_check_refinement_from_keys===========================
+/// Refine the (unrefined) second mesh according to the keys of the
+/// leaves of the first one and document a flag that indicates if the
+/// two meshes have the same leaves and the same nodes at the same
+/// positions.
+//=====================================================================
+void check_refinement_from_keys(TreeBasedRefineableMeshBase* const& mesh_1_pt,
+                                TreeBasedRefineableMeshBase* const& mesh_2_pt,
+                                ofstream& trace_file)
+{
+ Vector<unsigned long long> packed_keys_1;
+ mesh_1_pt->get_refinement_pattern_as_leaf_keys(packed_keys_1);
+ mesh_2_pt->refine_base_mesh_from_leaf_keys(packed_keys_1);
+ Vector<unsigned long long> packed_keys_2;
+ mesh_2_pt->get_refinement_pattern_as_leaf_keys(packed_keys_2);
+
+ bool same=(packed_keys_1==packed_keys_2)&&
+  (mesh_1_pt->nelement()==mesh_2_pt->nelement())&&
+  (mesh_1_pt->nnode()==mesh_2_pt->nnode());
+ if (same)
+  {
+   const unsigned n_node=mesh_1_pt->nnode();
+   const unsigned dim=mesh_1_pt->node_pt(0)->ndim();
+   for (unsigned j=0;j<n_node;j++)
+    {
+     for (unsigned i=0;i<dim;i++)
+      {
+       if (std::fabs(mesh_1_pt->node_pt(j)->x(i)-
+                     mesh_2_pt->node_pt(j)->x(i))>1.0e-14)
+        {
+         same=false;
+        }
+      }
+    }
+  }
+
+ oomph_info << "Number of packed keys: " << packed_keys_1.size()
+            << "; mesh refined from the keys is identical: " << same
+            << std::endl;
+ trace_file << packed_keys_1.size() << std::endl;
+ trace_file << same << std::endl;
+
+} // end of check_refinement_from_keys
+
+
+
+//===== start_of_refine_and_check=====================================
+/// Refine the first mesh uniformly, then refine every third element
+/// twice (so that the neighbours differ by more than one level),
+/// check the keys after each step and finally refine the second mesh
+/// according to the keys of the leaves of the first one.
+//=====================================================================
+void refine_and_check(TreeBasedRefineableMeshBase* const& mesh_1_pt,
+                      TreeBasedRefineableMeshBase* const& mesh_2_pt,
+                      ofstream& trace_file)
+{
+ // Uniform refinement
+ mesh_1_pt->refine_uniformly();
+ check_keys(mesh_1_pt,trace_file);
+
+ // Two rounds of selective refinement
+ for (unsigned round=0;round<2;round++)
+  {
+   Vector<unsigned> elements_to_be_refined;
+   const unsigned n_element=mesh_1_pt->nelement();
+   for (unsigned e=round;e<n_element;e+=3)
+    {
+     elements_to_be_refined.push_back(e);
+    }
+   mesh_1_pt->refine_selected_elements(elements_to_be_refined);
+   check_keys(mesh_1_pt,trace_file);
+  }
+
+ check_refinement_from_keys(mesh_1_pt,mesh_2_pt,trace_file);
+
+} // end of refine_and_check
+
+
+
+//====== start_of_main================================================
+/// Driver: Check the keys for a 1D line mesh, a 2D quad mesh and a 3D
+/// brick mesh
+//=====================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ // 1D: Line mesh
+ {
+  oomph_info << "Line mesh:" << std::endl;
+  typedef RefineableQPoissonElement<1,3> ELEMENT;
+  RefineableOneDMesh<ELEMENT>* mesh_1_pt=
+   new RefineableOneDMesh<ELEMENT>(3,1.5);
+  RefineableOneDMesh<ELEMENT>* mesh_2_pt=
+   new RefineableOneDMesh<ELEMENT>(3,1.5);
+
+  refine_and_check(mesh_1_pt,mesh_2_pt,trace_file);
+
+  delete mesh_1_pt;
+  delete mesh_2_pt;
+ }
+
+ // 2D: Quad mesh
+ {
+  oomph_info << "Quad mesh:" << std::endl;
+  typedef RefineableQPoissonElement<2,3> ELEMENT;
+  RefineableRectangularQuadMesh<ELEMENT>* mesh_1_pt=
+   new RefineableRectangularQuadMesh<ELEMENT>(3,2,1.5,1.0);
+  RefineableRectangularQuadMesh<ELEMENT>* mesh_2_pt=
+   new RefineableRectangularQuadMesh<ELEMENT>(3,2,1.5,1.0);
+
+  refine_and_check(mesh_1_pt,mesh_2_pt,trace_file);
+
+  delete mesh_1_pt;
+  delete mesh_2_pt;
+ }
+
+ // 3D: Brick mesh
+ {
+  oomph_info << "Brick mesh:" << std::endl;
+  typedef RefineableQPoissonElement<3,3> ELEMENT;
+  RefineableSimpleCubicMesh<ELEMENT>* mesh_1_pt=
+   new RefineableSimpleCubicMesh<ELEMENT>(2,2,2,1.0,1.0,1.0);
+  RefineableSimpleCubicMesh<ELEMENT>* mesh_2_pt=
+   new RefineableSimpleCubicMesh<ELEMENT>(2,2,2,1.0,1.0,1.0);
+
+  refine_and_check(mesh_1_pt,mesh_2_pt,trace_file);
+
+  delete mesh_1_pt;
+  delete mesh_2_pt;
+ }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
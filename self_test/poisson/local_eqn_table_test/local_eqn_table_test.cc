@@ -0,0 +1,336 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the mesh-level local equation table: Number the equations of a
+//Poisson problem with flux boundary conditions with the elements'
+//local equation numbers assigned serially, and compare the tables of
+//the global mesh and the sub-meshes with the elements' equation
+//numbers and the problem's dofs. Then renumber the equations with
+//the local equation numbers assigned concurrently (if the library is
+//built with OpenMP), and check that the tables are identical. Finally
+//check that null entries in a mesh's element vector are skipped.
+
+//Generic routines
+#include "generic.h"
+
+// Poisson elements
+#include "poisson.h"
+
+// The mesh
+#include "meshes/rectangular_quadmesh.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for the prescribed flux
+//=====================================================================
+namespace GlobalParameters
+{
+
+ /// Prescribed flux
+ void prescribed_flux(const Vector<double>& x, double& flux)
+ {
+  flux=1.0+x[1]*x[1];
+ }
+
+} // end of namespace
+
+
+
+//====== start_of_problem_class=======================================
+/// Poisson problem with Dirichlet conditions on three boundaries and
+/// a prescribed flux on the fourth. The elements store pointers to
+/// their dofs.
+//====================================================================
+template<class ELEMENT>
+class LocalEqnTableProblem : public Problem
+{
+
+public:
+
+ /// Constructor
+ LocalEqnTableProblem();
+
+ /// Destructor: Clean up
+ ~LocalEqnTableProblem()
+  {
+   delete Bulk_mesh_pt;
+   const unsigned n_element=Flux_mesh_pt->nelement();
+   for (unsigned e=0;e<n_element;e++)
+    {
+     delete Flux_mesh_pt->element_pt(e);
+    }
+   Flux_mesh_pt->flush_element_and_node_storage();
+   delete Flux_mesh_pt;
+  }
+
+ /// Enable the concurrent assignment of the local equation numbers
+ /// in the sub-meshes (which are the meshes numbered by the problem)
+ void enable_parallel_local_eqn_numbering()
+  {
+   Bulk_mesh_pt->enable_parallel_local_eqn_numbering();
+   Flux_mesh_pt->enable_parallel_local_eqn_numbering();
+  }
+
+ /// Pointer to the bulk mesh
+ RectangularQuadMesh<ELEMENT>* bulk_mesh_pt() {return Bulk_mesh_pt;}
+
+ /// Set up the local equation tables of the global mesh and the
+ /// sub-meshes and check them against the elements' equation numbers
+ /// and the problem's dofs; return the number of mismatches
+ unsigned setup_and_check_local_eqn_tables();
+
+private:
+
+ /// Check the local equation table of the given mesh against the
+ /// elements' equation numbers and the problem's dofs; return the
+ /// number of mismatches
+ unsigned check_local_eqn_table(Mesh* const& mesh_pt);
+
+ /// Pointer to the bulk mesh
+ RectangularQuadMesh<ELEMENT>* Bulk_mesh_pt;
+
+ /// Pointer to the mesh of flux elements
+ Mesh* Flux_mesh_pt;
+
+}; // end of problem class
+
+
+
+//=====start_of_constructor===============================================
+/// Constructor
+//========================================================================
+template<class ELEMENT>
+LocalEqnTableProblem<ELEMENT>::LocalEqnTableProblem()
+{
+ // Bulk mesh
+ Bulk_mesh_pt=new RectangularQuadMesh<ELEMENT>(6,4,1.5,1.0);
+
+ // Flux elements on boundary 1 (x=1.5)
+ Flux_mesh_pt=new Mesh;
+ const unsigned flux_boundary=1;
+ const unsigned n_boundary_element=
+  Bulk_mesh_pt->nboundary_element(flux_boundary);
+ for (unsigned e=0;e<n_boundary_element;e++)
+  {
+   PoissonFluxElement<ELEMENT>* flux_el_pt=
+    new PoissonFluxElement<ELEMENT>(
+     Bulk_mesh_pt->boundary_element_pt(flux_boundary,e),
+     Bulk_mesh_pt->face_index_at_boundary(flux_boundary,e));
+   flux_el_pt->flux_fct_pt()=&GlobalParameters::prescribed_flux;
+   Flux_mesh_pt->add_element_pt(flux_el_pt);
+  }
+
+ // Pin the values on the other boundaries
+ const unsigned n_bound=Bulk_mesh_pt->nboundary();
+ for (unsigned b=0;b<n_bound;b++)
+  {
+   if (b!=flux_boundary)
+    {
+     const unsigned n_node=Bulk_mesh_pt->nboundary_node(b);
+     for (unsigned n=0;n<n_node;n++)
+      {
+       Bulk_mesh_pt->boundary_node_pt(b,n)->pin(0);
+      }
+    }
+  }
+
+ add_sub_mesh(Bulk_mesh_pt);
+ add_sub_mesh(Flux_mesh_pt);
+ build_global_mesh();
+
+ // The elements store pointers to their dofs
+ enable_store_local_dof_pt_in_elements();
+
+ oomph_info << "Number of equations: " << assign_eqn_numbers()
+            << std::endl;
+
+} // end of constructor
+
+
+
+//=====start_of_setup_and_check_local_eqn_tables==========================
+/// Set up the local equation tables of the global mesh and the
+/// sub-meshes and check them; return the number of mismatches
+//========================================================================
+template<class ELEMENT>
+unsigned LocalEqnTableProblem<ELEMENT>::setup_and_check_local_eqn_tables()
+{
+ unsigned n_mismatch=check_local_eqn_table(mesh_pt());
+ const unsigned n_sub_mesh=nsub_mesh();
+ for (unsigned m=0;m<n_sub_mesh;m++)
+  {
+   n_mismatch+=check_local_eqn_table(mesh_pt(m));
+  }
+ return n_mismatch;
+}
+
+
+
+//=====start_of_check_local_eqn_table=====================================
+/// Set up the local equation table of the given mesh (with the
+/// pointers to the dofs) and check it against the elements' equation
+/// numbers and the problem's dofs; return the number of mismatches
+//========================================================================
+template<class ELEMENT>
+unsigned LocalEqnTableProblem<ELEMENT>::check_local_eqn_table(
+ Mesh* const& mesh_pt)
+{
+ mesh_pt->setup_local_eqn_table(true);
+
+ unsigned n_mismatch=0;
+ const unsigned n_element=mesh_pt->nelement();
+ for (unsigned e=0;e<n_element;e++)
+  {
+   GeneralisedElement* el_pt=mesh_pt->element_pt(e);
+   const unsigned n_dof=el_pt->ndof();
+   if (mesh_pt->nlocal_eqn_in_table(e)!=n_dof)
+    {
+     n_mismatch++;
+     continue;
+    }
+   const unsigned long* global_eqn=mesh_pt->local_to_global_eqn_pt(e);
+   double* const* local_dof_pt=mesh_pt->local_dof_pt_in_table(e);
+   for (unsigned i=0;i<n_dof;i++)
+    {
+     const unsigned long eqn_number=el_pt->eqn_number(i);
+     if ((global_eqn[i]!=eqn_number)||(local_dof_pt[i]!=dof_pt(eqn_number)))
+      {
+       n_mismatch++;
+      }
+    }
+  }
+ return n_mismatch;
+}
+
+
+
+//===== start_of_copy_local_eqn_table==================================
+/// Copy the local equation table of the given mesh into a vector
+/// (with the elements' numbers of local equations)
+//=====================================================================
+void copy_local_eqn_table(Mesh* const& mesh_pt,
+                          Vector<unsigned long>& table)
+{
+ table.clear();
+ const unsigned n_element=mesh_pt->nelement();
+ for (unsigned e=0;e<n_element;e++)
+  {
+   const unsigned n_dof=mesh_pt->nlocal_eqn_in_table(e);
+   table.push_back(n_dof);
+   const unsigned long* global_eqn=mesh_pt->local_to_global_eqn_pt(e);
+   for (unsigned i=0;i<n_dof;i++)
+    {
+     table.push_back(global_eqn[i]);
+    }
+  }
+}
+
+
+
+//====== start_of_main================================================
+/// Driver: Compare the local equation tables obtained with the serial
+/// and the concurrent assignment of the local equation numbers
+//=====================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ typedef QPoissonElement<2,3> ELEMENT;
+ LocalEqnTableProblem<ELEMENT> problem;
+ trace_file << problem.ndof() << std::endl;
+
+ // Serial assignment of the local equation numbers
+ unsigned n_mismatch=problem.setup_and_check_local_eqn_tables();
+ oomph_info << "Number of mismatches in the local equation tables "
+            << "(serial numbering): " << n_mismatch << std::endl;
+ trace_file << (n_mismatch==0) << std::endl;
+ Vector<unsigned long> table_serial;
+ copy_local_eqn_table(problem.mesh_pt(),table_serial);
+ trace_file << table_serial.size() << std::endl;
+
+ // Concurrent assignment: Renumbering outdates the tables
+ problem.enable_parallel_local_eqn_numbering();
+ problem.assign_eqn_numbers();
+ bool tables_are_outdated=!problem.mesh_pt()->local_eqn_table_is_set_up();
+ const unsigned n_sub_mesh=problem.nsub_mesh();
+ for (unsigned m=0;m<n_sub_mesh;m++)
+  {
+   if (problem.mesh_pt(m)->local_eqn_table_is_set_up())
+    {
+     tables_are_outdated=false;
+    }
+  }
+ trace_file << tables_are_outdated << std::endl;
+
+ // The new tables must be identical
+ n_mismatch=problem.setup_and_check_local_eqn_tables();
+ oomph_info << "Number of mismatches in the local equation tables "
+            << "(concurrent numbering): " << n_mismatch << std::endl;
+ trace_file << (n_mismatch==0) << std::endl;
+ Vector<unsigned long> table_parallel;
+ copy_local_eqn_table(problem.mesh_pt(),table_parallel);
+ trace_file << (table_parallel==table_serial) << std::endl;
+
+ // A mesh with a null entry in its element vector: The entry has no
+ // local equations in the table
+ Mesh mesh_with_null_entry;
+ mesh_with_null_entry.add_element_pt(problem.bulk_mesh_pt()->element_pt(0));
+ mesh_with_null_entry.add_element_pt(0);
+ mesh_with_null_entry.add_element_pt(problem.bulk_mesh_pt()->element_pt(1));
+ mesh_with_null_entry.setup_local_eqn_table();
+ bool null_entry_is_skipped=
+  (mesh_with_null_entry.nlocal_eqn_in_table(1)==0);
+ for (unsigned e=0;e<3;e+=2)
+  {
+   GeneralisedElement* el_pt=mesh_with_null_entry.element_pt(e);
+   const unsigned n_dof=el_pt->ndof();
+   if (mesh_with_null_entry.nlocal_eqn_in_table(e)!=n_dof)
+    {
+     null_entry_is_skipped=false;
+     continue;
+    }
+   const unsigned long* global_eqn=
+    mesh_with_null_entry.local_to_global_eqn_pt(e);
+   for (unsigned i=0;i<n_dof;i++)
+    {
+     if (global_eqn[i]!=static_cast<unsigned long>(el_pt->eqn_number(i)))
+      {
+       null_entry_is_skipped=false;
+      }
+    }
+  }
+ trace_file << null_entry_is_skipped << std::endl;
+
+ // The elements belong to the problem's mesh
+ mesh_with_null_entry.flush_element_and_node_storage();
+
+ trace_file.close();
+ return 0;
+
+} // end of main
@@ -0,0 +1,247 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the hyper-reduction of a POD-based reduced-order model: Check
+//that the hyper-reduced residuals agree with those of the full
+//reduced-order model (which assembles all elements) and that the two
+//reduced-order solutions agree.
+
+//Generic routines
+#include "generic.h"
+
+// Poisson elements
+#include "poisson.h"
+
+// The mesh
+#include "meshes/rectangular_quadmesh.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for the source function
+//=====================================================================
+namespace TanhSolnForPoisson
+{
+
+ /// Amplitude of the first component of the source function
+ double A=1.0;
+
+ /// Amplitude of the second component of the source function
+ double B=0.0;
+
+ /// Amplitude of the third component of the source function
+ double C=0.0;
+
+ /// Source function: A linear combination of three fixed functions
+ void get_source(const Vector<double>& x, double& source)
+ {
+  source=A*sin(MathematicalConstants::Pi*x[0])*
+   sin(MathematicalConstants::Pi*x[1])
+   +B*exp(x[0]*x[1])+C*x[0]*x[0];
+ }
+
+} // end of namespace
+
+
+
+//====== start_of_problem_class=======================================
+/// Poisson problem in the unit square with homogeneous Dirichlet
+/// boundary conditions
+//====================================================================
+class PoissonProblem : public Problem
+{
+
+public:
+
+ /// Constructor: Pass the number of elements in each direction
+ PoissonProblem(const unsigned& n_element);
+
+ /// Destructor: Clean up the mesh
+ ~PoissonProblem()
+  {
+   delete mesh_pt();
+  }
+
+}; // end of problem class
+
+
+
+//=====start_of_constructor===============================================
+/// Constructor for the Poisson problem
+//========================================================================
+PoissonProblem::PoissonProblem(const unsigned& n_element)
+{
+ mesh_pt()=new RectangularQuadMesh<QPoissonElement<2,3> >(
+  n_element,n_element,1.0,1.0);
+
+ // Pin the boundary values (they are zero)
+ unsigned n_bound=mesh_pt()->nboundary();
+ for (unsigned b=0;b<n_bound;b++)
+  {
+   unsigned n_node=mesh_pt()->nboundary_node(b);
+   for (unsigned n=0;n<n_node;n++)
+    {
+     mesh_pt()->boundary_node_pt(b,n)->pin(0);
+    }
+  }
+
+ // Complete the build of the elements
+ unsigned n_el=mesh_pt()->nelement();
+ for (unsigned e=0;e<n_el;e++)
+  {
+   dynamic_cast<QPoissonElement<2,3>*>(mesh_pt()->element_pt(e))->
+    source_fct_pt()=&TanhSolnForPoisson::get_source;
+  }
+
+ // Setup equation numbering scheme
+ oomph_info << "Number of equations: " << assign_eqn_numbers() << std::endl;
+
+} // end of constructor
+
+
+
+//===== start_of_main=====================================================
+/// Driver: Build a reduced-order model from the solutions for a few
+/// source functions, and compare the hyper-reduced and the full
+/// reduced-order models for another source function
+//========================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ PoissonProblem problem(12);
+ ReducedOrderModel rom(&problem);
+
+ // Collect the snapshots
+ const unsigned n_snapshot=5;
+ double a[n_snapshot]={1.0,0.0,0.0,0.5,-1.0};
+ double b[n_snapshot]={0.0,1.0,0.0,0.5,2.0};
+ double c[n_snapshot]={0.0,0.0,1.0,-0.5,1.0};
+ for (unsigned i=0;i<n_snapshot;i++)
+  {
+   TanhSolnForPoisson::A=a[i];
+   TanhSolnForPoisson::B=b[i];
+   TanhSolnForPoisson::C=c[i];
+   problem.newton_solve();
+   rom.add_snapshot();
+  }
+
+ // Build the basis
+ rom.build_pod_basis(4,1.0e-14);
+ const unsigned n_mode=rom.nmode();
+ const unsigned n_element=problem.mesh_pt()->nelement();
+ oomph_info << "Number of modes: " << n_mode << std::endl;
+ trace_file << problem.ndof() << std::endl;
+ trace_file << n_mode << std::endl;
+
+ // New source function
+ TanhSolnForPoisson::A=1.7;
+ TanhSolnForPoisson::B=-0.6;
+ TanhSolnForPoisson::C=0.3;
+
+ // Full reduced-order model: Residuals for some modal coefficients, and
+ // the solution
+ Vector<double> coefficients(n_mode);
+ for (unsigned m=0;m<n_mode;m++)
+  {
+   coefficients[m]=0.1*double(m+1);
+  }
+ rom.set_problem_dofs(coefficients);
+ Vector<double> full_residuals;
+ rom.get_reduced_residuals(full_residuals);
+ rom.reduced_newton_solve();
+ const unsigned n_dof=problem.ndof();
+ Vector<double> full_solution(n_dof);
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   full_solution[i]=problem.dof(i);
+  }
+
+ // Hyper-reduced model
+ rom.setup_hyper_reduction(1.0e-10);
+ oomph_info << "Number of sampled elements: " << rom.nsampled_element()
+            << " out of " << n_element << std::endl;
+ if (rom.nsampled_element()<n_element)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ // Compare the residuals
+ rom.set_problem_dofs(coefficients);
+ Vector<double> hyper_residuals;
+ rom.get_reduced_residuals(hyper_residuals);
+ double max_residual=0.0;
+ double max_residual_diff=0.0;
+ for (unsigned m=0;m<n_mode;m++)
+  {
+   max_residual=std::max(max_residual,std::fabs(full_residuals[m]));
+   max_residual_diff=std::max(max_residual_diff,
+                              std::fabs(full_residuals[m]-
+                                        hyper_residuals[m]));
+  }
+ oomph_info << "Max. reduced residual: " << max_residual
+            << "; max. difference between the full and hyper-reduced "
+            << "residuals: " << max_residual_diff << std::endl;
+ if (max_residual_diff<1.0e-6*max_residual)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ // Compare the solutions
+ rom.reduced_newton_solve();
+ double max_solution=0.0;
+ double max_solution_diff=0.0;
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   max_solution=std::max(max_solution,std::fabs(full_solution[i]));
+   max_solution_diff=std::max(max_solution_diff,
+                              std::fabs(full_solution[i]-problem.dof(i)));
+  }
+ oomph_info << "Max. difference between the full and hyper-reduced "
+            << "solutions: " << max_solution_diff << std::endl;
+ if (max_solution_diff<1.0e-6*max_solution)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
@@ -0,0 +1,198 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test that the refinement of quad and brick meshes produces the same
+//nodes, in the same order and at the same positions, whether the
+//nodes that have already been created by neighbouring sons are found
+//in the refinement node hash table or by searching the neighbours
+
+//Generic routines
+#include "generic.h"
+
+// Poisson elements
+#include "poisson.h"
+
+// The meshes
+#include "meshes/rectangular_quadmesh.h"
+#include "meshes/simple_cubic_mesh.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_compare_meshes=======================================
+/// Compare two meshes node by node: Document the numbers of elements,
+/// nodes and hanging nodes in the first mesh and flags that indicate
+/// if the second mesh has the same numbers, and if its nodes are at
+/// the same positions (to within roundoff) as those of the first one.
+//=====================================================================
+void compare_meshes(Mesh* const& mesh_1_pt, Mesh* const& mesh_2_pt,
+                    ofstream& trace_file)
+{
+ const unsigned n_element=mesh_1_pt->nelement();
+ const unsigned n_node=mesh_1_pt->nnode();
+
+ // Count the hanging nodes
+ unsigned n_hang_1=0;
+ unsigned n_hang_2=0;
+ for (unsigned j=0;j<n_node;j++)
+  {
+   if (mesh_1_pt->node_pt(j)->is_hanging()) n_hang_1++;
+  }
+ const unsigned n_node_2=mesh_2_pt->nnode();
+ for (unsigned j=0;j<n_node_2;j++)
+  {
+   if (mesh_2_pt->node_pt(j)->is_hanging()) n_hang_2++;
+  }
+
+ oomph_info << "Number of elements, nodes and hanging nodes: "
+            << n_element << " " << n_node << " " << n_hang_1
+            << " (with hash table) "
+            << mesh_2_pt->nelement() << " " << n_node_2 << " " << n_hang_2
+            << " (without hash table)" << std::endl;
+
+ trace_file << n_element << std::endl;
+ trace_file << n_node << std::endl;
+ trace_file << n_hang_1 << std::endl;
+
+ // Same numbers?
+ if ((mesh_2_pt->nelement()==n_element)&&(n_node_2==n_node)&&
+     (n_hang_2==n_hang_1))
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+   trace_file << "0" << std::endl;
+   return;
+  }
+
+ // Same positions?
+ double max_diff=0.0;
+ const unsigned dim=mesh_1_pt->node_pt(0)->ndim();
+ for (unsigned j=0;j<n_node;j++)
+  {
+   for (unsigned i=0;i<dim;i++)
+    {
+     max_diff=std::max(max_diff,std::fabs(mesh_1_pt->node_pt(j)->x(i)-
+                                          mesh_2_pt->node_pt(j)->x(i)));
+    }
+  }
+ oomph_info << "Max. difference between the nodal positions: "
+            << max_diff << std::endl;
+ if (max_diff<1.0e-14)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+} // end of compare_meshes
+
+
+
+//===== start_of_refine_and_compare===================================
+/// Refine two copies of the same mesh, the first one with the
+/// refinement node hash table enabled, the second one with it
+/// disabled: First refine uniformly, then refine every third element
+/// twice (so that the neighbouring sons differ by more than one
+/// level) and compare the meshes after each step.
+//=====================================================================
+void refine_and_compare(TreeBasedRefineableMeshBase* const& mesh_1_pt,
+                        TreeBasedRefineableMeshBase* const& mesh_2_pt,
+                        ofstream& trace_file)
+{
+ mesh_1_pt->enable_refinement_node_hash_table();
+ mesh_2_pt->disable_refinement_node_hash_table();
+
+ // Uniform refinement
+ mesh_1_pt->refine_uniformly();
+ mesh_2_pt->refine_uniformly();
+ compare_meshes(mesh_1_pt,mesh_2_pt,trace_file);
+
+ // Two rounds of selective refinement
+ for (unsigned round=0;round<2;round++)
+  {
+   Vector<unsigned> elements_to_be_refined;
+   const unsigned n_element=mesh_1_pt->nelement();
+   for (unsigned e=round;e<n_element;e+=3)
+    {
+     elements_to_be_refined.push_back(e);
+    }
+   mesh_1_pt->refine_selected_elements(elements_to_be_refined);
+   mesh_2_pt->refine_selected_elements(elements_to_be_refined);
+   compare_meshes(mesh_1_pt,mesh_2_pt,trace_file);
+  }
+
+} // end of refine_and_compare
+
+
+
+//====== start_of_main================================================
+/// Driver: Compare the refinement with and without the refinement
+/// node hash table for a 2D quad mesh and a 3D brick mesh
+//=====================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ // 2D: Quad mesh
+ {
+  oomph_info << "Quad mesh:" << std::endl;
+  typedef RefineableQPoissonElement<2,3> ELEMENT;
+  RefineableRectangularQuadMesh<ELEMENT>* mesh_1_pt=
+   new RefineableRectangularQuadMesh<ELEMENT>(3,2,1.5,1.0);
+  RefineableRectangularQuadMesh<ELEMENT>* mesh_2_pt=
+   new RefineableRectangularQuadMesh<ELEMENT>(3,2,1.5,1.0);
+
+  refine_and_compare(mesh_1_pt,mesh_2_pt,trace_file);
+
+  delete mesh_1_pt;
+  delete mesh_2_pt;
+ }
+
+ // 3D: Brick mesh
+ {
+  oomph_info << "Brick mesh:" << std::endl;
+  typedef RefineableQPoissonElement<3,3> ELEMENT;
+  RefineableSimpleCubicMesh<ELEMENT>* mesh_1_pt=
+   new RefineableSimpleCubicMesh<ELEMENT>(2,2,2,1.0,1.0,1.0);
+  RefineableSimpleCubicMesh<ELEMENT>* mesh_2_pt=
+   new RefineableSimpleCubicMesh<ELEMENT>(2,2,2,1.0,1.0,1.0);
+
+  refine_and_compare(mesh_1_pt,mesh_2_pt,trace_file);
+
+  delete mesh_1_pt;
+  delete mesh_2_pt;
+ }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
@@ -0,0 +1,328 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the typed assembly of the Jacobian and the residuals: Assemble
+//them for a Poisson problem with flux boundary conditions, computing
+//the contributions of the bulk elements with the typed kernel (and
+//those of the flux elements through the virtual interface), and
+//compare them with those from the standard assembly. Then solve the
+//problem with both.
+
+//Generic routines
+#include "generic.h"
+
+// Poisson elements
+#include "poisson.h"
+
+// The mesh
+#include "meshes/rectangular_quadmesh.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//===== start_of_namespace=============================================
+/// Namespace for the source function and the prescribed flux
+//=====================================================================
+namespace GlobalParameters
+{
+
+ /// Source function
+ void source_function(const Vector<double>& x, double& source)
+ {
+  source=sin(x[0])*cos(2.0*x[1])-1.0;
+ }
+
+ /// Prescribed flux
+ void prescribed_flux(const Vector<double>& x, double& flux)
+ {
+  flux=1.0+x[1]*x[1];
+ }
+
+} // end of namespace
+
+
+
+//====== start_of_problem_class=======================================
+/// Poisson problem with Dirichlet conditions on three boundaries and
+/// a prescribed flux on the fourth. The Jacobian and the residuals can
+/// be assembled with the typed kernel for the bulk elements.
+//====================================================================
+template<class ELEMENT>
+class TypedAssemblyProblem : public Problem
+{
+
+public:
+
+ /// Constructor
+ TypedAssemblyProblem();
+
+ /// Destructor: Clean up
+ ~TypedAssemblyProblem()
+  {
+   delete Bulk_mesh_pt;
+   const unsigned n_element=Flux_mesh_pt->nelement();
+   for (unsigned e=0;e<n_element;e++)
+    {
+     delete Flux_mesh_pt->element_pt(e);
+    }
+   Flux_mesh_pt->flush_element_and_node_storage();
+   delete Flux_mesh_pt;
+  }
+
+ /// Enable the typed assembly
+ void enable_typed_assembly() {Use_typed_assembly=true;}
+
+ /// Disable the typed assembly
+ void disable_typed_assembly() {Use_typed_assembly=false;}
+
+ /// Number of elements whose contributions were computed with the
+ /// typed kernel during the most recent assembly
+ unsigned long ntyped_element() const {return Ntyped_element;}
+
+ /// Overload the assembly of the Jacobian (used by the Newton solver)
+ void get_jacobian(DoubleVector& residuals, CRDoubleMatrix& jacobian)
+  {
+   if (Use_typed_assembly)
+    {
+     Ntyped_element=get_jacobian_by_element_type<ELEMENT>(residuals,jacobian);
+    }
+   else
+    {
+     Ntyped_element=0;
+     Problem::get_jacobian(residuals,jacobian);
+    }
+  }
+
+private:
+
+ /// Pointer to the bulk mesh
+ RectangularQuadMesh<ELEMENT>* Bulk_mesh_pt;
+
+ /// Pointer to the mesh of flux elements
+ Mesh* Flux_mesh_pt;
+
+ /// Use the typed assembly?
+ bool Use_typed_assembly;
+
+ /// Number of elements whose contributions were computed with the
+ /// typed kernel during the most recent assembly
+ unsigned long Ntyped_element;
+
+}; // end of problem class
+
+
+
+//=====start_of_constructor===============================================
+/// Constructor
+//========================================================================
+template<class ELEMENT>
+TypedAssemblyProblem<ELEMENT>::TypedAssemblyProblem()
+ : Use_typed_assembly(false), Ntyped_element(0)
+{
+ // Bulk mesh
+ Bulk_mesh_pt=new RectangularQuadMesh<ELEMENT>(6,4,1.5,1.0);
+
+ // Flux elements on boundary 1 (x=1.5)
+ Flux_mesh_pt=new Mesh;
+ const unsigned flux_boundary=1;
+ const unsigned n_boundary_element=
+  Bulk_mesh_pt->nboundary_element(flux_boundary);
+ for (unsigned e=0;e<n_boundary_element;e++)
+  {
+   PoissonFluxElement<ELEMENT>* flux_el_pt=
+    new PoissonFluxElement<ELEMENT>(
+     Bulk_mesh_pt->boundary_element_pt(flux_boundary,e),
+     Bulk_mesh_pt->face_index_at_boundary(flux_boundary,e));
+   flux_el_pt->flux_fct_pt()=&GlobalParameters::prescribed_flux;
+   Flux_mesh_pt->add_element_pt(flux_el_pt);
+  }
+
+ // Pin the values on the other boundaries
+ const unsigned n_bound=Bulk_mesh_pt->nboundary();
+ for (unsigned b=0;b<n_bound;b++)
+  {
+   if (b!=flux_boundary)
+    {
+     const unsigned n_node=Bulk_mesh_pt->nboundary_node(b);
+     for (unsigned n=0;n<n_node;n++)
+      {
+       Bulk_mesh_pt->boundary_node_pt(b,n)->pin(0);
+      }
+    }
+  }
+
+ // Set the source function
+ const unsigned n_element=Bulk_mesh_pt->nelement();
+ for (unsigned e=0;e<n_element;e++)
+  {
+   dynamic_cast<ELEMENT*>(Bulk_mesh_pt->element_pt(e))->source_fct_pt()=
+    &GlobalParameters::source_function;
+  }
+
+ add_sub_mesh(Bulk_mesh_pt);
+ add_sub_mesh(Flux_mesh_pt);
+ build_global_mesh();
+
+ oomph_info << "Number of equations: " << assign_eqn_numbers()
+            << std::endl;
+
+} // end of constructor
+
+
+
+//===== start_of_max_difference=======================================
+/// Maximum difference between the entries of two residual vectors and
+/// two Jacobians (which must have the same sparsity pattern; the
+/// entries within each row may be stored in different orders)
+//====================================================================
+double max_difference(DoubleVector& residuals_1, CRDoubleMatrix& jacobian_1,
+                      DoubleVector& residuals_2, CRDoubleMatrix& jacobian_2)
+{
+ double max_diff=0.0;
+ const unsigned n_row=residuals_1.nrow();
+ for (unsigned i=0;i<n_row;i++)
+  {
+   max_diff=std::max(max_diff,std::fabs(residuals_1[i]-residuals_2[i]));
+  }
+ const unsigned n_nz=jacobian_1.nnz();
+ if (jacobian_2.nnz()!=n_nz)
+  {
+   oomph_info << "Jacobians have different numbers of nonzeros: "
+              << n_nz << " " << jacobian_2.nnz() << std::endl;
+   return 1.0;
+  }
+ jacobian_1.sort_entries();
+ jacobian_2.sort_entries();
+ for (unsigned k=0;k<n_nz;k++)
+  {
+   if (jacobian_1.column_index()[k]!=jacobian_2.column_index()[k])
+    {
+     oomph_info << "Jacobians have different sparsity patterns"
+                << std::endl;
+     return 1.0;
+    }
+   max_diff=std::max(max_diff,std::fabs(jacobian_1.value()[k]-
+                                        jacobian_2.value()[k]));
+  }
+ return max_diff;
+}
+
+
+
+//====== start_of_main================================================
+/// Driver: Compare the typed assembly with the standard one and solve
+/// the problem with both
+//=====================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+ trace_file.precision(10);
+
+ typedef QPoissonElement<2,3> ELEMENT;
+ TypedAssemblyProblem<ELEMENT> problem;
+
+ // Start from a non-trivial state
+ const unsigned n_dof=problem.ndof();
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   problem.dof(i)=0.1*sin(double(i));
+  }
+
+ // Standard assembly
+ DoubleVector residuals_standard;
+ CRDoubleMatrix jacobian_standard;
+ problem.get_jacobian(residuals_standard,jacobian_standard);
+
+ // Typed assembly
+ problem.enable_typed_assembly();
+ DoubleVector residuals_typed;
+ CRDoubleMatrix jacobian_typed;
+ problem.get_jacobian(residuals_typed,jacobian_typed);
+
+ oomph_info << "Number of elements assembled with the typed kernel: "
+            << problem.ntyped_element() << " (out of "
+            << problem.mesh_pt()->nelement() << ")" << std::endl;
+ trace_file << problem.ntyped_element() << std::endl;
+ trace_file << problem.mesh_pt()->nelement_type_group() << std::endl;
+
+ // Differences should be at the level of roundoff (the contributions
+ // are added in a different order)
+ double max_diff=max_difference(residuals_standard,jacobian_standard,
+                                residuals_typed,jacobian_typed);
+ oomph_info << "Max. difference between standard and typed assembly: "
+            << max_diff << std::endl;
+ if (max_diff<1.0e-12)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ // Solve with the typed assembly...
+ problem.newton_solve();
+ Vector<double> solution_typed(n_dof);
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   solution_typed[i]=problem.dof(i);
+  }
+
+ // ...and, from the same initial guess, with the standard one
+ problem.disable_typed_assembly();
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   problem.dof(i)=0.1*sin(double(i));
+  }
+ problem.newton_solve();
+
+ max_diff=0.0;
+ for (unsigned i=0;i<n_dof;i++)
+  {
+   max_diff=std::max(max_diff,std::fabs(problem.dof(i)-solution_typed[i]));
+  }
+ oomph_info << "Max. difference between solutions: " << max_diff
+            << std::endl;
+ if (max_diff<1.0e-10)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+ // Document every tenth value
+ for (unsigned i=0;i<n_dof;i+=10)
+  {
+   trace_file << solution_typed[i] << std::endl;
+  }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
@@ -0,0 +1,290 @@
+//LIC// ====================================================================
+//LIC// This file forms part of oomph-lib, the object-oriented,
+//LIC// multi-physics finite-element library, available
+//LIC// at http://www.oomph-lib.org.
+//LIC//
+//LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+//LIC//
+//LIC// This library is free software; you can redistribute it and/or
+//LIC// modify it under the terms of the GNU Lesser General Public
+//LIC// License as published by the Free Software Foundation; either
+//LIC// version 2.1 of the License, or (at your option) any later version.
+//LIC//
+//LIC// This library is distributed in the hope that it will be useful,
+//LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+//LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//LIC// Lesser General Public License for more details.
+//LIC//
+//LIC// You should have received a copy of the GNU Lesser General Public
+//LIC// License along with this library; if not, write to the Free Software
+//LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+//LIC// 02110-1301  USA.
+//LIC//
+//LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+//LIC//
+//LIC//====================================================================
+//Test the analytic Jacobian of the Kirchhoff-Love shell elements:
+//Compare it against the finite-difference Jacobian for the elements
+//of a curved (elliptical) shell that is deformed, accelerated,
+//prestressed and subject to a position- and normal-dependent load,
+//with and without the membrane terms
+
+//Generic routines
+#include "generic.h"
+
+// The shell equations
+#include "shell.h"
+
+// The mesh
+#include "meshes/circular_shell_mesh.h"
+
+using namespace std;
+
+using namespace oomph;
+
+
+//==start_of_namespace====================================================
+/// Namespace for physical parameters
+//========================================================================
+namespace Global_Physical_Variables
+{
+
+ /// Non-dimensional wall thickness
+ double H=0.05;
+
+ /// Timescale ratio (non-dimensional density)
+ double Lambda_sq=0.5;
+
+ /// Axial prestress
+ double Sigma_xx=0.3;
+
+ /// Shear prestress
+ double Sigma_xy=0.1;
+
+ /// Azimuthal prestress
+ double Sigma_yy=-0.2;
+
+ /// Pressure load
+ double P_ext=2.0;
+
+ /// Load: External pressure acting along the normal plus a traction
+ /// that varies with the Eulerian and Lagrangian position
+ void load(const Vector<double>& xi, const Vector<double>& x,
+           const Vector<double>& N, Vector<double>& load)
+ {
+  for (unsigned i=0;i<3;i++)
+   {
+    load[i]=-P_ext*N[i]+0.1*x[i]*(1.0+xi[0])*x[(i+1)%3];
+   }
+ }
+
+} // end_of_namespace
+
+
+
+//==start_of_problem_class================================================
+/// Problem that holds the mesh of shell elements
+//========================================================================
+template<class ELEMENT>
+class ShellJacobianProblem : public Problem
+{
+
+public:
+
+ /// Constructor: Build the mesh, deform it and set the history values
+ ShellJacobianProblem();
+
+ /// Destructor: Clean up
+ ~ShellJacobianProblem()
+  {
+   delete mesh_pt();
+   delete Undeformed_geom_pt;
+   delete time_stepper_pt();
+  }
+
+ /// Compare the analytic and finite-difference element Jacobians:
+ /// Document a flag that indicates if the residuals agree and a flag
+ /// that indicates if the Jacobians agree to within the finite-difference
+ /// error
+ void compare_jacobians(ofstream& trace_file);
+
+private:
+
+ /// Geometric object that specifies the undeformed midplane
+ GeomObject* Undeformed_geom_pt;
+
+}; // end of problem class
+
+
+
+//==start_of_constructor==================================================
+/// Constructor
+//========================================================================
+template<class ELEMENT>
+ShellJacobianProblem<ELEMENT>::ShellJacobianProblem()
+{
+ // Timestepper: Newmark, so that the inertia terms contribute
+ add_time_stepper_pt(new Newmark<2>);
+
+ // Build the mesh on a quarter of the circumference
+ unsigned nx=2;
+ unsigned ny=2;
+ double length=1.0;
+ double ly=0.5*MathematicalConstants::Pi;
+ CircularCylindricalShellMesh<ELEMENT>* shell_mesh_pt=
+  new CircularCylindricalShellMesh<ELEMENT>(nx,ny,length,ly,
+                                            time_stepper_pt());
+ mesh_pt()=shell_mesh_pt;
+
+ // Undeformed shape: An elliptical tube
+ Undeformed_geom_pt=new EllipticalTube(1.0,1.2);
+ shell_mesh_pt->assign_undeformed_positions(Undeformed_geom_pt);
+
+ // Complete the build of the elements
+ unsigned n_element=mesh_pt()->nelement();
+ for (unsigned e=0;e<n_element;e++)
+  {
+   ELEMENT* el_pt=dynamic_cast<ELEMENT*>(mesh_pt()->element_pt(e));
+   el_pt->undeformed_midplane_pt()=Undeformed_geom_pt;
+   el_pt->h_pt()=&Global_Physical_Variables::H;
+   el_pt->lambda_sq_pt()=&Global_Physical_Variables::Lambda_sq;
+   el_pt->load_vector_fct_pt()=&Global_Physical_Variables::load;
+   el_pt->set_prestress_pt(0,0,&Global_Physical_Variables::Sigma_xx);
+   el_pt->set_prestress_pt(0,1,&Global_Physical_Variables::Sigma_xy);
+   el_pt->set_prestress_pt(1,1,&Global_Physical_Variables::Sigma_yy);
+  }
+
+ // Setup equation numbering scheme
+ oomph_info << "Number of equations: " << assign_eqn_numbers() << std::endl;
+
+ // Start from rest in the undeformed configuration
+ initialise_dt(0.1);
+ assign_initial_values_impulsive();
+
+ // Now deform the shell (this also accelerates it)
+ unsigned n_node=mesh_pt()->nnode();
+ for (unsigned j=0;j<n_node;j++)
+  {
+   Node* nod_pt=mesh_pt()->node_pt(j);
+   for (unsigned k=0;k<4;k++)
+    {
+     for (unsigned i=0;i<3;i++)
+      {
+       nod_pt->x_gen(k,i)+=0.05*sin(double(1+j+3*k+7*i));
+      }
+    }
+  }
+
+} // end of constructor
+
+
+
+//==start_of_compare_jacobians============================================
+/// Compare the analytic and the finite-difference element Jacobians
+//========================================================================
+template<class ELEMENT>
+void ShellJacobianProblem<ELEMENT>::compare_jacobians(ofstream& trace_file)
+{
+ double max_residual_diff=0.0;
+ double max_jacobian_diff=0.0;
+ double max_jacobian_entry=0.0;
+ unsigned n_element=mesh_pt()->nelement();
+ for (unsigned e=0;e<n_element;e++)
+  {
+   ELEMENT* el_pt=dynamic_cast<ELEMENT*>(mesh_pt()->element_pt(e));
+   unsigned n_dof=el_pt->ndof();
+
+   // Analytic Jacobian
+   el_pt->disable_evaluate_jacobian_by_fd();
+   Vector<double> residuals(n_dof);
+   DenseMatrix<double> jacobian(n_dof,n_dof);
+   el_pt->get_jacobian(residuals,jacobian);
+
+   // Finite-difference Jacobian
+   el_pt->enable_evaluate_jacobian_by_fd();
+   Vector<double> residuals_fd(n_dof);
+   DenseMatrix<double> jacobian_fd(n_dof,n_dof);
+   el_pt->get_jacobian(residuals_fd,jacobian_fd);
+   el_pt->disable_evaluate_jacobian_by_fd();
+
+   for (unsigned i=0;i<n_dof;i++)
+    {
+     max_residual_diff=std::max(max_residual_diff,
+                                std::fabs(residuals[i]-residuals_fd[i]));
+     for (unsigned j=0;j<n_dof;j++)
+      {
+       max_jacobian_diff=std::max(max_jacobian_diff,
+                                  std::fabs(jacobian(i,j)-
+                                            jacobian_fd(i,j)));
+       max_jacobian_entry=std::max(max_jacobian_entry,
+                                   std::fabs(jacobian_fd(i,j)));
+      }
+    }
+  }
+
+ oomph_info << "Max. difference between the residuals: "
+            << max_residual_diff << std::endl;
+ oomph_info << "Max. difference between the Jacobians: "
+            << max_jacobian_diff << " (max. entry: "
+            << max_jacobian_entry << ")" << std::endl;
+
+ trace_file << n_element << std::endl;
+ if (max_residual_diff<1.0e-12*max_jacobian_entry)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+ if (max_jacobian_diff<1.0e-5*max_jacobian_entry)
+  {
+   trace_file << "1" << std::endl;
+  }
+ else
+  {
+   trace_file << "0" << std::endl;
+  }
+
+} // end of compare_jacobians
+
+
+
+//==start_of_main=========================================================
+/// Driver: Compare the analytic and the finite-difference Jacobians
+/// of the shell elements with and without the membrane terms
+//========================================================================
+int main()
+{
+ ofstream trace_file("RESLT/trace.dat");
+
+ // Hermite shell elements
+ {
+  ShellJacobianProblem<HermiteShellElement> problem;
+
+  oomph_info << "HermiteShellElement:" << std::endl;
+  problem.compare_jacobians(trace_file);
+
+  oomph_info << "HermiteShellElement without membrane terms:" << std::endl;
+  unsigned n_element=problem.mesh_pt()->nelement();
+  for (unsigned e=0;e<n_element;e++)
+   {
+    dynamic_cast<HermiteShellElement*>(problem.mesh_pt()->element_pt(e))->
+     disable_membrane_terms();
+   }
+  problem.compare_jacobians(trace_file);
+ }
+
+ // Hermite shell elements with diagonal Jacobian of the mapping
+ // between local and Lagrangian coordinates
+ {
+  ShellJacobianProblem<DiagHermiteShellElement> problem;
+
+  oomph_info << "DiagHermiteShellElement:" << std::endl;
+  problem.compare_jacobians(trace_file);
+ }
+
+ trace_file.close();
+ return 0;
+
+} // end of main
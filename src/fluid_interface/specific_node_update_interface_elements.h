@@ -287,6 +287,45 @@ namespace oomph
       this->fill_in_jacobian_from_geometric_data(jacobian);
     }
 
+    /// The number of "DOF types" that degrees of freedom in this element
+    /// are sub-divided into: The spine heights (which are determined
+    /// by the kinematic condition).
+    unsigned ndof_types() const
+    {
+      return 1;
+    }
+
+    /// Create a list of pairs for all unknowns in this element,
+    /// so that the first entry in each pair contains the global equation
+    /// number of the unknown, while the second one contains the number
+    /// of the "DOF type" that this unknown is associated with.
+    /// Only the spine heights are classified (as DOF type 0); the fluid
+    /// unknowns are classified by the bulk elements.
+    void get_dof_numbers_for_unknowns(
+      std::list<std::pair<unsigned long, unsigned>>& dof_lookup_list) const
+    {
+      // temporary pair (used to store dof lookup prior to being added to list)
+      std::pair<unsigned long, unsigned> dof_lookup;
+
+      // Loop over the nodes
+      const unsigned n_node = this->nnode();
+      for (unsigned n = 0; n < n_node; n++)
+      {
+        // Get the spine height at the node
+        SpineNode* spine_nod_pt = static_cast<SpineNode*>(this->node_pt(n));
+        Data* spine_height_pt = spine_nod_pt->spine_pt()->spine_height_pt();
+
+        // Ignore pinned spine heights
+        long global_eqn = spine_height_pt->eqn_number(0);
+        if (global_eqn >= 0)
+        {
+          dof_lookup.first = global_eqn;
+          dof_lookup.second = 0;
+          dof_lookup_list.push_front(dof_lookup);
+        }
+      }
+    }
+
     /// \short
     /// Helper function to calculate the additional contributions
     /// These are those filled in by the particular equations
@@ -845,6 +884,61 @@ namespace oomph
       this->fill_in_jacobian_from_solid_position_by_fd(jacobian);
     }
 
+    /// The number of "DOF types" that degrees of freedom in this element
+    /// are sub-divided into: The nodal positions on the interface
+    /// (one per coordinate direction) followed by the Lagrange multiplier
+    /// that enforces the kinematic condition.
+    unsigned ndof_types() const
+    {
+      return this->nodal_dimension() + 1;
+    }
+
+    /// Create a list of pairs for all unknowns in this element,
+    /// so that the first entry in each pair contains the global equation
+    /// number of the unknown, while the second one contains the number
+    /// of the "DOF type" that this unknown is associated with.
+    /// The positions of the interface nodes are labelled 0,...,DIM-1
+    /// (which reclassifies them if the bulk elements in an earlier mesh
+    /// have labelled them as mesh-motion dofs) and the Lagrange multipliers
+    /// are labelled DIM. The fluid unknowns are left to the bulk elements.
+    void get_dof_numbers_for_unknowns(
+      std::list<std::pair<unsigned long, unsigned>>& dof_lookup_list) const
+    {
+      // temporary pair (used to store dof lookup prior to being added to list)
+      std::pair<unsigned long, unsigned> dof_lookup;
+
+      // Number of nodes and spatial dimension
+      const unsigned n_node = this->nnode();
+      const unsigned nodal_dim = this->nodal_dimension();
+
+      // Loop over the nodes
+      for (unsigned n = 0; n < n_node; n++)
+      {
+        // Positions of the interface node
+        SolidNode* solid_nod_pt = static_cast<SolidNode*>(this->node_pt(n));
+        for (unsigned i = 0; i < nodal_dim; i++)
+        {
+          // Ignore pinned positions
+          long global_eqn = solid_nod_pt->position_eqn_number(0, i);
+          if (global_eqn >= 0)
+          {
+            dof_lookup.first = global_eqn;
+            dof_lookup.second = i;
+            dof_lookup_list.push_front(dof_lookup);
+          }
+        }
+
+        // Lagrange multiplier (ignore it if it is pinned)
+        long global_eqn = solid_nod_pt->eqn_number(this->Lagrange_index[n]);
+        if (global_eqn >= 0)
+        {
+          dof_lookup.first = global_eqn;
+          dof_lookup.second = nodal_dim;
+          dof_lookup_list.push_front(dof_lookup);
+        }
+      }
+    }
+
     /// Overload the output function
     void output(std::ostream& outfile)
     {
@@ -71,7 +71,7 @@ namespace oomph
                                              const unsigned& t,
                                              const unsigned& i)
   {
-    return *(problem_pt->dof_pt(i) + t);
+    return *(problem_pt->dof_pt(t, i));
   }
 
 
@@ -629,11 +629,6 @@ namespace oomph
 
     // Now let's assemble stuff
     const unsigned n_dof = this->ndof();
-    // Allocate storage for the local mass matrix (if required)
-    if (M_pt == 0)
-    {
-      M_pt = new DenseDoubleMatrix;
-    }
 
     // Resize and initialise the vector that will holds the residuals
     minv_res.resize(n_dof);
@@ -642,6 +637,21 @@ namespace oomph
       minv_res[n] = 0.0;
     }
 
+    // If the mass matrix has been factorised in a batch, get the
+    // residuals and backsubstitute with its factors
+    if (Batched_mass_matrix_lu_pt != 0)
+    {
+      this->fill_in_contribution_to_residuals(minv_res);
+      Batched_mass_matrix_lu_pt->solve(Batched_mass_matrix_index, minv_res);
+      return;
+    }
+
+    // Allocate storage for the local mass matrix (if required)
+    if (M_pt == 0)
+    {
+      M_pt = new DenseDoubleMatrix;
+    }
+
     // If we are recycling the mass matrix
     if (Mass_matrix_reuse_is_enabled && Mass_matrix_has_been_computed)
     {
@@ -734,6 +744,86 @@ namespace oomph
   double DGMesh::FaceTolerance = 1.0e-10;
 
 
+  //======================================================================
+  /// Compute the mass matrices of all the elements and LU decompose
+  /// them in one batch (in parallel if OpenMP is available). The
+  /// elements then use these factors in
+  /// get_inverse_mass_matrix_times_residuals() until their mass matrix
+  /// reuse is enabled or disabled again.
+  //======================================================================
+  void DGMesh::pre_compute_batched_mass_matrices()
+  {
+    const unsigned long n_element = this->nelement();
+    if (n_element == 0)
+    {
+      Mass_matrix_lu.clean_up_memory();
+      return;
+    }
+
+    // All mass matrices must have the same size
+    const unsigned n_dof = this->element_pt(0)->ndof();
+#ifdef PARANOID
+    for (unsigned long e = 0; e < n_element; e++)
+    {
+      if (this->element_pt(e)->ndof() != n_dof)
+      {
+        std::ostringstream error_stream;
+        error_stream << "The mass matrices can only be factorised in a batch "
+                     << "if all elements\nhave the same number of dofs. "
+                     << "Element 0 has " << n_dof << " dofs but element " << e
+                     << " has " << this->element_pt(e)->ndof() << ".\n";
+        throw OomphLibError(
+          error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+      }
+      if (this->element_pt(e)->nexternal_data() > 0)
+      {
+        std::ostringstream error_stream;
+        error_stream
+          << "Cannot use a discontinuous formulation for the mass matrix when\n"
+          << "there are external data (element " << e << " has some).\n";
+        throw OomphLibError(
+          error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+      }
+    }
+#endif
+
+    // Collect the mass matrices, element after element, each one row
+    // by row
+    Vector<double> mass_matrix_values(n_dof * n_dof * n_element);
+    Vector<double> dummy(n_dof);
+    DenseMatrix<double> mass_matrix(n_dof, n_dof);
+    for (unsigned long e = 0; e < n_element; e++)
+    {
+      this->element_pt(e)->get_mass_matrix(dummy, mass_matrix);
+      double* const values_pt = &mass_matrix_values[0] + n_dof * n_dof * e;
+      for (unsigned i = 0; i < n_dof; i++)
+      {
+        for (unsigned j = 0; j < n_dof; j++)
+        {
+          values_pt[n_dof * i + j] = mass_matrix(i, j);
+        }
+      }
+    }
+
+    // Factorise them all in one go
+    if (n_dof > 0)
+    {
+      Mass_matrix_lu.factorise(n_dof, n_element, &mass_matrix_values[0]);
+    }
+    else
+    {
+      Mass_matrix_lu.clean_up_memory();
+    }
+
+    // Tell the elements where to find their factors
+    for (unsigned long e = 0; e < n_element; e++)
+    {
+      dynamic_cast<DGElement*>(this->element_pt(e))
+        ->set_mass_matrix_from_batch(&Mass_matrix_lu, e);
+    }
+  }
+
+
   //====================================================
   /// Helper minmod function
   //====================================================
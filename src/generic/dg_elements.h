@@ -37,6 +37,7 @@
 // Oomph-lib header
 #include "elements.h"
 #include "mesh.h"
+#include "linear_solver.h"
 
 namespace oomph
 {
@@ -189,6 +190,13 @@ namespace oomph
     /// deleted (i.e. was it created by this element)
     bool Can_delete_mass_matrix;
 
+    /// Pointer to a batched LU decomposition that contains the
+    /// element's mass matrix (null if the element computes its own)
+    BatchedDenseLU* Batched_mass_matrix_lu_pt;
+
+    /// Index of the element's mass matrix in the batched LU decomposition
+    unsigned long Batched_mass_matrix_index;
+
     /// Set the number of flux components
     virtual unsigned required_nflux()
     {
@@ -203,7 +211,9 @@ namespace oomph
         Average_value(0),
         Mass_matrix_reuse_is_enabled(false),
         Mass_matrix_has_been_computed(false),
-        Can_delete_mass_matrix(true)
+        Can_delete_mass_matrix(true),
+        Batched_mass_matrix_lu_pt(0),
+        Batched_mass_matrix_index(0)
     {
     }
 
@@ -234,6 +244,7 @@ namespace oomph
     {
       Mass_matrix_reuse_is_enabled = true;
       Mass_matrix_has_been_computed = false;
+      Batched_mass_matrix_lu_pt = 0;
     }
 
     /// Function that disables the reuse of the mass matrix
@@ -249,6 +260,19 @@ namespace oomph
       Mass_matrix_reuse_is_enabled = false;
       // Recalculate the mass matrix
       Mass_matrix_has_been_computed = false;
+      Batched_mass_matrix_lu_pt = 0;
+    }
+
+    /// Use the LU decomposition of the mass matrix that is stored as
+    /// the i-th matrix in the batch addressed by lu_pt (only used by the
+    /// default implementation of get_inverse_mass_matrix_times_residuals()).
+    /// The batch is forgotten by enable_mass_matrix_reuse() and
+    /// disable_mass_matrix_reuse().
+    void set_mass_matrix_from_batch(BatchedDenseLU* const& lu_pt,
+                                    const unsigned long& i)
+    {
+      Batched_mass_matrix_lu_pt = lu_pt;
+      Batched_mass_matrix_index = i;
     }
 
 
@@ -498,6 +522,15 @@ namespace oomph
       }
     }
 
+    /// Compute the mass matrices of all the elements and LU decompose
+    /// them in one batch (in parallel if OpenMP is available). The
+    /// elements then use these factors in
+    /// get_inverse_mass_matrix_times_residuals() until their mass matrix
+    /// reuse is enabled or disabled again; call this function again if
+    /// the mass matrices change. All elements must have the same number
+    /// of dofs and no external data.
+    void pre_compute_batched_mass_matrices();
+
     // Limit the slopes on the entire mesh
     void limit_slopes(SlopeLimiter* const& slope_limiter_pt)
     {
@@ -515,6 +548,10 @@ namespace oomph
           ->slope_limit(slope_limiter_pt);
       }
     }
+
+  private:
+    /// Batched LU decomposition of the elements' mass matrices
+    BatchedDenseLU Mass_matrix_lu;
   };
 
 
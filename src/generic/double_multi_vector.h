@@ -526,6 +526,12 @@ namespace oomph
       {
         return true;
       }
+      // Different numbers of vectors or rows
+      else if ((vec.nvector() != this->nvector()) ||
+               (*vec.distribution_pt() != *this->distribution_pt()))
+      {
+        return false;
+      }
       else
       {
         double** const v_values = vec.values();
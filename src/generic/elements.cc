@@ -257,9 +257,9 @@ namespace oomph
 
   //========================================================================
   /// Static storage used when pointers to the dofs are being assembled by
-  /// add_global_eqn_numbers()
+  /// add_global_eqn_numbers() (one per thread)
   //========================================================================
-  std::deque<double*> GeneralisedElement::Dof_pt_deque;
+  thread_local std::deque<double*> GeneralisedElement::Dof_pt_deque;
 
 
   //=========================================================================
@@ -227,8 +227,10 @@ namespace oomph
     static DenseMatrix<double> Dummy_matrix;
 
     /// Static storage for deque used to add_global_equation_numbers
-    /// when pointers to the dofs in each element are not required
-    static std::deque<double*> Dof_pt_deque;
+    /// when pointers to the dofs in each element are not required.
+    /// Each thread has its own copy, so the elements' local equation
+    /// numbers can be assigned concurrently.
+    static thread_local std::deque<double*> Dof_pt_deque;
 
     /// Assign the local equation numbers for the internal
     /// and external Data
@@ -837,7 +839,10 @@ namespace oomph
       return Ndof;
     }
 
-    /// Return the vector of dof values at time level t
+    /// Return the vector of dof values at time level t. Note: The
+    /// history values are addressed by their storage slot, so for t>0
+    /// this is only meaningful if the timesteppers do not use indexed
+    /// history (see TimeStepper::enable_indexed_history()).
     void dof_vector(const unsigned& t, Vector<double>& dof)
     {
       // Check that the internal storage has been set up
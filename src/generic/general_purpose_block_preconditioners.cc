@@ -525,6 +525,280 @@ namespace oomph
   }
 
 
+  //============================================================================
+  /// setup for the field-split preconditioner
+  //============================================================================
+  template<typename MATRIX>
+  void FieldSplitPreconditioner<MATRIX>::setup()
+  {
+    // clean the memory
+    this->clean_up_memory();
+
+    // Subsidiary preconditioners don't really need the meshes
+    if (this->is_master_block_preconditioner())
+    {
+#ifdef PARANOID
+      if (this->gp_nmesh() == 0)
+      {
+        std::ostringstream err_msg;
+        err_msg << "There are no meshes set.\n"
+                << "Did you remember to call add_mesh(...)?";
+        throw OomphLibError(
+          err_msg.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+      }
+#endif
+
+      // Set all meshes if this is master block preconditioner
+      this->gp_preconditioner_set_all_meshes();
+    }
+
+    // If we're meant to build silently
+    if (this->Silent_preconditioner_setup == true)
+    {
+      // Store the output stream pointer
+      this->Stream_pt = oomph_info.stream_pt();
+
+      // Now set the oomph_info stream pointer to the null stream to
+      // disable all possible output
+      oomph_info.stream_pt() = &oomph_nullstream;
+    }
+
+    // Set up the block look up schemes
+    this->gp_preconditioner_block_setup();
+
+    // number of fields
+    unsigned n_field = this->nblock_types();
+
+    // storage for the coupling matrix vector products
+    Coupling_matrix_vector_products.resize(n_field, n_field, 0);
+
+    // Fill in any null subsidiary preconditioners
+    this->fill_in_subsidiary_preconditioners(n_field);
+    Field_preconditioner_is_block_preconditioner.assign(n_field, false);
+
+    // Which coupling blocks do we need? A single block Jacobi sweep needs
+    // none, a single forward Gauss-Seidel sweep only needs the blocks
+    // below the diagonal. Everything else needs all of them.
+    bool need_lower = true;
+    bool need_upper = true;
+    if (N_outer_sweep == 1)
+    {
+      if (Outer_iteration == Block_jacobi)
+      {
+        need_lower = false;
+        need_upper = false;
+      }
+      else if (Outer_iteration == Block_gauss_seidel)
+      {
+        need_upper = false;
+      }
+    }
+
+    // The total time for setting up the field preconditioners
+    double t_subsidiary_setup_total = 0.0;
+
+    // The total time for setting up the matrix-vector products
+    double t_mvp_setup_total = 0.0;
+
+    // build the field preconditioners and coupling operators
+    for (unsigned i = 0; i < n_field; i++)
+    {
+      double t_subsidiary_setup_start = TimingHelpers::timer();
+
+      // Is the field preconditioner a block preconditioner?
+      BlockPreconditioner<MATRIX>* block_prec_pt =
+        dynamic_cast<BlockPreconditioner<MATRIX>*>(
+          this->Subsidiary_preconditioner_pt[i]);
+      if (block_prec_pt != 0)
+      {
+        // It operates on the dof types in this field. These are numbered
+        // as the dof types of this preconditioner (with this preconditioner
+        // as its master); if this preconditioner is itself a subsidiary
+        // one, block_setup() composes them with our master's dof types.
+        Field_preconditioner_is_block_preconditioner[i] = true;
+        block_prec_pt->turn_into_subsidiary_block_preconditioner(
+          this, this->Block_to_dof_map_coarse[i]);
+        block_prec_pt->setup(this->matrix_pt());
+      }
+      else
+      {
+        // Set up the i-th field preconditioner with the diagonal block
+        CRDoubleMatrix block_matrix = this->get_block(i, i);
+        this->Subsidiary_preconditioner_pt[i]->setup(&block_matrix);
+      }
+
+      t_subsidiary_setup_total +=
+        TimingHelpers::timer() - t_subsidiary_setup_start;
+
+      // Now the coupling blocks
+      for (unsigned j = 0; j < n_field; j++)
+      {
+        if (((j < i) && need_lower) || ((j > i) && need_upper))
+        {
+          double t_mvp_start = TimingHelpers::timer();
+
+          CRDoubleMatrix block_matrix = this->get_block(i, j);
+          Coupling_matrix_vector_products(i, j) = new MatrixVectorProduct();
+          this->setup_matrix_vector_product(
+            Coupling_matrix_vector_products(i, j), &block_matrix, j);
+
+          t_mvp_setup_total += TimingHelpers::timer() - t_mvp_start;
+        }
+      }
+    }
+
+    // Tell the user
+    oomph_info << "Total field preconditioner setup time [sec]: "
+               << t_subsidiary_setup_total
+               << "\nTotal matrix-vector product setup time [sec]: "
+               << t_mvp_setup_total << std::endl;
+
+    // If we're meant to build silently, reassign the oomph stream pointer
+    if (this->Silent_preconditioner_setup == true)
+    {
+      // Store the output stream pointer
+      oomph_info.stream_pt() = this->Stream_pt;
+
+      // Reset our own stream pointer
+      this->Stream_pt = 0;
+    }
+  }
+
+
+  //=============================================================================
+  /// Compute the right-hand side for field i by subtracting the action
+  /// of the coupling blocks on the other fields from block_r[i]. Unbuilt
+  /// entries in block_z represent zero iterates and are skipped.
+  //=============================================================================
+  template<typename MATRIX>
+  void FieldSplitPreconditioner<MATRIX>::get_field_rhs(
+    const unsigned& i,
+    const Vector<DoubleVector>& block_r,
+    const Vector<DoubleVector>& block_z,
+    DoubleVector& rhs)
+  {
+    rhs.build(block_r[i]);
+    unsigned n_field = block_z.size();
+    for (unsigned j = 0; j < n_field; j++)
+    {
+      if ((j != i) && block_z[j].built() &&
+          (Coupling_matrix_vector_products(i, j) != 0))
+      {
+        DoubleVector temp;
+        Coupling_matrix_vector_products(i, j)->multiply(block_z[j], temp);
+        rhs -= temp;
+      }
+    }
+  }
+
+
+  //=============================================================================
+  /// Apply the subsidiary preconditioner for field i to block_r.
+  /// Block preconditioners need full-length vectors, so the block vector
+  /// is embedded into (and the result extracted from) such a vector.
+  //=============================================================================
+  template<typename MATRIX>
+  void FieldSplitPreconditioner<MATRIX>::field_preconditioner_solve(
+    const unsigned& i,
+    const DoubleVector& r,
+    const DoubleVector& block_r,
+    DoubleVector& block_z)
+  {
+    double t_start = TimingHelpers::timer();
+
+    if (Field_preconditioner_is_block_preconditioner[i])
+    {
+      DoubleVector r_full(r.distribution_pt(), 0.0);
+      DoubleVector z_full(r.distribution_pt(), 0.0);
+      this->return_block_vector(i, block_r, r_full);
+      this->Subsidiary_preconditioner_pt[i]->preconditioner_solve(r_full,
+                                                                  z_full);
+      this->get_block_vector(i, z_full, block_z);
+    }
+    else
+    {
+      this->Subsidiary_preconditioner_pt[i]->preconditioner_solve(block_r,
+                                                                  block_z);
+    }
+
+    if (Doc_time_during_preconditioner_solve)
+    {
+      oomph_info << "Time for application of " << i
+                 << "-th field preconditioner: "
+                 << TimingHelpers::timer() - t_start << std::endl;
+    }
+  }
+
+
+  //=============================================================================
+  /// Preconditioner solve for the field-split preconditioner
+  //=============================================================================
+  template<typename MATRIX>
+  void FieldSplitPreconditioner<MATRIX>::preconditioner_solve(
+    const DoubleVector& r, DoubleVector& z)
+  {
+    // Cache number of fields
+    unsigned n_field = this->nblock_types();
+
+    // rearrange the vector r into the vector of block vectors block_r
+    Vector<DoubleVector> block_r;
+    this->get_block_vectors(r, block_r);
+
+    // vector of vectors for the solution block vectors (unbuilt vectors
+    // represent zero initial guesses)
+    Vector<DoubleVector> block_z(n_field);
+
+    // Order in which the fields are visited during a sweep
+    Vector<unsigned> order;
+    for (unsigned i = 0; i < n_field; i++)
+    {
+      order.push_back(i);
+    }
+    if (Outer_iteration == Symmetric_block_gauss_seidel)
+    {
+      for (int i = int(n_field) - 2; i >= 0; i--)
+      {
+        order.push_back(unsigned(i));
+      }
+    }
+
+    for (unsigned sweep = 0; sweep < N_outer_sweep; sweep++)
+    {
+      if (Outer_iteration == Block_jacobi)
+      {
+        // All fields use the previous iterate for the coupling terms,
+        // so form all right-hand sides before updating any field
+        Vector<DoubleVector> rhs(n_field);
+        for (unsigned i = 0; i < n_field; i++)
+        {
+          get_field_rhs(i, block_r, block_z, rhs[i]);
+        }
+        for (unsigned i = 0; i < n_field; i++)
+        {
+          block_z[i].clear();
+          field_preconditioner_solve(i, r, rhs[i], block_z[i]);
+        }
+      }
+      else
+      {
+        // Gauss-Seidel: Each field uses the latest iterate of the others
+        unsigned n_visit = order.size();
+        for (unsigned k = 0; k < n_visit; k++)
+        {
+          unsigned i = order[k];
+          DoubleVector rhs;
+          get_field_rhs(i, block_r, block_z, rhs);
+          block_z[i].clear();
+          field_preconditioner_solve(i, r, rhs, block_z[i]);
+        }
+      }
+    }
+
+    // copy solution in block vectors block_z back to z
+    this->return_block_vectors(block_z, z);
+  }
+
+
   //=============================================================================
   /// Setup for the exact block preconditioner
   //=============================================================================
@@ -602,6 +876,7 @@ namespace oomph
 
   template class BlockDiagonalPreconditioner<CRDoubleMatrix>;
   template class BlockTriangularPreconditioner<CRDoubleMatrix>;
+  template class FieldSplitPreconditioner<CRDoubleMatrix>;
   template class ExactBlockPreconditioner<CRDoubleMatrix>;
   template class BlockAntiDiagonalPreconditioner<CRDoubleMatrix>;
   template class DummyBlockPreconditioner<CRDoubleMatrix>;
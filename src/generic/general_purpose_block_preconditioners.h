@@ -213,6 +213,12 @@ namespace oomph
       return Gp_mesh_pt.size();
     }
 
+    /// Remove all meshes that have been specified with add_mesh(...)
+    void clear_meshes()
+    {
+      Gp_mesh_pt.clear();
+    }
+
   protected:
     /// Set the mesh in the block preconditioning framework.
     void gp_preconditioner_set_all_meshes()
@@ -532,6 +538,155 @@ namespace oomph
   /// ////////////////////////////////////////////////////////////////////////////
 
 
+  //=============================================================================
+  /// General purpose field-split preconditioner. Each block (a "field",
+  /// i.e. a group of dof types specified via set_dof_to_block_map(...),
+  /// e.g. the fluid velocities and pressure in a Boussinesq problem) is
+  /// solved by its own subsidiary preconditioner. Subsidiary preconditioners
+  /// that are themselves block preconditioners (e.g. the
+  /// NavierStokesSchurComplementPreconditioner) are turned into subsidiary
+  /// block preconditioners that operate on the dof types of their field;
+  /// all others are set up with the diagonal block of their field.
+  /// The fields are combined by an outer block Jacobi, block Gauss-Seidel
+  /// (default) or symmetric block Gauss-Seidel iteration in which the
+  /// coupling blocks are only applied via matrix-vector products.
+  /// By default SuperLU is used for all fields, but other preconditioners
+  /// can be set for each field with set_subsidiary_preconditioner_pt(...).
+  //=============================================================================
+  template<typename MATRIX>
+  class FieldSplitPreconditioner
+    : public GeneralPurposeBlockPreconditioner<MATRIX>
+  {
+  public:
+    /// Enumeration for the outer iteration that combines the fields
+    enum OuterIteration
+    {
+      Block_jacobi,
+      Block_gauss_seidel,
+      Symmetric_block_gauss_seidel
+    };
+
+    /// Constructor. (By default we do one block Gauss-Seidel sweep).
+    FieldSplitPreconditioner() : GeneralPurposeBlockPreconditioner<MATRIX>()
+    {
+      Outer_iteration = Block_gauss_seidel;
+      N_outer_sweep = 1;
+      Doc_time_during_preconditioner_solve = false;
+    }
+
+    /// Destructor - delete the matrix vector products
+    virtual ~FieldSplitPreconditioner()
+    {
+      this->clean_up_memory();
+    }
+
+    /// clean up the memory
+    virtual void clean_up_memory()
+    {
+      // Delete anything in Coupling_matrix_vector_products
+      for (unsigned i = 0, ni = Coupling_matrix_vector_products.nrow(); i < ni;
+           i++)
+      {
+        for (unsigned j = 0, nj = Coupling_matrix_vector_products.ncol();
+             j < nj;
+             j++)
+        {
+          delete Coupling_matrix_vector_products(i, j);
+          Coupling_matrix_vector_products(i, j) = 0;
+        }
+      }
+
+      // Clean up the base class too
+      GeneralPurposeBlockPreconditioner<MATRIX>::clean_up_memory();
+    }
+
+    /// Broken copy constructor
+    FieldSplitPreconditioner(const FieldSplitPreconditioner&) = delete;
+
+    /// Broken assignment operator
+    void operator=(const FieldSplitPreconditioner&) = delete;
+
+    /// Apply preconditioner to r
+    void preconditioner_solve(const DoubleVector& r, DoubleVector& z);
+
+    /// Setup the preconditioner
+    virtual void setup();
+
+    /// Combine the fields by block Jacobi iterations
+    void use_block_jacobi()
+    {
+      Outer_iteration = Block_jacobi;
+    }
+
+    /// Combine the fields by (forward) block Gauss-Seidel iterations
+    void use_block_gauss_seidel()
+    {
+      Outer_iteration = Block_gauss_seidel;
+    }
+
+    /// Combine the fields by symmetric block Gauss-Seidel iterations
+    /// (a forward sweep followed by a backward sweep)
+    void use_symmetric_block_gauss_seidel()
+    {
+      Outer_iteration = Symmetric_block_gauss_seidel;
+    }
+
+    /// Access function for the number of outer sweeps (default 1)
+    unsigned& n_outer_sweep()
+    {
+      return N_outer_sweep;
+    }
+
+    /// Enable Doc timings in application of the field preconditioners
+    void enable_doc_time_during_preconditioner_solve()
+    {
+      Doc_time_during_preconditioner_solve = true;
+    }
+
+    /// Disable Doc timings in application of the field preconditioners
+    void disable_doc_time_during_preconditioner_solve()
+    {
+      Doc_time_during_preconditioner_solve = false;
+    }
+
+  private:
+    /// Compute the right-hand side for field i: block_r[i] minus the
+    /// action of the coupling blocks on the (built) entries of block_z
+    void get_field_rhs(const unsigned& i,
+                       const Vector<DoubleVector>& block_r,
+                       const Vector<DoubleVector>& block_z,
+                       DoubleVector& rhs);
+
+    /// Apply the subsidiary preconditioner for field i to the
+    /// block vector block_r, returning the result in block_z
+    void field_preconditioner_solve(const unsigned& i,
+                                    const DoubleVector& r,
+                                    const DoubleVector& block_r,
+                                    DoubleVector& block_z);
+
+    /// Matrix of matrix vector product operators for the coupling blocks
+    DenseMatrix<MatrixVectorProduct*> Coupling_matrix_vector_products;
+
+    /// Flags indicating which subsidiary preconditioners are block
+    /// preconditioners
+    std::vector<bool> Field_preconditioner_is_block_preconditioner;
+
+    /// Outer iteration used to combine the fields
+    OuterIteration Outer_iteration;
+
+    /// Number of outer sweeps
+    unsigned N_outer_sweep;
+
+    /// Doc timings in application of the field preconditioners?
+    bool Doc_time_during_preconditioner_solve;
+  };
+
+
+  /// ////////////////////////////////////////////////////////////////////////////
+  /// ////////////////////////////////////////////////////////////////////////////
+  /// ////////////////////////////////////////////////////////////////////////////
+
+
   //=============================================================================
   /// Exact block preconditioner - block preconditioner assembled from all
   /// blocks associated with the preconditioner and solved by SuperLU.
@@ -33,6 +33,412 @@
 
 namespace oomph
 {
+  /// /////////////////////////////////////////////////////////////
+  //       Shared tables of shape functions at the knots
+  /// /////////////////////////////////////////////////////////////
+
+  //==================================================================
+  /// Local (not exported in header) helper function for
+  /// PRefineableQElementBasisTable: Create the Gauss-Lobatto-Legendre
+  /// integration scheme that a PRefineableQElement<DIM> of the given
+  /// p-order uses (null if there is none).
+  //==================================================================
+  template<unsigned DIM>
+  Integral* new_p_refineable_q_integration_scheme(const unsigned& p_order)
+  {
+    switch (p_order)
+    {
+      case 2:
+        return new GaussLobattoLegendre<DIM, 2>;
+      case 3:
+        return new GaussLobattoLegendre<DIM, 3>;
+      case 4:
+        return new GaussLobattoLegendre<DIM, 4>;
+      case 5:
+        return new GaussLobattoLegendre<DIM, 5>;
+      case 6:
+        return new GaussLobattoLegendre<DIM, 6>;
+      case 7:
+        return new GaussLobattoLegendre<DIM, 7>;
+      default:
+        return 0;
+    }
+  }
+
+  //==================================================================
+  /// Local (not exported in header) helper function for
+  /// PRefineableQElementBasisTable: Get the NNODE_1D one-dimensional
+  /// Legendre shape functions and their derivatives at s.
+  //==================================================================
+  template<unsigned NNODE_1D>
+  void get_one_d_legendre_shape(const double& s,
+                                double* const& psi,
+                                double* const& dpsids)
+  {
+    OneDimensionalLegendreShape<NNODE_1D>::calculate_nodal_positions();
+    OneDimensionalLegendreShape<NNODE_1D> psi1(s);
+    OneDimensionalLegendreDShape<NNODE_1D> dpsi1ds(s);
+    for (unsigned l = 0; l < NNODE_1D; l++)
+    {
+      psi[l] = psi1[l];
+      dpsids[l] = dpsi1ds[l];
+    }
+  }
+
+  //==================================================================
+  /// Local (not exported in header) helper function for
+  /// PRefineableQElementBasisTable: Get the one-dimensional Legendre
+  /// shape functions of the given p-order and their derivatives at s.
+  //==================================================================
+  void get_one_d_legendre_shape(const unsigned& p_order,
+                                const double& s,
+                                double* const& psi,
+                                double* const& dpsids)
+  {
+    switch (p_order)
+    {
+      case 2:
+        get_one_d_legendre_shape<2>(s, psi, dpsids);
+        break;
+      case 3:
+        get_one_d_legendre_shape<3>(s, psi, dpsids);
+        break;
+      case 4:
+        get_one_d_legendre_shape<4>(s, psi, dpsids);
+        break;
+      case 5:
+        get_one_d_legendre_shape<5>(s, psi, dpsids);
+        break;
+      case 6:
+        get_one_d_legendre_shape<6>(s, psi, dpsids);
+        break;
+      case 7:
+        get_one_d_legendre_shape<7>(s, psi, dpsids);
+        break;
+      default:
+        std::ostringstream error_message;
+        error_message << "\nERROR: Exceeded maximum polynomial order for";
+        error_message << "\n       polynomial order for shape functions.\n";
+        throw OomphLibError(error_message.str(),
+                            OOMPH_CURRENT_FUNCTION,
+                            OOMPH_EXCEPTION_LOCATION);
+    }
+  }
+
+  //==================================================================
+  /// The tables that have been built so far (indexed by p-order)
+  //==================================================================
+  template<unsigned DIM>
+  Vector<std::unique_ptr<PRefineableQElementBasisTable<DIM>>>
+    PRefineableQElementBasisTable<DIM>::Table_pt;
+
+  //==================================================================
+  /// Return pointer to the (shared) table for the given p-order;
+  /// null if there is no Gauss-Lobatto-Legendre integration scheme
+  /// (and hence no PRefineableQElement) of this order. The table is
+  /// built on first request, inside a critical section so this function
+  /// can be called from multiple threads.
+  //==================================================================
+  template<unsigned DIM>
+  const PRefineableQElementBasisTable<DIM>* PRefineableQElementBasisTable<
+    DIM>::table_pt(const unsigned& p_order)
+  {
+    // Orders for which there are integration schemes
+    const unsigned max_p_order = 7;
+    if ((p_order < 2) || (p_order > max_p_order))
+    {
+      return 0;
+    }
+
+    PRefineableQElementBasisTable<DIM>* result_pt = 0;
+#ifdef _OPENMP
+#pragma omp critical(p_refineable_q_element_basis_table)
+#endif
+    {
+      if (Table_pt.size() == 0)
+      {
+        Table_pt.resize(max_p_order + 1);
+      }
+      if (!Table_pt[p_order])
+      {
+        Table_pt[p_order].reset(
+          new PRefineableQElementBasisTable<DIM>(p_order));
+      }
+      result_pt = Table_pt[p_order].get();
+    }
+    return result_pt;
+  }
+
+  //==================================================================
+  /// Constructor: Evaluate the tensor-product shape functions (numbered
+  /// with s_0 varying fastest, as in PRefineableQElement<DIM>::shape())
+  /// and their derivatives at the knots of the Gauss-Lobatto-Legendre
+  /// integration scheme of the given p-order.
+  //==================================================================
+  template<unsigned DIM>
+  PRefineableQElementBasisTable<DIM>::PRefineableQElementBasisTable(
+    const unsigned& p_order)
+    : P_order(p_order), Nknot(0), Nnode(1)
+  {
+    for (unsigned i = 0; i < DIM; i++)
+    {
+      Nnode *= P_order;
+    }
+
+    // Get the knots
+    Integral* integral_pt =
+      new_p_refineable_q_integration_scheme<DIM>(P_order);
+    Nknot = integral_pt->nweight();
+    Knot.resize(Nknot * DIM);
+    for (unsigned ipt = 0; ipt < Nknot; ipt++)
+    {
+      for (unsigned i = 0; i < DIM; i++)
+      {
+        Knot[DIM * ipt + i] = integral_pt->knot(ipt, i);
+      }
+    }
+    delete integral_pt;
+    integral_pt = 0;
+
+    Psi.resize(Nknot * Nnode);
+    DPsids.resize(Nknot * Nnode * DIM);
+
+    // Storage for the 1D shape functions and their derivatives in each
+    // coordinate direction
+    Vector<double> psi_1d(DIM * P_order);
+    Vector<double> dpsi_1d(DIM * P_order);
+
+    // Storage for the 1D node numbers of a node
+    unsigned l_1d[DIM];
+
+    for (unsigned ipt = 0; ipt < Nknot; ipt++)
+    {
+      for (unsigned i = 0; i < DIM; i++)
+      {
+        get_one_d_legendre_shape(P_order,
+                                 Knot[DIM * ipt + i],
+                                 &psi_1d[P_order * i],
+                                 &dpsi_1d[P_order * i]);
+      }
+
+      for (unsigned l = 0; l < Nnode; l++)
+      {
+        // Decompose the node number (s_0 direction varies fastest)
+        unsigned remainder = l;
+        for (unsigned i = 0; i < DIM; i++)
+        {
+          l_1d[i] = remainder % P_order;
+          remainder /= P_order;
+        }
+
+        // Shape function
+        double psi = 1.0;
+        for (unsigned i = 0; i < DIM; i++)
+        {
+          psi *= psi_1d[P_order * i + l_1d[i]];
+        }
+        Psi[Nnode * ipt + l] = psi;
+
+        // Derivatives
+        for (unsigned i = 0; i < DIM; i++)
+        {
+          double dpsi = 1.0;
+          for (unsigned j = 0; j < DIM; j++)
+          {
+            if (j == i)
+            {
+              dpsi *= dpsi_1d[P_order * j + l_1d[j]];
+            }
+            else
+            {
+              dpsi *= psi_1d[P_order * j + l_1d[j]];
+            }
+          }
+          DPsids[(Nnode * ipt + l) * DIM + i] = dpsi;
+        }
+      }
+    }
+  }
+
+  //==================================================================
+  /// Is the table applicable to the integration scheme, i.e. does
+  /// it have the same knots?
+  //==================================================================
+  template<unsigned DIM>
+  bool PRefineableQElementBasisTable<DIM>::is_compatible(
+    Integral* const& integral_pt) const
+  {
+    if (integral_pt->nweight() != Nknot)
+    {
+      return false;
+    }
+    const double tol = 1.0e-14;
+    for (unsigned ipt = 0; ipt < Nknot; ipt++)
+    {
+      for (unsigned i = 0; i < DIM; i++)
+      {
+        if (std::fabs(integral_pt->knot(ipt, i) - Knot[DIM * ipt + i]) > tol)
+        {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+
+  /// /////////////////////////////////////////////////////////////
+  //       Smoothness indicator for hp-adaptation
+  /// /////////////////////////////////////////////////////////////
+
+  //==================================================================
+  /// Local (not exported in header) helper function for
+  /// PRefineableQElement<DIM>::legendre_smoothness_indicator():
+  /// Expand the i_value-th nodal value of the element (whose p_order
+  /// nodes along each edge are located at the Gauss-Lobatto-Legendre
+  /// points, numbered with s_0 varying fastest) in Legendre polynomials
+  /// and return the decay rate sigma of the coefficients,
+  /// |a_k| ~ exp(-sigma k), obtained from a least-squares fit to the
+  /// envelope of the largest coefficients of each degree
+  /// k = max(k_0,...,k_{DIM-1}).
+  //==================================================================
+  template<unsigned DIM>
+  double get_legendre_smoothness_indicator(FiniteElement* const& el_pt,
+                                           const unsigned& p_order,
+                                           const unsigned& i_value)
+  {
+    // Polynomial degree
+    const unsigned degree = p_order - 1;
+    if (degree == 0)
+    {
+      return 0.0;
+    }
+
+    // Get the GLL nodes and weights (gll_nodes() doesn't resize the
+    // weights)
+    Vector<double> z, w(p_order);
+    Orthpoly::gll_nodes(p_order, z, w);
+
+    // Discrete Legendre transform in 1D: a_k = sum_j t(k,j) u_j with
+    // t(k,j) = w_j L_k(z_j) / gamma_k; gamma_k is the discrete norm of L_k
+    Vector<double> transform(p_order * p_order);
+    for (unsigned k = 0; k < p_order; k++)
+    {
+      double gamma = 2.0 / (2.0 * double(k) + 1.0);
+      if (k == degree)
+      {
+        gamma = 2.0 / double(degree);
+      }
+      for (unsigned j = 0; j < p_order; j++)
+      {
+        transform[p_order * k + j] =
+          w[j] * Orthpoly::legendre(k, z[j]) / gamma;
+      }
+    }
+
+    // Number of nodes (and coefficients)
+    unsigned n_node = 1;
+    for (unsigned i = 0; i < DIM; i++)
+    {
+      n_node *= p_order;
+    }
+
+    // Get the nodal values
+    Vector<double> u(n_node);
+    for (unsigned l = 0; l < n_node; l++)
+    {
+      u[l] = el_pt->node_pt(l)->value(i_value);
+    }
+
+    // Storage for the largest coefficient of each degree
+    Vector<double> max_coeff(p_order, 0.0);
+
+    // Storage for the 1D indices of a coefficient/node
+    unsigned k_1d[DIM];
+    unsigned j_1d[DIM];
+
+    // Loop over the coefficients
+    for (unsigned m = 0; m < n_node; m++)
+    {
+      unsigned remainder = m;
+      unsigned k_max = 0;
+      for (unsigned i = 0; i < DIM; i++)
+      {
+        k_1d[i] = remainder % p_order;
+        remainder /= p_order;
+        if (k_1d[i] > k_max)
+        {
+          k_max = k_1d[i];
+        }
+      }
+
+      // Tensor-product transform
+      double coeff = 0.0;
+      for (unsigned l = 0; l < n_node; l++)
+      {
+        remainder = l;
+        double factor = 1.0;
+        for (unsigned i = 0; i < DIM; i++)
+        {
+          j_1d[i] = remainder % p_order;
+          remainder /= p_order;
+          factor *= transform[p_order * k_1d[i] + j_1d[i]];
+        }
+        coeff += factor * u[l];
+      }
+
+      if (std::fabs(coeff) > max_coeff[k_max])
+      {
+        max_coeff[k_max] = std::fabs(coeff);
+      }
+    }
+
+    // Replace the coefficients by their (monotonically decreasing)
+    // envelope, so that coefficients that vanish by symmetry (e.g. the
+    // odd ones of an even function) don't spoil the fit
+    for (unsigned k = degree; k > 0; k--)
+    {
+      max_coeff[k - 1] = std::max(max_coeff[k - 1], max_coeff[k]);
+    }
+
+    // Scale of the solution; if it's (numerically) zero there's nothing
+    // to resolve, so treat it as smooth
+    const double scale = max_coeff[0];
+    const double tiny = 1.0e-14;
+    if (scale == 0.0)
+    {
+      return -std::log(tiny);
+    }
+
+    // Fit log(max_coeff[k]) = c - sigma k over k=1,...,degree (the mean
+    // value doesn't tell us anything about the smoothness) unless we only
+    // have linear modes
+    unsigned k_start = 1;
+    if (degree == 1)
+    {
+      k_start = 0;
+    }
+    double sum_k = 0.0;
+    double sum_k2 = 0.0;
+    double sum_log = 0.0;
+    double sum_k_log = 0.0;
+    double n_fit = 0.0;
+    for (unsigned k = k_start; k <= degree; k++)
+    {
+      double log_coeff = std::log(std::max(max_coeff[k], tiny * scale));
+      sum_k += double(k);
+      sum_k2 += double(k) * double(k);
+      sum_log += log_coeff;
+      sum_k_log += double(k) * log_coeff;
+      n_fit += 1.0;
+    }
+
+    // (Minus the) slope of the regression line
+    return -(n_fit * sum_k_log - sum_k * sum_log) /
+           (n_fit * sum_k2 - sum_k * sum_k);
+  }
+
+
   /// /////////////////////////////////////////////////////////////
   //       1D PRefineableQElements
   /// /////////////////////////////////////////////////////////////
@@ -1189,6 +1595,18 @@ namespace oomph
     }
   }
 
+  //=================================================================
+  /// Smoothness indicator for the i_value-th nodal value: The decay
+  /// rate sigma of the coefficients of its expansion in Legendre
+  /// polynomials, |a_k| ~ exp(-sigma k).
+  //=================================================================
+  template<unsigned INITIAL_NNODE_1D>
+  double PRefineableQElement<1, INITIAL_NNODE_1D>::
+    legendre_smoothness_indicator(const unsigned& i_value)
+  {
+    return get_legendre_smoothness_indicator<1>(this, this->p_order(), i_value);
+  }
+
   //=================================================================
   /// Check inter-element continuity of
   /// - nodal positions
@@ -3737,6 +4155,18 @@ namespace oomph
     // }
   }
 
+  //=================================================================
+  /// Smoothness indicator for the i_value-th nodal value: The decay
+  /// rate sigma of the coefficients of its expansion in Legendre
+  /// polynomials, |a_k| ~ exp(-sigma k).
+  //=================================================================
+  template<unsigned INITIAL_NNODE_1D>
+  double PRefineableQElement<2, INITIAL_NNODE_1D>::
+    legendre_smoothness_indicator(const unsigned& i_value)
+  {
+    return get_legendre_smoothness_indicator<2>(this, this->p_order(), i_value);
+  }
+
   //=================================================================
   /// Check inter-element continuity of
   /// - nodal positions
@@ -8325,6 +8755,18 @@ namespace oomph
     }
   }
 
+  //=================================================================
+  /// Smoothness indicator for the i_value-th nodal value: The decay
+  /// rate sigma of the coefficients of its expansion in Legendre
+  /// polynomials, |a_k| ~ exp(-sigma k).
+  //=================================================================
+  template<unsigned INITIAL_NNODE_1D>
+  double PRefineableQElement<3, INITIAL_NNODE_1D>::
+    legendre_smoothness_indicator(const unsigned& i_value)
+  {
+    return get_legendre_smoothness_indicator<3>(this, this->p_order(), i_value);
+  }
+
   //=================================================================
   /// Check inter-element continuity of
   /// - nodal positions
@@ -10696,6 +11138,10 @@ namespace oomph
   //===================================================================
   // Build required templates
   //===================================================================
+  template class PRefineableQElementBasisTable<1>;
+  template class PRefineableQElementBasisTable<2>;
+  template class PRefineableQElementBasisTable<3>;
+
   template class PRefineableQElement<1, 2>;
   template class PRefineableQElement<1, 3>;
   template class PRefineableQElement<1, 4>;
@@ -40,8 +40,114 @@
 #include "refineable_brick_element.h"
 #include "mesh.h"
 
+#include <memory>
+
 namespace oomph
 {
+  //======================================================================
+  /// Immutable table of the shape functions of a PRefineableQElement<DIM>
+  /// of given p-order and their derivatives w.r.t. the local coordinates,
+  /// evaluated at the knots of the associated Gauss-Lobatto-Legendre
+  /// integration scheme. There is one table per dimension and p-order;
+  /// it's built on first request and then shared by all elements of that
+  /// order, so (hp-refined) assembly doesn't have to re-evaluate the
+  /// tensor-product basis at every integration point.
+  //======================================================================
+  template<unsigned DIM>
+  class PRefineableQElementBasisTable
+  {
+  public:
+    /// Return pointer to the (shared) table for the given p-order
+    /// (i.e. number of nodes along each edge). The table is built on
+    /// first request; this function is thread-safe.
+    static const PRefineableQElementBasisTable<DIM>* table_pt(
+      const unsigned& p_order);
+
+    /// Broken copy constructor
+    PRefineableQElementBasisTable(const PRefineableQElementBasisTable&) =
+      delete;
+
+    /// Broken assignment operator
+    void operator=(const PRefineableQElementBasisTable&) = delete;
+
+    /// p-order of the shape functions in the table
+    unsigned p_order() const
+    {
+      return P_order;
+    }
+
+    /// Number of knots at which the shape functions are tabulated
+    unsigned nknot() const
+    {
+      return Nknot;
+    }
+
+    /// Number of shape functions
+    unsigned nnode() const
+    {
+      return Nnode;
+    }
+
+    /// Is the table applicable to the integration scheme, i.e. does
+    /// it have the same knots?
+    bool is_compatible(Integral* const& integral_pt) const;
+
+    /// Copy the shape functions at the ipt-th knot into psi
+    void shape(const unsigned& ipt, Shape& psi) const
+    {
+      const double* psi_pt = &Psi[Nnode * ipt];
+      for (unsigned l = 0; l < Nnode; l++)
+      {
+        psi[l] = psi_pt[l];
+      }
+    }
+
+    /// Copy the shape functions and their derivatives w.r.t. the
+    /// local coordinates at the ipt-th knot into psi and dpsids
+    void dshape_local(const unsigned& ipt, Shape& psi, DShape& dpsids) const
+    {
+      const double* psi_pt = &Psi[Nnode * ipt];
+      const double* dpsi_pt = &DPsids[Nnode * DIM * ipt];
+      for (unsigned l = 0; l < Nnode; l++)
+      {
+        psi[l] = psi_pt[l];
+        for (unsigned i = 0; i < DIM; i++)
+        {
+          dpsids(l, i) = dpsi_pt[DIM * l + i];
+        }
+      }
+    }
+
+  private:
+    /// Constructor: Build the table for the given p-order
+    PRefineableQElementBasisTable(const unsigned& p_order);
+
+    /// The tables that have been built so far (indexed by p-order);
+    /// they're owned here, so they're deleted at exit
+    static Vector<std::unique_ptr<PRefineableQElementBasisTable<DIM>>>
+      Table_pt;
+
+    /// p-order of the shape functions
+    unsigned P_order;
+
+    /// Number of knots
+    unsigned Nknot;
+
+    /// Number of shape functions
+    unsigned Nnode;
+
+    /// Local coordinates of the knots (knot after knot)
+    Vector<double> Knot;
+
+    /// Shape functions (knot after knot)
+    Vector<double> Psi;
+
+    /// Derivatives of the shape functions w.r.t. the local
+    /// coordinates (knot after knot, shape function after shape function)
+    Vector<double> DPsids;
+  };
+
+
   //======================================================================
   /// p-refineable version of RefineableQElement<1,INITIAL_NNODE_1D>.
   /// Generic class definitions
@@ -54,7 +160,13 @@ namespace oomph
   {
   public:
     /// Constructor
-    PRefineableQElement() : PRefineableElement(), RefineableQElement<1>() {}
+    PRefineableQElement()
+      : PRefineableElement(),
+        RefineableQElement<1>(),
+        Basis_table_pt(0),
+        Basis_table_integral_pt(0)
+    {
+    }
 
     /// Destructor
     virtual ~PRefineableQElement() {}
@@ -84,6 +196,47 @@ namespace oomph
                        DShape& dpsids,
                        DShape& d2psids) const;
 
+    /// Shape functions at the ipt-th integration point: Copied from
+    /// the shared PRefineableQElementBasisTable if the element uses the
+    /// Gauss-Lobatto-Legendre scheme that goes with its p-order.
+    void shape_at_knot(const unsigned& ipt, Shape& psi) const
+    {
+      if (basis_table_is_valid())
+      {
+        Basis_table_pt->shape(ipt, psi);
+      }
+      else
+      {
+        FiniteElement::shape_at_knot(ipt, psi);
+      }
+    }
+
+    /// Shape functions and their derivatives w.r.t. the local
+    /// coordinates at the ipt-th integration point: Copied from the
+    /// shared PRefineableQElementBasisTable if the element uses the
+    /// Gauss-Lobatto-Legendre scheme that goes with its p-order.
+    void dshape_local_at_knot(const unsigned& ipt,
+                              Shape& psi,
+                              DShape& dpsids) const
+    {
+      if (basis_table_is_valid())
+      {
+        Basis_table_pt->dshape_local(ipt, psi, dpsids);
+      }
+      else
+      {
+        FiniteElement::dshape_local_at_knot(ipt, psi, dpsids);
+      }
+    }
+
+    /// Set the integration scheme and look up the shared table of
+    /// shape functions at its knots (if there is one).
+    void set_integration_scheme(Integral* const& integral_pt)
+    {
+      FiniteElement::set_integration_scheme(integral_pt);
+      setup_basis_table();
+    }
+
     /// Perform additional hanging node procedures for variables
     /// that are not interpolated by all nodes (e.g. lower order interpolations
     /// for the pressure in Taylor Hood).
@@ -128,11 +281,51 @@ namespace oomph
     /// boundaries.
     void check_integrity(double& max_error);
 
+    /// Smoothness indicator for the i_value-th nodal value: The decay
+    /// rate sigma of the coefficients of its expansion in Legendre
+    /// polynomials, |a_k| ~ exp(-sigma k), obtained from a least-squares
+    /// fit to the envelope of the largest coefficients of each degree k.
+    double legendre_smoothness_indicator(const unsigned& i_value);
+
   protected:
     /// Set up hanging node information. Empty for 1D elements.
     void binary_hang_helper(const int& value_id,
                             const int& my_edge,
                             std::ofstream& output_hangfile);
+
+  private:
+    /// Look up the shared table of shape functions for the element's
+    /// p-order; it's only used if it applies to the integration scheme.
+    void setup_basis_table()
+    {
+      Basis_table_pt = 0;
+      Basis_table_integral_pt = this->integral_pt();
+      if (Basis_table_integral_pt != 0)
+      {
+        const PRefineableQElementBasisTable<1>* table_pt =
+          PRefineableQElementBasisTable<1>::table_pt(this->p_order());
+        if ((table_pt != 0) && table_pt->is_compatible(Basis_table_integral_pt))
+        {
+          Basis_table_pt = table_pt;
+        }
+      }
+    }
+
+    /// Can the shared table be used? (Not if the p-order or the
+    /// integration scheme have changed since it was looked up.)
+    bool basis_table_is_valid() const
+    {
+      return (Basis_table_pt != 0) &&
+             (Basis_table_pt->p_order() == this->p_order()) &&
+             (Basis_table_integral_pt == this->integral_pt());
+    }
+
+    /// Pointer to the shared table of shape functions at the knots
+    /// (null if there's no table for the integration scheme)
+    const PRefineableQElementBasisTable<1>* Basis_table_pt;
+
+    /// Integration scheme for which Basis_table_pt was looked up
+    Integral* Basis_table_integral_pt;
   };
 
   //=======================================================================
@@ -146,7 +339,13 @@ namespace oomph
   {
   public:
     /// Constructor
-    PRefineableQElement() : PRefineableElement(), RefineableQElement<2>() {}
+    PRefineableQElement()
+      : PRefineableElement(),
+        RefineableQElement<2>(),
+        Basis_table_pt(0),
+        Basis_table_integral_pt(0)
+    {
+    }
 
     /// Destructor
     virtual ~PRefineableQElement() {}
@@ -176,6 +375,47 @@ namespace oomph
                        DShape& dpsids,
                        DShape& d2psids) const;
 
+    /// Shape functions at the ipt-th integration point: Copied from
+    /// the shared PRefineableQElementBasisTable if the element uses the
+    /// Gauss-Lobatto-Legendre scheme that goes with its p-order.
+    void shape_at_knot(const unsigned& ipt, Shape& psi) const
+    {
+      if (basis_table_is_valid())
+      {
+        Basis_table_pt->shape(ipt, psi);
+      }
+      else
+      {
+        FiniteElement::shape_at_knot(ipt, psi);
+      }
+    }
+
+    /// Shape functions and their derivatives w.r.t. the local
+    /// coordinates at the ipt-th integration point: Copied from the
+    /// shared PRefineableQElementBasisTable if the element uses the
+    /// Gauss-Lobatto-Legendre scheme that goes with its p-order.
+    void dshape_local_at_knot(const unsigned& ipt,
+                              Shape& psi,
+                              DShape& dpsids) const
+    {
+      if (basis_table_is_valid())
+      {
+        Basis_table_pt->dshape_local(ipt, psi, dpsids);
+      }
+      else
+      {
+        FiniteElement::dshape_local_at_knot(ipt, psi, dpsids);
+      }
+    }
+
+    /// Set the integration scheme and look up the shared table of
+    /// shape functions at its knots (if there is one).
+    void set_integration_scheme(Integral* const& integral_pt)
+    {
+      FiniteElement::set_integration_scheme(integral_pt);
+      setup_basis_table();
+    }
+
     /// Perform additional hanging node procedures for variables
     /// that are not interpolated by all nodes (e.g. lower order interpolations
     /// for the pressure in Taylor Hood).
@@ -226,6 +466,12 @@ namespace oomph
     /// continuity of interpolated values across these boundaries.
     void check_integrity(double& max_error);
 
+    /// Smoothness indicator for the i_value-th nodal value: The decay
+    /// rate sigma of the coefficients of its expansion in Legendre
+    /// polynomials, |a_k| ~ exp(-sigma k), obtained from a least-squares
+    /// fit to the envelope of the largest coefficients of each degree k.
+    double legendre_smoothness_indicator(const unsigned& i_value);
+
   protected:
     /// Set up hanging node information.
     /// Overloaded to implement the mortar method rather than constrained
@@ -234,6 +480,40 @@ namespace oomph
     void quad_hang_helper(const int& value_id,
                           const int& my_edge,
                           std::ofstream& output_hangfile);
+
+  private:
+    /// Look up the shared table of shape functions for the element's
+    /// p-order; it's only used if it applies to the integration scheme.
+    void setup_basis_table()
+    {
+      Basis_table_pt = 0;
+      Basis_table_integral_pt = this->integral_pt();
+      if (Basis_table_integral_pt != 0)
+      {
+        const PRefineableQElementBasisTable<2>* table_pt =
+          PRefineableQElementBasisTable<2>::table_pt(this->p_order());
+        if ((table_pt != 0) && table_pt->is_compatible(Basis_table_integral_pt))
+        {
+          Basis_table_pt = table_pt;
+        }
+      }
+    }
+
+    /// Can the shared table be used? (Not if the p-order or the
+    /// integration scheme have changed since it was looked up.)
+    bool basis_table_is_valid() const
+    {
+      return (Basis_table_pt != 0) &&
+             (Basis_table_pt->p_order() == this->p_order()) &&
+             (Basis_table_integral_pt == this->integral_pt());
+    }
+
+    /// Pointer to the shared table of shape functions at the knots
+    /// (null if there's no table for the integration scheme)
+    const PRefineableQElementBasisTable<2>* Basis_table_pt;
+
+    /// Integration scheme for which Basis_table_pt was looked up
+    Integral* Basis_table_integral_pt;
   };
 
   //=======================================================================
@@ -247,7 +527,13 @@ namespace oomph
   {
   public:
     /// Constructor
-    PRefineableQElement() : PRefineableElement(), RefineableQElement<3>() {}
+    PRefineableQElement()
+      : PRefineableElement(),
+        RefineableQElement<3>(),
+        Basis_table_pt(0),
+        Basis_table_integral_pt(0)
+    {
+    }
 
     /// Destructor
     virtual ~PRefineableQElement() {}
@@ -277,6 +563,47 @@ namespace oomph
                        DShape& dpsids,
                        DShape& d2psids) const;
 
+    /// Shape functions at the ipt-th integration point: Copied from
+    /// the shared PRefineableQElementBasisTable if the element uses the
+    /// Gauss-Lobatto-Legendre scheme that goes with its p-order.
+    void shape_at_knot(const unsigned& ipt, Shape& psi) const
+    {
+      if (basis_table_is_valid())
+      {
+        Basis_table_pt->shape(ipt, psi);
+      }
+      else
+      {
+        FiniteElement::shape_at_knot(ipt, psi);
+      }
+    }
+
+    /// Shape functions and their derivatives w.r.t. the local
+    /// coordinates at the ipt-th integration point: Copied from the
+    /// shared PRefineableQElementBasisTable if the element uses the
+    /// Gauss-Lobatto-Legendre scheme that goes with its p-order.
+    void dshape_local_at_knot(const unsigned& ipt,
+                              Shape& psi,
+                              DShape& dpsids) const
+    {
+      if (basis_table_is_valid())
+      {
+        Basis_table_pt->dshape_local(ipt, psi, dpsids);
+      }
+      else
+      {
+        FiniteElement::dshape_local_at_knot(ipt, psi, dpsids);
+      }
+    }
+
+    /// Set the integration scheme and look up the shared table of
+    /// shape functions at its knots (if there is one).
+    void set_integration_scheme(Integral* const& integral_pt)
+    {
+      FiniteElement::set_integration_scheme(integral_pt);
+      setup_basis_table();
+    }
+
     /// Perform additional hanging node procedures for variables
     /// that are not interpolated by all nodes (e.g. lower order interpolations
     /// for the pressure in Taylor Hood).
@@ -327,6 +654,12 @@ namespace oomph
     /// continuity of interpolated values across these boundaries.
     void check_integrity(double& max_error);
 
+    /// Smoothness indicator for the i_value-th nodal value: The decay
+    /// rate sigma of the coefficients of its expansion in Legendre
+    /// polynomials, |a_k| ~ exp(-sigma k), obtained from a least-squares
+    /// fit to the envelope of the largest coefficients of each degree k.
+    double legendre_smoothness_indicator(const unsigned& i_value);
+
   protected:
     /// Set up hanging node information.
     /// Overloaded to implement the mortar method rather than constrained
@@ -335,6 +668,40 @@ namespace oomph
     void oc_hang_helper(const int& value_id,
                         const int& my_face,
                         std::ofstream& output_hangfile);
+
+  private:
+    /// Look up the shared table of shape functions for the element's
+    /// p-order; it's only used if it applies to the integration scheme.
+    void setup_basis_table()
+    {
+      Basis_table_pt = 0;
+      Basis_table_integral_pt = this->integral_pt();
+      if (Basis_table_integral_pt != 0)
+      {
+        const PRefineableQElementBasisTable<3>* table_pt =
+          PRefineableQElementBasisTable<3>::table_pt(this->p_order());
+        if ((table_pt != 0) && table_pt->is_compatible(Basis_table_integral_pt))
+        {
+          Basis_table_pt = table_pt;
+        }
+      }
+    }
+
+    /// Can the shared table be used? (Not if the p-order or the
+    /// integration scheme have changed since it was looked up.)
+    bool basis_table_is_valid() const
+    {
+      return (Basis_table_pt != 0) &&
+             (Basis_table_pt->p_order() == this->p_order()) &&
+             (Basis_table_integral_pt == this->integral_pt());
+    }
+
+    /// Pointer to the shared table of shape functions at the knots
+    /// (null if there's no table for the integration scheme)
+    const PRefineableQElementBasisTable<3>* Basis_table_pt;
+
+    /// Integration scheme for which Basis_table_pt was looked up
+    Integral* Basis_table_integral_pt;
   };
 
 } // namespace oomph
@@ -194,6 +194,12 @@ namespace oomph
       Setup_preconditioner_before_solve = false;
     }
 
+    /// Is the preconditioner set up before the solve?
+    bool setup_preconditioner_before_solve() const
+    {
+      return Setup_preconditioner_before_solve;
+    }
+
     /// Throw an error if we don't converge within max_iter
     void enable_error_after_max_iter()
     {
@@ -34,6 +34,9 @@
 #include "mpi.h"
 #endif
 
+#include <algorithm>
+#include <exception>
+
 // oomph-lib includes
 #include "Vector.h"
 #include "linear_solver.h"
@@ -124,32 +127,45 @@ namespace oomph
   }
 
   //=============================================================================
-  /// LU decompose the matrix.
-  /// WARNING: this class does not perform any PARANOID checks on the vectors -
-  /// these are all performed in the solve(...) method.
+  /// Local (not exported in header) helper function: In-place LU
+  /// decomposition, with implicitly (row-)scaled partial pivoting, of the
+  /// n x n matrix whose entries are stored row by row in a. On return, a
+  /// contains the unit lower triangular factor L (below the diagonal) and
+  /// the upper triangular factor U; index[j] is the row that was
+  /// interchanged with row j in step j. Returns the sign of the row
+  /// permutation. The elimination works on whole rows, so all inner loops
+  /// have unit stride. NMAT is the size of the matrix if it's known at
+  /// compile time (so the compiler can unroll the loops), or zero.
   //=============================================================================
-  void DenseLU::factorise(DoubleMatrixBase* const& matrix_pt)
+  template<unsigned NMAT>
+  int dense_lu_factorise_helper(const unsigned long& n_dynamic,
+                                double* const a,
+                                long* const index)
   {
-    // Set the number of unknowns
-    const unsigned long n = matrix_pt->nrow();
+    const unsigned long n = (NMAT == 0) ? n_dynamic : NMAT;
 
     // Small constant
     const double small_number = 1.0e-20;
 
-    // Vector scaling stores the implicit scaling of each row
-    Vector<double> scaling(n);
-
-    // Integer to store the sign that must multiply the determinant as
-    // a consequence of the row/column interchanges
-    int signature = 1;
+    // Storage for the implicit scaling of each row (on the stack if the
+    // size is known)
+    double scaling_fixed[(NMAT == 0) ? 1 : NMAT];
+    Vector<double> scaling_dynamic;
+    double* scaling = scaling_fixed;
+    if (NMAT == 0)
+    {
+      scaling_dynamic.resize(n + 1);
+      scaling = &scaling_dynamic[0];
+    }
 
     // Loop over rows to get implicit scaling information
     for (unsigned long i = 0; i < n; i++)
     {
+      const double* const row_i = a + n * i;
       double largest_entry = 0.0;
       for (unsigned long j = 0; j < n; j++)
       {
-        double tmp = std::fabs((*matrix_pt)(i, j));
+        double tmp = std::fabs(row_i[j]);
         if (tmp > largest_entry) largest_entry = tmp;
       }
       if (largest_entry == 0.0)
@@ -161,56 +177,19 @@ namespace oomph
       scaling[i] = 1.0 / largest_entry;
     }
 
-    // Firsly, we shall delete any previous LU storage.
-    // If the user calls this function twice without changing the matrix
-    // then it is their own inefficiency, not ours (this time).
-    clean_up_memory();
-
-    // Allocate storage for the LU factors, the index and store
-    // the number of unknowns
-    LU_factors = new double[n * n];
-    Index = new long[n];
-
-    // Now we know that memory has been allocated, copy over
-    // the matrix values
-    unsigned count = 0;
-    for (unsigned long i = 0; i < n; i++)
-    {
-      for (unsigned long j = 0; j < n; j++)
-      {
-        LU_factors[count] = (*matrix_pt)(i, j);
-        ++count;
-      }
-    }
+    // Integer to store the sign that must multiply the determinant as
+    // a consequence of the row/column interchanges
+    int signature = 1;
 
     // Loop over columns
     for (unsigned long j = 0; j < n; j++)
     {
-      // Initialise imax
-      unsigned long imax = 0;
-
-      for (unsigned long i = 0; i < j; i++)
-      {
-        double sum = LU_factors[n * i + j];
-        for (unsigned long k = 0; k < i; k++)
-        {
-          sum -= LU_factors[n * i + k] * LU_factors[n * k + j];
-        }
-        LU_factors[n * i + j] = sum;
-      }
-
-      // Initialise search for largest pivot element
+      // Search for the largest (scaled) pivot element
+      unsigned long imax = j;
       double largest_entry = 0.0;
       for (unsigned long i = j; i < n; i++)
       {
-        double sum = LU_factors[n * i + j];
-        for (unsigned long k = 0; k < j; k++)
-        {
-          sum -= LU_factors[n * i + k] * LU_factors[n * k + j];
-        }
-        LU_factors[n * i + j] = sum;
-        // Set temporary
-        double tmp = scaling[i] * std::fabs(sum);
+        double tmp = scaling[i] * std::fabs(a[n * i + j]);
         if (tmp >= largest_entry)
         {
           largest_entry = tmp;
@@ -221,11 +200,13 @@ namespace oomph
       // Test to see if we need to interchange rows
       if (j != imax)
       {
+        double* const row_imax = a + n * imax;
+        double* const row_j = a + n * j;
         for (unsigned long k = 0; k < n; k++)
         {
-          double tmp = LU_factors[n * imax + k];
-          LU_factors[n * imax + k] = LU_factors[n * j + k];
-          LU_factors[n * j + k] = tmp;
+          double tmp = row_imax[k];
+          row_imax[k] = row_j[k];
+          row_j[k] = tmp;
         }
         // Change the parity of signature
         signature = -signature;
@@ -235,23 +216,216 @@ namespace oomph
       }
 
       // Set the index
-      Index[j] = imax;
-      if (LU_factors[n * j + j] == 0.0)
+      index[j] = imax;
+
+      const double* const row_j = a + n * j;
+      if (row_j[j] == 0.0)
       {
-        LU_factors[n * j + j] = small_number;
+        a[n * j + j] = small_number;
       }
-      // Divide by pivot element
-      if (j != n - 1)
+
+      // Compute the multipliers and eliminate the entries below the
+      // pivot from the remaining rows
+      const double inverse_pivot = 1.0 / row_j[j];
+      for (unsigned long i = j + 1; i < n; i++)
       {
-        double tmp = 1.0 / LU_factors[n * j + j];
-        for (unsigned long i = j + 1; i < n; i++)
+        double* const row_i = a + n * i;
+        const double multiplier = row_i[j] * inverse_pivot;
+        row_i[j] = multiplier;
+        for (unsigned long k = j + 1; k < n; k++)
         {
-          LU_factors[n * i + j] *= tmp;
+          row_i[k] -= multiplier * row_j[k];
         }
       }
-
     } // End of loop over columns
 
+    return signature;
+  }
+
+
+  //=============================================================================
+  /// Local (not exported in header) helper function: Solve the system
+  /// whose LU factors and row interchanges were computed by
+  /// dense_lu_factorise_helper(). On entry x contains the rhs, on return
+  /// the solution.
+  //=============================================================================
+  template<unsigned NMAT>
+  void dense_lu_backsub_helper(const unsigned long& n_dynamic,
+                               const double* const lu,
+                               const long* const index,
+                               double* const x)
+  {
+    const unsigned long n = (NMAT == 0) ? n_dynamic : NMAT;
+
+    // Loop over all rows for forward substition
+    unsigned long k = 0;
+    for (unsigned long i = 0; i < n; i++)
+    {
+      unsigned long ip = index[i];
+      double sum = x[ip];
+      x[ip] = x[i];
+      if (k != 0)
+      {
+        const double* const row_i = lu + n * i;
+        for (unsigned long j = k - 1; j < i; j++)
+        {
+          sum -= row_i[j] * x[j];
+        }
+      }
+      else if (sum != 0.0)
+      {
+        k = i + 1;
+      }
+      x[i] = sum;
+    }
+
+    // Now do the back substitution
+    for (long i = long(n) - 1; i >= 0; i--)
+    {
+      const double* const row_i = lu + n * i;
+      double sum = x[i];
+      for (long j = i + 1; j < long(n); j++)
+      {
+        sum -= row_i[j] * x[j];
+      }
+      x[i] = sum / row_i[i];
+    }
+  }
+
+
+  //=============================================================================
+  /// Local (not exported in header) helper function: LU decompose the
+  /// n x n matrix stored row by row in a, using the specialisation for
+  /// fixed (common element) sizes if there is one. See
+  /// dense_lu_factorise_helper().
+  //=============================================================================
+  int dense_lu_factorise(const unsigned long& n,
+                         double* const a,
+                         long* const index)
+  {
+    switch (n)
+    {
+      case 1:
+        return dense_lu_factorise_helper<1>(n, a, index);
+      case 2:
+        return dense_lu_factorise_helper<2>(n, a, index);
+      case 3:
+        return dense_lu_factorise_helper<3>(n, a, index);
+      case 4:
+        return dense_lu_factorise_helper<4>(n, a, index);
+      case 6:
+        return dense_lu_factorise_helper<6>(n, a, index);
+      case 8:
+        return dense_lu_factorise_helper<8>(n, a, index);
+      case 9:
+        return dense_lu_factorise_helper<9>(n, a, index);
+      case 10:
+        return dense_lu_factorise_helper<10>(n, a, index);
+      case 16:
+        return dense_lu_factorise_helper<16>(n, a, index);
+      case 27:
+        return dense_lu_factorise_helper<27>(n, a, index);
+      default:
+        return dense_lu_factorise_helper<0>(n, a, index);
+    }
+  }
+
+
+  //=============================================================================
+  /// Local (not exported in header) helper function: Back substitution
+  /// for a matrix that was decomposed by dense_lu_factorise().
+  //=============================================================================
+  void dense_lu_backsub(const unsigned long& n,
+                        const double* const lu,
+                        const long* const index,
+                        double* const x)
+  {
+    switch (n)
+    {
+      case 1:
+        dense_lu_backsub_helper<1>(n, lu, index, x);
+        break;
+      case 2:
+        dense_lu_backsub_helper<2>(n, lu, index, x);
+        break;
+      case 3:
+        dense_lu_backsub_helper<3>(n, lu, index, x);
+        break;
+      case 4:
+        dense_lu_backsub_helper<4>(n, lu, index, x);
+        break;
+      case 6:
+        dense_lu_backsub_helper<6>(n, lu, index, x);
+        break;
+      case 8:
+        dense_lu_backsub_helper<8>(n, lu, index, x);
+        break;
+      case 9:
+        dense_lu_backsub_helper<9>(n, lu, index, x);
+        break;
+      case 10:
+        dense_lu_backsub_helper<10>(n, lu, index, x);
+        break;
+      case 16:
+        dense_lu_backsub_helper<16>(n, lu, index, x);
+        break;
+      case 27:
+        dense_lu_backsub_helper<27>(n, lu, index, x);
+        break;
+      default:
+        dense_lu_backsub_helper<0>(n, lu, index, x);
+        break;
+    }
+  }
+
+
+  //=============================================================================
+  /// LU decompose the matrix.
+  /// WARNING: this class does not perform any PARANOID checks on the vectors -
+  /// these are all performed in the solve(...) method.
+  //=============================================================================
+  void DenseLU::factorise(DoubleMatrixBase* const& matrix_pt)
+  {
+    // Set the number of unknowns
+    const unsigned long n = matrix_pt->nrow();
+
+    // Firsly, we shall delete any previous LU storage.
+    // If the user calls this function twice without changing the matrix
+    // then it is their own inefficiency, not ours (this time).
+    clean_up_memory();
+
+    // Allocate storage for the LU factors, the index and store
+    // the number of unknowns
+    LU_factors = new double[n * n];
+    Index = new long[n];
+
+    // Now we know that memory has been allocated, copy over
+    // the matrix values (directly from the contiguous storage of a
+    // DenseDoubleMatrix, avoiding the virtual access functions)
+    DenseDoubleMatrix* dense_matrix_pt =
+      dynamic_cast<DenseDoubleMatrix*>(matrix_pt);
+    if ((dense_matrix_pt != 0) && (n > 0))
+    {
+      std::copy(&dense_matrix_pt->entry(0, 0),
+                &dense_matrix_pt->entry(0, 0) + n * n,
+                LU_factors);
+    }
+    else
+    {
+      unsigned count = 0;
+      for (unsigned long i = 0; i < n; i++)
+      {
+        for (unsigned long j = 0; j < n; j++)
+        {
+          LU_factors[count] = (*matrix_pt)(i, j);
+          ++count;
+        }
+      }
+    }
+
+    // Do the decomposition; signature is the sign that must multiply the
+    // determinant as a consequence of the row interchanges
+    int signature = dense_lu_factorise(n, LU_factors, Index);
 
     // Now multiply all the diagonal terms together to get the determinant
     // Note that we need to use the mantissa, exponent formulation to
@@ -330,37 +504,8 @@ namespace oomph
       result_pt[i] = rhs_pt[i];
     }
 
-    // Loop over all rows for forward substition
-    unsigned long k = 0;
-    for (unsigned long i = 0; i < n; i++)
-    {
-      unsigned long ip = Index[i];
-      double sum = result_pt[ip];
-      result_pt[ip] = result_pt[i];
-      if (k != 0)
-      {
-        for (unsigned long j = k - 1; j < i; j++)
-        {
-          sum -= LU_factors[n * i + j] * result_pt[j];
-        }
-      }
-      else if (sum != 0.0)
-      {
-        k = i + 1;
-      }
-      result_pt[i] = sum;
-    }
-
-    // Now do the back substitution
-    for (long i = long(n) - 1; i >= 0; i--)
-    {
-      double sum = result_pt[i];
-      for (long j = i + 1; j < long(n); j++)
-      {
-        sum -= LU_factors[n * i + j] * result_pt[j];
-      }
-      result_pt[i] = sum / LU_factors[n * i + i];
-    }
+    // Forward and back substitution
+    dense_lu_backsub(n, LU_factors, Index, result_pt);
   }
 
   //=============================================================================
@@ -378,36 +523,10 @@ namespace oomph
       result[i] = rhs[i];
     }
 
-    // Loop over all rows for forward substition
-    unsigned long k = 0;
-    for (unsigned long i = 0; i < n; i++)
+    // Forward and back substitution
+    if (n > 0)
     {
-      unsigned long ip = Index[i];
-      double sum = result[ip];
-      result[ip] = result[i];
-      if (k != 0)
-      {
-        for (unsigned long j = k - 1; j < i; j++)
-        {
-          sum -= LU_factors[n * i + j] * result[j];
-        }
-      }
-      else if (sum != 0.0)
-      {
-        k = i + 1;
-      }
-      result[i] = sum;
-    }
-
-    // Now do the back substitution
-    for (long i = long(n) - 1; i >= 0; i--)
-    {
-      double sum = result[i];
-      for (long j = i + 1; j < long(n); j++)
-      {
-        sum -= LU_factors[n * i + j] * result[j];
-      }
-      result[i] = sum / LU_factors[n * i + i];
+      dense_lu_backsub(n, LU_factors, Index, &result[0]);
     }
   }
 
@@ -567,6 +686,222 @@ namespace oomph
     }
   }
 
+  //=============================================================================
+  /// LU decompose n_matrix matrices of size n x n whose entries are
+  /// stored contiguously, matrix after matrix, each one row by row,
+  /// starting at values_pt.
+  //=============================================================================
+  void BatchedDenseLU::factorise(const unsigned long& n,
+                                 const unsigned long& n_matrix,
+                                 const double* const& values_pt)
+  {
+    // Wipe any previous factorisation
+    clean_up_memory();
+
+    // Copy the matrices
+    N = n;
+    Nmatrix = n_matrix;
+    LU_factors.assign(values_pt, values_pt + n * n * n_matrix);
+
+    // Do the work
+    factorise_stored_matrices();
+  }
+
+
+  //=============================================================================
+  /// LU decompose the (square, equally sized) matrices pointed to
+  /// by the entries of matrix_pt.
+  //=============================================================================
+  void BatchedDenseLU::factorise(const Vector<DenseMatrix<double>*>& matrix_pt)
+  {
+    // Wipe any previous factorisation
+    clean_up_memory();
+
+    // How many matrices?
+    const unsigned long n_matrix = matrix_pt.size();
+    if (n_matrix == 0)
+    {
+      return;
+    }
+
+    // Size of the matrices
+    const unsigned long n = matrix_pt[0]->nrow();
+
+#ifdef PARANOID
+    for (unsigned long m = 0; m < n_matrix; m++)
+    {
+      if ((matrix_pt[m]->nrow() != n) || (matrix_pt[m]->ncol() != n))
+      {
+        std::ostringstream error_message_stream;
+        error_message_stream
+          << "All matrices must be square and of the same size.\n"
+          << "Matrix 0 is " << n << " x " << n << " but matrix " << m
+          << " is " << matrix_pt[m]->nrow() << " x " << matrix_pt[m]->ncol()
+          << std::endl;
+        throw OomphLibError(error_message_stream.str(),
+                            OOMPH_CURRENT_FUNCTION,
+                            OOMPH_EXCEPTION_LOCATION);
+      }
+    }
+#endif
+
+    // Copy the matrices
+    N = n;
+    Nmatrix = n_matrix;
+    LU_factors.resize(n * n * n_matrix);
+    for (unsigned long m = 0; m < n_matrix; m++)
+    {
+      double* const a = &LU_factors[0] + n * n * m;
+      for (unsigned long i = 0; i < n; i++)
+      {
+        for (unsigned long j = 0; j < n; j++)
+        {
+          a[n * i + j] = (*matrix_pt[m])(i, j);
+        }
+      }
+    }
+
+    // Do the work
+    factorise_stored_matrices();
+  }
+
+
+  //=============================================================================
+  /// Factorise all the matrices whose entries have been copied into
+  /// LU_factors (in parallel if OpenMP is available).
+  //=============================================================================
+  void BatchedDenseLU::factorise_stored_matrices()
+  {
+    const unsigned long n = N;
+    const long n_matrix = Nmatrix;
+    if ((n == 0) || (n_matrix == 0))
+    {
+      return;
+    }
+
+    Index.resize(n * n_matrix);
+    Sign_of_determinant_of_matrix.resize(n_matrix);
+
+    // Storage for any exception thrown by one of the threads
+    std::exception_ptr exception_pt;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (long m = 0; m < n_matrix; m++)
+    {
+      try
+      {
+        double* const a = &LU_factors[0] + n * n * m;
+        int sign = dense_lu_factorise(n, a, &Index[0] + n * m);
+
+        // Sign of the determinant: The signature times the signs of
+        // the diagonal entries of U
+        for (unsigned long i = 0; i < n; i++)
+        {
+          if (a[n * i + i] < 0.0)
+          {
+            sign = -sign;
+          }
+        }
+        Sign_of_determinant_of_matrix[m] = sign;
+      }
+      catch (...)
+      {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+        {
+          if (!exception_pt)
+          {
+            exception_pt = std::current_exception();
+          }
+        }
+      }
+    }
+
+    // Pass on any exception
+    if (exception_pt)
+    {
+      clean_up_memory();
+      std::rethrow_exception(exception_pt);
+    }
+  }
+
+
+  //=============================================================================
+  /// Solve the system involving the i-th matrix; on entry x (which must
+  /// contain n() entries) contains the rhs, on return the solution.
+  //=============================================================================
+  void BatchedDenseLU::solve(const unsigned long& i, double* const& x) const
+  {
+#ifdef PARANOID
+    if (i >= Nmatrix)
+    {
+      std::ostringstream error_message_stream;
+      error_message_stream << "Requested solve with matrix " << i
+                           << " but only " << Nmatrix
+                           << " matrices have been factorised." << std::endl;
+      throw OomphLibError(error_message_stream.str(),
+                          OOMPH_CURRENT_FUNCTION,
+                          OOMPH_EXCEPTION_LOCATION);
+    }
+#endif
+    dense_lu_backsub(N, &LU_factors[0] + N * N * i, &Index[0] + N * i, x);
+  }
+
+
+  //=============================================================================
+  /// Solve the system involving the i-th matrix; on entry x contains
+  /// the rhs, on return the solution.
+  //=============================================================================
+  void BatchedDenseLU::solve(const unsigned long& i, Vector<double>& x) const
+  {
+#ifdef PARANOID
+    if (x.size() != N)
+    {
+      std::ostringstream error_message_stream;
+      error_message_stream << "The vector has " << x.size()
+                           << " entries but the matrices are " << N << " x "
+                           << N << std::endl;
+      throw OomphLibError(error_message_stream.str(),
+                          OOMPH_CURRENT_FUNCTION,
+                          OOMPH_EXCEPTION_LOCATION);
+    }
+#endif
+    if (N > 0)
+    {
+      solve(i, &x[0]);
+    }
+  }
+
+
+  //=============================================================================
+  /// Solve the systems involving all the matrices (in parallel if
+  /// OpenMP is available). x must contain nmatrix() blocks of n()
+  /// entries; on entry the i-th block contains the rhs for the i-th
+  /// matrix, on return its solution.
+  //=============================================================================
+  void BatchedDenseLU::solve_all(double* const& x) const
+  {
+    const unsigned long n = N;
+    const long n_matrix = Nmatrix;
+    if (n == 0)
+    {
+      return;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (long m = 0; m < n_matrix; m++)
+    {
+      dense_lu_backsub(
+        n, &LU_factors[0] + n * n * m, &Index[0] + n * m, x + n * m);
+    }
+  }
+
+
   //==================================================================
   /// Solver: Takes pointer to problem and returns the results Vector
   /// which contains the solution of the linear system defined by
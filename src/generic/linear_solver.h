@@ -423,6 +423,105 @@ namespace oomph
   };
 
 
+  //=============================================================================
+  /// Dense LU decomposition of a batch of small matrices of the same size
+  /// (e.g. the element-level matrices in block-diagonal preconditioners
+  /// or local projection/L2-fitting operations). The factors of all
+  /// matrices are stored contiguously, matrix after matrix, each one row
+  /// by row, and the matrices are factorised in parallel if OpenMP is
+  /// available. The factorisation uses the same (implicitly scaled,
+  /// partially pivoted) algorithm as DenseLU.
+  //============================================================================
+  class BatchedDenseLU
+  {
+  public:
+    /// Constructor, initialise storage
+    BatchedDenseLU() : N(0), Nmatrix(0) {}
+
+    /// Broken copy constructor
+    BatchedDenseLU(const BatchedDenseLU& dummy) = delete;
+
+    /// Broken assignment operator
+    void operator=(const BatchedDenseLU&) = delete;
+
+    /// Empty destructor
+    ~BatchedDenseLU() {}
+
+    /// LU decompose n_matrix matrices of size n x n whose entries are
+    /// stored contiguously, matrix after matrix, each one row by row,
+    /// starting at values_pt.
+    void factorise(const unsigned long& n,
+                   const unsigned long& n_matrix,
+                   const double* const& values_pt);
+
+    /// LU decompose the (square, equally sized) matrices pointed to
+    /// by the entries of matrix_pt.
+    void factorise(const Vector<DenseMatrix<double>*>& matrix_pt);
+
+    /// Solve the system involving the i-th matrix; on entry x contains
+    /// the rhs, on return the solution.
+    void solve(const unsigned long& i, Vector<double>& x) const;
+
+    /// Solve the system involving the i-th matrix; on entry x (which
+    /// must contain n() entries) contains the rhs, on return the solution.
+    void solve(const unsigned long& i, double* const& x) const;
+
+    /// Solve the systems involving all the matrices (in parallel if
+    /// OpenMP is available). x must contain nmatrix() blocks of n()
+    /// entries; on entry the i-th block contains the rhs for the i-th
+    /// matrix, on return its solution.
+    void solve_all(double* const& x) const;
+
+    /// Size of the matrices
+    unsigned long n() const
+    {
+      return N;
+    }
+
+    /// Number of matrices in the batch
+    unsigned long nmatrix() const
+    {
+      return Nmatrix;
+    }
+
+    /// Sign of the determinant of the i-th matrix
+    int sign_of_determinant(const unsigned long& i) const
+    {
+      return Sign_of_determinant_of_matrix[i];
+    }
+
+    /// Wipe the stored LU factors
+    void clean_up_memory()
+    {
+      N = 0;
+      Nmatrix = 0;
+      LU_factors.clear();
+      Index.clear();
+      Sign_of_determinant_of_matrix.clear();
+    }
+
+  private:
+    /// Factorise all the matrices whose entries have been copied into
+    /// LU_factors
+    void factorise_stored_matrices();
+
+    /// Size of the matrices
+    unsigned long N;
+
+    /// Number of matrices in the batch
+    unsigned long Nmatrix;
+
+    /// Storage for the LU decompositions (matrix after matrix)
+    Vector<double> LU_factors;
+
+    /// Storage for the index of permutations (matrix after matrix)
+    Vector<long> Index;
+
+    /// Sign of the determinants of the matrices
+    Vector<int> Sign_of_determinant_of_matrix;
+  };
+
+
   //====================================================================
   /// Dense LU decomposition-based solve of linear system
   /// assembled via finite differencing of the residuals Vector.
@@ -0,0 +1,381 @@
+// LIC// ====================================================================
+// LIC// This file forms part of oomph-lib, the object-oriented,
+// LIC// multi-physics finite-element library, available
+// LIC// at http://www.oomph-lib.org.
+// LIC//
+// LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+// LIC//
+// LIC// This library is free software; you can redistribute it and/or
+// LIC// modify it under the terms of the GNU Lesser General Public
+// LIC// License as published by the Free Software Foundation; either
+// LIC// version 2.1 of the License, or (at your option) any later version.
+// LIC//
+// LIC// This library is distributed in the hope that it will be useful,
+// LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// LIC// Lesser General Public License for more details.
+// LIC//
+// LIC// You should have received a copy of the GNU Lesser General Public
+// LIC// License along with this library; if not, write to the Free Software
+// LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// LIC// 02110-1301  USA.
+// LIC//
+// LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+// LIC//
+// LIC//====================================================================
+// Non-inline functions for the linear (Morton-key based) representation
+// of tree forests
+
+// Config header generated by autoconfig
+#ifdef HAVE_CONFIG_H
+#include <oomph-lib-config.h>
+#endif
+
+#include <algorithm>
+#include <set>
+
+// oomph-lib headers
+#include "linear_tree.h"
+
+// Need to include this so that we can use the member functions of
+// RefineableElement
+#include "refineable_elements.h"
+
+namespace oomph
+{
+  //========================================================================
+  /// Constructor: Build the linear representation of the forest
+  //========================================================================
+  LinearTreeForest::LinearTreeForest(TreeForest* const& forest_pt)
+    : Forest_pt(forest_pt)
+  {
+    build();
+  }
+
+  //========================================================================
+  /// (Re-)build the linear representation from the forest (e.g.
+  /// after the mesh has been adapted)
+  //========================================================================
+  void LinearTreeForest::build()
+  {
+    unsigned n_tree = Forest_pt->ntree();
+    Leaf_key.clear();
+    Leaf_key.resize(n_tree);
+    if (n_tree == 0)
+    {
+      return;
+    }
+
+#ifdef PARANOID
+    // Get the spatial dimension from the elements
+    unsigned dim = Forest_pt->tree_pt(0)->object_pt()->dim();
+#endif
+
+    Vector<Tree*> leaf_pt;
+    for (unsigned i_root = 0; i_root < n_tree; i_root++)
+    {
+      leaf_pt.clear();
+      Forest_pt->tree_pt(i_root)->stick_leaves_into_vector(leaf_pt);
+
+      unsigned n_leaf = leaf_pt.size();
+      Leaf_key[i_root].resize(n_leaf);
+      for (unsigned i_leaf = 0; i_leaf < n_leaf; i_leaf++)
+      {
+#ifdef PARANOID
+        if (leaf_pt[i_leaf]->level() > max_level(dim))
+        {
+          std::ostringstream error_stream;
+          error_stream << "Leaf at level " << leaf_pt[i_leaf]->level()
+                       << " can't be represented: The max. level in " << dim
+                       << "D is " << max_level(dim) << std::endl;
+          throw OomphLibError(error_stream.str(),
+                              OOMPH_CURRENT_FUNCTION,
+                              OOMPH_EXCEPTION_LOCATION);
+        }
+#endif
+        Leaf_key[i_root][i_leaf] = key(leaf_pt[i_leaf]);
+      }
+    }
+  }
+
+  //========================================================================
+  /// Get the keys of the leaves in all trees, packed into a single
+  /// vector: [nleaf in tree 0, keys of its leaves, nleaf in tree 1, ...]
+  //========================================================================
+  void LinearTreeForest::get_leaf_keys(Vector<Key>& packed_keys) const
+  {
+    unsigned n_root = nroot();
+    unsigned n_entry = n_root;
+    for (unsigned i_root = 0; i_root < n_root; i_root++)
+    {
+      n_entry += nleaf(i_root);
+    }
+
+    packed_keys.clear();
+    packed_keys.reserve(n_entry);
+    for (unsigned i_root = 0; i_root < n_root; i_root++)
+    {
+      packed_keys.push_back(nleaf(i_root));
+      packed_keys.insert(
+        packed_keys.end(), Leaf_key[i_root].begin(), Leaf_key[i_root].end());
+    }
+  }
+
+  //========================================================================
+  /// Morton key of the tree node (obtained by walking up to its root)
+  //========================================================================
+  LinearTreeForest::Key LinearTreeForest::key(Tree* const& tree_pt)
+  {
+    // Collect the son types on the way up
+    Vector<int> son_type;
+    Tree* current_pt = tree_pt;
+    while (current_pt->father_pt() != 0)
+    {
+      son_type.push_back(current_pt->son_type());
+      current_pt = current_pt->father_pt();
+    }
+
+    // The root's key is just the sentinel bit
+    Key result = 1;
+    unsigned n_level = son_type.size();
+    if (n_level == 0)
+    {
+      return result;
+    }
+
+    // The number of bits per level follows from the number of sons
+    unsigned dim = 0;
+    unsigned n_sons = tree_pt->father_pt()->nsons();
+    while ((1u << dim) < n_sons)
+    {
+      dim++;
+    }
+
+    for (unsigned l = n_level; l > 0; l--)
+    {
+      result = son_key(result, son_type[l - 1], dim);
+    }
+    return result;
+  }
+
+  //========================================================================
+  /// Level of the tree node with the given key
+  //========================================================================
+  unsigned LinearTreeForest::level(const Key& key, const unsigned& dim)
+  {
+    // Position of the sentinel bit
+    unsigned n_bit = 0;
+    Key remainder = key >> 1;
+    while (remainder != 0)
+    {
+      remainder >>= 1;
+      n_bit++;
+    }
+    return n_bit / dim;
+  }
+
+  //========================================================================
+  /// Get the integer coordinates (in [0, 2^level)) of the tree node
+  /// with the given key, at its level
+  //========================================================================
+  void LinearTreeForest::get_coordinates(const Key& key,
+                                         const unsigned& dim,
+                                         Vector<unsigned long>& coordinate)
+  {
+    coordinate.assign(dim, 0);
+    unsigned n_level = level(key, dim);
+    for (unsigned b = 0; b < n_level; b++)
+    {
+      Key digit = key >> (dim * b);
+      for (unsigned i = 0; i < dim; i++)
+      {
+        coordinate[i] |= (unsigned long)((digit >> i) & 1) << b;
+      }
+    }
+  }
+
+  //========================================================================
+  /// Get the refinement pattern (in the form used by
+  /// TreeBasedRefineableMeshBase::refine_base_mesh(...)) that
+  /// generates the leaves whose keys are packed as in get_leaf_keys(),
+  /// starting from the roots: to_be_refined[l] contains the numbers
+  /// of the elements (in the mesh obtained by truncating the refinement
+  /// at level l) that have to be split to get to level l+1.
+  //========================================================================
+  void LinearTreeForest::get_refinement_pattern(
+    const Vector<Key>& packed_keys,
+    const unsigned& dim,
+    Vector<Vector<unsigned>>& to_be_refined)
+  {
+    // Unpack the (root number, key) pairs of the leaves and start with
+    // the unrefined roots
+    std::set<std::pair<unsigned, Key>> leaf_set;
+    Vector<std::pair<unsigned, Key>> current;
+    unsigned max_leaf_level = 0;
+    unsigned n_entry = packed_keys.size();
+    unsigned i_root = 0;
+    unsigned count = 0;
+    while (count < n_entry)
+    {
+      unsigned n_leaf = packed_keys[count];
+      count++;
+      for (unsigned i_leaf = 0; i_leaf < n_leaf; i_leaf++)
+      {
+        Key leaf_key = packed_keys[count];
+        count++;
+        leaf_set.insert(std::make_pair(i_root, leaf_key));
+        max_leaf_level = std::max(max_leaf_level, level(leaf_key, dim));
+      }
+      current.push_back(std::make_pair(i_root, Key(1)));
+      i_root++;
+    }
+
+    // Split all nodes that aren't leaves, level by level; the sons
+    // replace their father in the enumeration of the elements
+    unsigned n_son = 1u << dim;
+    to_be_refined.clear();
+    to_be_refined.resize(max_leaf_level);
+    for (unsigned l = 0; l < max_leaf_level; l++)
+    {
+      Vector<std::pair<unsigned, Key>> next;
+      next.reserve(current.size());
+      unsigned n_current = current.size();
+      for (unsigned e = 0; e < n_current; e++)
+      {
+        if (leaf_set.count(current[e]) == 0)
+        {
+          to_be_refined[l].push_back(e);
+          for (unsigned ison = 0; ison < n_son; ison++)
+          {
+            next.push_back(std::make_pair(
+              current[e].first, son_key(current[e].second, ison, dim)));
+          }
+        }
+        else
+        {
+          next.push_back(current[e]);
+        }
+      }
+      current.swap(next);
+    }
+  }
+
+
+  //========================================================================
+  /// Hash the position
+  //========================================================================
+  std::size_t RefinementNodeHashTable::PositionHash::operator()(
+    const Position& position) const
+  {
+    std::size_t seed = std::hash<Tree*>()(position.root_pt) ^ position.level;
+    for (unsigned i = 0; i < 3; i++)
+    {
+      seed ^= std::hash<unsigned long>()(position.coordinate[i]) +
+              0x9e3779b9 + (seed << 6) + (seed >> 2);
+      seed ^= std::hash<double>()(position.fraction[i]) + 0x9e3779b9 +
+              (seed << 6) + (seed >> 2);
+    }
+    return seed;
+  }
+
+  //========================================================================
+  /// Get the position of the node at the fractional position
+  /// s_fraction in the element represented by tree_pt; returns false
+  /// if it's on the boundary of the root
+  //========================================================================
+  bool RefinementNodeHashTable::get_position(Tree* const& tree_pt,
+                                             const Vector<double>& s_fraction,
+                                             Position& position) const
+  {
+    unsigned dim = s_fraction.size();
+
+    // Decode the element's position in its tree (if we haven't just
+    // done so)
+    if (tree_pt != Last_tree_pt)
+    {
+      LinearTreeForest::Key key = LinearTreeForest::key(tree_pt);
+      Last_level = LinearTreeForest::level(key, dim);
+      LinearTreeForest::get_coordinates(key, dim, Last_coordinate);
+      Last_root_pt = tree_pt->root_pt();
+      Last_tree_pt = tree_pt;
+    }
+
+    position.root_pt = Last_root_pt;
+    position.level = Last_level;
+    unsigned long n_element_1d = 1ul << Last_level;
+    for (unsigned i = 0; i < 3; i++)
+    {
+      if (i < dim)
+      {
+        position.coordinate[i] = Last_coordinate[i];
+        position.fraction[i] = s_fraction[i];
+
+        // A node on the "upper" face of the element is on the "lower"
+        // face of its neighbour
+        if (position.fraction[i] >= 1.0)
+        {
+          position.coordinate[i]++;
+          position.fraction[i] = 0.0;
+        }
+
+        // Nodes on the boundary of the root aren't stored
+        if (((position.coordinate[i] == 0) && (position.fraction[i] == 0.0)) ||
+            (position.coordinate[i] == n_element_1d))
+        {
+          return false;
+        }
+      }
+      else
+      {
+        position.coordinate[i] = 0;
+        position.fraction[i] = 0.0;
+      }
+    }
+    return true;
+  }
+
+  //========================================================================
+  /// Return the node at the fractional position s_fraction (in
+  /// [0,1]^DIM) in the element represented by tree_pt, if it has been
+  /// stored; NULL otherwise
+  //========================================================================
+  Node* RefinementNodeHashTable::find(Tree* const& tree_pt,
+                                      const Vector<double>& s_fraction) const
+  {
+    if (Node_pt.empty())
+    {
+      return 0;
+    }
+
+    Position position;
+    if (!get_position(tree_pt, s_fraction, position))
+    {
+      return 0;
+    }
+
+    std::unordered_map<Position, Node*, PositionHash>::const_iterator it =
+      Node_pt.find(position);
+    if (it == Node_pt.end())
+    {
+      return 0;
+    }
+    return it->second;
+  }
+
+  //========================================================================
+  /// Store the node at the fractional position s_fraction (in
+  /// [0,1]^DIM) in the element represented by tree_pt (unless a node is
+  /// already stored there or the position is on the boundary of the root)
+  //========================================================================
+  void RefinementNodeHashTable::insert(Tree* const& tree_pt,
+                                       const Vector<double>& s_fraction,
+                                       Node* const& node_pt)
+  {
+    Position position;
+    if (get_position(tree_pt, s_fraction, position))
+    {
+      Node_pt.insert(std::make_pair(position, node_pt));
+    }
+  }
+
+} // namespace oomph
@@ -0,0 +1,286 @@
+// LIC// ====================================================================
+// LIC// This file forms part of oomph-lib, the object-oriented,
+// LIC// multi-physics finite-element library, available
+// LIC// at http://www.oomph-lib.org.
+// LIC//
+// LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+// LIC//
+// LIC// This library is free software; you can redistribute it and/or
+// LIC// modify it under the terms of the GNU Lesser General Public
+// LIC// License as published by the Free Software Foundation; either
+// LIC// version 2.1 of the License, or (at your option) any later version.
+// LIC//
+// LIC// This library is distributed in the hope that it will be useful,
+// LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// LIC// Lesser General Public License for more details.
+// LIC//
+// LIC// You should have received a copy of the GNU Lesser General Public
+// LIC// License along with this library; if not, write to the Free Software
+// LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// LIC// 02110-1301  USA.
+// LIC//
+// LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+// LIC//
+// LIC//====================================================================
+// Header file for the linear (Morton-key based) representation of
+// tree forests
+#ifndef OOMPH_LINEAR_TREE_HEADER
+#define OOMPH_LINEAR_TREE_HEADER
+
+// Config header generated by autoconfig
+#ifdef HAVE_CONFIG_H
+#include <oomph-lib-config.h>
+#endif
+
+#include <unordered_map>
+
+// OOMPH-LIB headers
+#include "Vector.h"
+#include "tree.h"
+
+namespace oomph
+{
+  //======================================================================
+  /// Linear representation of the leaves of a TreeForest (of
+  /// BinaryTrees, QuadTrees or OcTrees): For each root, the leaves are
+  /// stored as an array of Morton keys.
+  ///
+  /// The son types of binary, quad- and octrees are enumerated such
+  /// that bit i of the son type identifies the son's half of its
+  /// father along coordinate direction s_i (e.g. SW=00, SE=01, NW=10,
+  /// NE=11 in a QuadTree). The Morton key of a tree node is the
+  /// sequence of son types along the path from the root to the node,
+  /// preceded by a sentinel bit that encodes the level (so the key of
+  /// the root itself is 1). Its bits interleave the (integer)
+  /// coordinates of the node at its level, so the position of a node
+  /// within its root can be obtained without any pointer chasing
+  /// (this is used by the RefinementNodeHashTable).
+  ///
+  /// The keys of the leaves are a compact, numbering-independent
+  /// description of the refinement pattern of the forest; see
+  /// TreeBasedRefineableMeshBase::get_refinement_pattern_as_leaf_keys(...)
+  /// and TreeBasedRefineableMeshBase::refine_base_mesh_from_leaf_keys(...).
+  ///
+  /// The linear representation is a snapshot: It has to be re-built
+  /// (with build()) whenever the forest has been adapted.
+  //======================================================================
+  class LinearTreeForest
+  {
+  public:
+    /// Type used for the Morton keys
+    typedef unsigned long long Key;
+
+    /// Constructor: Build the linear representation of the forest
+    LinearTreeForest(TreeForest* const& forest_pt);
+
+    /// Broken copy constructor
+    LinearTreeForest(const LinearTreeForest& dummy) = delete;
+
+    /// Broken assignment operator
+    void operator=(const LinearTreeForest&) = delete;
+
+    /// Empty destructor
+    ~LinearTreeForest() {}
+
+    /// (Re-)build the linear representation from the forest (e.g.
+    /// after the mesh has been adapted)
+    void build();
+
+    /// Number of roots (trees) in the forest
+    unsigned nroot() const
+    {
+      return Leaf_key.size();
+    }
+
+    /// Number of leaves in the i_root-th tree
+    unsigned nleaf(const unsigned& i_root) const
+    {
+      return Leaf_key[i_root].size();
+    }
+
+    /// Morton key of the i_leaf-th leaf in the i_root-th tree (the
+    /// leaves are enumerated as in Tree::stick_leaves_into_vector(...))
+    Key leaf_key(const unsigned& i_root, const unsigned& i_leaf) const
+    {
+      return Leaf_key[i_root][i_leaf];
+    }
+
+    /// Get the keys of the leaves in all trees, packed into a single
+    /// vector: [nleaf in tree 0, keys of its leaves, nleaf in tree 1, ...]
+    void get_leaf_keys(Vector<Key>& packed_keys) const;
+
+    /// Max. level that can be represented by the keys in dim dimensions
+    static unsigned max_level(const unsigned& dim)
+    {
+      return 63 / dim;
+    }
+
+    /// Morton key of the tree node (obtained by walking up to its root)
+    static Key key(Tree* const& tree_pt);
+
+    /// Level of the tree node with the given key
+    static unsigned level(const Key& key, const unsigned& dim);
+
+    /// Key of the son (of the given son type) of the tree node with the
+    /// given key
+    static Key son_key(const Key& key, const int& son_type, const unsigned& dim)
+    {
+      return (key << dim) | Key(son_type);
+    }
+
+    /// Get the integer coordinates (in [0, 2^level)) of the tree node
+    /// with the given key, at its level
+    static void get_coordinates(const Key& key,
+                                const unsigned& dim,
+                                Vector<unsigned long>& coordinate);
+
+    /// Get the refinement pattern (in the form used by
+    /// TreeBasedRefineableMeshBase::refine_base_mesh(...)) that
+    /// generates the leaves whose keys are packed as in get_leaf_keys(),
+    /// starting from the roots.
+    static void get_refinement_pattern(const Vector<Key>& packed_keys,
+                                       const unsigned& dim,
+                                       Vector<Vector<unsigned>>& to_be_refined);
+
+  private:
+    /// The forest
+    TreeForest* Forest_pt;
+
+    /// Keys of the leaves, for each tree
+    Vector<Vector<Key>> Leaf_key;
+  };
+
+
+  class Node;
+
+  //======================================================================
+  /// Hash table for the nodes created while the elements in a
+  /// refineable mesh are built during its refinement. The nodes are
+  /// keyed on their position within their root (the level and integer
+  /// coordinates of the element, decoded from its Morton key, plus the
+  /// fractional position of the node within the element), so
+  /// RefineableQElement<DIM>::build(...) can find a node that has already
+  /// been created by another son in the same tree in O(1) time, rather
+  /// than by searching the neighbours (and their sons).
+  ///
+  /// Only nodes that are created and looked up by elements at the same
+  /// level are matched, and nodes on the boundary of the root are never
+  /// stored (they may be shared with, or be periodic images of, nodes in
+  /// other trees); a failed lookup therefore has to be followed by the
+  /// usual neighbour-based search.
+  //======================================================================
+  class RefinementNodeHashTable
+  {
+  public:
+    /// Constructor: Empty table
+    RefinementNodeHashTable() : Last_tree_pt(0), Last_root_pt(0), Last_level(0)
+    {
+    }
+
+    /// Broken copy constructor
+    RefinementNodeHashTable(const RefinementNodeHashTable& dummy) = delete;
+
+    /// Broken assignment operator
+    void operator=(const RefinementNodeHashTable&) = delete;
+
+    /// Empty destructor
+    ~RefinementNodeHashTable() {}
+
+    /// Wipe the table
+    void clear()
+    {
+      Node_pt.clear();
+      Last_tree_pt = 0;
+    }
+
+    /// Number of nodes in the table
+    unsigned long nnode() const
+    {
+      return Node_pt.size();
+    }
+
+    /// Return the node at the fractional position s_fraction (in
+    /// [0,1]^DIM) in the element represented by tree_pt, if it has
+    /// been stored; NULL otherwise
+    Node* find(Tree* const& tree_pt, const Vector<double>& s_fraction) const;
+
+    /// Store the node at the fractional position s_fraction (in
+    /// [0,1]^DIM) in the element represented by tree_pt (unless a node
+    /// is already stored there or the position is on the boundary of the
+    /// root)
+    void insert(Tree* const& tree_pt,
+                const Vector<double>& s_fraction,
+                Node* const& node_pt);
+
+  private:
+    /// Position of a node within a tree: Integer coordinates of the
+    /// element at the given level, plus the fractional position within
+    /// the element (canonicalised so that it's in [0,1))
+    struct Position
+    {
+      /// The root of the tree
+      Tree* root_pt;
+
+      /// The level of the element
+      unsigned level;
+
+      /// Integer coordinates of the element
+      unsigned long coordinate[3];
+
+      /// Fractional position of the node within the element
+      double fraction[3];
+
+      /// Comparison operator
+      bool operator==(const Position& other) const
+      {
+        if ((root_pt != other.root_pt) || (level != other.level))
+        {
+          return false;
+        }
+        for (unsigned i = 0; i < 3; i++)
+        {
+          if ((coordinate[i] != other.coordinate[i]) ||
+              (fraction[i] != other.fraction[i]))
+          {
+            return false;
+          }
+        }
+        return true;
+      }
+    };
+
+    /// Hash function for Positions
+    struct PositionHash
+    {
+      /// Hash the position
+      std::size_t operator()(const Position& position) const;
+    };
+
+    /// Get the position of the node at the fractional position
+    /// s_fraction in the element represented by tree_pt; returns false
+    /// if it's on the boundary of the root
+    bool get_position(Tree* const& tree_pt,
+                      const Vector<double>& s_fraction,
+                      Position& position) const;
+
+    /// The nodes, keyed on their position
+    std::unordered_map<Position, Node*, PositionHash> Node_pt;
+
+    /// The tree node whose coordinates were decoded most recently (all
+    /// the nodes in an element are looked up in turn)
+    mutable Tree* Last_tree_pt;
+
+    /// Root of Last_tree_pt
+    mutable Tree* Last_root_pt;
+
+    /// Level of Last_tree_pt
+    mutable unsigned Last_level;
+
+    /// Integer coordinates of Last_tree_pt
+    mutable Vector<unsigned long> Last_coordinate;
+  };
+
+} // namespace oomph
+
+#endif
@@ -32,6 +32,8 @@
 #include <algorithm>
 #include <limits.h>
 #include <typeinfo>
+#include <typeindex>
+#include <exception>
 
 
 // oomph-lib headers
@@ -51,6 +53,128 @@ namespace oomph
   Steady<0> Mesh::Default_TimeStepper;
 
 
+  //========================================================================
+  /// Group the elements by their dynamic type, so that loops over the
+  /// elements of a given type can be performed with a pointer to the
+  /// actual element type. The groups are enumerated in the order in
+  /// which their first element appears in the mesh.
+  //========================================================================
+  void Mesh::group_elements_by_type()
+  {
+    flush_element_type_groups();
+
+    // Map from the dynamic type to the number of its group
+    std::map<std::type_index, unsigned> group_number;
+
+    unsigned long n_element = Element_pt.size();
+    for (unsigned long e = 0; e < n_element; e++)
+    {
+      GeneralisedElement* el_pt = Element_pt[e];
+      if (el_pt == 0)
+      {
+        continue;
+      }
+
+      // Find (or create) the group for the element's type
+      const std::type_info& el_type = typeid(*el_pt);
+      std::map<std::type_index, unsigned>::iterator it =
+        group_number.find(std::type_index(el_type));
+      unsigned i_group = 0;
+      if (it == group_number.end())
+      {
+        i_group = Element_type_in_group_pt.size();
+        group_number[std::type_index(el_type)] = i_group;
+        Element_type_in_group_pt.push_back(&el_type);
+        Element_number_in_type_group.resize(i_group + 1);
+        Element_pt_in_type_group.resize(i_group + 1);
+        Most_derived_element_pt_in_type_group.resize(i_group + 1);
+      }
+      else
+      {
+        i_group = it->second;
+      }
+
+      Element_number_in_type_group[i_group].push_back(e);
+      Element_pt_in_type_group[i_group].push_back(el_pt);
+      Most_derived_element_pt_in_type_group[i_group].push_back(
+        dynamic_cast<void*>(el_pt));
+    }
+
+    Nelement_when_grouped_by_type = n_element;
+    Element_type_groups_are_up_to_date = true;
+  }
+
+  //========================================================================
+  /// Check that the element type groups contain exactly the elements in
+  /// the mesh and that these still have the recorded dynamic types. This
+  /// catches modifications of the element storage that bypassed the
+  /// Mesh's member functions (and hence didn't flush the groups), and
+  /// elements that were deleted and replaced by new ones at the same
+  /// address.
+  //========================================================================
+  void Mesh::check_element_type_groups() const
+  {
+    unsigned long n_element = Element_pt.size();
+    unsigned long n_element_in_groups = 0;
+    unsigned n_group = Element_type_in_group_pt.size();
+    for (unsigned i_group = 0; i_group < n_group; i_group++)
+    {
+      check_element_type_group(i_group);
+      n_element_in_groups += Element_number_in_type_group[i_group].size();
+    }
+
+    // Null entries in the mesh are not included in the groups
+    unsigned long n_non_null_element = 0;
+    for (unsigned long e = 0; e < n_element; e++)
+    {
+      if (Element_pt[e] != 0)
+      {
+        n_non_null_element++;
+      }
+    }
+    if (n_element_in_groups != n_non_null_element)
+    {
+      std::ostringstream error_stream;
+      error_stream
+        << "Element type groups contain " << n_element_in_groups
+        << " elements but the mesh contains " << n_non_null_element
+        << ".\nIf you modify the mesh's element storage directly (rather\n"
+        << "than through the Mesh's member functions), you must call\n"
+        << "Mesh::flush_element_type_groups() afterwards.\n";
+      throw OomphLibError(
+        error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+  }
+
+  //========================================================================
+  /// Check that the elements in the i_group-th element type group are
+  /// still in the mesh, at the recorded positions, and still have the
+  /// group's dynamic type
+  //========================================================================
+  void Mesh::check_element_type_group(const unsigned& i_group) const
+  {
+    unsigned long n_element = Element_pt.size();
+    unsigned long n_el = Element_number_in_type_group[i_group].size();
+    for (unsigned long i = 0; i < n_el; i++)
+    {
+      unsigned long e = Element_number_in_type_group[i_group][i];
+      GeneralisedElement* el_pt = Element_pt_in_type_group[i_group][i];
+      if ((e >= n_element) || (Element_pt[e] != el_pt) ||
+          (typeid(*el_pt) != *Element_type_in_group_pt[i_group]))
+      {
+        std::ostringstream error_stream;
+        error_stream
+          << "Element type groups don't match the elements in the mesh.\n"
+          << "If you modify the mesh's element storage directly (rather\n"
+          << "than through the Mesh's member functions), you must call\n"
+          << "Mesh::flush_element_type_groups() afterwards.\n";
+        throw OomphLibError(
+          error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+      }
+    }
+  }
+
+
   //=======================================================================
   /// Static boolean flag to control warning about mesh level timesteppers
   //=======================================================================
@@ -87,6 +211,8 @@ namespace oomph
     // Reserve storage for element and node pointers
     Element_pt.clear();
     Element_pt.reserve(n_element);
+    flush_element_type_groups();
+    flush_local_eqn_table();
     Node_pt.clear();
     Node_pt.reserve(n_node);
 
@@ -94,11 +220,12 @@ namespace oomph
     Boundary_node_pt.clear();
     Boundary_node_pt.resize(n_bound);
 
-    // Sets of pointers to elements and nodes (to exlude duplicates -- they
-    // shouldn't occur anyway but if they do, they must only be added
-    // once in the global mesh to avoid trouble in the timestepping)
+    // Set of pointers to elements and visit stamp for nodes (to exclude
+    // duplicates -- they shouldn't occur anyway but if they do, they must
+    // only be added once in the global mesh to avoid trouble in the
+    // timestepping)
     std::set<GeneralisedElement*> element_set_pt;
-    std::set<Node*> node_set_pt;
+    const unsigned node_added_stamp = Data::new_visit_stamp();
 
     // Counter for total number of boundaries in all the submeshes
     unsigned ibound_global = 0;
@@ -135,15 +262,12 @@ namespace oomph
 
       // Loop over the nodes of the submesh and add to vector
       // duplicates are ignored
-      unsigned nnod_before = 0;
       unsigned long n_node = sub_mesh_pt[imesh]->nnode();
       for (unsigned long n = 0; n < n_node; n++)
       {
         Node* nod_pt = sub_mesh_pt[imesh]->node_pt(n);
-        node_set_pt.insert(nod_pt);
         // Was it a duplicate?
-        unsigned nnod_now = node_set_pt.size();
-        if (nnod_now == nnod_before)
+        if (!nod_pt->mark_visited(node_added_stamp))
         {
           std::ostringstream warning_stream;
           warning_stream
@@ -159,7 +283,6 @@ namespace oomph
         {
           Node_pt.push_back(nod_pt);
         }
-        nnod_before = nnod_now;
       }
 
       // Loop over the boundaries of the submesh
@@ -178,6 +301,9 @@ namespace oomph
         ibound_global++;
       }
     } // End of loop over submeshes
+
+    // The traversal of the nodes is complete
+    Data::release_visit_stamp(node_added_stamp);
   }
 
 
@@ -760,16 +886,111 @@ namespace oomph
 
 
   //========================================================
-  /// Assign local equation numbers in all elements
+  /// Assign local equation numbers in all elements. The elements
+  /// are independent of each other, so (if the code is compiled with
+  /// OpenMP and this has been enabled) they're numbered concurrently.
   //========================================================
   void Mesh::assign_local_eqn_numbers(const bool& store_local_dof_pt)
   {
+    // The local equation table refers to the old numbering
+    flush_local_eqn_table();
+
     // Now loop over the elements and assign local equation numbers
-    unsigned long Element_pt_range = Element_pt.size();
-    for (unsigned long i = 0; i < Element_pt_range; i++)
+    const long n_element = Element_pt.size();
+
+    // Storage for any exception thrown by one of the threads
+    std::exception_ptr exception_pt;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 64) \
+  if (Use_parallel_local_eqn_numbering)
+#endif
+    for (long e = 0; e < n_element; e++)
+    {
+      // Exceptions must not escape from the parallel region
+      try
+      {
+        Element_pt[e]->assign_local_eqn_numbers(store_local_dof_pt);
+      }
+      catch (...)
+      {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+        {
+          if (!exception_pt)
+          {
+            exception_pt = std::current_exception();
+          }
+        }
+      }
+    }
+
+    // Pass on the first exception
+    if (exception_pt)
+    {
+      std::rethrow_exception(exception_pt);
+    }
+  }
+
+  //========================================================
+  /// Set up the local equation table, which stores the elements'
+  /// local-to-global equation numbers (and, if required, the pointers
+  /// to the dofs) contiguously.
+  //========================================================
+  void Mesh::setup_local_eqn_table(const bool& store_local_dof_pt)
+  {
+    // Find where each element's entries start...
+    const unsigned long n_element = Element_pt.size();
+    Local_eqn_table_row_start.resize(n_element + 1);
+    Local_eqn_table_row_start[0] = 0;
+    for (unsigned long e = 0; e < n_element; e++)
+    {
+      Local_eqn_table_row_start[e + 1] = Local_eqn_table_row_start[e];
+      if (Element_pt[e] != 0)
+      {
+        Local_eqn_table_row_start[e + 1] += Element_pt[e]->ndof();
+      }
+    }
+
+    // ...and copy them across
+    const unsigned long n_entry = Local_eqn_table_row_start[n_element];
+    Local_eqn_table_global_eqn.resize(n_entry);
+    if (store_local_dof_pt)
+    {
+      Local_eqn_table_dof_pt.resize(n_entry);
+    }
+    else
+    {
+      Local_eqn_table_dof_pt.clear();
+    }
+
+    // Storage for the pointers to the element's dofs
+    Vector<double*> dof_pt;
+    for (unsigned long e = 0; e < n_element; e++)
     {
-      Element_pt[i]->assign_local_eqn_numbers(store_local_dof_pt);
+      GeneralisedElement* const el_pt = Element_pt[e];
+      if (el_pt == 0)
+      {
+        continue;
+      }
+      const unsigned long offset = Local_eqn_table_row_start[e];
+      const unsigned n_dof = el_pt->ndof();
+      for (unsigned i = 0; i < n_dof; i++)
+      {
+        Local_eqn_table_global_eqn[offset + i] = el_pt->eqn_number(i);
+      }
+      if (store_local_dof_pt && (n_dof > 0))
+      {
+        el_pt->dof_pt_vector(dof_pt);
+        for (unsigned i = 0; i < n_dof; i++)
+        {
+          Local_eqn_table_dof_pt[offset + i] = dof_pt[i];
+        }
+      }
     }
+
+    Local_eqn_table_is_up_to_date = true;
   }
 
   //========================================================
@@ -175,8 +175,9 @@ namespace oomph
     void describe_local_dofs(std::ostream& out,
                              const std::string& current_string) const;
 
-    /// Assign the local equation numbers in all elements
-    /// If the boolean argument is true then also store pointers to dofs
+    /// Assign the local equation numbers in all elements (concurrently,
+    /// if this has been enabled). If the boolean argument is true then
+    /// also store pointers to dofs
     void assign_local_eqn_numbers(const bool& store_local_dof_pt);
 
     /// Vector of pointers to nodes
@@ -185,6 +186,56 @@ namespace oomph
     /// Vector of pointers to generalised elements
     Vector<GeneralisedElement*> Element_pt;
 
+    /// Dynamic types of the elements in the element type groups
+    /// (see group_elements_by_type())
+    Vector<const std::type_info*> Element_type_in_group_pt;
+
+    /// Numbers of the elements in each element type group
+    Vector<Vector<unsigned long>> Element_number_in_type_group;
+
+    /// Pointers to the elements in each element type group
+    Vector<Vector<GeneralisedElement*>> Element_pt_in_type_group;
+
+    /// Pointers to the most derived objects of the elements in each
+    /// element type group (so they can be converted to the actual
+    /// element type with a static cast)
+    Vector<Vector<void*>> Most_derived_element_pt_in_type_group;
+
+    /// Number of elements in the mesh when the element type groups
+    /// were set up
+    unsigned long Nelement_when_grouped_by_type;
+
+    /// Boolean to indicate if the element type groups have been set up
+    /// and the mesh's element storage hasn't been modified since (through
+    /// the Mesh's member functions or by the Problem's equation
+    /// numbering, which follows any change to the elements)
+    bool Element_type_groups_are_up_to_date;
+
+    /// Global equation numbers of the local equations of all
+    /// elements, stored contiguously (in compressed row storage) by
+    /// setup_local_eqn_table(...): The global equation number of the
+    /// i-th local equation of the e-th element is stored in entry
+    /// Local_eqn_table_row_start[e]+i.
+    Vector<unsigned long> Local_eqn_table_global_eqn;
+
+    /// Start of the e-th element's entries in the local equation table
+    /// (the vector has nelement()+1 entries when the table has been set up)
+    Vector<unsigned long> Local_eqn_table_row_start;
+
+    /// Pointers to the dofs associated with the entries in the local
+    /// equation table (only set up if setup_local_eqn_table(...) is
+    /// told to store pointers to the dofs)
+    Vector<double*> Local_eqn_table_dof_pt;
+
+    /// Boolean to indicate if the local equation table has been set up
+    /// and neither the elements in the mesh nor their equation numbers
+    /// have changed since
+    bool Local_eqn_table_is_up_to_date;
+
+    /// Boolean to indicate if the elements' local equation numbers
+    /// may be assigned concurrently (if the code is compiled with OpenMP)
+    bool Use_parallel_local_eqn_numbering;
+
     /// Vector of boolean data that indicates whether the boundary
     /// coordinates have been set for the boundary
     std::vector<bool> Boundary_coordinate_exists;
@@ -237,6 +288,13 @@ namespace oomph
     {
       // Lookup scheme hasn't been setup yet
       Lookup_for_elements_next_boundary_is_setup = false;
+      // Elements haven't been grouped by type yet
+      Nelement_when_grouped_by_type = 0;
+      Element_type_groups_are_up_to_date = false;
+      // Local equation table hasn't been set up yet
+      Local_eqn_table_is_up_to_date = false;
+      // Local equation numbers are assigned serially by default
+      Use_parallel_local_eqn_numbering = false;
 #ifdef OOMPH_HAS_MPI
       // Set defaults for distributed meshes
 
@@ -256,6 +314,13 @@ namespace oomph
     /// duplicates; no boundary information etc. is created).
     Mesh(const Vector<Mesh*>& sub_mesh_pt)
     {
+      // Elements haven't been grouped by type yet
+      Nelement_when_grouped_by_type = 0;
+      Element_type_groups_are_up_to_date = false;
+      // Local equation table hasn't been set up yet
+      Local_eqn_table_is_up_to_date = false;
+      // Local equation numbers are assigned serially by default
+      Use_parallel_local_eqn_numbering = false;
 #ifdef OOMPH_HAS_MPI
       // Mesh hasn't been distributed: Null out pointer to communicator
       Comm_pt = 0;
@@ -423,6 +488,8 @@ namespace oomph
     void flush_element_storage()
     {
       Element_pt.clear();
+      flush_element_type_groups();
+      flush_local_eqn_table();
     }
 
     /// Flush storage for nodes (only) by emptying the
@@ -598,6 +665,225 @@ namespace oomph
       return Node_pt.size();
     }
 
+    /// Group the elements by their dynamic type, so that loops over
+    /// the elements of a given type can be performed with a pointer to
+    /// the actual element type (see visit_elements_of_type(...)).
+    /// The elements stay where they are in the mesh: The groups contain
+    /// their numbers. Null entries in the mesh's element vector are
+    /// ignored.
+    void group_elements_by_type();
+
+    /// Are the element type groups up to date? They're outdated by
+    /// any change to the mesh's elements through the Mesh's member
+    /// functions (add_element_pt(...), flush_element_storage(), mesh
+    /// adaptation, ...) and by the Problem's equation numbering. Code
+    /// that modifies the element storage directly, once the groups have
+    /// been set up, must call flush_element_type_groups(). (This check
+    /// is cheap; with PARANOID, visit_elements_of_type(...) also checks
+    /// the elements in the group it visits, see
+    /// check_element_type_group(...).)
+    bool element_type_groups_are_up_to_date() const
+    {
+      return (Element_type_groups_are_up_to_date &&
+              (Element_pt.size() == Nelement_when_grouped_by_type));
+    }
+
+    /// Wipe the element type groups (they're rebuilt when they're
+    /// next needed)
+    void flush_element_type_groups()
+    {
+      Element_type_in_group_pt.clear();
+      Element_number_in_type_group.clear();
+      Element_pt_in_type_group.clear();
+      Most_derived_element_pt_in_type_group.clear();
+      Nelement_when_grouped_by_type = 0;
+      Element_type_groups_are_up_to_date = false;
+    }
+
+    /// Check that the element type groups, which are flagged as
+    /// being up to date, contain exactly the elements in the mesh and
+    /// that these still have the recorded dynamic types (throws an
+    /// error otherwise)
+    void check_element_type_groups() const;
+
+    /// Check that the elements in the i_group-th element type group are
+    /// still in the mesh, at the recorded positions, and still have the
+    /// group's dynamic type (throws an error otherwise)
+    void check_element_type_group(const unsigned& i_group) const;
+
+    /// Number of element type groups (they're (re-)built if they're
+    /// not up to date)
+    unsigned nelement_type_group()
+    {
+      if (!element_type_groups_are_up_to_date())
+      {
+        group_elements_by_type();
+      }
+      return Element_type_in_group_pt.size();
+    }
+
+    /// Dynamic type of the elements in the i_group-th element type group
+    const std::type_info& element_type_in_group(const unsigned& i_group) const
+    {
+      return *Element_type_in_group_pt[i_group];
+    }
+
+    /// Number of elements in the i_group-th element type group
+    unsigned long nelement_in_type_group(const unsigned& i_group) const
+    {
+      return Element_number_in_type_group[i_group].size();
+    }
+
+    /// Number (in the mesh) of the i-th element in the i_group-th element
+    /// type group
+    unsigned long element_number_in_type_group(const unsigned& i_group,
+                                               const unsigned long& i) const
+    {
+      return Element_number_in_type_group[i_group][i];
+    }
+
+    /// Pointer to the i-th element in the i_group-th element type group
+    GeneralisedElement* element_in_type_group_pt(const unsigned& i_group,
+                                                 const unsigned long& i) const
+    {
+      return Element_pt_in_type_group[i_group][i];
+    }
+
+    /// Set up the local equation table, a contiguous copy of the
+    /// elements' local-to-global equation numbers (and, if the boolean
+    /// argument is true, of the pointers to their dofs, which the
+    /// elements must have stored). The table is only valid until
+    /// the elements in the mesh or their equation numbers change.
+    /// Null entries in the mesh's element vector have no entries.
+    void setup_local_eqn_table(const bool& store_local_dof_pt = false);
+
+    /// Is the local equation table (still) valid? It is outdated by
+    /// the (re-)assignment of the local equation numbers, by changes
+    /// to the mesh's elements through the Mesh's member functions and
+    /// by the Problem's equation numbering (which also covers the global
+    /// mesh when the Problem numbers its sub-meshes).
+    bool local_eqn_table_is_set_up() const
+    {
+      return (Local_eqn_table_is_up_to_date &&
+              (Local_eqn_table_row_start.size() == Element_pt.size() + 1));
+    }
+
+    /// Wipe the local equation table
+    void flush_local_eqn_table()
+    {
+      Local_eqn_table_global_eqn.clear();
+      Local_eqn_table_row_start.clear();
+      Local_eqn_table_dof_pt.clear();
+      Local_eqn_table_is_up_to_date = false;
+    }
+
+    /// Number of local equations of the e-th element, according to the
+    /// local equation table
+    unsigned nlocal_eqn_in_table(const unsigned long& e) const
+    {
+      return Local_eqn_table_row_start[e + 1] - Local_eqn_table_row_start[e];
+    }
+
+    /// Pointer to the global equation numbers of the e-th element's local
+    /// equations in the local equation table. They are stored
+    /// contiguously (ordered by local equation number), and so are those
+    /// of consecutive elements, so this provides the local-to-global
+    /// map for scatter-based assembly without going through the elements.
+    const unsigned long* local_to_global_eqn_pt(const unsigned long& e) const
+    {
+#ifdef PARANOID
+      if (!local_eqn_table_is_set_up())
+      {
+        throw OomphLibError("Local equation table is not set up (or is "
+                            "outdated); call "
+                            "Mesh::setup_local_eqn_table(...) first.",
+                            OOMPH_CURRENT_FUNCTION,
+                            OOMPH_EXCEPTION_LOCATION);
+      }
+#endif
+      // Note: Not &Local_eqn_table_global_eqn[0], which is out of range
+      // if none of the elements has any equations
+      return Local_eqn_table_global_eqn.data() + Local_eqn_table_row_start[e];
+    }
+
+    /// Pointer to the pointers to the dofs associated with the e-th
+    /// element's local equations in the local equation table (only
+    /// available if the pointers to the dofs were stored in the call to
+    /// setup_local_eqn_table(...))
+    double* const* local_dof_pt_in_table(const unsigned long& e) const
+    {
+#ifdef PARANOID
+      if ((!local_eqn_table_is_set_up()) ||
+          (Local_eqn_table_dof_pt.size() != Local_eqn_table_global_eqn.size()))
+      {
+        throw OomphLibError("Pointers to dofs are not stored in the local "
+                            "equation table; call "
+                            "Mesh::setup_local_eqn_table(true) first.",
+                            OOMPH_CURRENT_FUNCTION,
+                            OOMPH_EXCEPTION_LOCATION);
+      }
+#endif
+      return Local_eqn_table_dof_pt.data() + Local_eqn_table_row_start[e];
+    }
+
+    /// Enable concurrent assignment of the elements' local equation
+    /// numbers (only has an effect if the code is compiled with
+    /// OpenMP). The elements' (possibly overloaded) local equation
+    /// numbering must be thread-safe.
+    void enable_parallel_local_eqn_numbering()
+    {
+      Use_parallel_local_eqn_numbering = true;
+    }
+
+    /// Disable concurrent assignment of the elements' local equation
+    /// numbers (the default)
+    void disable_parallel_local_eqn_numbering()
+    {
+      Use_parallel_local_eqn_numbering = false;
+    }
+
+    /// Call visitor(el_pt) for all elements whose dynamic type is
+    /// exactly ELEMENT (in the order in which they're stored in the
+    /// mesh), with el_pt being an ELEMENT* that is obtained without a
+    /// (per-element) dynamic cast. Note that calls to the element's
+    /// virtual member functions through el_pt are still dispatched
+    /// virtually. The element type groups are (re-)built if they're
+    /// not up to date. Returns the number of elements visited.
+    template<class ELEMENT, class VISITOR>
+    unsigned long visit_elements_of_type(VISITOR& visitor)
+    {
+      if (!element_type_groups_are_up_to_date())
+      {
+        group_elements_by_type();
+      }
+
+      // Find the group of elements of this type (if any)
+      unsigned n_group = Element_type_in_group_pt.size();
+      for (unsigned i_group = 0; i_group < n_group; i_group++)
+      {
+        if (*Element_type_in_group_pt[i_group] == typeid(ELEMENT))
+        {
+#ifdef PARANOID
+          // Only check the elements we're about to visit, so the cost
+          // is proportional to the work done by the visitor
+          check_element_type_group(i_group);
+#endif
+
+          // The elements' dynamic type is ELEMENT, so their most
+          // derived objects are ELEMENTs
+          const Vector<void*>& el_pt =
+            Most_derived_element_pt_in_type_group[i_group];
+          unsigned long n_el = el_pt.size();
+          for (unsigned long e = 0; e < n_el; e++)
+          {
+            visitor(static_cast<ELEMENT*>(el_pt[e]));
+          }
+          return n_el;
+        }
+      }
+      return 0;
+    }
+
     /// Return number of dof types in mesh
     unsigned ndof_types() const;
 
@@ -617,6 +903,8 @@ namespace oomph
     void add_element_pt(GeneralisedElement* const& element_pt)
     {
       Element_pt.push_back(element_pt);
+      Element_type_groups_are_up_to_date = false;
+      Local_eqn_table_is_up_to_date = false;
     }
 
     /// Update nodal positions in response to changes in the domain
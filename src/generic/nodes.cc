@@ -202,10 +202,24 @@ namespace oomph
     Eqn_number = 0;
   }
 
+  //================================================================
+  /// Default (steady) timestepper for steady Data. This is a
+  /// function-local static so that it is created on first use: Data
+  /// that are constructed during the static initialisation of another
+  /// translation unit would otherwise dereference a null pointer when
+  /// setting up their history index.
+  //================================================================
+  TimeStepper* Data::default_static_time_stepper_pt()
+  {
+    static TimeStepper* const time_stepper_pt = new Steady<0>();
+    return time_stepper_pt;
+  }
+
   //================================================================
   /// Default (steady) timestepper for steady Data
   //================================================================
-  TimeStepper* Data::Default_static_time_stepper_pt = new Steady<0>();
+  TimeStepper* Data::Default_static_time_stepper_pt =
+    Data::default_static_time_stepper_pt();
 
   //================================================================
   /// Static "Magic number" to indicate pinned values
@@ -231,13 +245,82 @@ namespace oomph
   long Data::Is_segregated_solve_pinned = -3;
 
 
+  //================================================================
+  /// Counter for the visit stamps issued by Data::new_visit_stamp()
+  //================================================================
+  unsigned Data::Visit_stamp_counter = 0;
+
+#ifdef PARANOID
+  //================================================================
+  /// Stamp of the traversal that is currently active (zero if there
+  /// is none)
+  //================================================================
+  unsigned Data::Active_visit_stamp = 0;
+#endif
+
+  //================================================================
+  /// Issue a new stamp for a traversal that must process each Data
+  /// object only once. Zero is never issued because it labels Data
+  /// that have never been visited.
+  //================================================================
+  unsigned Data::new_visit_stamp()
+  {
+#ifdef PARANOID
+    if (Active_visit_stamp != 0)
+    {
+      std::ostringstream error_stream;
+      error_stream << "The traversal with visit stamp " << Active_visit_stamp
+                   << " is still active.\n"
+                   << "Traversals that use visit stamps can't be nested: "
+                   << "Call Data::release_visit_stamp(...)\n"
+                   << "at the end of each traversal.\n";
+      throw OomphLibError(
+        error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+#endif
+
+    // Skip zero when the counter wraps around
+    Visit_stamp_counter++;
+    if (Visit_stamp_counter == 0)
+    {
+      Visit_stamp_counter++;
+    }
+
+#ifdef PARANOID
+    Active_visit_stamp = Visit_stamp_counter;
+#endif
+    return Visit_stamp_counter;
+  }
+
+  //================================================================
+  /// End the traversal that uses the given stamp
+  //================================================================
+  void Data::release_visit_stamp(const unsigned& stamp)
+  {
+#ifdef PARANOID
+    if (stamp != Active_visit_stamp)
+    {
+      std::ostringstream error_stream;
+      error_stream << "Visit stamp " << stamp
+                   << " doesn't belong to the active traversal (whose "
+                   << "stamp is " << Active_visit_stamp << ")\n";
+      throw OomphLibError(
+        error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+    Active_visit_stamp = 0;
+#endif
+  }
+
+
   //================================================================
   /// Default constructor.
   //================================================================
   Data::Data()
     : Value(0),
       Eqn_number(0),
-      Time_stepper_pt(Data::Default_static_time_stepper_pt),
+      Time_stepper_pt(Data::default_static_time_stepper_pt()),
+      History_index_pt(
+        Data::default_static_time_stepper_pt()->history_index_pt()),
       Copy_of_data_pt(0),
       Ncopies(0),
       Nvalue(0)
@@ -245,6 +328,8 @@ namespace oomph
       ,
       Non_halo_proc_ID(-1)
 #endif
+      ,
+      Visit_stamp(0)
 
   {
   }
@@ -256,7 +341,9 @@ namespace oomph
   Data::Data(const unsigned& initial_n_value)
     : Value(0),
       Eqn_number(0),
-      Time_stepper_pt(Data::Default_static_time_stepper_pt),
+      Time_stepper_pt(Data::default_static_time_stepper_pt()),
+      History_index_pt(
+        Data::default_static_time_stepper_pt()->history_index_pt()),
       Copy_of_data_pt(0),
       Ncopies(0),
       Nvalue(initial_n_value)
@@ -264,6 +351,8 @@ namespace oomph
       ,
       Non_halo_proc_ID(-1)
 #endif
+      ,
+      Visit_stamp(0)
   {
     // Only bother to do something if there are values
     if (initial_n_value > 0)
@@ -302,6 +391,7 @@ namespace oomph
     : Value(0),
       Eqn_number(0),
       Time_stepper_pt(time_stepper_pt_),
+      History_index_pt(time_stepper_pt_->history_index_pt()),
       Copy_of_data_pt(0),
       Ncopies(0),
       Nvalue(initial_n_value)
@@ -309,6 +399,8 @@ namespace oomph
       ,
       Non_halo_proc_ID(-1)
 #endif
+      ,
+      Visit_stamp(0)
   {
     // If we are in charge of allocating the storage,
     // and there are data to allocate, do so
@@ -420,8 +512,12 @@ namespace oomph
       n_preserved_tstorage = this->ntstorage();
     }
 
+    // Keep track of the old indexing of the history values
+    const TimeHistoryIndex* const old_history_index_pt = History_index_pt;
+
     // Set the new time stepper
     Time_stepper_pt = time_stepper_pt;
+    History_index_pt = time_stepper_pt->history_index_pt();
 
     // If the data is a copy don't mess with it
     if (this->is_a_copy())
@@ -451,7 +547,8 @@ namespace oomph
       {
         for (unsigned t = 0; t < n_preserved_tstorage; t++)
         {
-          values[i * n_tstorage + t] = Value[i][t];
+          values[i * n_tstorage + History_index_pt->slot(t)] =
+            Value[i][old_history_index_pt->slot(t)];
         }
       }
 
@@ -465,7 +562,7 @@ namespace oomph
         // Initialise all new time storage values to zero
         for (unsigned t = n_preserved_tstorage; t < n_tstorage; t++)
         {
-          Value[i][t] = 0.0;
+          Value[i][History_index_pt->slot(t)] = 0.0;
         }
       }
 
@@ -1573,7 +1670,9 @@ namespace oomph
   //========================================================================
   Node::Node()
     : Data(),
-      Position_time_stepper_pt(Data::Default_static_time_stepper_pt),
+      Position_time_stepper_pt(Data::default_static_time_stepper_pt()),
+      Position_history_index_pt(
+        Data::default_static_time_stepper_pt()->history_index_pt()),
       Hanging_pt(0),
       Ndim(0),
       Nposition_type(0),
@@ -1598,7 +1697,9 @@ namespace oomph
              const bool& allocate_x_position)
     : Data(initial_n_value),
       X_position(0),
-      Position_time_stepper_pt(Data::Default_static_time_stepper_pt),
+      Position_time_stepper_pt(Data::default_static_time_stepper_pt()),
+      Position_history_index_pt(
+        Data::default_static_time_stepper_pt()->history_index_pt()),
       Hanging_pt(0),
       Ndim(n_dim),
       Nposition_type(n_position_type),
@@ -1649,6 +1750,7 @@ namespace oomph
     : Data(time_stepper_pt_, initial_n_value),
       X_position(0),
       Position_time_stepper_pt(time_stepper_pt_),
+      Position_history_index_pt(time_stepper_pt_->history_index_pt()),
       Hanging_pt(0),
       Ndim(n_dim),
       Nposition_type(n_position_type),
@@ -1766,8 +1868,13 @@ namespace oomph
       n_preserved_tstorage = Position_time_stepper_pt->ntstorage();
     }
 
+    // Keep track of the old indexing of the history values
+    const TimeHistoryIndex* const old_history_index_pt =
+      Position_history_index_pt;
+
     // Set the new time stepper
     Position_time_stepper_pt = position_time_stepper_pt;
+    Position_history_index_pt = position_time_stepper_pt->history_index_pt();
 
     // Determine the total amount of storage required for position variables
     const unsigned n_storage = this->ndim() * this->nposition_type();
@@ -1790,7 +1897,8 @@ namespace oomph
     {
       for (unsigned t = 0; t < n_preserved_tstorage; t++)
       {
-        x_positions[j * n_tstorage + t] = this->X_position[j][t];
+        x_positions[j * n_tstorage + Position_history_index_pt->slot(t)] =
+          this->X_position[j][old_history_index_pt->slot(t)];
       }
     }
 
@@ -1805,7 +1913,7 @@ namespace oomph
       // Initialise all new time storgae values to be zero
       for (unsigned t = n_preserved_tstorage; t < n_tstorage; t++)
       {
-        X_position[j][t] = 0.0;
+        X_position[j][Position_history_index_pt->slot(t)] = 0.0;
       }
     }
   }
@@ -1954,7 +2062,9 @@ namespace oomph
     {
       for (unsigned j = 0; j < npos_storage; j++)
       {
-        X_position[j][t] = orig_node_pt->X_position[j][t];
+        X_position[j][Position_history_index_pt->slot(t)] =
+          orig_node_pt
+            ->X_position[j][orig_node_pt->Position_history_index_pt->slot(t)];
       }
     }
 
@@ -1982,7 +2092,8 @@ namespace oomph
     {
       for (unsigned j = 0; j < npos_storage; j++)
       {
-        dump_file << X_position[j][t] << std::endl;
+        dump_file << X_position[j][Position_history_index_pt->slot(t)]
+                  << std::endl;
       }
     }
 
@@ -2047,7 +2158,8 @@ namespace oomph
         getline(restart_file, input_string);
 
         // Transform to double
-        X_position[j][t] = atof(input_string.c_str());
+        X_position[j][Position_history_index_pt->slot(t)] =
+          atof(input_string.c_str());
       }
     }
 
@@ -3557,6 +3669,7 @@ namespace oomph
 
     // Set the new time stepper
     Position_time_stepper_pt = position_time_stepper_pt;
+    Position_history_index_pt = position_time_stepper_pt->history_index_pt();
 
     // Now simply set the time stepper of the variable position data
     this->Variable_position_pt->set_time_stepper(position_time_stepper_pt,
@@ -62,6 +62,81 @@ namespace oomph
   template<class NODE_TYPE>
   class BoundaryNode;
 
+
+  //=====================================================================
+  /// Map from the (logical) time level t (t=0: present; t>0: previous)
+  /// to the slot in which the corresponding history value is stored.
+  /// By default the two coincide. If a TimeStepper uses indexed history
+  /// the slots 1,...,nring() that hold the previous values form a ring
+  /// buffer: Advancing to the next timestep rotates the ring instead of
+  /// copying each value down by one slot, so only the present value has
+  /// to be copied (into the slot that becomes the previous value).
+  /// The present value (t=0) and any additional history values
+  /// (t>nring(), e.g. velocities or predicted values) stay where they are.
+  /// Every TimeStepper owns one of these; Data and Nodes keep a pointer to
+  /// the one owned by their TimeStepper.
+  //=====================================================================
+  class TimeHistoryIndex
+  {
+  public:
+    /// Constructor: Logical and physical time levels coincide
+    TimeHistoryIndex() : Nring(0), Offset(0) {}
+
+    /// Slot in which the history value at time level t is stored
+    unsigned slot(const unsigned& t) const
+    {
+      if ((t == 0) || (t > Nring))
+      {
+        return t;
+      }
+      const unsigned s = t + Offset;
+      return (s > Nring) ? s - Nring : s;
+    }
+
+    /// Number of history values in the ring buffer (zero if the
+    /// history is not indexed)
+    unsigned nring() const
+    {
+      return Nring;
+    }
+
+    /// Use a ring buffer for the history values at time levels
+    /// 1,...,n_ring (n_ring=0 switches indexing off). Must only be
+    /// called while the ring is not rotated, i.e. while logical and
+    /// physical time levels coincide.
+    void set_nring(const unsigned& n_ring)
+    {
+      Nring = n_ring;
+      Offset = 0;
+    }
+
+    /// Is the ring rotated, i.e. do logical and physical time levels
+    /// differ?
+    bool is_rotated() const
+    {
+      return (Offset != 0);
+    }
+
+    /// Rotate the ring so that the value stored at time level nring()
+    /// becomes the value at time level 1, and the values at all
+    /// other time levels t become those at time level t+1.
+    void rotate()
+    {
+      if (Nring > 0)
+      {
+        Offset = (Offset == 0) ? Nring - 1 : Offset - 1;
+      }
+    }
+
+  private:
+    /// Number of history values in the ring buffer
+    unsigned Nring;
+
+    /// Rotation of the ring buffer
+    unsigned Offset;
+  };
+
+
   //=====================================================================
   /// A class that represents a collection of data;
   /// each Data object may contain many different individual values,
@@ -121,6 +196,10 @@ namespace oomph
     /// low (Data) level.
     TimeStepper* Time_stepper_pt;
 
+    /// Pointer to the Timestepper's map from logical time levels
+    /// to the storage slots of the history values.
+    const TimeHistoryIndex* History_index_pt;
+
   protected:
     /// C-style array of any Data objects that contain copies
     /// of the current Data object's data values.
@@ -139,6 +218,20 @@ namespace oomph
     /// Non-halo processor ID for Data; -1 if it's not a halo.
     int Non_halo_proc_ID;
 
+#endif
+
+    /// Stamp of the most recent traversal that has visited this
+    /// Data object (zero if it has never been visited).
+    /// See Data::new_visit_stamp().
+    unsigned Visit_stamp;
+
+    /// Counter for the visit stamps that have been issued so far
+    static unsigned Visit_stamp_counter;
+
+#ifdef PARANOID
+    /// Stamp of the traversal that is currently active (zero if there
+    /// is none); used to detect nested traversals
+    static unsigned Active_visit_stamp;
 #endif
 
     /// Check that the arguments are within
@@ -161,6 +254,10 @@ namespace oomph
     /// Default (static) timestepper used in steady problems.
     static TimeStepper* Default_static_time_stepper_pt;
 
+    /// Pointer to the default (static) timestepper; safe to use during
+    /// static initialisation.
+    static TimeStepper* default_static_time_stepper_pt();
+
     /// Helper function that should be overloaded in derived classes
     /// that can contain copies of Data. The function must
     /// reset the internal pointers to the copied data. This is used
@@ -234,7 +331,9 @@ namespace oomph
     void set_time_stepper(TimeStepper* const& time_stepper_pt,
                           const bool& preserve_existing_data);
 
-    /// Return the pointer to the timestepper.
+    /// Return the pointer to the timestepper. Use set_time_stepper(...)
+    /// to change the timestepper -- this also updates the storage and
+    /// the indexing of the history values.
     TimeStepper*& time_stepper_pt()
     {
       return Time_stepper_pt;
@@ -283,7 +382,7 @@ namespace oomph
 #ifdef RANGE_CHECKING
       range_check(t, i);
 #endif
-      Value[i][t] = value_;
+      Value[i][History_index_pt->slot(t)] = value_;
     }
 
     /// Return i-th stored value.
@@ -307,7 +406,7 @@ namespace oomph
 #ifdef RANGE_CHECKING
       range_check(t, i);
 #endif
-      return Value[i][t];
+      return Value[i][History_index_pt->slot(t)];
     }
 
     /// Compute Vector of values for the Data value.
@@ -339,7 +438,7 @@ namespace oomph
 #ifdef RANGE_CHECKING
       range_check(t, i);
 #endif
-      return &Value[i][t];
+      return &Value[i][History_index_pt->slot(t)];
     }
 
     /// Check whether the pointer parameter_pt addresses internal data values
@@ -564,6 +663,53 @@ namespace oomph
 
 
 #endif
+
+    /// Issue a new stamp for a traversal that must process each Data
+    /// object only once. Traversals that mark the Data they have
+    /// visited with this stamp (using mark_visited(...)) do not need
+    /// pointer-keyed maps or sets for their bookkeeping. Each Data
+    /// object only stores the most recent stamp it was marked with, so
+    /// traversals must not be nested (or run concurrently on different
+    /// threads): Call release_visit_stamp(...) at the end of each
+    /// traversal before a new stamp is issued (this is checked with
+    /// PARANOID). The stamps are unique until the (unsigned) counter
+    /// wraps around, after 2^32-1 traversals; a Data object that
+    /// hasn't been marked by any of these traversals may then appear to
+    /// have been visited by the new one.
+    static unsigned new_visit_stamp();
+
+    /// End the traversal that uses the given stamp (see
+    /// new_visit_stamp())
+    static void release_visit_stamp(const unsigned& stamp);
+
+    /// Has this Data object been visited by the traversal with the
+    /// given stamp?
+    bool is_visited(const unsigned& stamp) const
+    {
+      return (Visit_stamp == stamp);
+    }
+
+    /// Mark this Data object as visited by the traversal with the
+    /// given stamp. Returns true if this is the first visit, false if
+    /// the Data had already been visited.
+    bool mark_visited(const unsigned& stamp)
+    {
+#ifdef PARANOID
+      if (stamp != Active_visit_stamp)
+      {
+        throw OomphLibError("Data marked with a visit stamp that doesn't "
+                            "belong to the active traversal",
+                            OOMPH_CURRENT_FUNCTION,
+                            OOMPH_EXCEPTION_LOCATION);
+      }
+#endif
+      if (Visit_stamp == stamp)
+      {
+        return false;
+      }
+      Visit_stamp = stamp;
+      return true;
+    }
   };
 
   //=========================================================================
@@ -931,6 +1077,10 @@ namespace oomph
     /// Pointer to the timestepper associated with the position data.
     TimeStepper* Position_time_stepper_pt;
 
+    /// Pointer to the position timestepper's map from logical time
+    /// levels to the storage slots of the history values.
+    const TimeHistoryIndex* Position_history_index_pt;
+
     /// C-style array of pointers to hanging node info.
     /// It's set to NULL if the node isn't hanging.
     /// The first entry (0) is the geometric hanging node data.
@@ -1018,7 +1168,9 @@ namespace oomph
       return Nposition_type;
     }
 
-    /// Return a pointer to the position timestepper.
+    /// Return a pointer to the position timestepper. Use
+    /// set_position_time_stepper(...) to change the timestepper -- this
+    /// also updates the storage and the indexing of the history values.
     TimeStepper*& position_time_stepper_pt()
     {
       return Position_time_stepper_pt;
@@ -1081,7 +1233,7 @@ namespace oomph
 #ifdef RANGE_CHECKING
       x_gen_range_check(t, 0, i);
 #endif
-      return X_position[Nposition_type * i][t];
+      return X_position[Nposition_type * i][Position_history_index_pt->slot(t)];
     }
 
     /// Return the position x(i) at previous timestep t
@@ -1091,7 +1243,7 @@ namespace oomph
 #ifdef RANGE_CHECKING
       x_gen_range_check(t, 0, i);
 #endif
-      return X_position[Nposition_type * i][t];
+      return X_position[Nposition_type * i][Position_history_index_pt->slot(t)];
     }
 
     ///  Return the i-th component of nodal velocity: dx/dt
@@ -1148,7 +1300,8 @@ namespace oomph
 #ifdef RANGE_CHECKING
       x_gen_range_check(t, k, i);
 #endif
-      return X_position[Nposition_type * i + k][t];
+      return X_position[Nposition_type * i + k]
+                       [Position_history_index_pt->slot(t)];
     }
 
     /// Reference to the generalised position x(k,i) at the previous
@@ -1161,7 +1314,8 @@ namespace oomph
 #ifdef RANGE_CHECKING
       x_gen_range_check(t, k, i);
 #endif
-      return X_position[Nposition_type * i + k][t];
+      return X_position[Nposition_type * i + k]
+                       [Position_history_index_pt->slot(t)];
     }
 
     ///  i-th component of time derivative (velocity) of the
@@ -1180,7 +1334,8 @@ namespace oomph
     /// (t=0: present; t>0: previous)
     double* x_pt(const unsigned& t, const unsigned& i)
     {
-      return &X_position[Nposition_type * i][t];
+      return &X_position[Nposition_type * i]
+                        [Position_history_index_pt->slot(t)];
     }
 
     /// Copy all nodal data from specified Node object
@@ -2366,7 +2521,8 @@ namespace oomph
         // Initialise all the values to be those of the original data
         for (unsigned t = 0; t < n_tstorage; ++t)
         {
-          this->Value[i][t] = Copied_node_pt->value(t, i);
+          this->Value[i][this->History_index_pt->slot(t)] =
+            Copied_node_pt->value(t, i);
         }
 
         // Copy over the values of the equation numbers
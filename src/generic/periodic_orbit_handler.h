@@ -852,20 +852,26 @@ namespace oomph
       oomph_info << "Re-allocated " << problem_pt->assign_eqn_numbers()
                  << " equation numbers\n";
 
-      // Now's let's add all the unknowns to the problem
-      problem_pt->Dof_pt.resize(Ndof * N_tstorage + 1);
-      // This is reasonably straight forward using pointer arithmetic
-      // but this does rely on knowing how the data is stored in the
-      // Nodes which is a little nasty
+      // Find the addresses of the history values of the dofs (through
+      // the history index of the Data that stores them)
+      Vector<double*> history_dof_pt(Ndof * N_tstorage);
       for (unsigned i = 0; i < N_tstorage; i++)
       {
         unsigned offset = Ndof * i;
         for (unsigned n = 0; n < Ndof; n++)
         {
-          problem_pt->Dof_pt[offset + n] = problem_pt->Dof_pt[n] + i;
+          history_dof_pt[offset + n] = problem_pt->dof_pt(i, n);
         }
       }
 
+      // Now's let's add all the unknowns to the problem
+      problem_pt->Dof_pt.resize(Ndof * N_tstorage + 1);
+      for (unsigned i = 0; i < Ndof * N_tstorage; i++)
+      {
+        problem_pt->Dof_pt[i] = history_dof_pt[i];
+      }
+      problem_pt->Dof_history_index_is_up_to_date = false;
+
       // Add the frequency of the orbit to the unknowns
       problem_pt->Dof_pt[Ndof * N_tstorage] = &Omega;
 
@@ -1331,20 +1337,26 @@ namespace oomph
       oomph_info << "Re-allocated " << Problem_pt->assign_eqn_numbers()
                  << " equation numbers\n";
 
-      // Now's let's add all the unknowns to the problem
-      Problem_pt->Dof_pt.resize(Ndof * N_tstorage + 1);
-      // This is reasonably straight forward using pointer arithmetic
-      // but this does rely on knowing how the data is stored in the
-      // Nodes which is a little nasty
+      // Find the addresses of the history values of the dofs (through
+      // the history index of the Data that stores them)
+      Vector<double*> history_dof_pt(Ndof * N_tstorage);
       for (unsigned i = 0; i < N_tstorage; i++)
       {
         unsigned offset = Ndof * i;
         for (unsigned n = 0; n < Ndof; n++)
         {
-          Problem_pt->Dof_pt[offset + n] = Problem_pt->Dof_pt[n] + i;
+          history_dof_pt[offset + n] = Problem_pt->dof_pt(i, n);
         }
       }
 
+      // Now's let's add all the unknowns to the problem
+      Problem_pt->Dof_pt.resize(Ndof * N_tstorage + 1);
+      for (unsigned i = 0; i < Ndof * N_tstorage; i++)
+      {
+        Problem_pt->Dof_pt[i] = history_dof_pt[i];
+      }
+      Problem_pt->Dof_history_index_is_up_to_date = false;
+
       // Add the frequency of the orbit to the unknowns
       Problem_pt->Dof_pt[Ndof * N_tstorage] = &Omega;
 
@@ -31,6 +31,13 @@
 #include <list>
 #include <algorithm>
 #include <string>
+#include <exception>
+#include <limits>
+#include <memory>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "oomph_utilities.h"
 #include "problem.h"
@@ -40,11 +47,13 @@
 #include "refineable_mesh.h"
 #include "triangle_mesh.h"
 #include "linear_solver.h"
+#include "iterative_linear_solver.h"
 #include "eigen_solver.h"
 #include "assembly_handler.h"
 #include "dg_elements.h"
 #include "partitioning.h"
 #include "spines.h"
+#include "element_with_external_element.h"
 
 // Include to fill in additional_setup_shared_node_scheme() function
 #include "refineable_mesh.template.cc"
@@ -77,6 +86,7 @@ namespace oomph
       Empty_actions_after_read_unstructured_meshes_has_been_called(false),
       Store_local_dof_pt_in_elements(false),
       Calculate_hessian_products_analytic(false),
+      Use_threaded_hessian_products(false),
 #ifdef OOMPH_HAS_MPI
       Doc_imbalance_in_parallel_assembly(false),
       Use_default_partition_in_load_balance(false),
@@ -91,10 +101,14 @@ namespace oomph
       Time_adaptive_newton_crash_on_solve_fail(false),
       Jacobian_reuse_is_enabled(false),
       Jacobian_has_been_computed(false),
+      Jacobian_factorisation_is_current(false),
       Problem_is_nonlinear(true),
       Pause_at_end_of_sparse_assembly(false),
       Doc_time_in_distribute(false),
       Sparse_assembly_method(Perform_assembly_using_vectors_of_pairs),
+      Use_coloured_assembly(false),
+      Coloured_assembly_is_up_to_date(false),
+      Dof_history_index_is_up_to_date(false),
       Sparse_assemble_with_arrays_initial_allocation(400),
       Sparse_assemble_with_arrays_allocation_increment(150),
       Numerical_zero_for_sparse_assembly(0.0),
@@ -126,6 +140,12 @@ namespace oomph
       First_jacobian_sign_change(false),
       Arc_length_step_taken(false),
       Use_finite_differences_for_continuation_derivatives(false),
+      Use_curvature_based_arc_length_control(false),
+      Desired_continuation_angle(0.1),
+      Continuation_curvature(-1.0),
+      Reuse_factorisation_for_continuation_tangent(false),
+      Continuation_factorisation_is_available(false),
+      Resolve_enabled_before_continuation_factorisation(false),
 #ifdef OOMPH_HAS_MPI
       Dist_problem_matrix_distribution(Uniform_matrix_distribution),
       Parallel_sparse_assemble_previous_allocation(0),
@@ -139,6 +159,22 @@ namespace oomph
       Keep_temporal_error_below_tolerance(true)
   {
     Use_predictor_values_as_initial_guess = false;
+    Use_extrapolated_initial_guess = false;
+    Extrapolation_degree = 2;
+    Nprev_value_for_extrapolation = 3;
+    Use_dof_based_temporal_error_norm = false;
+    Temporal_error_absolute_tolerance = 1.0;
+    Temporal_error_relative_tolerance = 0.0;
+    Temporal_error_position_weight = 1.0;
+    Temporal_error_non_nodal_value_weight = 1.0;
+    Dof_based_temporal_error_table_is_up_to_date = false;
+    Use_pipelined_preconditioner_setup = false;
+    Pipelined_preconditioner_pt[0] = 0;
+    Pipelined_preconditioner_pt[1] = 0;
+    Pipelined_preconditioner_matrix_pt[0] = 0;
+    Pipelined_preconditioner_matrix_pt[1] = 0;
+    Active_pipelined_preconditioner = 0;
+    Pipelined_preconditioner_is_set_up = false;
 
     /// Setup terminate helper
     TerminateHelper::setup();
@@ -201,6 +237,9 @@ namespace oomph
     delete Communicator_pt;
     delete Dof_distribution_pt;
 
+    // Delete any Jacobians kept for the pipelined preconditioner setup
+    clean_up_pipelined_preconditioner_setup();
+
     // Delete any copies of the problem that have been created for
     // use in adaptive bifurcation tracking.
     // ALH: This will eventually go
@@ -223,6 +262,347 @@ namespace oomph
     TerminateHelper::clean_up_memory();
   }
 
+  //=================================================================
+  /// Stop using the pipelined preconditioner setup: Make the linear
+  /// solver use its original preconditioner again (it will be set up
+  /// before the next solve) and delete the Jacobians that were kept.
+  //=================================================================
+  void Problem::disable_pipelined_preconditioner_setup()
+  {
+    if (Use_pipelined_preconditioner_setup &&
+        (Pipelined_preconditioner_pt[0] != 0))
+    {
+      IterativeLinearSolver* solver_pt =
+        dynamic_cast<IterativeLinearSolver*>(Linear_solver_pt);
+      if (solver_pt != 0)
+      {
+        solver_pt->preconditioner_pt() = Pipelined_preconditioner_pt[0];
+      }
+    }
+    clean_up_pipelined_preconditioner_setup();
+    Use_pipelined_preconditioner_setup = false;
+  }
+
+
+  //=================================================================
+  /// Delete the Jacobians kept for the pipelined preconditioner setup
+  //=================================================================
+  void Problem::clean_up_pipelined_preconditioner_setup()
+  {
+    for (unsigned i = 0; i < 2; i++)
+    {
+      delete Pipelined_preconditioner_matrix_pt[i];
+      Pipelined_preconditioner_matrix_pt[i] = 0;
+    }
+    Active_pipelined_preconditioner = 0;
+    Pipelined_preconditioner_is_set_up = false;
+  }
+
+
+#ifdef _OPENMP
+
+  //=================================================================
+  /// Output modifier that is used by oomph_info while the Krylov solve
+  /// and the setup of the standby preconditioner run concurrently in
+  /// Problem::pipelined_linear_solve(): Output from the OpenMP thread
+  /// that sets up the preconditioner is suppressed; for all other
+  /// threads the decision is left to the original modifier.
+  //=================================================================
+  class PipelinedSetupOutputModifier : public OutputModifier
+  {
+  public:
+    /// Constructor: Pass the original output modifier and the number
+    /// of the thread whose output is to be suppressed
+    PipelinedSetupOutputModifier(OutputModifier* const& original_modifier_pt,
+                                 const int& silenced_thread)
+      : Original_modifier_pt(original_modifier_pt),
+        Silenced_thread(silenced_thread)
+    {
+    }
+
+    /// Suppress the output from the silenced thread
+    bool operator()(std::ostream& stream)
+    {
+      if (omp_get_thread_num() == Silenced_thread)
+      {
+        return false;
+      }
+      return (*Original_modifier_pt)(stream);
+    }
+
+  private:
+    /// The original output modifier
+    OutputModifier* Original_modifier_pt;
+
+    /// Number of the thread whose output is suppressed
+    int Silenced_thread;
+  };
+
+
+  //=================================================================
+  /// Stream buffer that is used by oomph_info while the Krylov solve
+  /// and the setup of the standby preconditioner run concurrently in
+  /// Problem::pipelined_linear_solve(): Characters from the thread
+  /// that sets up the preconditioner (stream manipulators such as
+  /// std::endl bypass the output modifier) are discarded; all others
+  /// are passed on to the original stream buffer.
+  //=================================================================
+  class PipelinedSetupStreamBuffer : public std::streambuf
+  {
+  public:
+    /// Constructor: Pass the original stream buffer and the number of
+    /// the thread whose output is to be discarded
+    PipelinedSetupStreamBuffer(std::streambuf* const& original_buffer_pt,
+                               const int& silenced_thread)
+      : Original_buffer_pt(original_buffer_pt),
+        Silenced_thread(silenced_thread)
+    {
+    }
+
+  protected:
+    /// Pass on (or discard) a single character
+    int overflow(int c)
+    {
+      if ((c == traits_type::eof()) ||
+          (omp_get_thread_num() == Silenced_thread))
+      {
+        return traits_type::not_eof(c);
+      }
+      return Original_buffer_pt->sputc(traits_type::to_char_type(c));
+    }
+
+    /// Pass on (or discard) a sequence of characters
+    std::streamsize xsputn(const char* s, std::streamsize n)
+    {
+      if (omp_get_thread_num() == Silenced_thread)
+      {
+        return n;
+      }
+      return Original_buffer_pt->sputn(s, n);
+    }
+
+    /// Flush the original stream buffer
+    int sync()
+    {
+      if (omp_get_thread_num() == Silenced_thread)
+      {
+        return 0;
+      }
+      return Original_buffer_pt->pubsync();
+    }
+
+  private:
+    /// The original stream buffer
+    std::streambuf* Original_buffer_pt;
+
+    /// Number of the thread whose output is discarded
+    int Silenced_thread;
+  };
+
+#endif
+
+
+  //=================================================================
+  /// Solve the linear system in a Newton iteration with the pipelined
+  /// preconditioner setup: The Krylov solve uses the preconditioner that
+  /// was set up from the previous Jacobian while the other preconditioner
+  /// is set up from the present one on a second OpenMP thread; the two
+  /// then swap roles. If the two can't run concurrently (no OpenMP, a
+  /// single thread, or a distributed problem, where both would
+  /// communicate at once), the lagged preconditioner would only slow
+  /// down the convergence of the Krylov solver, so an ordinary linear
+  /// solve is performed instead.
+  //=================================================================
+  void Problem::pipelined_linear_solve(DoubleVector& dx)
+  {
+    IterativeLinearSolver* solver_pt =
+      dynamic_cast<IterativeLinearSolver*>(Linear_solver_pt);
+    if (solver_pt == 0)
+    {
+      std::ostringstream error_stream;
+      error_stream << "The pipelined preconditioner setup requires an\n"
+                   << "iterative linear solver.\n";
+      throw OomphLibError(
+        error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+
+    // Can the preconditioner setup and the solve run concurrently?
+#ifdef _OPENMP
+    bool can_run_concurrently = (omp_get_max_threads() > 1);
+#ifdef OOMPH_HAS_MPI
+    if (this->communicator_pt()->nproc() > 1)
+    {
+      can_run_concurrently = false;
+    }
+#endif
+#else
+    const bool can_run_concurrently = false;
+#endif
+
+    // If not, do an ordinary linear solve with the solver's own
+    // preconditioner
+    if (!can_run_concurrently)
+    {
+      if (Pipelined_preconditioner_pt[0] != 0)
+      {
+        solver_pt->preconditioner_pt() = Pipelined_preconditioner_pt[0];
+      }
+      clean_up_pipelined_preconditioner_setup();
+      Linear_solver_pt->solve(this, dx);
+      return;
+    }
+
+    // On first use, the linear solver's own preconditioner becomes the
+    // first of the pair
+    if (Pipelined_preconditioner_pt[0] == 0)
+    {
+      Pipelined_preconditioner_pt[0] = solver_pt->preconditioner_pt();
+      Active_pipelined_preconditioner = 0;
+    }
+
+    // Assemble the Jacobian and the residuals (the Jacobian is owned by
+    // jacobian_storage until it is handed over to one of the
+    // preconditioners)
+    std::unique_ptr<CRDoubleMatrix> jacobian_storage(new CRDoubleMatrix);
+    CRDoubleMatrix* const jacobian_pt = jacobian_storage.get();
+    DoubleVector residuals;
+    get_jacobian(residuals, *jacobian_pt);
+
+    const unsigned active = Active_pipelined_preconditioner;
+    const unsigned standby = 1 - active;
+    Preconditioner* const active_pt = Pipelined_preconditioner_pt[active];
+    Preconditioner* const standby_pt = Pipelined_preconditioner_pt[standby];
+
+    // If the active preconditioner hasn't been set up (e.g. in the first
+    // iteration), set it up from the present Jacobian; there's nothing
+    // to overlap with the solve in that case.
+    bool setup_standby = true;
+    if (!Pipelined_preconditioner_is_set_up)
+    {
+      active_pt->setup(jacobian_pt);
+      delete Pipelined_preconditioner_matrix_pt[active];
+      Pipelined_preconditioner_matrix_pt[active] = jacobian_storage.release();
+      Pipelined_preconditioner_is_set_up = true;
+      setup_standby = false;
+    }
+
+    // Solve with the active preconditioner, without setting it up again
+    const bool backup_setup_before_solve =
+      solver_pt->setup_preconditioner_before_solve();
+    solver_pt->preconditioner_pt() = active_pt;
+    solver_pt->disable_setup_preconditioner_before_solve();
+
+    // Storage for any exception thrown by one of the threads
+    std::exception_ptr exception_pt;
+
+#ifdef _OPENMP
+    // The Krylov solve runs on thread 0, the setup of the standby
+    // preconditioner on thread 1. Both write to oomph_info, which isn't
+    // thread-safe, so the output from the preconditioner setup is
+    // suppressed while they run concurrently; the output from the
+    // solve is passed on as usual.
+    const int setup_thread = 1;
+    std::ostream* const backup_stream_pt = oomph_info.stream_pt();
+    OutputModifier* const backup_modifier_pt =
+      oomph_info.output_modifier_pt();
+    PipelinedSetupStreamBuffer setup_buffer(backup_stream_pt->rdbuf(),
+                                            setup_thread);
+    std::ostream setup_stream(&setup_buffer);
+    setup_stream.copyfmt(*backup_stream_pt);
+    PipelinedSetupOutputModifier setup_modifier(backup_modifier_pt,
+                                                setup_thread);
+    if (setup_standby)
+    {
+      oomph_info.stream_pt() = &setup_stream;
+      oomph_info.output_modifier_pt() = &setup_modifier;
+    }
+
+#pragma omp parallel num_threads(2) if (setup_standby)
+#endif
+    {
+      // Which of the two tasks does this thread perform? (If only a
+      // single thread is available, it performs both, one after the
+      // other.)
+#ifdef _OPENMP
+      const int thread = omp_get_thread_num();
+      const int n_thread = omp_get_num_threads();
+#else
+      const int thread = 0;
+      const int n_thread = 1;
+#endif
+      if (thread == 0)
+      {
+        try
+        {
+          solver_pt->solve(jacobian_pt, residuals, dx);
+        }
+        catch (...)
+        {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+          {
+            if (!exception_pt)
+            {
+              exception_pt = std::current_exception();
+            }
+          }
+        }
+      }
+      if (setup_standby && (thread == std::min(1, n_thread - 1)))
+      {
+        try
+        {
+          standby_pt->setup(jacobian_pt);
+        }
+        catch (...)
+        {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+          {
+            if (!exception_pt)
+            {
+              exception_pt = std::current_exception();
+            }
+          }
+        }
+      }
+    }
+
+#ifdef _OPENMP
+    // Restore the output stream and modifier
+    oomph_info.stream_pt() = backup_stream_pt;
+    oomph_info.output_modifier_pt() = backup_modifier_pt;
+#endif
+
+    // Restore the linear solver's setting
+    if (backup_setup_before_solve)
+    {
+      solver_pt->enable_setup_preconditioner_before_solve();
+    }
+
+    // The standby preconditioner (set up from the present Jacobian)
+    // becomes the active one for the next iteration. The previous
+    // Jacobian is no longer needed.
+    if (setup_standby)
+    {
+      delete Pipelined_preconditioner_matrix_pt[standby];
+      Pipelined_preconditioner_matrix_pt[standby] = jacobian_storage.release();
+      Active_pipelined_preconditioner = standby;
+      solver_pt->preconditioner_pt() = standby_pt;
+    }
+
+    // Pass on the first exception (the preconditioners must be set up
+    // afresh)
+    if (exception_pt)
+    {
+      Pipelined_preconditioner_is_set_up = false;
+      std::rethrow_exception(exception_pt);
+    }
+  }
+
+
   //=================================================================
   /// Setup the count vector that records how many elements contribute
   /// to each degree of freedom. Returns the total number of elements
@@ -2108,6 +2488,39 @@ namespace oomph
     // Number of submeshes
     unsigned n_sub_mesh = Sub_mesh_pt.size();
 
+    // The elements or their Data may have changed, so the colouring
+    // for the coloured assembly must be recomputed
+    Coloured_assembly_is_up_to_date = false;
+
+    // ...and so must the history indices of the dofs
+    Dof_history_index_is_up_to_date = false;
+
+    // Any factorisation held by the linear solver refers to the old
+    // equation numbering
+    Jacobian_factorisation_is_current = false;
+
+    // Any factorisation retained from a continuation step refers to the
+    // old equation numbering
+    discard_continuation_factorisation();
+
+    // ...as does the lookup table for the dof-based temporal error norm
+    Dof_based_temporal_error_table_is_up_to_date = false;
+
+    // ...and the preconditioners in the pipelined setup
+    Pipelined_preconditioner_is_set_up = false;
+
+    // The meshes' elements may have been changed without going through
+    // the Mesh's member functions (e.g. during unstructured
+    // re-meshing), so their element type groups must be rebuilt;
+    // their local equation tables are outdated by the renumbering
+    Mesh_pt->flush_element_type_groups();
+    Mesh_pt->flush_local_eqn_table();
+    for (unsigned i = 0; i < n_sub_mesh; i++)
+    {
+      Sub_mesh_pt[i]->flush_element_type_groups();
+      Sub_mesh_pt[i]->flush_local_eqn_table();
+    }
+
 #ifdef OOMPH_HAS_MPI
 
     // Storage for number of processors
@@ -2686,8 +3099,9 @@ namespace oomph
     // map:
     std::map<unsigned, Node*> global_node_pt;
 
-    // Only do each retained node once
-    std::map<Node*, bool> node_done;
+    // Only do each retained node once: Retained nodes are marked with
+    // this visit stamp (cheaper than a map keyed by the node pointers)
+    const unsigned retained_stamp = Data::new_visit_stamp();
 
     // Loop over existing "normal" elements in mesh
     unsigned n_element = mesh_pt->nelement();
@@ -2704,10 +3118,8 @@ namespace oomph
           Node* nod_pt = el_pt->node_pt(j);
 
           // Have we already done the node?
-          if (!node_done[nod_pt])
+          if (nod_pt->mark_visited(retained_stamp))
           {
-            node_done[nod_pt] = true;
-
             // Loop over values stored at node (if any) to find
             // the first non-negative eqn number
             unsigned first_non_negative_eqn_number_plus_one = 0;
@@ -2768,10 +3180,8 @@ namespace oomph
                   for (unsigned m = 0; m < n_master; m++)
                   {
                     Node* master_nod_pt = hang_pt->master_node_pt(m);
-                    if (!node_done[master_nod_pt])
+                    if (master_nod_pt->mark_visited(retained_stamp))
                     {
-                      node_done[master_nod_pt] = true;
-
                       // Loop over values stored at node (if any) to find
                       // the first non-negative eqn number
                       unsigned first_non_negative_eqn_number_plus_one = 0;
@@ -2837,8 +3247,10 @@ namespace oomph
       // internal data on locally-stored elements can never be halo.
     }
 
-    // Set to record duplicate nodes scheduled to be killed
-    std::set<Node*> killed_nodes;
+    // Duplicate nodes scheduled to be killed (a node may be recorded
+    // more than once; the duplicates are removed before the nodes are
+    // killed, since the retained nodes' visit stamp is still in use)
+    Vector<Node*> killed_nodes;
 
     // Now loop over the other processors from highest to lowest
     // (i.e. if there is a duplicate between these containers
@@ -2919,7 +3331,7 @@ namespace oomph
                   // It's a duplicate, so store the duplicated one for
                   // later killing...
                   Node* duplicated_node_pt = nod_pt;
-                  if (!node_done[duplicated_node_pt])
+                  if (!duplicated_node_pt->is_visited(retained_stamp))
                   {
                     // Remove node from all boundaries
                     std::set<unsigned>* boundaries_pt;
@@ -2944,7 +3356,7 @@ namespace oomph
                     }
 
                     // Get ready to kill it
-                    killed_nodes.insert(duplicated_node_pt);
+                    killed_nodes.push_back(duplicated_node_pt);
                     unsigned i_proc = unsigned(iproc);
                     mesh_pt->null_external_halo_node(i_proc,
                                                      duplicated_node_pt);
@@ -3065,7 +3477,7 @@ namespace oomph
                 {
                   global_node_pt[first_non_negative_eqn_number_plus_one - 1] =
                     nod_pt;
-                  node_done[nod_pt] = true;
+                  nod_pt->mark_visited(retained_stamp);
                 }
               }
 
@@ -3146,7 +3558,8 @@ namespace oomph
                           // later killing...
                           Node* duplicated_node_pt = master_nod_pt;
 
-                          if (!node_done[duplicated_node_pt])
+                          if (!duplicated_node_pt->is_visited(
+                                retained_stamp))
                           {
                             // Remove node from all boundaries
                             std::set<unsigned>* boundaries_pt;
@@ -3164,7 +3577,7 @@ namespace oomph
                               }
                             }
 
-                            killed_nodes.insert(duplicated_node_pt);
+                            killed_nodes.push_back(duplicated_node_pt);
                             unsigned i_proc = unsigned(iproc);
                             mesh_pt->null_external_halo_node(
                               i_proc, duplicated_node_pt);
@@ -3217,7 +3630,7 @@ namespace oomph
                           global_node_pt
                             [first_non_negative_eqn_number_plus_one - 1] =
                               master_nod_pt;
-                          node_done[master_nod_pt] = true;
+                          master_nod_pt->mark_visited(retained_stamp);
                         }
                       }
                     } // End of loop over master nodes
@@ -3234,12 +3647,17 @@ namespace oomph
     } // end loop over processors
 
 
-    // Now kill all the deleted nodes
-    for (std::set<Node*>::iterator it = killed_nodes.begin();
-         it != killed_nodes.end();
-         it++)
+    // The traversal of the retained nodes is complete
+    Data::release_visit_stamp(retained_stamp);
+
+    // Now kill all the deleted nodes (each one once)
+    std::sort(killed_nodes.begin(), killed_nodes.end());
+    killed_nodes.erase(std::unique(killed_nodes.begin(), killed_nodes.end()),
+                       killed_nodes.end());
+    unsigned n_killed = killed_nodes.size();
+    for (unsigned j = 0; j < n_killed; j++)
     {
-      delete (*it);
+      delete killed_nodes[j];
     }
 
 
@@ -3855,23 +4273,107 @@ namespace oomph
     if (this->communicator_pt()->nproc() == 1)
     {
 #endif // OOMPH_HAS_MPI
-      // Loop over all the elements
-      unsigned long Element_pt_range = Mesh_pt->nelement();
-      for (unsigned long e = 0; e < Element_pt_range; e++)
+      // Coloured (threaded) assembly of the residuals; only with the
+      // (re-entrant) default assembly handler
+      if (Use_coloured_assembly &&
+          (assembly_handler_pt == Default_assembly_handler_pt))
       {
-        // Get the pointer to the element
-        GeneralisedElement* elem_pt = Mesh_pt->element_pt(e);
-        // Find number of dofs in the element
-        unsigned n_element_dofs = assembly_handler_pt->ndof(elem_pt);
-        // Set up an array
-        Vector<double> element_residuals(n_element_dofs);
-        // Fill the array
-        assembly_handler_pt->get_residuals(elem_pt, element_residuals);
-        // Now loop over the dofs and assign values to global Vector
-        for (unsigned l = 0; l < n_element_dofs; l++)
+        // (Re-)compute the colouring if required
+        if (!Coloured_assembly_is_up_to_date)
+        {
+          setup_coloured_assembly();
+        }
+
+        // Cache the pointer to the values
+        double* const residuals_pt = residuals.values_pt();
+
+        // Storage for any exception thrown by one of the threads
+        std::exception_ptr exception_pt;
+
+        // Loop over the colours: No two elements of the same colour share
+        // any Data, so they never add to the same row. Each row therefore
+        // receives its contributions in the order of the colours, whatever
+        // the number of threads.
+        const unsigned n_colour = ncolour_for_assembly();
+        for (unsigned c = 0; c < n_colour; c++)
+        {
+          const long first = Coloured_assembly_colour_start[c];
+          const long last = Coloured_assembly_colour_start[c + 1];
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+          {
+            // Each thread has its own storage for the elemental residuals
+            Vector<double> element_residuals;
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+            for (long i = first; i < last; i++)
+            {
+              // Get the pointer to the element
+              GeneralisedElement* elem_pt =
+                Mesh_pt->element_pt(Coloured_assembly_element_index[i]);
+
+              // Exceptions must not escape from the parallel region
+              try
+              {
+                // Find number of dofs in the element
+                unsigned n_element_dofs = assembly_handler_pt->ndof(elem_pt);
+                // Set up and fill the array
+                element_residuals.resize(n_element_dofs);
+                element_residuals.initialise(0.0);
+                assembly_handler_pt->get_residuals(elem_pt, element_residuals);
+                // Now loop over the dofs and assign values to global Vector
+                for (unsigned l = 0; l < n_element_dofs; l++)
+                {
+                  residuals_pt[assembly_handler_pt->eqn_number(elem_pt, l)] +=
+                    element_residuals[l];
+                }
+              }
+              catch (...)
+              {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+                {
+                  if (!exception_pt)
+                  {
+                    exception_pt = std::current_exception();
+                  }
+                }
+              }
+            }
+          }
+
+          // Pass on the first exception
+          if (exception_pt)
+          {
+            std::rethrow_exception(exception_pt);
+          }
+        }
+      }
+      else
+      {
+        // Loop over all the elements
+        unsigned long Element_pt_range = Mesh_pt->nelement();
+        for (unsigned long e = 0; e < Element_pt_range; e++)
         {
-          residuals[assembly_handler_pt->eqn_number(elem_pt, l)] +=
-            element_residuals[l];
+          // Get the pointer to the element
+          GeneralisedElement* elem_pt = Mesh_pt->element_pt(e);
+          // Find number of dofs in the element
+          unsigned n_element_dofs = assembly_handler_pt->ndof(elem_pt);
+          // Set up an array
+          Vector<double> element_residuals(n_element_dofs);
+          // Fill the array
+          assembly_handler_pt->get_residuals(elem_pt, element_residuals);
+          // Now loop over the dofs and assign values to global Vector
+          for (unsigned l = 0; l < n_element_dofs; l++)
+          {
+            residuals[assembly_handler_pt->eqn_number(elem_pt, l)] +=
+              element_residuals[l];
+          }
         }
       }
       // Otherwise parallel case
@@ -5435,9 +5937,105 @@ namespace oomph
       Elemental_assembly_time.resize(n_elements);
     }
 
+#endif
+
+    // Can we use the coloured (threaded) assembly? Only if this processor
+    // assembles all of its elements, if we're not timing the elements for
+    // load balancing, and if the (re-entrant) default assembly
+    // handler is used.
+    bool use_coloured_assembly =
+      Use_coloured_assembly && (el_lo == 0) && (el_hi + 1 == n_elements) &&
+      (assembly_handler_pt == Default_assembly_handler_pt);
+#ifdef OOMPH_HAS_MPI
+    if ((!doing_residuals) && Must_recompute_load_balance_for_assembly)
+    {
+      use_coloured_assembly = false;
+    }
 #endif
 
     //----------------Assemble and populate the vector storage scheme--------
+    if (use_coloured_assembly)
+    {
+      // (Re-)compute the colouring if required
+      if (!Coloured_assembly_is_up_to_date)
+      {
+        setup_coloured_assembly();
+      }
+
+      // Storage for any exception thrown by one of the threads
+      std::exception_ptr exception_pt;
+
+      // Loop over the colours: No two elements of the same colour
+      // share any Data, so they can be assembled concurrently;
+      // contributions to rows shared between colours are added
+      // colour by colour, so the result is independent of the number
+      // of threads.
+      const unsigned n_colour = ncolour_for_assembly();
+      for (unsigned c = 0; c < n_colour; c++)
+      {
+        const long first = Coloured_assembly_colour_start[c];
+        const long last = Coloured_assembly_colour_start[c + 1];
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+        {
+          // Each thread has its own storage for the elemental
+          // contributions
+          Vector<Vector<double>> el_residuals(n_vector);
+          Vector<DenseMatrix<double>> el_jacobian(n_matrix);
+
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 16)
+#endif
+          for (long i = first; i < last; i++)
+          {
+            // Get the pointer to the element
+            GeneralisedElement* elem_pt =
+              mesh_pt()->element_pt(Coloured_assembly_element_index[i]);
+
+#ifdef OOMPH_HAS_MPI
+            // Ignore halo elements
+            if (elem_pt->is_halo())
+            {
+              continue;
+            }
+#endif
+
+            // Exceptions must not escape from the parallel region
+            try
+            {
+              add_element_contribution_to_vectors_of_pairs(
+                elem_pt,
+                el_residuals,
+                el_jacobian,
+                matrix_data,
+                residuals,
+                compressed_row_flag);
+            }
+            catch (...)
+            {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
+              {
+                if (!exception_pt)
+                {
+                  exception_pt = std::current_exception();
+                }
+              }
+            }
+          }
+        }
+
+        // Pass on the first exception
+        if (exception_pt)
+        {
+          std::rethrow_exception(exception_pt);
+        }
+      }
+    }
+    else
     {
       // Allocate local storage for the element's contribution to the
       // residuals vectors and system matrices of the size of the maximum
@@ -5466,117 +6064,30 @@ namespace oomph
         {
 #endif
 
-          // Find number of degrees of freedom in the element
-          const unsigned nvar = assembly_handler_pt->ndof(elem_pt);
+          // Get the element's contribution and add it to the vectors of
+          // pairs
+          add_element_contribution_to_vectors_of_pairs(elem_pt,
+                                                       el_residuals,
+                                                       el_jacobian,
+                                                       matrix_data,
+                                                       residuals,
+                                                       compressed_row_flag);
 
-          // Resize the storage for elemental jacobian and residuals
-          for (unsigned v = 0; v < n_vector; v++)
-          {
-            el_residuals[v].resize(nvar);
-          }
-          for (unsigned m = 0; m < n_matrix; m++)
-          {
-            el_jacobian[m].resize(nvar);
-          }
+#ifdef OOMPH_HAS_MPI
+        } // endif halo element
+#endif
 
-          // Now get the residuals and jacobian for the element
-          assembly_handler_pt->get_all_vectors_and_matrices(
-            elem_pt, el_residuals, el_jacobian);
 
-          //---------------Insert the values into the vectors--------------
+#ifdef OOMPH_HAS_MPI
+        // Time it?
+        if ((!doing_residuals) && Must_recompute_load_balance_for_assembly)
+        {
+          Elemental_assembly_time[e] =
+            TimingHelpers::timer() - t_assemble_start;
+        }
+#endif
 
-          // Loop over the first index of local variables
-          for (unsigned i = 0; i < nvar; i++)
-          {
-            // Get the local equation number
-            unsigned eqn_number = assembly_handler_pt->eqn_number(elem_pt, i);
-
-            // Add the contribution to the residuals
-            for (unsigned v = 0; v < n_vector; v++)
-            {
-              // Fill in each residuals vector
-              residuals[v][eqn_number] += el_residuals[v][i];
-            }
-
-            // Now loop over the other index
-            for (unsigned j = 0; j < nvar; j++)
-            {
-              // Get the number of the unknown
-              unsigned unknown = assembly_handler_pt->eqn_number(elem_pt, j);
-
-              // Loop over the matrices
-              // If it's compressed row storage, then our vector of maps
-              // is indexed by row (equation number)
-              for (unsigned m = 0; m < n_matrix; m++)
-              {
-                // Get the value of the matrix at this point
-                double value = el_jacobian[m](i, j);
-                // Only bother to add to the vector if it's non-zero
-                if (std::fabs(value) > Numerical_zero_for_sparse_assembly)
-                {
-                  // If it's compressed row storage, then our vector of maps
-                  // is indexed by row (equation number)
-                  if (compressed_row_flag)
-                  {
-                    // Find the correct position and add the data into the
-                    // vectors
-                    const unsigned size = matrix_data[m][eqn_number].size();
-                    for (unsigned k = 0; k <= size; k++)
-                    {
-                      if (k == size)
-                      {
-                        matrix_data[m][eqn_number].push_back(
-                          std::make_pair(unknown, value));
-                        break;
-                      }
-                      else if (matrix_data[m][eqn_number][k].first == unknown)
-                      {
-                        matrix_data[m][eqn_number][k].second += value;
-                        break;
-                      }
-                    }
-                  }
-                  // Otherwise it's compressed column storage and our vector is
-                  // indexed by column (the unknown)
-                  else
-                  {
-                    // Add the data into the vectors in the correct position
-                    const unsigned size = matrix_data[m][unknown].size();
-                    for (unsigned k = 0; k <= size; k++)
-                    {
-                      if (k == size)
-                      {
-                        matrix_data[m][unknown].push_back(
-                          std::make_pair(eqn_number, value));
-                        break;
-                      }
-                      else if (matrix_data[m][unknown][k].first == eqn_number)
-                      {
-                        matrix_data[m][unknown][k].second += value;
-                        break;
-                      }
-                    }
-                  }
-                }
-              } // End of loop over matrices
-            }
-          }
-
-#ifdef OOMPH_HAS_MPI
-        } // endif halo element
-#endif
-
-
-#ifdef OOMPH_HAS_MPI
-        // Time it?
-        if ((!doing_residuals) && Must_recompute_load_balance_for_assembly)
-        {
-          Elemental_assembly_time[e] =
-            TimingHelpers::timer() - t_assemble_start;
-        }
-#endif
-
-      } // End of loop over the elements
+      } // End of loop over the elements
 
 
     } // End of vector assembly
@@ -5657,6 +6168,352 @@ namespace oomph
   }
 
 
+  //=====================================================================
+  /// Private helper function for the assembly with vectors of pairs:
+  /// Get the contributions of element elem_pt to the residuals vectors
+  /// and matrices (using the storage el_residuals and el_jacobian)
+  /// and add them to the residuals and the vectors of pairs in
+  /// matrix_data.
+  //=====================================================================
+  void Problem::add_element_contribution_to_vectors_of_pairs(
+    GeneralisedElement* const& elem_pt,
+    Vector<Vector<double>>& el_residuals,
+    Vector<DenseMatrix<double>>& el_jacobian,
+    Vector<Vector<Vector<std::pair<unsigned, double>>>>& matrix_data,
+    Vector<double*>& residuals,
+    const bool& compressed_row_flag)
+  {
+    // Find the number of vectors to be assembled
+    const unsigned n_vector = residuals.size();
+
+    // Find the number of matrices to be assembled
+    const unsigned n_matrix = matrix_data.size();
+
+    // Locally cache pointer to assembly handler
+    AssemblyHandler* const assembly_handler_pt = Assembly_handler_pt;
+
+    // Find number of degrees of freedom in the element
+    const unsigned nvar = assembly_handler_pt->ndof(elem_pt);
+
+    // Resize the storage for elemental jacobian and residuals
+    for (unsigned v = 0; v < n_vector; v++)
+    {
+      el_residuals[v].resize(nvar);
+    }
+    for (unsigned m = 0; m < n_matrix; m++)
+    {
+      el_jacobian[m].resize(nvar);
+    }
+
+    // Now get the residuals and jacobian for the element
+    assembly_handler_pt->get_all_vectors_and_matrices(
+      elem_pt, el_residuals, el_jacobian);
+
+    //---------------Insert the values into the vectors--------------
+
+    // Loop over the first index of local variables
+    for (unsigned i = 0; i < nvar; i++)
+    {
+      // Get the local equation number
+      unsigned eqn_number = assembly_handler_pt->eqn_number(elem_pt, i);
+
+      // Add the contribution to the residuals
+      for (unsigned v = 0; v < n_vector; v++)
+      {
+        // Fill in each residuals vector
+        residuals[v][eqn_number] += el_residuals[v][i];
+      }
+
+      // Now loop over the other index
+      for (unsigned j = 0; j < nvar; j++)
+      {
+        // Get the number of the unknown
+        unsigned unknown = assembly_handler_pt->eqn_number(elem_pt, j);
+
+        // Loop over the matrices
+        // If it's compressed row storage, then our vector of maps
+        // is indexed by row (equation number)
+        for (unsigned m = 0; m < n_matrix; m++)
+        {
+          // Get the value of the matrix at this point
+          double value = el_jacobian[m](i, j);
+          // Only bother to add to the vector if it's non-zero
+          if (std::fabs(value) > Numerical_zero_for_sparse_assembly)
+          {
+            // If it's compressed row storage, then our vector of maps
+            // is indexed by row (equation number)
+            if (compressed_row_flag)
+            {
+              // Find the correct position and add the data into the
+              // vectors
+              const unsigned size = matrix_data[m][eqn_number].size();
+              for (unsigned k = 0; k <= size; k++)
+              {
+                if (k == size)
+                {
+                  matrix_data[m][eqn_number].push_back(
+                    std::make_pair(unknown, value));
+                  break;
+                }
+                else if (matrix_data[m][eqn_number][k].first == unknown)
+                {
+                  matrix_data[m][eqn_number][k].second += value;
+                  break;
+                }
+              }
+            }
+            // Otherwise it's compressed column storage and our vector is
+            // indexed by column (the unknown)
+            else
+            {
+              // Add the data into the vectors in the correct position
+              const unsigned size = matrix_data[m][unknown].size();
+              for (unsigned k = 0; k <= size; k++)
+              {
+                if (k == size)
+                {
+                  matrix_data[m][unknown].push_back(
+                    std::make_pair(eqn_number, value));
+                  break;
+                }
+                else if (matrix_data[m][unknown][k].first == eqn_number)
+                {
+                  matrix_data[m][unknown][k].second += value;
+                  break;
+                }
+              }
+            }
+          }
+        } // End of loop over matrices
+      }
+    }
+  }
+
+
+  //=====================================================================
+  /// Private helper function for the coloured assembly: Add all Data
+  /// that are read or (temporarily) changed when the element's
+  /// residuals and Jacobian are computed to the vector data_pt (Data
+  /// that are involved in several ways are added more than once). These
+  /// are the element's internal and external Data, its nodes (and the
+  /// master nodes of any hanging nodes), the Data that determine its
+  /// geometry and, for elements with external elements, the field and
+  /// geometric Data of the external elements.
+  //=====================================================================
+  void Problem::identify_data_for_coloured_assembly(
+    GeneralisedElement* const& elem_pt, Vector<Data*>& data_pt) const
+  {
+    // Internal data
+    const unsigned n_internal = elem_pt->ninternal_data();
+    for (unsigned i = 0; i < n_internal; i++)
+    {
+      data_pt.push_back(elem_pt->internal_data_pt(i));
+    }
+
+    // External data
+    const unsigned n_external = elem_pt->nexternal_data();
+    for (unsigned i = 0; i < n_external; i++)
+    {
+      data_pt.push_back(elem_pt->external_data_pt(i));
+    }
+
+    // Nodes and geometric data of finite elements
+    FiniteElement* const fe_pt = dynamic_cast<FiniteElement*>(elem_pt);
+    if (fe_pt != 0)
+    {
+      const unsigned n_node = fe_pt->nnode();
+      for (unsigned n = 0; n < n_node; n++)
+      {
+        Node* const nod_pt = fe_pt->node_pt(n);
+        data_pt.push_back(nod_pt);
+
+        // Add the master nodes of hanging nodes (the position and
+        // the values may hang on different masters)
+        const int n_value = nod_pt->nvalue();
+        for (int i = -1; i < n_value; i++)
+        {
+          if (nod_pt->is_hanging(i))
+          {
+            HangInfo* const hang_pt = nod_pt->hanging_pt(i);
+            const unsigned n_master = hang_pt->nmaster();
+            for (unsigned m = 0; m < n_master; m++)
+            {
+              Node* const master_pt = hang_pt->master_node_pt(m);
+              data_pt.push_back(master_pt);
+              SolidNode* const solid_master_pt =
+                dynamic_cast<SolidNode*>(master_pt);
+              if (solid_master_pt != 0)
+              {
+                data_pt.push_back(solid_master_pt->variable_position_pt());
+              }
+            }
+          }
+        }
+      }
+
+      // Data that affect the element's geometry (positional Data of
+      // SolidNodes, geometric Data of elements with moving nodes).
+      // (The elements' interface for this takes a set; it's empty for
+      // most elements.)
+      std::set<Data*> geometric_data_pt;
+      fe_pt->identify_geometric_data(geometric_data_pt);
+      data_pt.insert(
+        data_pt.end(), geometric_data_pt.begin(), geometric_data_pt.end());
+    }
+
+    // Data that affect the interaction with external elements
+    ElementWithExternalElement* const ext_el_pt =
+      dynamic_cast<ElementWithExternalElement*>(elem_pt);
+    if (ext_el_pt != 0)
+    {
+      Vector<Data*> field_data_pt =
+        ext_el_pt->external_interaction_field_data_pt();
+      data_pt.insert(data_pt.end(), field_data_pt.begin(), field_data_pt.end());
+      Vector<Data*> geometric_data_pt =
+        ext_el_pt->external_interaction_geometric_data_pt();
+      data_pt.insert(
+        data_pt.end(), geometric_data_pt.begin(), geometric_data_pt.end());
+    }
+  }
+
+
+  //=====================================================================
+  /// Setup the colouring of the elements in the global mesh for the
+  /// coloured (threaded) assembly: A greedy algorithm assigns each
+  /// element the lowest colour not yet taken by any other element
+  /// that shares any of its Data (as identified by
+  /// identify_data_for_coloured_assembly(...)). The elements of one colour
+  /// can therefore be assembled concurrently. The elements that share
+  /// a given Data object are found by sorting the (Data, element) pairs,
+  /// so no map keyed by the Data is required.
+  //=====================================================================
+  void Problem::setup_coloured_assembly()
+  {
+    // Total number of elements
+    const unsigned long n_element = mesh_pt()->nelement();
+
+    // Pairs of the Data involved in an element's assembly and the
+    // element's number, for all elements
+    Vector<std::pair<Data*, unsigned long>> data_and_element;
+    Vector<Data*> data_pt;
+    for (unsigned long e = 0; e < n_element; e++)
+    {
+      data_pt.clear();
+      identify_data_for_coloured_assembly(mesh_pt()->element_pt(e), data_pt);
+      const unsigned n_data = data_pt.size();
+      for (unsigned i = 0; i < n_data; i++)
+      {
+        data_and_element.push_back(std::make_pair(data_pt[i], e));
+      }
+    }
+
+    // Sort them so that the elements that share a Data object are
+    // stored consecutively (in increasing order). Repeated pairs are
+    // harmless.
+    std::sort(data_and_element.begin(), data_and_element.end());
+
+    // The pairs involving the same Data form a group; record the start
+    // of each group and the number of groups each element is in
+    const unsigned long n_pair = data_and_element.size();
+    Vector<unsigned long> group_start;
+    Vector<unsigned long> element_group_start(n_element + 1, 0);
+    for (unsigned long k = 0; k < n_pair; k++)
+    {
+      if ((k == 0) ||
+          (data_and_element[k].first != data_and_element[k - 1].first))
+      {
+        group_start.push_back(k);
+      }
+      element_group_start[data_and_element[k].second + 1]++;
+    }
+    group_start.push_back(n_pair);
+    for (unsigned long e = 0; e < n_element; e++)
+    {
+      element_group_start[e + 1] += element_group_start[e];
+    }
+
+    // The groups each element is in
+    Vector<unsigned long> element_group(n_pair);
+    Vector<unsigned long> count(element_group_start);
+    const unsigned long n_group = group_start.size() - 1;
+    for (unsigned long g = 0; g < n_group; g++)
+    {
+      for (unsigned long k = group_start[g]; k < group_start[g + 1]; k++)
+      {
+        element_group[count[data_and_element[k].second]++] = g;
+      }
+    }
+
+    // The colour of each element
+    Vector<unsigned> element_colour(n_element, 0);
+
+    // Each colour that is not available for the current element e is
+    // marked by an entry e+1
+    Vector<unsigned long> colour_taken;
+
+    // Number of colours required
+    unsigned n_colour = 0;
+
+    // Loop over the elements
+    for (unsigned long e = 0; e < n_element; e++)
+    {
+      // Mark the colours of all (already coloured) elements that share
+      // Data with this one
+      for (unsigned long j = element_group_start[e];
+           j < element_group_start[e + 1];
+           j++)
+      {
+        const unsigned long g = element_group[j];
+        for (unsigned long k = group_start[g]; k < group_start[g + 1]; k++)
+        {
+          const unsigned long other_e = data_and_element[k].second;
+          if (other_e >= e)
+          {
+            break;
+          }
+          colour_taken[element_colour[other_e]] = e + 1;
+        }
+      }
+
+      // Find the lowest available colour
+      unsigned colour = 0;
+      while ((colour < n_colour) && (colour_taken[colour] == e + 1))
+      {
+        colour++;
+      }
+      if (colour == n_colour)
+      {
+        n_colour++;
+        colour_taken.push_back(0);
+      }
+      element_colour[e] = colour;
+    }
+
+    // Count the number of elements of each colour...
+    Coloured_assembly_colour_start.assign(n_colour + 1, 0);
+    for (unsigned long e = 0; e < n_element; e++)
+    {
+      Coloured_assembly_colour_start[element_colour[e] + 1]++;
+    }
+    for (unsigned c = 0; c < n_colour; c++)
+    {
+      Coloured_assembly_colour_start[c + 1] +=
+        Coloured_assembly_colour_start[c];
+    }
+
+    // ...and sort the elements by colour (retaining the order of the
+    // elements within each colour)
+    Coloured_assembly_element_index.resize(n_element);
+    count = Coloured_assembly_colour_start;
+    for (unsigned long e = 0; e < n_element; e++)
+    {
+      Coloured_assembly_element_index[count[element_colour[e]]++] = e;
+    }
+
+    Coloured_assembly_is_up_to_date = true;
+  }
+
+
   //=====================================================================
   /// This is a (private) helper function that is used to assemble system
   /// matrices in compressed row or column format
@@ -7951,45 +8808,262 @@ namespace oomph
 
 
   //======================================================================
-  /// Return the product of the global hessian (derivative of Jacobian
-  /// matrix  with respect to all variables) with
-  /// an eigenvector, Y, and any number of other specified vectors C
-  /// (d(J_{ij})/d u_{k}) Y_{j} C_{k}.
-  /// This function is used in assembling and solving the augmented systems
-  /// associated with bifurcation tracking.
-  /// The default implementation is to use finite differences at the global
-  /// level.
-  //========================================================================
-  void Problem::get_hessian_vector_products(
-    DoubleVectorWithHaloEntries const& Y,
-    Vector<DoubleVectorWithHaloEntries> const& C,
-    Vector<DoubleVectorWithHaloEntries>& product)
+  /// Get derivatives of the residuals vector wrt a number of global
+  /// parameters. The unperturbed residuals are only assembled once for
+  /// all derivatives that are computed by finite differences.
+  //=======================================================================
+  void Problem::get_derivative_wrt_global_parameter(
+    Vector<double*> const& parameter_pt, Vector<DoubleVector>& result)
   {
-    // How many vector products must we construct
-    const unsigned n_vec = C.size();
-
-    // currently only global (non-distributed) distributions are allowed
-    // LinearAlgebraDistribution* dist_pt = new
-    // LinearAlgebraDistribution(Communicator_pt,n_dof,false);
+    const unsigned n_param = parameter_pt.size();
+    result.resize(n_param);
 
-    // Cache the assembly hander
-    AssemblyHandler* const assembly_handler_pt = Assembly_handler_pt;
+    // Storage for the unperturbed residuals (only assembled if required)
+    DoubleVector res;
 
-    // Rebuild the results vectors and initialise to zero
-    // use the same distribution of the vector Y
-    for (unsigned i = 0; i < n_vec; i++)
-    {
-      product[i].build(Y.distribution_pt(), 0.0);
-      product[i].initialise(0.0);
-    }
+    // Increase the global parameter
+    const double FD_step = 1.0e-8;
 
-// Setup the halo schemes for the result
-#ifdef OOMPH_HAS_MPI
-    if (Problem_has_been_distributed)
+    for (unsigned p = 0; p < n_param; p++)
     {
-      for (unsigned i = 0; i < n_vec; i++)
+      // Derivatives that are calculated analytically don't need the
+      // unperturbed residuals
+      if (is_dparameter_calculated_analytically(parameter_pt[p]))
       {
-        product[i].build_halo_scheme(this->Halo_scheme_pt);
+        get_derivative_wrt_global_parameter(parameter_pt[p], result[p]);
+        continue;
+      }
+
+      // Get the (global) unperturbed residuals if we haven't done so yet
+      if (!res.built())
+      {
+        get_residuals(res);
+      }
+
+      // Store the current value of the parameter
+      double param_value = *parameter_pt[p];
+
+      // Increase the parameter
+      *parameter_pt[p] += FD_step;
+
+      // Do any possible updates
+      actions_after_change_in_global_parameter(parameter_pt[p]);
+
+      // Get the new residuals (in the same distribution as the
+      // unperturbed ones)
+      result[p].clear();
+      get_residuals(result[p]);
+
+      // Do the finite differencing in the local variables
+      const unsigned ndof_local = res.nrow_local();
+      for (unsigned n = 0; n < ndof_local; ++n)
+      {
+        result[p][n] = (result[p][n] - res[n]) / FD_step;
+      }
+
+      // Reset the value of the parameter
+      *parameter_pt[p] = param_value;
+
+      // Do any possible updates
+      actions_after_change_in_global_parameter(parameter_pt[p]);
+    }
+  }
+
+
+  //======================================================================
+  /// Default implementation of the derivatives of the output functional
+  /// with respect to the dofs: finite differences.
+  //======================================================================
+  void Problem::get_doutput_functional_ddofs(DoubleVector& dfunctional_ddof)
+  {
+#ifdef OOMPH_HAS_MPI
+    if (Problem_has_been_distributed)
+    {
+      std::ostringstream error_stream;
+      error_stream
+        << "The finite-difference derivatives of the output functional\n"
+        << "are not available for distributed problems.\n"
+        << "Please overload Problem::get_doutput_functional_ddofs().\n";
+      throw OomphLibError(
+        error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+#endif
+
+    // Build the vector in the distribution of the dofs
+    dfunctional_ddof.build(Dof_distribution_pt, 0.0);
+
+    // Finite difference step
+    const double FD_step = 1.0e-8;
+
+    // Unperturbed value of the functional
+    const double functional = output_functional();
+
+    // Perturb each dof in turn
+    const unsigned long n_dof_local = Dof_distribution_pt->nrow_local();
+    for (unsigned long n = 0; n < n_dof_local; n++)
+    {
+      const double backup = *Dof_pt[n];
+      *Dof_pt[n] += FD_step;
+      dfunctional_ddof[n] = (output_functional() - functional) / FD_step;
+      *Dof_pt[n] = backup;
+    }
+  }
+
+
+  //======================================================================
+  /// Default implementation of the partial derivative of the output
+  /// functional with respect to a global parameter: finite differences.
+  //======================================================================
+  double Problem::get_doutput_functional_dparameter(double* const& parameter_pt)
+  {
+    // Finite difference step
+    const double FD_step = 1.0e-8;
+
+    // Unperturbed value of the functional
+    const double functional = output_functional();
+
+    // Store the current value of the parameter
+    double param_value = *parameter_pt;
+
+    // Increase the parameter and do any possible updates
+    *parameter_pt += FD_step;
+    actions_after_change_in_global_parameter(parameter_pt);
+
+    // Get the perturbed value of the functional
+    const double derivative = (output_functional() - functional) / FD_step;
+
+    // Reset the value of the parameter and do any possible updates
+    *parameter_pt = param_value;
+    actions_after_change_in_global_parameter(parameter_pt);
+
+    return derivative;
+  }
+
+
+  //======================================================================
+  /// Compute the gradient of the output functional with respect to the
+  /// registered parameters by the adjoint method and return the adjoint
+  /// solution: Solve J^T adjoint = dF/du, then
+  /// dF/dp = partial F/partial p - adjoint^T dR/dp.
+  //======================================================================
+  void Problem::get_output_functional_gradient(Vector<double>& gradient,
+                                               DoubleVector& adjoint)
+  {
+    const unsigned n_param = Sensitivity_parameter_pt.size();
+    gradient.resize(n_param);
+    gradient.initialise(0.0);
+
+    // Nothing to do if there are no parameters
+    if (n_param == 0)
+    {
+      return;
+    }
+
+    // Get the derivatives of the functional wrt the dofs
+    DoubleVector dfunctional_ddof;
+    get_doutput_functional_ddofs(dfunctional_ddof);
+
+    // Solve the adjoint problem, re-using the factorisation from the
+    // last Newton iteration if it is that of the present Jacobian (with
+    // Jacobian reuse, the factorisation may date back to the first
+    // iteration or even to a previous solve)
+    if (Jacobian_factorisation_is_current)
+    {
+      if (!Shut_up_in_newton_solve)
+      {
+        oomph_info << "Re-using Jacobian for the adjoint problem" << std::endl;
+      }
+      dfunctional_ddof.redistribute(Linear_solver_pt->distribution_pt());
+      Linear_solver_pt->resolve_transpose(dfunctional_ddof, adjoint);
+    }
+    else
+    {
+      // Save the status of the linear solver
+      bool enable_resolve = Linear_solver_pt->is_resolve_enabled();
+
+      // Factorise the Jacobian (the solution itself is not required)
+      Linear_solver_pt->enable_resolve();
+      DoubleVector dummy;
+      Linear_solver_pt->solve(this, dummy);
+
+      // Solve the transposed system
+      dfunctional_ddof.redistribute(Linear_solver_pt->distribution_pt());
+      Linear_solver_pt->resolve_transpose(dfunctional_ddof, adjoint);
+
+      // Restore the storage status of the linear solver; if the
+      // factorisation is retained, it is now that of the present Jacobian
+      if (enable_resolve)
+      {
+        Linear_solver_pt->enable_resolve();
+        Jacobian_factorisation_is_current = true;
+      }
+      else
+      {
+        Linear_solver_pt->disable_resolve();
+      }
+    }
+
+    // Get the derivatives of the residuals wrt all the parameters
+    Vector<DoubleVector> dresiduals_dparameter;
+    get_derivative_wrt_global_parameter(Sensitivity_parameter_pt,
+                                        dresiduals_dparameter);
+
+    // Assemble the gradient
+    DoubleVector adjoint_copy(adjoint);
+    for (unsigned p = 0; p < n_param; p++)
+    {
+      if (!(*adjoint_copy.distribution_pt() ==
+            *dresiduals_dparameter[p].distribution_pt()))
+      {
+        adjoint_copy.redistribute(dresiduals_dparameter[p].distribution_pt());
+      }
+      gradient[p] =
+        get_doutput_functional_dparameter(Sensitivity_parameter_pt[p]) -
+        adjoint_copy.dot(dresiduals_dparameter[p]);
+    }
+  }
+
+
+  //======================================================================
+  /// Return the product of the global hessian (derivative of Jacobian
+  /// matrix  with respect to all variables) with
+  /// an eigenvector, Y, and any number of other specified vectors C
+  /// (d(J_{ij})/d u_{k}) Y_{j} C_{k}.
+  /// This function is used in assembling and solving the augmented systems
+  /// associated with bifurcation tracking.
+  /// The default implementation is to use finite differences at the global
+  /// level.
+  //========================================================================
+  void Problem::get_hessian_vector_products(
+    DoubleVectorWithHaloEntries const& Y,
+    Vector<DoubleVectorWithHaloEntries> const& C,
+    Vector<DoubleVectorWithHaloEntries>& product)
+  {
+    // How many vector products must we construct
+    const unsigned n_vec = C.size();
+
+    // currently only global (non-distributed) distributions are allowed
+    // LinearAlgebraDistribution* dist_pt = new
+    // LinearAlgebraDistribution(Communicator_pt,n_dof,false);
+
+    // Cache the assembly hander
+    AssemblyHandler* const assembly_handler_pt = Assembly_handler_pt;
+
+    // Rebuild the results vectors and initialise to zero
+    // use the same distribution of the vector Y
+    for (unsigned i = 0; i < n_vec; i++)
+    {
+      product[i].build(Y.distribution_pt(), 0.0);
+      product[i].initialise(0.0);
+    }
+
+// Setup the halo schemes for the result
+#ifdef OOMPH_HAS_MPI
+    if (Problem_has_been_distributed)
+    {
+      for (unsigned i = 0; i < n_vec; i++)
+      {
+        product[i].build_halo_scheme(this->Halo_scheme_pt);
       }
     }
 #endif
@@ -8001,45 +9075,98 @@ namespace oomph
     // handler
     if (this->are_hessian_products_calculated_analytically())
     {
-      // Loop over all the elements
-      unsigned long Element_pt_range = Mesh_pt->nelement();
-      for (unsigned long e = 0; e < Element_pt_range; e++)
+      // The elements are processed in chunks: Their products are
+      // computed (concurrently, if enabled by
+      // enable_threaded_hessian_products()) into separate storage and
+      // then added to the global vectors in the order of the elements, so
+      // the result doesn't depend on the number of threads, and the
+      // assembly handler's equation numbers may be shared between
+      // elements.
+      const unsigned long n_element = Mesh_pt->nelement();
+      const unsigned long chunk_size = 1024;
+      Vector<DenseMatrix<double>> product_local(
+        std::min(chunk_size, n_element));
+
+      // Storage for any exception thrown by one of the threads
+      std::exception_ptr exception_pt;
+
+      for (unsigned long e_lo = 0; e_lo < n_element; e_lo += chunk_size)
       {
-        // Get the pointer to the element
-        GeneralisedElement* elem_pt = Mesh_pt->element_pt(e);
-// Do not loop over halo elements
-#ifdef OOMPH_HAS_MPI
-        if (!elem_pt->is_halo())
+        const long n_chunk = std::min(chunk_size, n_element - e_lo);
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 16) \
+  if (Use_threaded_hessian_products)
+#endif
+        for (long k = 0; k < n_chunk; k++)
         {
+          // Get the pointer to the element
+          GeneralisedElement* elem_pt = Mesh_pt->element_pt(e_lo + k);
+
+          // Do not loop over halo elements
+#ifdef OOMPH_HAS_MPI
+          if (elem_pt->is_halo())
+          {
+            product_local[k].resize(n_vec, 0);
+            continue;
+          }
 #endif
-          // Find number of dofs in the element
-          unsigned n_var = assembly_handler_pt->ndof(elem_pt);
-          // Set up a matrix for the input and output
-          Vector<double> Y_local(n_var);
-          DenseMatrix<double> C_local(n_vec, n_var);
-          DenseMatrix<double> product_local(n_vec, n_var);
-
-          // Translate the global input vectors into the local storage
-          // Probably horribly inefficient, but otherwise things get really
-          // messy at the elemental level
-          for (unsigned l = 0; l < n_var; l++)
+
+          // Exceptions must not escape from the parallel region
+          try
           {
-            // Cache the global equation number
-            const unsigned long eqn_number =
-              assembly_handler_pt->eqn_number(elem_pt, l);
+            // Find number of dofs in the element
+            unsigned n_var = assembly_handler_pt->ndof(elem_pt);
+            // Set up a matrix for the input and output
+            Vector<double> Y_local(n_var);
+            DenseMatrix<double> C_local(n_vec, n_var);
+            product_local[k].resize(n_vec, n_var);
+
+            // Translate the global input vectors into the local storage
+            // Probably horribly inefficient, but otherwise things get really
+            // messy at the elemental level
+            for (unsigned l = 0; l < n_var; l++)
+            {
+              // Cache the global equation number
+              const unsigned long eqn_number =
+                assembly_handler_pt->eqn_number(elem_pt, l);
 
-            Y_local[l] = Y.global_value(eqn_number);
-            for (unsigned i = 0; i < n_vec; i++)
+              Y_local[l] = Y.global_value(eqn_number);
+              for (unsigned i = 0; i < n_vec; i++)
+              {
+                C_local(i, l) = C[i].global_value(eqn_number);
+              }
+            }
+
+            // Fill the array
+            assembly_handler_pt->get_hessian_vector_products(
+              elem_pt, Y_local, C_local, product_local[k]);
+          }
+          catch (...)
+          {
+#ifdef _OPENMP
+#pragma omp critical
+#endif
             {
-              C_local(i, l) = C[i].global_value(eqn_number);
+              if (!exception_pt)
+              {
+                exception_pt = std::current_exception();
+              }
             }
           }
+        }
 
-          // Fill the array
-          assembly_handler_pt->get_hessian_vector_products(
-            elem_pt, Y_local, C_local, product_local);
+        // Pass on the first exception
+        if (exception_pt)
+        {
+          std::rethrow_exception(exception_pt);
+        }
 
-          // Assign the local results to the global vector
+        // Assign the local results to the global vector
+        for (long k = 0; k < n_chunk; k++)
+        {
+          GeneralisedElement* elem_pt = Mesh_pt->element_pt(e_lo + k);
+          const unsigned n_var = product_local[k].ncol();
           for (unsigned l = 0; l < n_var; l++)
           {
             const unsigned long eqn_number =
@@ -8047,14 +9174,10 @@ namespace oomph
 
             for (unsigned i = 0; i < n_vec; i++)
             {
-              product[i].global_value(eqn_number) += product_local(i, l);
-              // std::cout << "BLA " << e << " " << i << " "
-              //          << l << " " << product_local(i,l) << "\n";
+              product[i].global_value(eqn_number) += product_local[k](i, l);
             }
           }
-#ifdef OOMPH_HAS_MPI
         }
-#endif
       }
     }
     // Otherwise calculate using finite differences by
@@ -8135,6 +9258,17 @@ namespace oomph
       // Dummy vector to stand in the place of the residuals
       Vector<double> dummy_res;
 
+      // Storage for the elements' global equation numbers, the
+      // unperturbed values of their dofs and the entries in Y, which are
+      // shared by all perturbations
+      Vector<unsigned long> eqn_number;
+      Vector<double> dof_bac;
+      Vector<double> Y_local;
+
+      // Storage for the unperturbed and perturbed jacobian matrices
+      DenseMatrix<double> jac;
+      DenseMatrix<double> jac_C;
+
       // Calculate the product of the jacobian matrices, etc by looping over the
       // elements
       const unsigned long n_element = this->mesh_pt()->nelement();
@@ -8150,59 +9284,53 @@ namespace oomph
           unsigned n_var = assembly_handler_pt->ndof(elem_pt);
           // Resize the dummy residuals vector
           dummy_res.resize(n_var);
-          // Allocate storage for the unperturbed jacobian matrix
-          DenseMatrix<double> jac(n_var);
           // Get unperturbed jacobian
+          jac.resize(n_var, n_var);
           assembly_handler_pt->get_jacobian(elem_pt, dummy_res, jac);
 
-          // Backup the dofs
-          Vector<double> dof_bac(n_var);
+          // Backup the dofs and gather the local entries of Y
+          eqn_number.resize(n_var);
+          dof_bac.resize(n_var);
+          Y_local.resize(n_var);
           for (unsigned n = 0; n < n_var; n++)
           {
-            unsigned eqn_number = assembly_handler_pt->eqn_number(elem_pt, n);
-            dof_bac[n] = *this->global_dof_pt(eqn_number);
+            eqn_number[n] = assembly_handler_pt->eqn_number(elem_pt, n);
+            dof_bac[n] = *this->global_dof_pt(eqn_number[n]);
+            Y_local[n] = Y.global_value(eqn_number[n]);
           }
 
           // Now loop over all vectors C
+          jac_C.resize(n_var, n_var);
           for (unsigned i = 0; i < n_vec; i++)
           {
             // Perturb the dofs by the appropriate vector
             for (unsigned n = 0; n < n_var; n++)
             {
-              unsigned eqn_number = assembly_handler_pt->eqn_number(elem_pt, n);
               // Perturb by vector C[i]
-              *this->global_dof_pt(eqn_number) +=
-                C_mult[i] * C[i].global_value(eqn_number);
+              *this->global_dof_pt(eqn_number[n]) +=
+                C_mult[i] * C[i].global_value(eqn_number[n]);
             }
             actions_before_newton_convergence_check();
 
-            // Allocate storage for the perturbed jacobian
-            DenseMatrix<double> jac_C(n_var);
-
             // Now get the new jacobian
             assembly_handler_pt->get_jacobian(elem_pt, dummy_res, jac_C);
 
             // Reset the dofs
             for (unsigned n = 0; n < n_var; n++)
             {
-              unsigned eqn_number = assembly_handler_pt->eqn_number(elem_pt, n);
-              *this->global_dof_pt(eqn_number) = dof_bac[n];
+              *this->global_dof_pt(eqn_number[n]) = dof_bac[n];
             }
             actions_before_newton_convergence_check();
 
             // Now work out the products
             for (unsigned n = 0; n < n_var; n++)
             {
-              unsigned eqn_number = assembly_handler_pt->eqn_number(elem_pt, n);
               double prod_c = 0.0;
               for (unsigned m = 0; m < n_var; m++)
               {
-                unsigned unknown = assembly_handler_pt->eqn_number(elem_pt, m);
-                prod_c += (jac_C(n, m) - jac(n, m)) * Y.global_value(unknown);
+                prod_c += (jac_C(n, m) - jac(n, m)) * Y_local[m];
               }
-              // std::cout << "FD   " << e << " " << i << " "
-              //          << n << " " << prod_c/C_mult[i] << "\n";
-              product[i].global_value(eqn_number) += prod_c / C_mult[i];
+              product[i].global_value(eqn_number[n]) += prod_c / C_mult[i];
             }
           }
 #ifdef OOMPH_HAS_MPI
@@ -8967,6 +10095,24 @@ namespace oomph
   }
 
 
+  //================================================================
+  /// Discard the factorisation retained from the last corrector
+  /// iteration of a continuation step (if any) and restore the
+  /// resolve setting that the linear solver had before.
+  //================================================================
+  void Problem::discard_continuation_factorisation()
+  {
+    if (Continuation_factorisation_is_available)
+    {
+      Continuation_factorisation_is_available = false;
+      if (!Resolve_enabled_before_continuation_factorisation)
+      {
+        Linear_solver_pt->disable_resolve();
+      }
+    }
+  }
+
+
   //================================================================
   /// General Newton solver. Requires only a convergence tolerance.
   /// The linear solver takes a pointer to the problem (which defines
@@ -8981,6 +10127,13 @@ namespace oomph
     double t_start = TimingHelpers::timer();
     Max_res.clear();
 
+    // Any factorisation retained from a continuation step is about to be
+    // overwritten
+    discard_continuation_factorisation();
+
+    // The dofs are about to change
+    Jacobian_factorisation_is_current = false;
+
     // Find total number of dofs
     unsigned long n_dofs = ndof();
 
@@ -9157,6 +10310,9 @@ namespace oomph
 
         // Resolve
         Linear_solver_pt->resolve(resid, dx);
+
+        // The factorisation is not that of the present Jacobian
+        Jacobian_factorisation_is_current = false;
       }
       else
       {
@@ -9168,7 +10324,17 @@ namespace oomph
           }
           Linear_solver_pt->enable_resolve();
         }
-        Linear_solver_pt->solve(this, dx);
+        if (Use_pipelined_preconditioner_setup)
+        {
+          pipelined_linear_solve(dx);
+          Jacobian_factorisation_is_current = false;
+        }
+        else
+        {
+          Linear_solver_pt->solve(this, dx);
+          Jacobian_factorisation_is_current =
+            Linear_solver_pt->is_resolve_enabled();
+        }
         Jacobian_has_been_computed = true;
       }
 
@@ -9616,6 +10782,12 @@ namespace oomph
     // Check the arc-length constraint
     double arc_length_constraint_residual = 0.0;
 
+    // Any factorisation retained from the previous step belongs to a
+    // different point on the solution branch: discard it (this also
+    // restores the user's resolve setting)
+    discard_continuation_factorisation();
+    Jacobian_factorisation_is_current = false;
+
     // Are we storing the matrix in the linear solve
     bool enable_resolve = Linear_solver_pt->is_resolve_enabled();
 
@@ -9883,9 +11055,23 @@ namespace oomph
     // Now update anything that needs updating
     actions_after_newton_solve();
 
+    // If any corrector iterations were performed, the linear solver now
+    // holds the factorisation of the Jacobian from the last one. Retain
+    // it if requested (not possible for the block Hopf solver, which only
+    // solves for both right-hand sides at once). If no iterations were
+    // performed, there is no factorisation for the present solution.
+    Continuation_factorisation_is_available =
+      (count > 0) && Reuse_factorisation_for_continuation_tangent &&
+      (dynamic_cast<BlockHopfLinearSolver*>(Linear_solver_pt) == 0);
+
     // Reset the storage of the matrix on the linear solver to what it was
-    // on entry to this routine
-    if (enable_resolve)
+    // on entry to this routine; if the factorisation is retained, this
+    // is deferred until it has been used or discarded.
+    if (Continuation_factorisation_is_available)
+    {
+      Resolve_enabled_before_continuation_factorisation = enable_resolve;
+    }
+    else if (enable_resolve)
     {
       Linear_solver_pt->enable_resolve();
     }
@@ -9937,16 +11123,29 @@ namespace oomph
     // Otherwise we can use the normal resolve
     else
     {
-      // Save the status before entry to this routine
-      bool enable_resolve = Linear_solver_pt->is_resolve_enabled();
+      // Save the status before entry to this routine (or, if the
+      // factorisation from the last corrector iteration has been
+      // retained, before it was retained)
+      const bool reuse_factorisation = Continuation_factorisation_is_available;
+      bool enable_resolve =
+        reuse_factorisation ?
+          Resolve_enabled_before_continuation_factorisation :
+          Linear_solver_pt->is_resolve_enabled();
+
+      // The retained factorisation (if any) is used up here
+      Continuation_factorisation_is_available = false;
 
       // We need to do resolves
       Linear_solver_pt->enable_resolve();
 
       // Solve the standard problem, we only want to make sure that
       // we factorise the matrix, if it has not been factorised. We shall
-      // ignore the return value of z.
-      Linear_solver_pt->solve(this, z);
+      // ignore the return value of z. If the factorisation from the last
+      // corrector iteration has been retained, re-use it instead.
+      if (!reuse_factorisation)
+      {
+        Linear_solver_pt->solve(this, z);
+      }
 
       // Get the vector dresiduals/dparameter
       get_derivative_wrt_global_parameter(parameter_pt, z);
@@ -10748,6 +11947,24 @@ namespace oomph
     // Flag to indicate a sign change
     bool SIGN_CHANGE = false;
 
+    // Keep a copy of the tangent at the start of the step if we need it
+    // to estimate the curvature of the solution branch. (It is only
+    // meaningful if a step has been taken before.)
+    Vector<double> previous_dof_derivative;
+    double previous_parameter_derivative = Parameter_derivative;
+    if (Use_curvature_based_arc_length_control && Arc_length_step_taken)
+    {
+      unsigned ndof_local = Dof_distribution_pt->nrow_local();
+      previous_dof_derivative.resize(ndof_local);
+      for (unsigned long l = 0; l < ndof_local; l++)
+      {
+        previous_dof_derivative[l] = dof_derivative(l);
+      }
+    }
+
+    // Arc-length of the step that is actually taken
+    double ds_taken = 0.0;
+
 
     // Adaptation loop
     for (unsigned isolve = 0; isolve < max_solve; ++isolve)
@@ -10924,6 +12141,9 @@ namespace oomph
       {
         max_count_in_adapt_loop = count;
       }
+
+      // Record the step that was accepted
+      ds_taken = Ds_current;
     } /// end of adaptation loop
 
     // Only recalculate the derivatives if there has been a Newton solve
@@ -11057,6 +12277,50 @@ namespace oomph
       Sign_of_jacobian = temp_sign;
     }
 
+    //-----------ESTIMATE THE CURVATURE OF THE SOLUTION BRANCH-----------
+    // The angle between the (unit) tangents at the beginning and the end
+    // of the step, measured in the arc-length metric, divided by the
+    // length of the step. This can't be done if the number of dofs
+    // has been changed by adaptation.
+    double continuation_angle = -1.0;
+    unsigned n_previous_dof = previous_dof_derivative.size();
+    if ((n_previous_dof > 0) &&
+        (n_previous_dof == Dof_distribution_pt->nrow_local()) &&
+        (ds_taken != 0.0))
+    {
+      double dot = 0.0;
+      for (unsigned long l = 0; l < n_previous_dof; l++)
+      {
+        dot += previous_dof_derivative[l] * dof_derivative(l);
+      }
+#ifdef OOMPH_HAS_MPI
+      if ((Dof_distribution_pt->distributed()) &&
+          (Dof_distribution_pt->communicator_pt()->nproc() > 1))
+      {
+        double global_dot = 0.0;
+        MPI_Allreduce(&dot,
+                      &global_dot,
+                      1,
+                      MPI_DOUBLE,
+                      MPI_SUM,
+                      Dof_distribution_pt->communicator_pt()->mpi_comm());
+        dot = global_dot;
+      }
+#endif
+      double cos_angle = Theta_squared * dot +
+                         previous_parameter_derivative * Parameter_derivative;
+      if (cos_angle > 1.0)
+      {
+        cos_angle = 1.0;
+      }
+      if (cos_angle < -1.0)
+      {
+        cos_angle = -1.0;
+      }
+      continuation_angle = std::acos(cos_angle);
+      Continuation_curvature = continuation_angle / std::fabs(ds_taken);
+    }
+
     // Reset the is_steady status of all timesteppers that
     // weren't already steady when we came in here and reset their
     // weights
@@ -11091,18 +12355,41 @@ namespace oomph
       return Ds_current;
     }
 
+    // Step suggested by the number of Newton iterations:
     // If fewer than the desired number of Newton Iterations, increase the step
+    double next_ds = Ds_current;
     if (max_count_in_adapt_loop < Desired_newton_iterations_ds)
     {
-      return Ds_current * 1.5;
+      next_ds = Ds_current * 1.5;
     }
     // If more than the desired number of Newton Iterations, reduce the step
-    if (max_count_in_adapt_loop > Desired_newton_iterations_ds)
+    else if (max_count_in_adapt_loop > Desired_newton_iterations_ds)
+    {
+      next_ds = Ds_current * (2.0 / 3.0);
+    }
+
+    // Don't let the tangent turn by much more than the desired angle
+    // over the next step
+    if (Use_curvature_based_arc_length_control && (continuation_angle >= 0.0))
     {
-      return Ds_current * (2.0 / 3.0);
+      double factor = 2.0;
+      if (continuation_angle * factor > Desired_continuation_angle)
+      {
+        factor = Desired_continuation_angle / continuation_angle;
+      }
+      if (factor < 0.5)
+      {
+        factor = 0.5;
+      }
+      double curvature_ds = Ds_current * factor;
+      if (std::fabs(curvature_ds) < std::fabs(next_ds))
+      {
+        next_ds = curvature_ds;
+      }
     }
-    // Otherwise return the step just taken
-    return Ds_current;
+
+    // Return the desired value of the step
+    return next_ds;
   }
 
 
@@ -11137,19 +12424,163 @@ namespace oomph
 
 
   //========================================================================
-  /// Do one timestep of size dt using Newton's method with the specified
-  /// tolerance and linear solver defined as member data of the Problem class.
-  /// This will be the most commonly used version
-  /// of  unsteady_newton_solve, in which the time values are always shifted
-  /// This does not include any kind of adaptativity. If the solution fails to
-  /// converge the program will end.
+  /// Solve the nonlinear system(s) for the present implicit timestep
+  /// (time and dt have already been advanced). Multistep timesteppers
+  /// require a single Newton solve. Multi-stage timesteppers require one
+  /// Newton solve per stage; actions_before_implicit_timestep() is
+  /// called before each of them so that time-dependent boundary
+  /// conditions can be applied at the time of the stage. (For the first
+  /// stage this call has already been made by the caller, after the
+  /// timestepper's actions_before_timestep(...) has set up the stage.)
+  /// If the stages share the same Jacobian (as they do for singly
+  /// diagonally implicit Runge-Kutta methods), the Jacobian (and hence its factorisation or
+  /// preconditioner) computed at the beginning of the first stage is
+  /// re-used for all stages of the timestep (modified Newton method).
+  /// It is only recomputed if the Newton iteration for a stage fails to
+  /// converge with the re-used one.
   //========================================================================
-  void Problem::unsteady_newton_solve(const double& dt)
+  void Problem::implicit_timestep_newton_solve()
   {
-    // We shift the values, so shift_values is true
-    unsteady_newton_solve(dt, true);
-  }
-
+    // Standard case: a single Newton solve
+    if ((ntime_stepper() == 0) || (time_stepper_pt()->nstage() == 1))
+    {
+      newton_solve();
+      return;
+    }
+
+#ifdef PARANOID
+    if (ntime_stepper() != 1)
+    {
+      std::string error_message =
+        "Multi-stage timesteppers only work for problems with a single ";
+      error_message += "timestepper.\n";
+      throw OomphLibError(
+        error_message, OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+#endif
+
+    TimeStepper* const ts_pt = time_stepper_pt();
+    const unsigned n_stage = ts_pt->nstage();
+
+    // Backup the user's Jacobian re-use settings
+    const bool backup_jacobian_reuse = Jacobian_reuse_is_enabled;
+    const bool backup_resolve = Linear_solver_pt->is_resolve_enabled();
+
+    // Re-use the Jacobian of the first stage for all stages (unless the
+    // user has asked for Jacobian re-use anyway, the Jacobian from the
+    // previous timestep is out of date)
+    if (ts_pt->jacobian_is_shared_by_stages() && (!backup_jacobian_reuse))
+    {
+      Jacobian_reuse_is_enabled = true;
+      Jacobian_has_been_computed = false;
+    }
+
+    // Storage for the initial guess for the stage, in case we have to
+    // redo the Newton solve with a new Jacobian
+    Vector<double> dofs_backup;
+
+    try
+    {
+      for (unsigned i = 0; i < n_stage; i++)
+      {
+        // Set time, weights, etc. for this stage and update the boundary
+        // conditions (the first stage has been set up before the call
+        // to this function)
+        if (i > 0)
+        {
+          ts_pt->actions_before_stage(this, i);
+          actions_before_implicit_timestep();
+        }
+
+        // Will the Jacobian be re-used?
+        const bool jacobian_is_reused =
+          Jacobian_reuse_is_enabled && Jacobian_has_been_computed;
+        if (jacobian_is_reused)
+        {
+          unsigned n_dof_local = dof_distribution_pt()->nrow_local();
+          dofs_backup.resize(n_dof_local);
+          for (unsigned j = 0; j < n_dof_local; j++)
+          {
+            dofs_backup[j] = dof(j);
+          }
+        }
+
+        try
+        {
+          newton_solve();
+        }
+        catch (NewtonSolverError& error)
+        {
+          // Nothing we can do if the Jacobian was up to date or the
+          // linear solver failed
+          if ((!jacobian_is_reused) || error.linear_solver_error)
+          {
+            throw;
+          }
+
+          if (!Shut_up_in_newton_solve)
+          {
+            oomph_info << "Newton iteration for stage " << i
+                       << " did not converge with re-used Jacobian;\n"
+                       << "recomputing the Jacobian." << std::endl;
+          }
+
+          // Restore the initial guess and try again with a new Jacobian
+          unsigned n_dof_local = dofs_backup.size();
+          for (unsigned j = 0; j < n_dof_local; j++)
+          {
+            dof(j) = dofs_backup[j];
+          }
+          Jacobian_has_been_computed = false;
+          newton_solve();
+        }
+
+        // Store the stage values/derivatives
+        ts_pt->actions_after_stage(this, i);
+      }
+    }
+    catch (NewtonSolverError&)
+    {
+      // Restore the user's settings before passing the error on
+      if (!backup_jacobian_reuse)
+      {
+        Jacobian_reuse_is_enabled = false;
+        Jacobian_has_been_computed = false;
+      }
+      if (!backup_resolve)
+      {
+        Linear_solver_pt->disable_resolve();
+      }
+      throw;
+    }
+
+    // Restore the user's settings
+    if (!backup_jacobian_reuse)
+    {
+      Jacobian_reuse_is_enabled = false;
+      Jacobian_has_been_computed = false;
+    }
+    if (!backup_resolve)
+    {
+      Linear_solver_pt->disable_resolve();
+    }
+  }
+
+
+  //========================================================================
+  /// Do one timestep of size dt using Newton's method with the specified
+  /// tolerance and linear solver defined as member data of the Problem class.
+  /// This will be the most commonly used version
+  /// of  unsteady_newton_solve, in which the time values are always shifted
+  /// This does not include any kind of adaptativity. If the solution fails to
+  /// converge the program will end.
+  //========================================================================
+  void Problem::unsteady_newton_solve(const double& dt)
+  {
+    // We shift the values, so shift_values is true
+    unsteady_newton_solve(dt, true);
+  }
+
   //========================================================================
   /// Do one timestep forward of size dt using Newton's method with the
   /// specified tolerance and linear solver defined via member data of the
@@ -11179,6 +12610,12 @@ namespace oomph
       time_stepper_pt(i)->set_weights();
     }
 
+    // Extrapolate the initial guess from the history values
+    if (Use_extrapolated_initial_guess)
+    {
+      extrapolate_initial_guess();
+    }
+
     // Run the individual timesteppers actions before timestep. These need to
     // be before the problem's actions_before_implicit_timestep so that the
     // boundary conditions are set consistently.
@@ -11194,7 +12631,7 @@ namespace oomph
     try
     {
       // Solve the non-linear problem for this timestep with Newton's method
-      newton_solve();
+      implicit_timestep_newton_solve();
     }
     // Catch any exceptions thrown in the Newton solver
     catch (NewtonSolverError& error)
@@ -11336,6 +12773,14 @@ namespace oomph
       // Now calculate the predicted values for the all data and all positions
       calculate_predictions();
 
+      // Extrapolate the initial guess from the history values (unless
+      // the predicted values are used)
+      if (Use_extrapolated_initial_guess &&
+          (!Use_predictor_values_as_initial_guess))
+      {
+        extrapolate_initial_guess();
+      }
+
       // Run the individual timesteppers actions before timestep. These need to
       // be before the problem's actions_before_implicit_timestep so that the
       // boundary conditions are set consistently.
@@ -11351,7 +12796,7 @@ namespace oomph
       try
       {
         // Solve the non-linear problem at this timestep
-        newton_solve();
+        implicit_timestep_newton_solve();
       }
       // Catch any exceptions thrown
       catch (NewtonSolverError& error)
@@ -11411,9 +12856,39 @@ namespace oomph
         // as a factor of the maximum error tolerance
         double target_error = Target_error_safety_factor * epsilon;
 
-        // Calculate the scaling factor
-        dt_rescaling_factor = std::pow(
-          (target_error / error), (1.0 / (1.0 + time_stepper_pt()->order())));
+        // Is the error too large?
+        const bool error_too_large =
+          (error > epsilon) && Keep_temporal_error_below_tolerance;
+
+        // Variable-order timesteppers may now change their order: get the
+        // error estimates for the orders they consider, and the one for
+        // the order that is used for the next timestep. (Only the order
+        // of the first timestepper is adapted.)
+        TimeStepper* const ts_pt = time_stepper_pt();
+        Vector<unsigned> candidate_order;
+        ts_pt->setup_order_adaptation(!error_too_large, candidate_order);
+        const unsigned n_candidate = candidate_order.size();
+        Vector<double> candidate_error(n_candidate);
+        for (unsigned i = 0; i < n_candidate; i++)
+        {
+          ts_pt->set_error_order(candidate_order[i]);
+          candidate_error[i] =
+            std::max(std::abs(global_temporal_error_norm()), 1e-12);
+        }
+        if (n_candidate > 0)
+        {
+          ts_pt->set_error_order(ts_pt->order());
+        }
+        double next_order_error = std::max(
+          ts_pt->adapt_order(
+            error, target_error, candidate_order, candidate_error),
+          1e-12);
+
+        // Calculate the scaling factor from the order of the error
+        // estimate
+        dt_rescaling_factor =
+          std::pow((target_error / next_order_error),
+                   (1.0 / (1.0 + time_stepper_pt()->error_order())));
 
         oomph_info
           << "- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -\n"
@@ -11426,7 +12901,7 @@ namespace oomph
         {
           oomph_info << "Estimated timestepping error " << error
                      << " exceeds tolerance " << epsilon << "\n";
-          if (Keep_temporal_error_below_tolerance)
+          if (error_too_large)
           {
             oomph_info << "    --> rejecting timestep.\n";
             reject_timestep = true;
@@ -11845,11 +13320,139 @@ namespace oomph
   }
 
 
+  //=======================================================================
+  /// Local (not exported in header) helper function: Record the history
+  /// index of the timestepper of the Data data_pt for all of its values
+  /// that are (local) dofs, i.e. whose equation number lies in
+  /// [first_row, first_row+dof_history_index_pt.size()).
+  //=======================================================================
+  void record_dof_history_index(
+    Data* const& data_pt,
+    const unsigned long& first_row,
+    Vector<const TimeHistoryIndex*>& dof_history_index_pt)
+  {
+    const TimeHistoryIndex* const history_index_pt =
+      data_pt->time_stepper_pt()->history_index_pt();
+    const unsigned long n_row_local = dof_history_index_pt.size();
+    const unsigned n_value = data_pt->nvalue();
+    for (unsigned j = 0; j < n_value; j++)
+    {
+      const long eqn_number = data_pt->eqn_number(j);
+      if ((eqn_number >= 0) &&
+          (static_cast<unsigned long>(eqn_number) >= first_row) &&
+          (static_cast<unsigned long>(eqn_number) < first_row + n_row_local))
+      {
+        dof_history_index_pt[eqn_number - first_row] = history_index_pt;
+      }
+    }
+  }
+
+
+  //=======================================================================
+  /// Pointer to the history value at time level t of the i-th (local)
+  /// dof. The history index of each dof is found (once per equation
+  /// numbering) by visiting all Data in the problem.
+  //=======================================================================
+  double* Problem::dof_pt(const unsigned& t, const unsigned& i)
+  {
+    // The present value is always stored first
+    if (t == 0)
+    {
+      return Dof_pt[i];
+    }
+
+    if (!Dof_history_index_is_up_to_date)
+    {
+      const unsigned long n_dof_local = Dof_pt.size();
+      const unsigned long first_row = Dof_distribution_pt->first_row();
+      Dof_history_index_pt.assign(n_dof_local, 0);
+
+      // Global data
+      const unsigned n_global = Global_data_pt.size();
+      for (unsigned l = 0; l < n_global; l++)
+      {
+        record_dof_history_index(
+          Global_data_pt[l], first_row, Dof_history_index_pt);
+      }
+
+      // Internal data of the elements
+      const unsigned long n_element = Mesh_pt->nelement();
+      for (unsigned long e = 0; e < n_element; e++)
+      {
+        GeneralisedElement* const el_pt = Mesh_pt->element_pt(e);
+        const unsigned n_internal = el_pt->ninternal_data();
+        for (unsigned l = 0; l < n_internal; l++)
+        {
+          record_dof_history_index(
+            el_pt->internal_data_pt(l), first_row, Dof_history_index_pt);
+        }
+      }
+
+      // Nodal values and (for solid nodes) positions
+      const unsigned long n_node = Mesh_pt->nnode();
+      for (unsigned long n = 0; n < n_node; n++)
+      {
+        Node* const nod_pt = Mesh_pt->node_pt(n);
+        record_dof_history_index(nod_pt, first_row, Dof_history_index_pt);
+        SolidNode* const solid_nod_pt = dynamic_cast<SolidNode*>(nod_pt);
+        if (solid_nod_pt != 0)
+        {
+          record_dof_history_index(solid_nod_pt->variable_position_pt(),
+                                   first_row,
+                                   Dof_history_index_pt);
+        }
+      }
+
+      // Spine heights, which are numbered by the spine meshes
+      // (see assign_eqn_numbers())
+      const unsigned n_sub_mesh = nsub_mesh();
+      const unsigned n_mesh = (n_sub_mesh == 0) ? 1 : n_sub_mesh;
+      for (unsigned m = 0; m < n_mesh; m++)
+      {
+        SpineMesh* const spine_mesh_pt = dynamic_cast<SpineMesh*>(
+          (n_sub_mesh == 0) ? Mesh_pt : Sub_mesh_pt[m]);
+        if (spine_mesh_pt != 0)
+        {
+          const unsigned long n_spine = spine_mesh_pt->nspine();
+          for (unsigned long s = 0; s < n_spine; s++)
+          {
+            record_dof_history_index(
+              spine_mesh_pt->spine_pt(s)->spine_height_pt(),
+              first_row,
+              Dof_history_index_pt);
+          }
+        }
+      }
+      Dof_history_index_is_up_to_date = true;
+    }
+
+    const TimeHistoryIndex* const history_index_pt = Dof_history_index_pt[i];
+
+#ifdef PARANOID
+    // The Data that stores the dof hasn't been found
+    if (history_index_pt == 0)
+    {
+      std::ostringstream error_stream;
+      error_stream << "The Data that stores (local) dof " << i
+                   << " is not numbered by assign_eqn_numbers(), so\n"
+                   << "the address of its history values is unknown.\n";
+      throw OomphLibError(
+        error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+#endif
+
+    return Dof_pt[i] + history_index_pt->slot(t);
+  }
+
+
   //========================================================================
   /// Shift all time-dependent data along for next timestep.
   //========================================================================
   void Problem::shift_time_values()
   {
+    // The Jacobian depends on the history values
+    Jacobian_factorisation_is_current = false;
+
     // Move the values of dt in the Time object
     Time_pt->shift_dt();
 
@@ -11864,6 +13467,14 @@ namespace oomph
       Global_data_pt[iglobal]->time_stepper_pt()->shift_time_values(
         Global_data_pt[iglobal]);
     }
+
+    // Now that all history values have been shifted, rotate the ring
+    // buffers of any timesteppers with indexed history
+    unsigned n_time_steppers = ntime_stepper();
+    for (unsigned i = 0; i < n_time_steppers; i++)
+    {
+      time_stepper_pt(i)->rotate_history();
+    }
   }
 
 
@@ -12004,18 +13615,386 @@ namespace oomph
           err, OOMPH_EXCEPTION_LOCATION, OOMPH_CURRENT_FUNCTION);
       }
 
-      // Get predicted values
-      DoubleVector predicted_dofs;
-      get_dofs(time_stepper_pt()->predictor_storage_index(), predicted_dofs);
+      // Get predicted values
+      DoubleVector predicted_dofs;
+      get_dofs(time_stepper_pt()->predictor_storage_index(), predicted_dofs);
+
+      // Update dofs at current step
+      for (unsigned i = 0; i < ndof(); i++)
+      {
+        dof(i) = predicted_dofs[i];
+      }
+    }
+  }
+
+
+  //========================================================================
+  /// Local (not exported in header) helper function for
+  /// Problem::extrapolate_initial_guess(): Set the present value of the
+  /// unknowns in the Data to the weighted sum of the previous values
+  /// 1,2,...
+  //========================================================================
+  void extrapolate_unknowns_in_data(Data* const& data_pt,
+                                    const Vector<double>& weight)
+  {
+    const unsigned n_prev = weight.size();
+    const unsigned n_value = data_pt->nvalue();
+    for (unsigned j = 0; j < n_value; j++)
+    {
+      if ((!data_pt->is_a_copy(j)) && (data_pt->eqn_number(j) >= 0))
+      {
+        double value = 0.0;
+        for (unsigned t = 0; t < n_prev; t++)
+        {
+          value += weight[t] * data_pt->value(t + 1, j);
+        }
+        data_pt->set_value(j, value);
+      }
+    }
+  }
+
+
+  //========================================================================
+  /// Extrapolate the initial guess for the Newton iteration at the
+  /// present time (the time has already been advanced) from the history
+  /// values: For each timestepper, the weights of its previous values
+  /// are obtained by fitting a polynomial of degree Extrapolation_degree
+  /// to the previous values (in the least-squares sense if there are
+  /// more than Extrapolation_degree+1 of them) and evaluating it at the
+  /// present time. Only the unknowns are changed; the pinned values are
+  /// left for actions_before_implicit_timestep() to update.
+  //========================================================================
+  void Problem::extrapolate_initial_guess()
+  {
+    unsigned n_time_steppers = ntime_stepper();
+    for (unsigned i = 0; i < n_time_steppers; i++)
+    {
+      TimeStepper* const ts_pt = time_stepper_pt(i);
+
+      // Steady timesteppers keep their values
+      if (ts_pt->is_steady())
+      {
+        continue;
+      }
+
+      // How many previous values can we use?
+      unsigned n_prev =
+        std::min(std::min(Nprev_value_for_extrapolation, ts_pt->nprev_values()),
+                 time_pt()->ndt());
+      unsigned n_coef = std::min(Extrapolation_degree + 1, n_prev);
+
+      // Nothing to do for constant extrapolation
+      if (n_coef < 2)
+      {
+        continue;
+      }
+
+      // Times of the previous values relative to the present time,
+      // scaled by the present timestep
+      Vector<double> tau(n_prev);
+      for (unsigned t = 0; t < n_prev; t++)
+      {
+        tau[t] = (time_pt()->time(t + 1) - time_pt()->time()) / time_pt()->dt();
+      }
+
+      // The extrapolated value is the constant coefficient of the
+      // least-squares polynomial, sum_t weight[t] y[t] with
+      // weight = V (V^T V)^{-1} e_0, where V[t][k] = tau[t]^k.
+      // Assemble and solve the normal equations for z = (V^T V)^{-1} e_0
+      DenseDoubleMatrix normal_matrix(n_coef, n_coef, 0.0);
+      for (unsigned t = 0; t < n_prev; t++)
+      {
+        for (unsigned k = 0; k < n_coef; k++)
+        {
+          for (unsigned l = 0; l < n_coef; l++)
+          {
+            normal_matrix(k, l) += std::pow(tau[t], int(k + l));
+          }
+        }
+      }
+      Vector<double> rhs(n_coef, 0.0);
+      rhs[0] = 1.0;
+      Vector<double> z(n_coef);
+      normal_matrix.solve(rhs, z);
+
+      Vector<double> weight(n_prev, 0.0);
+      for (unsigned t = 0; t < n_prev; t++)
+      {
+        for (unsigned k = 0; k < n_coef; k++)
+        {
+          weight[t] += z[k] * std::pow(tau[t], int(k));
+        }
+      }
+
+      // Global data
+      unsigned n_global = Global_data_pt.size();
+      for (unsigned l = 0; l < n_global; l++)
+      {
+        if (Global_data_pt[l]->time_stepper_pt() == ts_pt)
+        {
+          extrapolate_unknowns_in_data(Global_data_pt[l], weight);
+        }
+      }
+
+      // Element internal data
+      unsigned n_element = Mesh_pt->nelement();
+      for (unsigned e = 0; e < n_element; e++)
+      {
+        GeneralisedElement* el_pt = Mesh_pt->element_pt(e);
+        unsigned n_internal = el_pt->ninternal_data();
+        for (unsigned l = 0; l < n_internal; l++)
+        {
+          if (el_pt->internal_data_pt(l)->time_stepper_pt() == ts_pt)
+          {
+            extrapolate_unknowns_in_data(el_pt->internal_data_pt(l), weight);
+          }
+        }
+      }
+
+      // Nodal values and (unknown) nodal positions
+      unsigned n_node = Mesh_pt->nnode();
+      for (unsigned n = 0; n < n_node; n++)
+      {
+        Node* nod_pt = Mesh_pt->node_pt(n);
+        if (nod_pt->time_stepper_pt() == ts_pt)
+        {
+          extrapolate_unknowns_in_data(nod_pt, weight);
+        }
+        SolidNode* solid_nod_pt = dynamic_cast<SolidNode*>(nod_pt);
+        if ((solid_nod_pt != 0) &&
+            (solid_nod_pt->position_time_stepper_pt() == ts_pt))
+        {
+          extrapolate_unknowns_in_data(solid_nod_pt->variable_position_pt(),
+                                       weight);
+        }
+      }
+    }
+  }
+
+  //========================================================================
+  /// Local (not exported in header) helper function for
+  /// Problem::setup_dof_based_temporal_error_table(): Record the Data,
+  /// value index and field for all (local) dofs stored in the Data.
+  /// A field of zero indicates nodal values, whose field is their value
+  /// number.
+  //========================================================================
+  void add_data_to_temporal_error_table(Data* const& data_pt,
+                                        const int& field,
+                                        const unsigned long& first_row,
+                                        Vector<Data*>& dof_data_pt,
+                                        Vector<unsigned>& dof_value_index,
+                                        Vector<int>& dof_field)
+  {
+    const unsigned long n_dof_local = dof_data_pt.size();
+    const unsigned n_value = data_pt->nvalue();
+    for (unsigned j = 0; j < n_value; j++)
+    {
+      const long eqn = data_pt->eqn_number(j);
+      if ((eqn >= 0) && (!data_pt->is_a_copy(j)) &&
+          (static_cast<unsigned long>(eqn) >= first_row) &&
+          (static_cast<unsigned long>(eqn) - first_row < n_dof_local))
+      {
+        const unsigned long local_eqn = eqn - first_row;
+        dof_data_pt[local_eqn] = data_pt;
+        dof_value_index[local_eqn] = j;
+        dof_field[local_eqn] = (field == 0) ? int(j) : field;
+      }
+    }
+  }
+
+
+  //========================================================================
+  /// Set up the lookup tables for the dof-based temporal error norm:
+  /// the Data, the index within the Data and the field of each local dof.
+  //========================================================================
+  void Problem::setup_dof_based_temporal_error_table()
+  {
+    const unsigned long n_dof_local = Dof_distribution_pt->nrow_local();
+    const unsigned long first_row = Dof_distribution_pt->first_row();
+    Temporal_error_dof_data_pt.assign(n_dof_local, 0);
+    Temporal_error_dof_value_index.assign(n_dof_local, 0);
+    Temporal_error_dof_field.assign(n_dof_local, -2);
+
+    // Global data
+    unsigned n_global = Global_data_pt.size();
+    for (unsigned l = 0; l < n_global; l++)
+    {
+      add_data_to_temporal_error_table(Global_data_pt[l],
+                                       -2,
+                                       first_row,
+                                       Temporal_error_dof_data_pt,
+                                       Temporal_error_dof_value_index,
+                                       Temporal_error_dof_field);
+    }
+
+    // Element internal data
+    unsigned long n_element = Mesh_pt->nelement();
+    for (unsigned long e = 0; e < n_element; e++)
+    {
+      GeneralisedElement* el_pt = Mesh_pt->element_pt(e);
+      unsigned n_internal = el_pt->ninternal_data();
+      for (unsigned l = 0; l < n_internal; l++)
+      {
+        add_data_to_temporal_error_table(el_pt->internal_data_pt(l),
+                                         -2,
+                                         first_row,
+                                         Temporal_error_dof_data_pt,
+                                         Temporal_error_dof_value_index,
+                                         Temporal_error_dof_field);
+      }
+    }
+
+    // Nodal values and (unknown) nodal positions
+    unsigned long n_node = Mesh_pt->nnode();
+    for (unsigned long n = 0; n < n_node; n++)
+    {
+      Node* nod_pt = Mesh_pt->node_pt(n);
+      add_data_to_temporal_error_table(nod_pt,
+                                       0,
+                                       first_row,
+                                       Temporal_error_dof_data_pt,
+                                       Temporal_error_dof_value_index,
+                                       Temporal_error_dof_field);
+      SolidNode* solid_nod_pt = dynamic_cast<SolidNode*>(nod_pt);
+      if (solid_nod_pt != 0)
+      {
+        add_data_to_temporal_error_table(solid_nod_pt->variable_position_pt(),
+                                         -1,
+                                         first_row,
+                                         Temporal_error_dof_data_pt,
+                                         Temporal_error_dof_value_index,
+                                         Temporal_error_dof_field);
+      }
+    }
+
+    // Spine heights, which are numbered by the spine meshes
+    // (see assign_eqn_numbers())
+    const unsigned n_sub_mesh = nsub_mesh();
+    const unsigned n_mesh = (n_sub_mesh == 0) ? 1 : n_sub_mesh;
+    for (unsigned m = 0; m < n_mesh; m++)
+    {
+      SpineMesh* const spine_mesh_pt = dynamic_cast<SpineMesh*>(
+        (n_sub_mesh == 0) ? Mesh_pt : Sub_mesh_pt[m]);
+      if (spine_mesh_pt != 0)
+      {
+        const unsigned long n_spine = spine_mesh_pt->nspine();
+        for (unsigned long s = 0; s < n_spine; s++)
+        {
+          add_data_to_temporal_error_table(
+            spine_mesh_pt->spine_pt(s)->spine_height_pt(),
+            -2,
+            first_row,
+            Temporal_error_dof_data_pt,
+            Temporal_error_dof_value_index,
+            Temporal_error_dof_field);
+        }
+      }
+    }
+
+#ifdef PARANOID
+    // Every dof must be stored in one of the Data that we visited,
+    // otherwise its error would be ignored
+    for (unsigned long n = 0; n < n_dof_local; n++)
+    {
+      if (Temporal_error_dof_data_pt[n] == 0)
+      {
+        std::ostringstream error_stream;
+        error_stream
+          << "The Data that stores (local) dof " << n
+          << " is not numbered by assign_eqn_numbers(), so its\n"
+          << "temporal error can't be included in the dof-based error "
+          << "norm.\nPlease overload global_temporal_error_norm().\n";
+        throw OomphLibError(
+          error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+      }
+    }
+#endif
+
+    Dof_based_temporal_error_table_is_up_to_date = true;
+  }
+
+
+  //========================================================================
+  /// Temporal error norm evaluated in a single pass over the (local) dofs:
+  /// weighted root-mean-square of the errors, each scaled by
+  /// absolute_tolerance + relative_tolerance |u|, reduced over all
+  /// processors.
+  //========================================================================
+  double Problem::dof_based_temporal_error_norm()
+  {
+    // (Re-)build the lookup tables if required
+    if (!Dof_based_temporal_error_table_is_up_to_date)
+    {
+      setup_dof_based_temporal_error_table();
+    }
+
+    // Cache the weights
+    const unsigned n_nodal_weight = Temporal_error_nodal_value_weight.size();
+    const double abs_tol = Temporal_error_absolute_tolerance;
+    const double rel_tol = Temporal_error_relative_tolerance;
+
+    // Sum of the squared weighted errors and number of contributing dofs
+    double sum[2] = {0.0, 0.0};
+    const unsigned long n_dof_local = Temporal_error_dof_data_pt.size();
+    for (unsigned long n = 0; n < n_dof_local; n++)
+    {
+      Data* const data_pt = Temporal_error_dof_data_pt[n];
+      if (data_pt == 0)
+      {
+        continue;
+      }
 
-      // Update dofs at current step
-      for (unsigned i = 0; i < ndof(); i++)
+      // Find the weight of the dof's field
+      const int field = Temporal_error_dof_field[n];
+      double weight = Temporal_error_non_nodal_value_weight;
+      if (field == -1)
       {
-        dof(i) = predicted_dofs[i];
+        weight = Temporal_error_position_weight;
+      }
+      else if (field >= 0)
+      {
+        weight = (unsigned(field) < n_nodal_weight) ?
+                   Temporal_error_nodal_value_weight[field] :
+                   1.0;
       }
+      if (weight == 0.0)
+      {
+        continue;
+      }
+
+      const unsigned j = Temporal_error_dof_value_index[n];
+      const double error =
+        weight * data_pt->time_stepper_pt()->temporal_error_in_value(data_pt, j);
+      const double scale = abs_tol + rel_tol * std::fabs(*Dof_pt[n]);
+      sum[0] += (error / scale) * (error / scale);
+      sum[1] += 1.0;
     }
+
+#ifdef OOMPH_HAS_MPI
+    // Add up the contributions from all processors
+    if (Dof_distribution_pt->distributed() &&
+        (Dof_distribution_pt->communicator_pt()->nproc() > 1))
+    {
+      double global_sum[2];
+      MPI_Allreduce(sum,
+                    global_sum,
+                    2,
+                    MPI_DOUBLE,
+                    MPI_SUM,
+                    Dof_distribution_pt->communicator_pt()->mpi_comm());
+      sum[0] = global_sum[0];
+      sum[1] = global_sum[1];
+    }
+#endif
+
+    if (sum[1] == 0.0)
+    {
+      return 0.0;
+    }
+    return std::sqrt(sum[0] / sum[1]);
   }
 
+
   //======================================================================
   /// Enable recycling of the mass matrix in explicit timestepping
   /// schemes. Useful for timestepping on fixed meshes when you want
@@ -14733,6 +16712,132 @@ namespace oomph
     }
   }
 
+  //========================================================================
+  /// hp-adapt problem:
+  /// Perform hp-adaptation for (all) refineable (sub)mesh(es) for which
+  /// both h- and p-adaptation are enabled, based on their own error
+  /// estimates and the target errors specified in the mesh(es): Elements
+  /// whose error is too large are p-refined where the solution is
+  /// locally smooth (and that's predicted to be the cheaper way of
+  /// reducing the error) and h-refined elsewhere; see
+  /// TreeBasedRefineableMeshBase::hp_adapt(). Following mesh adaptation,
+  /// update global mesh, and re-assign equation numbers.
+  /// Return # of refined/unrefined elements. On return from this
+  /// function, Problem can immediately be solved again.
+  //========================================================================
+  void Problem::hp_adapt(unsigned& n_refined, unsigned& n_unrefined)
+  {
+    // Get the bifurcation type
+    int bifurcation_type = this->Assembly_handler_pt->bifurcation_type();
+
+    // If we are tracking a bifurcation then call the bifurcation adapt
+    // function (as in p_adapt())
+    if (bifurcation_type != 0)
+    {
+      this->bifurcation_adapt_helper(n_refined, n_unrefined, bifurcation_type);
+      // Return immediately
+      return;
+    }
+
+    oomph_info << std::endl << std::endl;
+    oomph_info << "hp-adapting problem:" << std::endl;
+    oomph_info << "====================" << std::endl;
+
+    // Call the actions before adaptation
+    actions_before_adapt();
+
+    // Initialise counters
+    n_refined = 0;
+    n_unrefined = 0;
+
+    // Number of submeshes? (If there are none, the zero-th submesh is
+    // the mesh itself)
+    unsigned Nmesh = nsub_mesh();
+    unsigned n_mesh_to_adapt = Nmesh;
+    if (Nmesh == 0)
+    {
+      n_mesh_to_adapt = 1;
+    }
+
+    // Loop over (sub)meshes
+    for (unsigned imesh = 0; imesh < n_mesh_to_adapt; imesh++)
+    {
+      RefineableMeshBase* mmesh_pt =
+        dynamic_cast<RefineableMeshBase*>(mesh_pt(imesh));
+      if (mmesh_pt == 0)
+      {
+        oomph_info << "Info/Warning: Mesh cannot be adapted." << std::endl;
+        continue;
+      }
+      if (!(mmesh_pt->is_adaptation_enabled() &&
+            mmesh_pt->is_p_adaptation_enabled()))
+      {
+        oomph_info << "Info/Warning: Mesh adaptation is disabled."
+                   << std::endl;
+        continue;
+      }
+
+      // Get pointer to error estimator
+      ErrorEstimator* error_estimator_pt =
+        mmesh_pt->spatial_error_estimator_pt();
+
+#ifdef PARANOID
+      if (error_estimator_pt == 0)
+      {
+        throw OomphLibError("Error estimator hasn't been set yet",
+                            OOMPH_CURRENT_FUNCTION,
+                            OOMPH_EXCEPTION_LOCATION);
+      }
+#endif
+
+      // Get error for all elements
+      Vector<double> elemental_error(mmesh_pt->nelement());
+      if (mmesh_pt->doc_info_pt() == 0)
+      {
+        error_estimator_pt->get_element_errors(mesh_pt(imesh),
+                                               elemental_error);
+      }
+      else
+      {
+        error_estimator_pt->get_element_errors(
+          mesh_pt(imesh), elemental_error, *mmesh_pt->doc_info_pt());
+      }
+
+      // Store max./min error if the mesh has any elements
+      if (mesh_pt(imesh)->nelement() > 0)
+      {
+        mmesh_pt->max_error() = std::fabs(*std::max_element(
+          elemental_error.begin(), elemental_error.end(), AbsCmp<double>()));
+
+        mmesh_pt->min_error() = std::fabs(*std::min_element(
+          elemental_error.begin(), elemental_error.end(), AbsCmp<double>()));
+      }
+
+      oomph_info << "\n Max/min error: " << mmesh_pt->max_error() << " "
+                 << mmesh_pt->min_error() << std::endl;
+
+      // Adapt mesh
+      mmesh_pt->hp_adapt(elemental_error);
+
+      // Add to counters
+      n_refined += mmesh_pt->nrefined();
+      n_unrefined += mmesh_pt->nunrefined();
+    }
+
+    // Rebuild the global mesh
+    if (Nmesh != 0)
+    {
+      rebuild_global_mesh();
+    }
+
+    // Any actions after adapt
+    actions_after_adapt();
+
+    // Attach the boundary conditions to the mesh
+    oomph_info << "\nNumber of equations: " << assign_eqn_numbers() << std::endl
+               << std::endl;
+  }
+
   //========================================================================
   /// Perform mesh adaptation for (all) refineable (sub)mesh(es),
   /// based on the error estimates in elemental_error
@@ -17801,7 +19906,6 @@ namespace oomph
       get_flat_packed_refinement_pattern_for_load_balancing(
         old_domain_for_base_element,
         new_domain_for_base_element,
-        max_refinement_level_overall,
         flat_packed_refinement_info_for_root);
 
       if (report_stats)
@@ -18540,7 +20644,152 @@ namespace oomph
 
 
   //==========================================================================
-  /// Send refinement information between processors
+  /// Local (not exported in header) helper function for the load
+  /// balancing: Add the compact refinement pattern of the tree emanating
+  /// from root_pt (number of sons of a refined tree node, number of tree
+  /// nodes, and one bit per tree node, visited depth-first: 1 if it's been
+  /// split, 0 if it's a leaf) to packed_data.
+  //==========================================================================
+  void add_compact_refinement_pattern(Tree* const& root_pt,
+                                      Vector<unsigned>& packed_data)
+  {
+    // Get all the tree nodes (depth first)
+    Vector<Tree*> all_tree_nodes_pt;
+    root_pt->stick_all_tree_nodes_into_vector(all_tree_nodes_pt);
+
+    const unsigned n_bit_per_word = std::numeric_limits<unsigned>::digits;
+    unsigned n_tree_node = all_tree_nodes_pt.size();
+    unsigned n_word = (n_tree_node + n_bit_per_word - 1) / n_bit_per_word;
+
+    // Header
+    unsigned offset = packed_data.size() + 2;
+    packed_data.reserve(offset + n_word);
+    packed_data.push_back(1u << root_pt->object_pt()->dim());
+    packed_data.push_back(n_tree_node);
+    packed_data.resize(offset + n_word, 0);
+
+    // Set the bits of the split tree nodes
+    for (unsigned i = 0; i < n_tree_node; i++)
+    {
+      if (!all_tree_nodes_pt[i]->is_leaf())
+      {
+        packed_data[offset + i / n_bit_per_word] |= 1u << (i % n_bit_per_word);
+      }
+    }
+  }
+
+
+  //==========================================================================
+  /// Local (not exported in header) helper function for
+  /// get_refinement_info_from_compact_pattern(...): Decode the tree node
+  /// (at the given level) whose refinement bit is the i_bit-th one in the
+  /// bitstream, and (recursively) its sons. i_bit is advanced past the
+  /// subtree.
+  //==========================================================================
+  void decode_compact_refinement_pattern(
+    const unsigned* const& word_pt,
+    const unsigned& n_son,
+    const unsigned& level,
+    const unsigned& max_level,
+    unsigned& i_bit,
+    Vector<Vector<unsigned>>& refinement_info)
+  {
+    const unsigned n_bit_per_word = std::numeric_limits<unsigned>::digits;
+    bool is_split =
+      ((word_pt[i_bit / n_bit_per_word] >> (i_bit % n_bit_per_word)) & 1u);
+    i_bit++;
+
+    // Split tree node: Refine it when going to the next level, then
+    // deal with its sons (which follow in the mesh enumeration)
+    if (is_split)
+    {
+#ifdef PARANOID
+      if (level >= max_level)
+      {
+        std::ostringstream error_message;
+        error_message << "Tree node at level " << level
+                      << " is refined, but the max. refinement level is "
+                      << max_level << std::endl;
+        throw OomphLibError(error_message.str(),
+                            OOMPH_CURRENT_FUNCTION,
+                            OOMPH_EXCEPTION_LOCATION);
+      }
+#endif
+      refinement_info[level].push_back(2);
+      for (unsigned ison = 0; ison < n_son; ison++)
+      {
+        decode_compact_refinement_pattern(
+          word_pt, n_son, level + 1, max_level, i_bit, refinement_info);
+      }
+    }
+    // Leaf: Exists (unrefined) in the meshes at all remaining levels
+    else
+    {
+      for (unsigned l = level; l < max_level; l++)
+      {
+        refinement_info[l].push_back(1);
+      }
+    }
+  }
+
+
+  //==========================================================================
+  /// Local (not exported in header) helper function for the load
+  /// balancing: Expand the compact refinement pattern of a root (as
+  /// assembled by
+  /// Problem::get_flat_packed_refinement_pattern_for_load_balancing(...)),
+  /// starting at packed_data_pt, into the refinement info used by
+  /// Problem::refine_distributed_base_mesh(...):
+  /// refinement_info[level][e] is 2 if the e-th element in the tree
+  /// (using the enumeration when the mesh has been refined to the
+  /// level-th level) is to be refined during the next refinement; it's 1
+  /// if it's not to be refined. Returns the number of entries read.
+  //==========================================================================
+  unsigned get_refinement_info_from_compact_pattern(
+    const unsigned* const& packed_data_pt,
+    const unsigned& max_level,
+    Vector<Vector<unsigned>>& refinement_info)
+  {
+    refinement_info.clear();
+    refinement_info.resize(max_level);
+
+    // Not refineable: Nothing else to read
+    unsigned n_son = packed_data_pt[0];
+    if (n_son == 0)
+    {
+      return 1;
+    }
+
+    // Decode the entire tree in one pass
+    unsigned n_tree_node = packed_data_pt[1];
+    unsigned i_bit = 0;
+    decode_compact_refinement_pattern(
+      packed_data_pt + 2, n_son, 0, max_level, i_bit, refinement_info);
+
+#ifdef PARANOID
+    if (i_bit != n_tree_node)
+    {
+      std::ostringstream error_message;
+      error_message << "Decoded " << i_bit << " tree nodes but "
+                    << n_tree_node << " were sent" << std::endl;
+      throw OomphLibError(error_message.str(),
+                          OOMPH_CURRENT_FUNCTION,
+                          OOMPH_EXCEPTION_LOCATION);
+    }
+#endif
+
+    const unsigned n_bit_per_word = std::numeric_limits<unsigned>::digits;
+    return 2 + (n_tree_node + n_bit_per_word - 1) / n_bit_per_word;
+  }
+
+
+  //==========================================================================
+  /// Send refinement information between processors. The refinement
+  /// pattern of each root is sent in the compact form assembled by
+  /// get_flat_packed_refinement_pattern_for_load_balancing(...), both to
+  /// its new owner and (from there) to the processors that hold halo
+  /// copies of it; it is only expanded into the level-by-level
+  /// refinement_info_for_root_elements on the receiving side.
   //==========================================================================
   void Problem::send_refinement_info_helper(
     Vector<unsigned>& old_domain_for_base_element,
@@ -18557,9 +20806,9 @@ namespace oomph
     unsigned n_base_element = old_domain_for_base_element.size();
     refinement_info_for_root_elements.resize(n_base_element);
 
-    // Make space for list of domains that the refinement info
-    // is to be forwarded to
-    std::map<unsigned, Vector<unsigned>> halo_domain_of_haloed_base_element;
+    // Compact refinement pattern of the haloed base elements, and the
+    // domains that it is to be forwarded to
+    std::map<unsigned, Vector<unsigned>> compact_refinement_info_for_haloed;
 
     // Find out haloed elements in new, redistributed problem
     //-------------------------------------------------------
@@ -18615,8 +20864,8 @@ namespace oomph
       } // if (!(sub_mesh_pt!=0))
     } // for (i_mesh<max_mesh)
 
-    // Accumulate relevant flat-packed refinement data to be sent to
-    //--------------------------------------------------------------
+    // Accumulate relevant compact refinement data to be sent to
+    //----------------------------------------------------------
     // various processors
     //-------------------
 
@@ -18651,197 +20900,77 @@ namespace oomph
         // If it stays local, deal with it here
         if (int(new_domain) == my_rank)
         {
-          // Record on which other procs/domains the refinement info for
-          // this element is required because it's haloed.
-          unsigned nhalo = halo_domains[e].size();
-          halo_domain_of_haloed_base_element[e].resize(nhalo);
-          for (unsigned j = 0; j < nhalo; j++)
-          {
-            halo_domain_of_haloed_base_element[e][j] = halo_domains[e][j];
-          }
-
-          // Provide storage for refinement pattern
-          refinement_info_for_root_elements[e].resize(
-            max_refinement_level_overall);
-
-#ifdef PARANOID
-          // Get number of additional data sent for check
-          unsigned n_additional_data =
-            flat_packed_refinement_info_for_root[e].size();
-#endif
-
-          // Get number of tree nodes
-          unsigned n_tree_nodes = flat_packed_refinement_info_for_root[e][0];
-
-          // Counter for entries to be processed locally
-          unsigned local_count = 1; // (have already processed zero-th entry)
-
-          // Loop over levels and number of nodes in tree
-          for (unsigned level = 0; level < max_refinement_level_overall;
-               level++)
-          {
-            for (unsigned ee = 0; ee < n_tree_nodes; ee++)
-            {
-              // Element exists at this level
-              if (flat_packed_refinement_info_for_root[e][local_count] == 1)
-              {
-                local_count++;
-
-                // Element should be refined
-                if (flat_packed_refinement_info_for_root[e][local_count] == 1)
-                {
-                  refinement_info_for_root_elements[e][level].push_back(2);
-                  local_count++;
-                }
-                // Element should not be refined
-                else
-                {
-                  refinement_info_for_root_elements[e][level].push_back(1);
-                  local_count++;
-                }
-              }
-              // Element does not exist at this level
-              else
-              {
-                refinement_info_for_root_elements[e][level].push_back(0);
-                local_count++;
-              }
-            }
-          }
+          // Expand the refinement pattern
+          unsigned n_data = get_refinement_info_from_compact_pattern(
+            &flat_packed_refinement_info_for_root[e][0],
+            max_refinement_level_overall,
+            refinement_info_for_root_elements[e]);
 
 #ifdef PARANOID
-          if (n_additional_data != local_count)
+          if (n_data != flat_packed_refinement_info_for_root[e].size())
           {
             std::stringstream error_message;
-            error_message << "Number of additional data: " << n_additional_data
-                          << " doesn't match that actually send: "
-                          << local_count << std::endl;
+            error_message << "Number of additional data: "
+                          << flat_packed_refinement_info_for_root[e].size()
+                          << " doesn't match that actually send: " << n_data
+                          << std::endl;
             throw OomphLibError(error_message.str(),
                                 OOMPH_CURRENT_FUNCTION,
                                 OOMPH_EXCEPTION_LOCATION);
           }
 #endif
-        }
-        // Element in question is not one of mine so prepare for sending
-        //--------------------------------------------------------------
-        else
-        {
-          // Make space
-          unsigned current_size = data_for_proc[new_domain].size();
-          unsigned n_additional_data =
-            flat_packed_refinement_info_for_root[e].size();
-          data_for_proc[new_domain].reserve(current_size + n_additional_data +
-                                            2);
-
-          // Keep counting
-          count += n_additional_data + 2;
-
-          // Add base element number
-          data_for_proc[new_domain].push_back(e);
-
-#ifdef PARANOID
-          // Add number of flat-packed instructions to follow
-          data_for_proc[new_domain].push_back(n_additional_data);
-#endif
 
-          // Add flat packed refinement data
-          for (unsigned j = 0; j < n_additional_data; j++)
+          // Keep the compact form if it has to be forwarded to the
+          // procs/domains that hold halo copies of the element
+          if (halo_domains[e].size() > 0)
           {
-            data_for_proc[new_domain].push_back(
-              flat_packed_refinement_info_for_root[e][j]);
+            compact_refinement_info_for_haloed[e].assign(
+              flat_packed_refinement_info_for_root[e].begin(),
+              flat_packed_refinement_info_for_root[e].begin() + n_data);
           }
         }
-      }
-    }
-
-
-    // Now do the actual send/receive
-    //-------------------------------
-
-    // Storage for number of data to be sent to each processor
-    Vector<int> send_n(n_proc, 0);
-
-    // Storage for all values to be sent to all processors
-    Vector<unsigned> send_data;
-    send_data.reserve(count);
-
-    // Start location within send_data for data to be sent to each processor
-    Vector<int> send_displacement(n_proc, 0);
-
-    // Loop over all processors
-    for (int rank = 0; rank < n_proc; rank++)
-    {
-      // Set the offset for the current processor
-      send_displacement[rank] = send_data.size();
-
-      // Don't bother to do anything if the processor in the loop is the
-      // current processor
-      if (rank != my_rank)
-      {
-        // Record how many base elements are to be sent
-        send_data.push_back(nbase_elements_for_proc[rank]);
-
-        // Add data
-        unsigned n_data = data_for_proc[rank].size();
-        for (unsigned j = 0; j < n_data; j++)
+        // Element in question is not one of mine so prepare for sending
+        //--------------------------------------------------------------
+        else
         {
-          send_data.push_back(data_for_proc[rank][j]);
-        }
-      }
-
-      // Find the number of data added to the vector
-      send_n[rank] = send_data.size() - send_displacement[rank];
-    }
-
-    // Storage for the number of data to be received from each processor
-    Vector<int> receive_n(n_proc, 0);
+          // Make space
+          unsigned current_size = data_for_proc[new_domain].size();
+          unsigned n_additional_data =
+            flat_packed_refinement_info_for_root[e].size();
+          data_for_proc[new_domain].reserve(current_size + n_additional_data +
+                                            2);
 
-    // Now send numbers of data to be sent between all processors
-    MPI_Alltoall(&send_n[0],
-                 1,
-                 MPI_INT,
-                 &receive_n[0],
-                 1,
-                 MPI_INT,
-                 this->communicator_pt()->mpi_comm());
+          // Keep counting
+          count += n_additional_data + 2;
 
-    // We now prepare the data to be received
-    // by working out the displacements from the received data
-    Vector<int> receive_displacement(n_proc, 0);
-    int receive_data_count = 0;
-    for (int rank = 0; rank < n_proc; ++rank)
-    {
-      // Displacement is number of data received so far
-      receive_displacement[rank] = receive_data_count;
-      receive_data_count += receive_n[rank];
-    }
+          // Add base element number
+          data_for_proc[new_domain].push_back(e);
 
-    // Now resize the receive buffer for all data from all processors
-    // Make sure that it has a size of at least one
-    if (receive_data_count == 0)
-    {
-      ++receive_data_count;
-    }
-    Vector<unsigned> receive_data(receive_data_count);
+#ifdef PARANOID
+          // Add number of compact instructions to follow
+          data_for_proc[new_domain].push_back(n_additional_data);
+#endif
 
-    // Make sure that the send buffer has size at least one
-    // so that we don't get a segmentation fault
-    if (send_data.size() == 0)
-    {
-      send_data.resize(1);
+          // Add compact refinement data
+          data_for_proc[new_domain].insert(
+            data_for_proc[new_domain].end(),
+            flat_packed_refinement_info_for_root[e].begin(),
+            flat_packed_refinement_info_for_root[e].end());
+        }
+      }
     }
 
-    // Now send the data between all the processors
-    MPI_Alltoallv(&send_data[0],
-                  &send_n[0],
-                  &send_displacement[0],
-                  MPI_UNSIGNED,
-                  &receive_data[0],
-                  &receive_n[0],
-                  &receive_displacement[0],
-                  MPI_UNSIGNED,
-                  this->communicator_pt()->mpi_comm());
-
+    // Now do the actual send/receive
+    //-------------------------------
+    Vector<unsigned> receive_data;
+    Vector<int> receive_n;
+    Vector<int> receive_displacement;
+    send_compact_refinement_info_helper(nbase_elements_for_proc,
+                                        data_for_proc,
+                                        count,
+                                        receive_data,
+                                        receive_n,
+                                        receive_displacement);
 
     // Now use the received data to update
     //-----------------------------------
@@ -18863,109 +20992,48 @@ namespace oomph
           unsigned base_element_number = receive_data[count];
           count++;
 
-          // Record on which other procs/domains the refinement info for
-          // this element is required because it's haloed.
-          unsigned nhalo = halo_domains[base_element_number].size();
-          halo_domain_of_haloed_base_element[base_element_number].resize(nhalo);
-          for (unsigned j = 0; j < nhalo; j++)
-          {
-            halo_domain_of_haloed_base_element[base_element_number][j] =
-              halo_domains[base_element_number][j];
-          }
-
-          // Provide storage for refinement pattern
-          refinement_info_for_root_elements[base_element_number].resize(
-            max_refinement_level_overall);
-
-          // Get number of flat-packed instructions to follow
+          // Get number of compact instructions to follow
           // (only used for check)
 #ifdef PARANOID
           unsigned n_additional_data = receive_data[count];
           count++;
-
-          // Counter for number of additional data (validation only)
-          unsigned check_count = 0;
-#endif
-
-          // Get number of tree nodes
-          unsigned n_tree_nodes = receive_data[count];
-          count++;
-
-#ifdef PARANOID
-          check_count++;
-#endif
-
-          // Loop over levels and number of nodes in tree
-          for (unsigned level = 0; level < max_refinement_level_overall;
-               level++)
-          {
-            for (unsigned e = 0; e < n_tree_nodes; e++)
-            {
-              // Element exists at this level
-              if (receive_data[count] == 1)
-              {
-                count++;
-
-#ifdef PARANOID
-                check_count++;
-#endif
-
-                // Element should be refined
-                if (receive_data[count] == 1)
-                {
-                  refinement_info_for_root_elements[base_element_number][level]
-                    .push_back(2);
-                  count++;
-
-#ifdef PARANOID
-                  check_count++;
 #endif
-                }
-                // Element should not be refined
-                else
-                {
-                  refinement_info_for_root_elements[base_element_number][level]
-                    .push_back(1);
-                  count++;
-
-#ifdef PARANOID
-                  check_count++;
-#endif
-                }
-              }
-              // Element does not exist at this level
-              else
-              {
-                refinement_info_for_root_elements[base_element_number][level]
-                  .push_back(0);
-                count++;
 
-#ifdef PARANOID
-                check_count++;
-#endif
-              }
-            }
-          }
+          // Expand the refinement pattern
+          unsigned n_data = get_refinement_info_from_compact_pattern(
+            &receive_data[count],
+            max_refinement_level_overall,
+            refinement_info_for_root_elements[base_element_number]);
 
 #ifdef PARANOID
-          if (n_additional_data != check_count)
+          if (n_additional_data != n_data)
           {
             std::stringstream error_message;
             error_message << "Number of additional data: " << n_additional_data
-                          << " doesn't match that actually send: "
-                          << check_count << std::endl;
+                          << " doesn't match that actually send: " << n_data
+                          << std::endl;
             throw OomphLibError(error_message.str(),
                                 OOMPH_CURRENT_FUNCTION,
                                 OOMPH_EXCEPTION_LOCATION);
           }
 #endif
+
+          // Keep the compact form if it has to be forwarded to the
+          // procs/domains that hold halo copies of the element
+          if (halo_domains[base_element_number].size() > 0)
+          {
+            compact_refinement_info_for_haloed[base_element_number].assign(
+              receive_data.begin() + count,
+              receive_data.begin() + count + n_data);
+          }
+          count += n_data;
         }
       }
     }
 
 
-    // Now send the fully assembled refinement info to halo elements
-    //---------------------------------------------------------------
+    // Now forward the compact refinement info to the halo elements
+    //--------------------------------------------------------------
     {
       // Accumulate data to be sent
       //---------------------------
@@ -18977,18 +21045,21 @@ namespace oomph
       // Number of base elements to be sent to specified domain
       Vector<unsigned> nbase_elements_for_proc(n_proc, 0);
 
+      // Total number of entries in send vector
+      unsigned count = 0;
+
       // Loop over all haloed root elements and find out which
       // processors they have haloes on
       for (std::map<unsigned, Vector<unsigned>>::iterator it =
-             halo_domain_of_haloed_base_element.begin();
-           it != halo_domain_of_haloed_base_element.end();
+             compact_refinement_info_for_haloed.begin();
+           it != compact_refinement_info_for_haloed.end();
            it++)
       {
         // Get base element number
         unsigned base_element_number = (*it).first;
 
         // Loop over target domains
-        Vector<unsigned> domains = (*it).second;
+        Vector<unsigned>& domains = halo_domains[base_element_number];
         unsigned nd = domains.size();
         for (unsigned jd = 0; jd < nd; jd++)
         {
@@ -18998,115 +21069,25 @@ namespace oomph
           // Keep counting number of base elemements for domain
           nbase_elements_for_proc[d]++;
 
-          // Write base element number
+          // Write base element number and compact refinement info
           data_for_proc[d].push_back(base_element_number);
-
-          // Write refinement info in flat-packed form
-          for (unsigned level = 0; level < max_refinement_level_overall;
-               level++)
-          {
-            // Number of entries at each level
-            unsigned n =
-              refinement_info_for_root_elements[base_element_number][level]
-                .size();
-            data_for_proc[d].push_back(n);
-            for (unsigned j = 0; j < n; j++)
-            {
-              data_for_proc[d].push_back(
-                refinement_info_for_root_elements[base_element_number][level]
-                                                 [j]);
-            }
-          }
+          data_for_proc[d].insert(
+            data_for_proc[d].end(), (*it).second.begin(), (*it).second.end());
+          count += (*it).second.size() + 1;
         }
       }
 
-
       // Do the actual send
       //-------------------
-
-      // Storage for number of data to be sent to each processor
-      Vector<int> send_n(n_proc, 0);
-
-      // Storage for all values to be sent to all processors
-      Vector<unsigned> send_data;
-      send_data.reserve(count);
-
-      // Start location within send_data for data to be sent to each processor
-      Vector<int> send_displacement(n_proc, 0);
-
-      // Loop over all processors
-      for (int rank = 0; rank < n_proc; rank++)
-      {
-        // Set the offset for the current processor
-        send_displacement[rank] = send_data.size();
-
-        // Don't bother to do anything if the processor in the loop is the
-        // current processor
-        if (rank != my_rank)
-        {
-          // Record how many base elements are to be sent
-          send_data.push_back(nbase_elements_for_proc[rank]);
-
-          // Add data
-          unsigned n_data = data_for_proc[rank].size();
-          for (unsigned j = 0; j < n_data; j++)
-          {
-            send_data.push_back(data_for_proc[rank][j]);
-          }
-        }
-        // Find the number of data added to the vector
-        send_n[rank] = send_data.size() - send_displacement[rank];
-      }
-
-      // Storage for the number of data to be received from each processor
-      Vector<int> receive_n(n_proc, 0);
-
-      // Now send numbers of data to be sent between all processors
-      MPI_Alltoall(&send_n[0],
-                   1,
-                   MPI_INT,
-                   &receive_n[0],
-                   1,
-                   MPI_INT,
-                   this->communicator_pt()->mpi_comm());
-
-      // We now prepare the data to be received
-      // by working out the displacements from the received data
-      Vector<int> receive_displacement(n_proc, 0);
-      int receive_data_count = 0;
-      for (int rank = 0; rank < n_proc; ++rank)
-      {
-        // Displacement is number of data received so far
-        receive_displacement[rank] = receive_data_count;
-        receive_data_count += receive_n[rank];
-      }
-
-      // Now resize the receive buffer for all data from all processors
-      // Make sure that it has a size of at least one
-      if (receive_data_count == 0)
-      {
-        ++receive_data_count;
-      }
-      Vector<unsigned> receive_data(receive_data_count);
-
-      // Make sure that the send buffer has size at least one
-      // so that we don't get a segmentation fault
-      if (send_data.size() == 0)
-      {
-        send_data.resize(1);
-      }
-
-      // Now send the data between all the processors
-      MPI_Alltoallv(&send_data[0],
-                    &send_n[0],
-                    &send_displacement[0],
-                    MPI_UNSIGNED,
-                    &receive_data[0],
-                    &receive_n[0],
-                    &receive_displacement[0],
-                    MPI_UNSIGNED,
-                    this->communicator_pt()->mpi_comm());
-
+      Vector<unsigned> receive_data;
+      Vector<int> receive_n;
+      Vector<int> receive_displacement;
+      send_compact_refinement_info_helper(nbase_elements_for_proc,
+                                          data_for_proc,
+                                          count,
+                                          receive_data,
+                                          receive_n,
+                                          receive_displacement);
 
       // Now use the received data
       //------------------------
@@ -19129,30 +21110,125 @@ namespace oomph
             unsigned base_element_number = receive_data[count];
             count++;
 
-            // Provide storage for refinement pattern
-            refinement_info_for_root_elements[base_element_number].resize(
-              max_refinement_level_overall);
+            // Expand the refinement pattern
+            count += get_refinement_info_from_compact_pattern(
+              &receive_data[count],
+              max_refinement_level_overall,
+              refinement_info_for_root_elements[base_element_number]);
+          }
+        }
+      }
+    }
+  }
+
 
-            // Read refinement info in flat-packed form
-            for (unsigned level = 0; level < max_refinement_level_overall;
-                 level++)
-            {
-              // Read number of entries at each level
-              unsigned n = receive_data[count];
-              count++;
+  //==========================================================================
+  /// Load balance helper routine: Exchange the compact refinement data
+  /// in data_for_proc[rank] (preceded by the number of base elements
+  /// nbase_elements_for_proc[rank] they refer to) between all
+  /// processors in a single personalised all-to-all communication.
+  /// count is the total number of data (used to reserve storage).
+  /// The data received from processor rank start at
+  /// receive_data[receive_displacement[rank]]; there are
+  /// receive_n[rank] of them.
+  //==========================================================================
+  void Problem::send_compact_refinement_info_helper(
+    const Vector<unsigned>& nbase_elements_for_proc,
+    std::map<unsigned, Vector<unsigned>>& data_for_proc,
+    const unsigned& count,
+    Vector<unsigned>& receive_data,
+    Vector<int>& receive_n,
+    Vector<int>& receive_displacement)
+  {
+    // Number of processes etc.
+    const int n_proc = this->communicator_pt()->nproc();
+    const int my_rank = this->communicator_pt()->my_rank();
 
-              // Read entries
-              for (unsigned j = 0; j < n; j++)
-              {
-                refinement_info_for_root_elements[base_element_number][level]
-                  .push_back(receive_data[count]);
-                count++;
-              }
-            }
-          }
+    // Storage for number of data to be sent to each processor
+    Vector<int> send_n(n_proc, 0);
+
+    // Storage for all values to be sent to all processors
+    Vector<unsigned> send_data;
+    send_data.reserve(count + n_proc);
+
+    // Start location within send_data for data to be sent to each processor
+    Vector<int> send_displacement(n_proc, 0);
+
+    // Loop over all processors
+    for (int rank = 0; rank < n_proc; rank++)
+    {
+      // Set the offset for the current processor
+      send_displacement[rank] = send_data.size();
+
+      // Don't bother to do anything if the processor in the loop is the
+      // current processor
+      if (rank != my_rank)
+      {
+        // Record how many base elements are to be sent
+        send_data.push_back(nbase_elements_for_proc[rank]);
+
+        // Add data
+        std::map<unsigned, Vector<unsigned>>::iterator it =
+          data_for_proc.find(rank);
+        if (it != data_for_proc.end())
+        {
+          send_data.insert(
+            send_data.end(), (*it).second.begin(), (*it).second.end());
         }
       }
+
+      // Find the number of data added to the vector
+      send_n[rank] = send_data.size() - send_displacement[rank];
+    }
+
+    // Storage for the number of data to be received from each processor
+    receive_n.assign(n_proc, 0);
+
+    // Now send numbers of data to be sent between all processors
+    MPI_Alltoall(&send_n[0],
+                 1,
+                 MPI_INT,
+                 &receive_n[0],
+                 1,
+                 MPI_INT,
+                 this->communicator_pt()->mpi_comm());
+
+    // We now prepare the data to be received
+    // by working out the displacements from the received data
+    receive_displacement.assign(n_proc, 0);
+    int receive_data_count = 0;
+    for (int rank = 0; rank < n_proc; ++rank)
+    {
+      // Displacement is number of data received so far
+      receive_displacement[rank] = receive_data_count;
+      receive_data_count += receive_n[rank];
+    }
+
+    // Now resize the receive buffer for all data from all processors
+    // Make sure that it has a size of at least one
+    if (receive_data_count == 0)
+    {
+      ++receive_data_count;
+    }
+    receive_data.resize(receive_data_count);
+
+    // Make sure that the send buffer has size at least one
+    // so that we don't get a segmentation fault
+    if (send_data.size() == 0)
+    {
+      send_data.resize(1);
     }
+
+    // Now send the data between all the processors
+    MPI_Alltoallv(&send_data[0],
+                  &send_n[0],
+                  &send_displacement[0],
+                  MPI_UNSIGNED,
+                  &receive_data[0],
+                  &receive_n[0],
+                  &receive_displacement[0],
+                  MPI_UNSIGNED,
+                  this->communicator_pt()->mpi_comm());
   }
 
   //==========================================================================
@@ -19223,12 +21299,13 @@ namespace oomph
 
     unsigned el_count = 0;
 
-    // Only do each node once
-    Vector<std::map<Node*, bool>> node_done(n_proc);
-
     // Now use the received data to update the halo nodes
     for (int send_rank = 0; send_rank < n_proc; send_rank++)
     {
+      // Only do each node once (per processor): Nodes that have been
+      // done are marked with this visit stamp
+      const unsigned node_done_stamp = Data::new_visit_stamp();
+
       // Don't bother to do anything if no data were received from this
       // processor
       // NOTE: We do have to loop over our own processor number to process
@@ -19328,10 +21405,8 @@ namespace oomph
               for (unsigned j = 0; j < nnod; j++)
               {
                 Node* nod_pt = fe_pt->node_pt(j);
-                if (!node_done[send_rank][nod_pt])
+                if (nod_pt->mark_visited(node_done_stamp))
                 {
-                  node_done[send_rank][nod_pt] = true;
-
 
                   // Read number of values (as double) to allow for resizing
                   // before read (req'd in case we store data that
@@ -19456,6 +21531,9 @@ namespace oomph
           }
         }
       }
+
+      // The traversal for this processor is complete
+      Data::release_visit_stamp(node_done_stamp);
     }
 
     // Now that this is done, we need to synchronise dofs to get
@@ -19853,14 +21931,15 @@ namespace oomph
     //--------------------------------------------------------
     send_data.clear();
 
-    // Only do each node once (per processor!)
-    Vector<std::map<Node*, bool>> node_done(n_proc);
-
     // Loop over all processors. NOTE: We include current processor
     // since we have to refine local elements too -- store their data
     // in same data structure as the one used for off-processor elements.
     for (int rank = 0; rank < n_proc; rank++)
     {
+      // Only do each node once (per processor!): Nodes that have been
+      // done are marked with this visit stamp
+      const unsigned node_done_stamp = Data::new_visit_stamp();
+
       // Set the offset for the current processor
       send_displacement[rank] = send_data.size();
 
@@ -19935,12 +22014,10 @@ namespace oomph
               }
 
 
-              // Has the node already been done for current rank?
-              if (!node_done[rank][nod_pt])
+              // Has the node already been done for current rank? (If not,
+              // it is now marked as done.)
+              if (nod_pt->mark_visited(node_done_stamp))
               {
-                // Now it has been done
-                node_done[rank][nod_pt] = true;
-
                 // Store number of values (as double) to allow for resizing
                 // before read (req'd in case we store data that
                 // got introduced by attaching FaceElements to bulk)
@@ -20024,6 +22101,9 @@ namespace oomph
       }
 #endif
 
+      // The traversal for this processor is complete
+      Data::release_visit_stamp(node_done_stamp);
+
       // Find the number of data added to the vector
       send_n[rank] = send_data.size() - send_displacement[rank];
     }
@@ -20031,28 +22111,25 @@ namespace oomph
 
 
   //==========================================================================
-  /// Get flat-packed refinement pattern for each root element in current
+  /// Get compact refinement pattern for each root element in current
   /// mesh (labeled by unique number of root element in unrefined base mesh).
   /// The vector stored for each root element contains the following
   /// information:
-  /// - First entry: Number of tree nodes (not just leaves!) in refinement
-  ///   tree emanating from this root [Zero if root element is not refineable]
-  /// - Loop over all refinement levels
-  ///   - Loop over all tree nodes (not just leaves!)
-  ///     - If associated element exists when the mesh has been refined to
-  ///       this level (either because it has been refined to this level or
-  ///       because it's less refined): 1
-  ///       - If the element is to be refined: 1; else: 0
-  ///     - else (element doesn't exist when mesh is refined to this level
-  ///       (because it's more refined): 0
-  ///     .
-  ///   .
+  /// - First entry: Number of sons of a refined tree node [Zero if root
+  ///   element is not refineable; nothing else follows]
+  /// - Second entry: Number of tree nodes (not just leaves!) in refinement
+  ///   tree emanating from this root
+  /// - The refinement tree as a bitstream, packed into unsigneds: One bit
+  ///   for each tree node (visited depth-first, sons in the order of their
+  ///   son types, as in Tree::stick_all_tree_nodes_into_vector(...)); 1 if
+  ///   the tree node has been split, 0 if it's a leaf.
   /// .
+  /// This is decoded (in a single pass through the tree) by
+  /// get_refinement_info_from_compact_pattern(...).
   //==========================================================================
   void Problem::get_flat_packed_refinement_pattern_for_load_balancing(
     const Vector<unsigned>& old_domain_for_base_element,
     const Vector<unsigned>& new_domain_for_base_element,
-    const unsigned& max_refinement_level_overall,
     std::map<unsigned, Vector<unsigned>>& flat_packed_refinement_info_for_root)
   {
     // Map to store whether the root element has been visited yet
@@ -20126,63 +22203,11 @@ namespace oomph
 #endif
                 root_element_number -= 1;
 
-                // Get all the nodes associated with this root element
-                Vector<Tree*> all_tree_nodes_pt;
-                root_el_pt->tree_pt()->stick_all_tree_nodes_into_vector(
-                  all_tree_nodes_pt);
-
-                // How many tree nodes are there?
-                unsigned n_tree_nodes = all_tree_nodes_pt.size();
-                flat_packed_refinement_info_for_root[root_element_number]
-                  .push_back(n_tree_nodes);
-
-                // Loop over all levels
-                for (unsigned current_level = 0;
-                     current_level < max_refinement_level_overall;
-                     current_level++)
-                {
-                  // Loop over all tree nodes
-                  for (unsigned e = 0; e < n_tree_nodes; e++)
-                  {
-                    // What's the level of this tree node?
-                    unsigned level = all_tree_nodes_pt[e]->level();
-
-                    // Element exists at this refinement level of the mesh
-                    // if it's at this level or it's at a lower level and a leaf
-                    if ((level == current_level) ||
-                        ((level < current_level) &&
-                         (all_tree_nodes_pt[e]->is_leaf())))
-                    {
-                      flat_packed_refinement_info_for_root[root_element_number]
-                        .push_back(1);
+                // Encode the refinement tree emanating from this root
+                add_compact_refinement_pattern(
+                  root_el_pt->tree_pt(),
+                  flat_packed_refinement_info_for_root[root_element_number]);
 
-                      // If it's at this level, and not a leaf, then it will
-                      // need to be refined in the new mesh
-                      if ((level == current_level) &&
-                          (!all_tree_nodes_pt[e]->is_leaf()))
-                      {
-                        flat_packed_refinement_info_for_root
-                          [root_element_number]
-                            .push_back(1);
-                      }
-                      // Element exists at this level and is a leaf so it
-                      // doesn't have to be refined
-                      else
-                      {
-                        flat_packed_refinement_info_for_root
-                          [root_element_number]
-                            .push_back(0);
-                      }
-                    }
-                    // Element does not exist at this level so it doesn't have
-                    // to be refined
-                    else
-                    {
-                      flat_packed_refinement_info_for_root[root_element_number]
-                        .push_back(0);
-                    }
-                  }
-                }
                 // Now we've done it
                 root_el_done[root_el_pt] = true;
               }
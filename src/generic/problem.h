@@ -45,6 +45,7 @@
 #include "generalised_timesteppers.h"
 #include "explicit_timesteppers.h"
 #include "double_vector_with_halo.h"
+#include "mesh.h"
 #include <complex>
 #include <map>
 
@@ -81,6 +82,9 @@ namespace oomph
   // Forward definition for the Eigensolver class
   class EigenSolver;
 
+  // Forward definition for the Preconditioner class
+  class Preconditioner;
+
   // Forward definition for the assembly handler
   class AssemblyHandler;
 
@@ -92,6 +96,137 @@ namespace oomph
   /// //////////////////////////////////////////////////////////////////
 
 
+  //=======================================================================
+  /// Visitor used by Problem::get_jacobian_by_element_type<ELEMENT>(...):
+  /// Computes the residuals and the Jacobian of the elements it's given
+  /// and adds them to the global residuals and the rows of the global
+  /// Jacobian. The contributions of elements of type ELEMENT are computed
+  /// by a qualified (i.e. non-virtual) call to ELEMENT::get_jacobian(...),
+  /// those of any other elements through the virtual interface. The
+  /// contributions are scattered with the local-to-global equation
+  /// numbers in the mesh's local equation table (see
+  /// Mesh::setup_local_eqn_table(...)), which must be set up, as must the
+  /// mesh's element type groups.
+  //=======================================================================
+  template<class ELEMENT>
+  class ElementTypeJacobianAssembler
+  {
+  public:
+    /// Constructor: Pass the mesh that contains the elements, the
+    /// global residuals and the rows of the global Jacobian (maps from
+    /// the column index to the entry) to which the contributions are
+    /// added, and the magnitude below which entries of the elemental
+    /// Jacobians are ignored
+    ElementTypeJacobianAssembler(
+      Mesh* const& mesh_pt,
+      Vector<double>& residuals,
+      Vector<std::map<unsigned, double>>& jacobian_row,
+      const double& numerical_zero)
+      : Mesh_pt(mesh_pt),
+        Residuals(residuals),
+        Jacobian_row(jacobian_row),
+        Numerical_zero(numerical_zero),
+        Typed_group(0),
+        Ntyped_element_done(0)
+    {
+      // Find the element type group of the elements of type ELEMENT,
+      // whose numbers in the mesh are needed in the typed kernel
+      const unsigned n_group = Mesh_pt->nelement_type_group();
+      for (unsigned i_group = 0; i_group < n_group; i_group++)
+      {
+        if (Mesh_pt->element_type_in_group(i_group) == typeid(ELEMENT))
+        {
+          Typed_group = i_group;
+        }
+      }
+    }
+
+    /// Broken copy constructor
+    ElementTypeJacobianAssembler(const ElementTypeJacobianAssembler& dummy) =
+      delete;
+
+    /// Broken assignment operator
+    void operator=(const ElementTypeJacobianAssembler&) = delete;
+
+    /// Add the contribution of an element of type ELEMENT (typed
+    /// kernel). The elements must be passed in the order in which they're
+    /// stored in their element type group (as they are by
+    /// Mesh::visit_elements_of_type<ELEMENT>(...)).
+    void operator()(ELEMENT* const& el_pt)
+    {
+      const unsigned long e =
+        Mesh_pt->element_number_in_type_group(Typed_group,
+                                              Ntyped_element_done);
+      Ntyped_element_done++;
+      const unsigned n_dof = Mesh_pt->nlocal_eqn_in_table(e);
+      El_residuals.resize(n_dof);
+      El_jacobian.resize(n_dof, n_dof);
+      el_pt->ELEMENT::get_jacobian(El_residuals, El_jacobian);
+      add_to_global(Mesh_pt->local_to_global_eqn_pt(e), n_dof);
+    }
+
+    /// Add the contribution of the e-th element in the mesh, which may
+    /// be of any type (virtual interface)
+    void add_contribution(const unsigned long& e)
+    {
+      const unsigned n_dof = Mesh_pt->nlocal_eqn_in_table(e);
+      El_residuals.resize(n_dof);
+      El_jacobian.resize(n_dof, n_dof);
+      Mesh_pt->element_pt(e)->get_jacobian(El_residuals, El_jacobian);
+      add_to_global(Mesh_pt->local_to_global_eqn_pt(e), n_dof);
+    }
+
+  private:
+    /// Add the elemental residuals and Jacobian to the global ones,
+    /// given the global equation numbers of the element's local equations
+    void add_to_global(const unsigned long* const& global_eqn,
+                       const unsigned& n_dof)
+    {
+      for (unsigned i = 0; i < n_dof; i++)
+      {
+        const unsigned long eqn_number = global_eqn[i];
+        Residuals[eqn_number] += El_residuals[i];
+        for (unsigned j = 0; j < n_dof; j++)
+        {
+          // Only bother to add to the map if it's non-zero (as in the
+          // Problem's sparse assembly)
+          const double value = El_jacobian(i, j);
+          if (std::fabs(value) > Numerical_zero)
+          {
+            Jacobian_row[eqn_number][global_eqn[j]] += value;
+          }
+        }
+      }
+    }
+
+    /// The mesh that contains the elements
+    Mesh* Mesh_pt;
+
+    /// The global residuals
+    Vector<double>& Residuals;
+
+    /// The rows of the global Jacobian
+    Vector<std::map<unsigned, double>>& Jacobian_row;
+
+    /// Magnitude below which entries of the elemental Jacobians are
+    /// ignored
+    double Numerical_zero;
+
+    /// Storage for the elemental residuals
+    Vector<double> El_residuals;
+
+    /// Storage for the elemental Jacobian
+    DenseMatrix<double> El_jacobian;
+
+    /// Number of the element type group of the elements of type ELEMENT
+    unsigned Typed_group;
+
+    /// Number of elements of type ELEMENT whose contributions have been
+    /// added
+    unsigned long Ntyped_element_done;
+  };
+
+
   //=======================================================================
   /// The Problem class
   ///
@@ -160,6 +295,7 @@ namespace oomph
     friend class AugmentedBlockFoldLinearSolver;
     friend class AugmentedBlockPitchForkLinearSolver;
     friend class BlockHopfLinearSolver;
+    friend class ReducedOrderModel;
 
 
   private:
@@ -228,6 +364,85 @@ namespace oomph
     /// Use values from the time stepper predictor as an initial guess
     bool Use_predictor_values_as_initial_guess;
 
+    /// Extrapolate the initial guess for unsteady Newton solves from
+    /// the history values?
+    bool Use_extrapolated_initial_guess;
+
+    /// Degree of the polynomial used to extrapolate the initial guess
+    unsigned Extrapolation_degree;
+
+    /// Number of previous values used to extrapolate the initial guess
+    /// (least-squares fit if this exceeds Extrapolation_degree+1)
+    unsigned Nprev_value_for_extrapolation;
+
+    /// Use the library's dof-based temporal error norm in the default
+    /// global_temporal_error_norm()?
+    bool Use_dof_based_temporal_error_norm;
+
+    /// Absolute tolerance in the dof-based temporal error norm
+    double Temporal_error_absolute_tolerance;
+
+    /// Relative tolerance in the dof-based temporal error norm
+    double Temporal_error_relative_tolerance;
+
+    /// Weights of the nodal values (indexed by the value number) in the
+    /// dof-based temporal error norm; values beyond the end have weight 1
+    Vector<double> Temporal_error_nodal_value_weight;
+
+    /// Weight of the (SolidNode) positions in the dof-based temporal
+    /// error norm
+    double Temporal_error_position_weight;
+
+    /// Weight of the values in global and internal Data in the dof-based
+    /// temporal error norm
+    double Temporal_error_non_nodal_value_weight;
+
+    /// Is the lookup table for the dof-based temporal error norm
+    /// up to date? Reset whenever equation numbers are assigned.
+    bool Dof_based_temporal_error_table_is_up_to_date;
+
+    /// The Data that stores each (local) dof, for the dof-based temporal
+    /// error norm
+    Vector<Data*> Temporal_error_dof_data_pt;
+
+    /// The index of each (local) dof in its Data
+    Vector<unsigned> Temporal_error_dof_value_index;
+
+    /// The "field" of each (local) dof, for the weighting in the
+    /// dof-based temporal error norm: the value number for nodal values,
+    /// -1 for positions, -2 for values in global or internal Data
+    Vector<int> Temporal_error_dof_field;
+
+    /// Set up the lookup tables for the dof-based temporal error norm
+    void setup_dof_based_temporal_error_table();
+
+    /// Use pipelined preconditioner setup in the Newton solver?
+    bool Use_pipelined_preconditioner_setup;
+
+    /// The two preconditioners that take turns in the pipelined
+    /// preconditioner setup (the iterative linear solver's own
+    /// preconditioner and the user-specified one)
+    Preconditioner* Pipelined_preconditioner_pt[2];
+
+    /// The Jacobians from which the two preconditioners in the pipelined
+    /// setup were last set up (kept alive while they're in use)
+    CRDoubleMatrix* Pipelined_preconditioner_matrix_pt[2];
+
+    /// Index of the preconditioner (in Pipelined_preconditioner_pt) that
+    /// is used in the next linear solve
+    unsigned Active_pipelined_preconditioner;
+
+    /// Has the active preconditioner in the pipelined setup been set up
+    /// for the present equation numbering?
+    bool Pipelined_preconditioner_is_set_up;
+
+    /// Solve the linear system in a Newton iteration with the pipelined
+    /// preconditioner setup
+    void pipelined_linear_solve(DoubleVector& dx);
+
+    /// Delete the Jacobians kept for the pipelined preconditioner setup
+    void clean_up_pipelined_preconditioner_setup();
+
   protected:
     /// Vector of pointers to copies of the problem used in adaptive
     /// bifurcation tracking problems (ALH: TEMPORARY HACK, WILL BE FIXED)
@@ -243,6 +458,10 @@ namespace oomph
     /// differences will be used
     bool Calculate_hessian_products_analytic;
 
+    /// Compute the elements' (analytic) Hessian-vector products
+    /// concurrently? Default: false
+    bool Use_threaded_hessian_products;
+
   public:
     /// Hook for debugging. Can be overloaded in driver code; argument
     /// allows identification of where we're coming from
@@ -305,6 +524,25 @@ namespace oomph
       return Calculate_hessian_products_analytic;
     }
 
+    /// Compute the elements' contributions to the analytic Hessian-vector
+    /// products concurrently (using OpenMP, if the library is compiled
+    /// with it). Each element's products are stored separately and
+    /// added to the global vectors in the order of the elements, so the
+    /// result is bitwise identical for any number of threads. The
+    /// elements' get_hessian_vector_products(...) must not modify any
+    /// shared (e.g. static) storage.
+    void enable_threaded_hessian_products()
+    {
+      Use_threaded_hessian_products = true;
+    }
+
+    /// Compute the elements' contributions to the analytic Hessian-vector
+    /// products in turn (the default)
+    void disable_threaded_hessian_products()
+    {
+      Use_threaded_hessian_products = false;
+    }
+
     /// Set all pinned values to zero.
     /// Used to set boundary conditions to be homogeneous in the copy
     /// of the problem  used in adaptive bifurcation tracking
@@ -365,6 +603,27 @@ namespace oomph
       Vector<double*>& residual,
       bool compressed_row_flag);
 
+    /// Private helper function for the assembly with vectors of pairs:
+    /// Add the contribution of the element to the residuals vectors
+    /// and the vectors of pairs that store the matrices.
+    void add_element_contribution_to_vectors_of_pairs(
+      GeneralisedElement* const& elem_pt,
+      Vector<Vector<double>>& el_residuals,
+      Vector<DenseMatrix<double>>& el_jacobian,
+      Vector<Vector<Vector<std::pair<unsigned, double>>>>& matrix_data,
+      Vector<double*>& residuals,
+      const bool& compressed_row_flag);
+
+    /// Private helper function for the coloured assembly: Add all Data
+    /// involved in the computation of the element's residuals and
+    /// Jacobian to the vector (which may then contain duplicates).
+    void identify_data_for_coloured_assembly(
+      GeneralisedElement* const& elem_pt, Vector<Data*>& data_pt) const;
+
+    /// Colour the elements in the global mesh so that no two elements
+    /// of the same colour share any Data; used by the coloured assembly.
+    void setup_coloured_assembly();
+
     /// Private helper function that is used to assemble the Jacobian
     /// matrix in the case when the storage is row or column compressed.
     /// The boolean Flag indicates
@@ -553,6 +812,10 @@ namespace oomph
     /// Vector of pointers to dofs
     Vector<double*> Dof_pt;
 
+    /// Pointers to the history indices of the timesteppers of the Data
+    /// that store the (local) dofs. Set up on demand by dof_pt(t,i).
+    Vector<const TimeHistoryIndex*> Dof_history_index_pt;
+
     /// Counter that records how many elements contribute to each dof.
     /// Used to determine the (discrete) arc-length automatically.
     /// It really should be an integer, but is a double so that the
@@ -621,6 +884,14 @@ namespace oomph
     /// if required)? Default: false
     bool Jacobian_has_been_computed;
 
+    /// Does the linear solver hold the factorisation of the Jacobian
+    /// at the current dofs, i.e. was the Jacobian recomputed (not re-used)
+    /// in the last iteration of the last Newton solve, with resolve
+    /// enabled? Reset whenever the dofs, the equation numbering or the
+    /// time history change under the control of the Problem. Default:
+    /// false
+    bool Jacobian_factorisation_is_current;
+
     /// Boolean flag indicating if we're dealing with a linear or
     /// nonlinear Problem -- if set to false the Newton solver will not check
     /// the residual before or after the linear solve. Set to true by default;
@@ -640,6 +911,25 @@ namespace oomph
     /// By default we use assembly by vectors of pairs.
     unsigned Sparse_assembly_method;
 
+    /// Use the coloured (threaded) assembly for the assembly by vectors
+    /// of pairs? Default: false
+    bool Use_coloured_assembly;
+
+    /// Is the colouring of the elements for the coloured assembly
+    /// up to date? Reset whenever equation numbers are assigned.
+    bool Coloured_assembly_is_up_to_date;
+
+    /// Is Dof_history_index_pt up to date? Reset whenever equation
+    /// numbers are assigned.
+    bool Dof_history_index_is_up_to_date;
+
+    /// Numbers of the elements in the global mesh, sorted by colour
+    Vector<unsigned long> Coloured_assembly_element_index;
+
+    /// Index of the first entry for each colour in
+    /// Coloured_assembly_element_index (with an extra entry at the end)
+    Vector<unsigned long> Coloured_assembly_colour_start;
+
     /// Enumerated flags to determine which sparse assembly method is used
     enum Assembly_method
     {
@@ -684,6 +974,11 @@ namespace oomph
 
     double FD_step_used_in_get_hessian_vector_products;
 
+    /// Pointers to the global parameters with respect to which the
+    /// gradient of the output functional is computed in
+    /// get_output_functional_gradient()
+    Vector<double*> Sensitivity_parameter_pt;
+
     //---------------------Explicit time-stepping parameters
 
     /// Is re-use of the mass matrix in explicit timestepping enabled
@@ -819,6 +1114,39 @@ namespace oomph
     /// derivatievs
     bool Use_finite_differences_for_continuation_derivatives;
 
+    /// Boolean to control whether the arc-length step is also limited by
+    /// the curvature of the solution branch
+    bool Use_curvature_based_arc_length_control;
+
+    /// Desired angle (in the arc-length metric) between the tangents to
+    /// the solution branch at the beginning and the end of a step
+    double Desired_continuation_angle;
+
+    /// Estimate of the curvature of the solution branch (angle between
+    /// the tangents at the beginning and the end of the last step,
+    /// divided by its arc-length); negative if not available
+    double Continuation_curvature;
+
+    /// Boolean to control whether the linear solver retains the
+    /// factorisation of the Jacobian from the last corrector iteration in
+    /// a continuation step so that it can be re-used when the tangent has
+    /// to be computed by a linear solve
+    bool Reuse_factorisation_for_continuation_tangent;
+
+    /// Is the factorisation from the last corrector iteration of a
+    /// continuation step available in the linear solver?
+    bool Continuation_factorisation_is_available;
+
+    /// Was resolve enabled in the linear solver before the factorisation
+    /// from the last corrector iteration was retained? (The setting is
+    /// restored once the factorisation has been used or discarded.)
+    bool Resolve_enabled_before_continuation_factorisation;
+
+    /// Discard the factorisation retained from the last corrector
+    /// iteration of a continuation step (if any) and restore the
+    /// linear solver's resolve setting
+    void discard_continuation_factorisation();
+
   public:
     /// If we have MPI return the "problem has been distributed" flag,
     /// otherwise it can't be distributed so return false.
@@ -917,27 +1245,21 @@ namespace oomph
       Vector<unsigned>& new_domain_for_base_element,
       unsigned& max_refinement_level_overall);
 
-    /// Get flat-packed refinement pattern for each root element in
+    /// Get compact refinement pattern for each root element in
     /// current mesh (labeled by unique number of root element in unrefined base
     /// mesh). The vector stored for each root element contains the following
     /// information:
-    /// - First entry: Number of tree nodes (not just leaves!) in refinement
-    ///   tree emanating from this root [Zero if root element is not refineable]
-    /// - Loop over all refinement levels
-    ///   - Loop over all tree nodes (not just leaves!)
-    ///     - If associated element exists when the mesh has been refined to
-    ///       this level (either because it has been refined to this level or
-    ///       because it's less refined): 1
-    ///       - If the element is to be refined: 1; else: 0
-    ///     - else (element doesn't exist when mesh is refined to this level
-    ///       (because it's more refined): 0
-    ///     .
-    ///   .
+    /// - First entry: Number of sons of a refined tree node [Zero if root
+    ///   element is not refineable; nothing else follows]
+    /// - Second entry: Number of tree nodes (not just leaves!) in refinement
+    ///   tree emanating from this root
+    /// - The refinement tree as a bitstream, packed into unsigneds: One bit
+    ///   for each tree node (visited depth-first); 1 if the tree node has
+    ///   been split, 0 if it's a leaf.
     /// .
     void get_flat_packed_refinement_pattern_for_load_balancing(
       const Vector<unsigned>& old_domain_for_base_element,
       const Vector<unsigned>& new_domain_for_base_element,
-      const unsigned& max_refinement_level_overall,
       std::map<unsigned, Vector<unsigned>>&
         flat_packed_refinement_info_for_root);
 
@@ -961,6 +1283,19 @@ namespace oomph
       std::map<unsigned, Vector<unsigned>>& refinement_info_for_root_local,
       Vector<Vector<Vector<unsigned>>>& refinement_info_for_root_elements);
 
+    /// Helper function for send_refinement_info_helper(...): Exchange
+    /// the compact refinement data in data_for_proc[rank] (preceded by
+    /// the number of base elements nbase_elements_for_proc[rank] they
+    /// refer to) between all processors in a single all-to-all
+    /// communication. count is the total number of data to be sent.
+    void send_compact_refinement_info_helper(
+      const Vector<unsigned>& nbase_elements_for_proc,
+      std::map<unsigned, Vector<unsigned>>& data_for_proc,
+      const unsigned& count,
+      Vector<unsigned>& receive_data,
+      Vector<int>& receive_n,
+      Vector<int>& receive_displacement);
+
     /// The distributed matrix distribution method
     ///  1 - Automatic - the Problem distribution is employed, unless any
     /// processor has number of rows equal to 110% of N/P, in which case
@@ -1156,6 +1491,34 @@ namespace oomph
       actions_after_newton_solve();
     }
 
+    /// Value of the output functional (e.g. the drag on a body) whose
+    /// sensitivities are computed by get_output_functional_gradient().
+    /// Broken virtual; must be overloaded if the sensitivities are
+    /// required and either of the derivative functions below is not.
+    virtual double output_functional()
+    {
+      std::ostringstream error_stream;
+      error_stream << "Problem::output_functional() must be overloaded to\n"
+                   << "compute sensitivities of the output functional.\n";
+      throw OomphLibError(
+        error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+
+    /// Get the derivatives of the output functional with respect to
+    /// the dofs, in the distribution of the dofs. The default
+    /// implementation uses finite differences, perturbing each dof in turn
+    /// (and calling no actions functions), which is only sensible if
+    /// evaluating the functional is cheap (e.g. an integral over a few
+    /// boundary elements); it is not available for distributed problems.
+    virtual void get_doutput_functional_ddofs(DoubleVector& dfunctional_ddof);
+
+    /// Get the partial derivative of the output functional with respect
+    /// to the global parameter addressed by parameter_pt (at fixed dofs).
+    /// The default implementation uses finite differences and calls
+    /// actions_after_change_in_global_parameter().
+    virtual double get_doutput_functional_dparameter(
+      double* const& parameter_pt);
+
     /// Actions that are to be performed after a change in the parameter
     /// that is being varied as part of the solution of a bifurcation detection
     /// problem. The default is to call actions_before_newton_solve(),
@@ -1190,7 +1553,7 @@ namespace oomph
       }
       else
       {
-        return (*(Dof_pt[i] + Dof_derivative_offset));
+        return (*dof_pt(Dof_derivative_offset, i));
       }
     }
 
@@ -1204,7 +1567,7 @@ namespace oomph
       }
       else
       {
-        return (*(Dof_pt[i] + Dof_current_offset));
+        return (*dof_pt(Dof_current_offset, i));
       }
     }
 
@@ -1244,11 +1607,19 @@ namespace oomph
     /// problems a suitable norm is usually the weighted sum of the errors in
     /// the velocities; for moving mesh problems is it usually better to use the
     /// weighted sum of the errors in position.
+    /// The default uses dof_based_temporal_error_norm() if this has
+    /// been enabled with enable_dof_based_temporal_error_norm().
     virtual double global_temporal_error_norm()
     {
+      if (Use_dof_based_temporal_error_norm)
+      {
+        return dof_based_temporal_error_norm();
+      }
+
       std::string error_message =
         "The global_temporal_error_norm function will be problem-specific:\n";
-      error_message += "Please write your own in your Problem class";
+      error_message += "Please write your own in your Problem class,\n";
+      error_message += "or call enable_dof_based_temporal_error_norm()";
 
       throw OomphLibError(
         error_message, OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
@@ -1718,6 +2089,42 @@ namespace oomph
     /// Self-test: Check meshes and global data. Return 0 for OK
     unsigned self_test();
 
+    /// Enable the coloured assembly of the Jacobian (and other
+    /// matrices) with the default assembly method
+    /// (Perform_assembly_using_vectors_of_pairs) and of the residuals
+    /// in get_residuals() (and hence in explicit timestepping, finite
+    /// difference Jacobians and derivatives w.r.t. global parameters):
+    /// The elements of all sub-meshes are coloured so that no two
+    /// elements of the same colour share any Data (including
+    /// hanging-node masters, geometric Data, external Data and the Data
+    /// of external elements). The elements of each colour are then
+    /// assembled concurrently (using OpenMP, if the library is compiled
+    /// with it); the colours are processed in turn so the result is
+    /// bitwise identical for any number of threads. Only used with the
+    /// default assembly handler; the elements' residual and Jacobian
+    /// computations must not modify any shared (e.g. static) storage.
+    void enable_coloured_assembly()
+    {
+      Use_coloured_assembly = true;
+    }
+
+    /// Disable the coloured assembly (the default)
+    void disable_coloured_assembly()
+    {
+      Use_coloured_assembly = false;
+    }
+
+    /// Number of colours in the current colouring of the elements for
+    /// the coloured assembly (zero if it hasn't been set up yet)
+    unsigned ncolour_for_assembly() const
+    {
+      if (Coloured_assembly_colour_start.size() == 0)
+      {
+        return 0;
+      }
+      return Coloured_assembly_colour_start.size() - 1;
+    }
+
     /// Insist that local dof pointers are set up in each element
     /// when equation numbering takes place
     void enable_store_local_dof_pt_in_elements()
@@ -1860,6 +2267,12 @@ namespace oomph
       return Dof_pt[i];
     }
 
+    /// Pointer to the history value at time level t of the i-th dof in
+    /// the problem. The history values are addressed through the
+    /// TimeHistoryIndex of the timestepper of the Data that stores the
+    /// dof, so this is also valid for timesteppers with indexed history.
+    double* dof_pt(const unsigned& t, const unsigned& i);
+
     /// Return the residual vector multiplied by the inverse mass matrix
     /// Virtual so that it can be overloaded for mpi problems
     virtual void get_inverse_mass_matrix_times_residuals(DoubleVector& Mres);
@@ -1901,6 +2314,26 @@ namespace oomph
     virtual void get_jacobian(DoubleVector& residuals,
                               CCDoubleMatrix& jacobian);
 
+    /// Return the fully-assembled Jacobian (in row-compressed storage
+    /// format) and residuals for the problem, computing the contributions
+    /// of the elements whose dynamic type is exactly ELEMENT with a typed
+    /// kernel: These elements are visited with
+    /// Mesh::visit_elements_of_type<ELEMENT>(...), and their residuals
+    /// and Jacobian are computed by a qualified (hence non-virtual and
+    /// inlinable) call to ELEMENT::get_jacobian(...). If ELEMENT is a final
+    /// class, the compiler can also devirtualise the calls made within
+    /// it. The contributions of all other elements are computed through
+    /// the virtual interface. The result is the same as that of
+    /// get_jacobian(...), apart from roundoff (the contributions are
+    /// added in a different order). To use this in the Newton solver,
+    /// overload get_jacobian(DoubleVector&,CRDoubleMatrix&) so that it
+    /// calls this function. Only for non-distributed problems that use
+    /// the default assembly handler. Returns the number of elements
+    /// whose contributions were computed with the typed kernel.
+    template<class ELEMENT>
+    unsigned long get_jacobian_by_element_type(DoubleVector& residuals,
+                                               CRDoubleMatrix& jacobian);
+
     /// Dummy virtual function that must be overloaded by the problem to
     /// specify which matrices should be summed to give the final Jacobian.
     virtual void get_jacobian(DoubleVector& residuals, SumOfMatrices& jacobian)
@@ -1923,6 +2356,58 @@ namespace oomph
     void get_derivative_wrt_global_parameter(double* const& parameter_pt,
                                              DoubleVector& result);
 
+    /// Get the derivatives of the entire residuals vector wrt each of
+    /// the global parameters in parameter_pt (e.g. for sensitivity
+    /// analysis). The derivatives that are computed by finite differences
+    /// share the evaluation of the unperturbed residuals.
+    void get_derivative_wrt_global_parameter(
+      Vector<double*> const& parameter_pt, Vector<DoubleVector>& result);
+
+    /// Add the global parameter addressed by parameter_pt to the
+    /// parameters with respect to which get_output_functional_gradient()
+    /// computes the gradient of the output functional
+    void add_sensitivity_parameter(double* const& parameter_pt)
+    {
+      Sensitivity_parameter_pt.push_back(parameter_pt);
+    }
+
+    /// Number of parameters with respect to which the gradient of the
+    /// output functional is computed
+    unsigned nsensitivity_parameter() const
+    {
+      return Sensitivity_parameter_pt.size();
+    }
+
+    /// Remove all parameters from the sensitivity computation
+    void flush_sensitivity_parameters()
+    {
+      Sensitivity_parameter_pt.clear();
+    }
+
+    /// Compute the gradient of the output_functional() with respect to
+    /// all parameters that have been added with add_sensitivity_parameter(),
+    /// at the current (converged) solution, using the adjoint method:
+    /// a single solve of the transposed system J^T lambda = dF/du gives
+    /// dF/dp = partial F/partial p - lambda^T dR/dp for every parameter
+    /// p. The factorisation from the last Newton iteration is re-used if
+    /// the Jacobian was recomputed in that iteration (and resolve was
+    /// enabled); otherwise the Jacobian is factorised afresh. (If the
+    /// parameters have been changed since the last Newton solve, the
+    /// gradient is computed for the new parameters but at the old
+    /// solution.) The linear solver must support resolve_transpose()
+    /// (e.g. SuperLUSolver).
+    void get_output_functional_gradient(Vector<double>& gradient)
+    {
+      DoubleVector adjoint;
+      get_output_functional_gradient(gradient, adjoint);
+    }
+
+    /// Compute the gradient of the output_functional() with respect to
+    /// the registered parameters as above and also return the adjoint
+    /// solution lambda (in the distribution of the linear solver).
+    void get_output_functional_gradient(Vector<double>& gradient,
+                                        DoubleVector& adjoint);
+
     /// Return the product of the global hessian (derivative of Jacobian
     /// matrix  with respect to all variables) with
     /// an eigenvector, Y, and any number of other specified vectors C
@@ -2135,6 +2620,7 @@ namespace oomph
     {
       Jacobian_reuse_is_enabled = false;
       Jacobian_has_been_computed = false;
+      Jacobian_factorisation_is_current = false;
     }
 
     /// Is recycling of Jacobian in Newton iteration enabled?
@@ -2148,6 +2634,139 @@ namespace oomph
       return Use_predictor_values_as_initial_guess;
     }
 
+    /// Extrapolate the initial guess for the Newton iteration in
+    /// unsteady solves from the history values of the unknowns (values
+    /// and SolidNode positions): The polynomial of the specified degree
+    /// that interpolates the values at the last degree+1 timesteps (or
+    /// approximates the values at the last n_prev_value timesteps in the
+    /// least-squares sense, which is more robust for noisy or nearly
+    /// periodic solutions) is evaluated at the new time. The number of
+    /// previous values is limited by the number that is stored by the
+    /// timestepper. Not used if the predictor values are used as the
+    /// initial guess.
+    void enable_extrapolated_initial_guess(const unsigned& degree = 2,
+                                           const unsigned& n_prev_value = 0)
+    {
+      Use_extrapolated_initial_guess = true;
+      Extrapolation_degree = degree;
+      if (n_prev_value == 0)
+      {
+        Nprev_value_for_extrapolation = degree + 1;
+      }
+      else
+      {
+#ifdef PARANOID
+        if (n_prev_value < degree + 1)
+        {
+          std::ostringstream error_stream;
+          error_stream << "Need at least " << degree + 1
+                       << " previous values for an extrapolating "
+                       << "polynomial of degree " << degree << " not "
+                       << n_prev_value << std::endl;
+          throw OomphLibError(error_stream.str(),
+                              OOMPH_CURRENT_FUNCTION,
+                              OOMPH_EXCEPTION_LOCATION);
+        }
+#endif
+        Nprev_value_for_extrapolation = n_prev_value;
+      }
+    }
+
+    /// Start the Newton iteration in unsteady solves from the values at
+    /// the previous timestep (default)
+    void disable_extrapolated_initial_guess()
+    {
+      Use_extrapolated_initial_guess = false;
+    }
+
+    /// Overlap the setup of the preconditioner with the Krylov solve in
+    /// Newton's method (for iterative linear solvers): In each Newton
+    /// iteration the linear system is solved with the preconditioner that
+    /// was set up from the previous iteration's Jacobian while (on a
+    /// second thread, if OpenMP is available) another preconditioner is
+    /// set up from the present one, to be used in the next iteration.
+    /// The two preconditioners take turns, so the argument must be a
+    /// second preconditioner of the same type (and with the same
+    /// settings) as the linear solver's one. Since the setup of one
+    /// preconditioner runs concurrently with the application of the
+    /// other, the two must not share any Problem or static state (e.g.
+    /// a shared block setup, or a Problem pointer through which the
+    /// setup modifies the Problem), and the setup must not modify any
+    /// data that is used by the Krylov solve. Output from the
+    /// concurrent setup is suppressed. Run serially for distributed
+    /// problems.
+    void enable_pipelined_preconditioner_setup(
+      Preconditioner* const& second_preconditioner_pt)
+    {
+      disable_pipelined_preconditioner_setup();
+      Use_pipelined_preconditioner_setup = true;
+      Pipelined_preconditioner_pt[0] = 0;
+      Pipelined_preconditioner_pt[1] = second_preconditioner_pt;
+    }
+
+    /// Set up the preconditioner from the present Jacobian before each
+    /// linear solve in Newton's method (default)
+    void disable_pipelined_preconditioner_setup();
+
+    /// Use dof_based_temporal_error_norm() as the default
+    /// global_temporal_error_norm() in adaptive timestepping, with
+    /// the specified absolute and relative tolerances. (With the default
+    /// tolerances the norm is the root-mean-square of the weighted errors.)
+    void enable_dof_based_temporal_error_norm(
+      const double& absolute_tolerance = 1.0,
+      const double& relative_tolerance = 0.0)
+    {
+      Use_dof_based_temporal_error_norm = true;
+      Temporal_error_absolute_tolerance = absolute_tolerance;
+      Temporal_error_relative_tolerance = relative_tolerance;
+    }
+
+    /// Don't use dof_based_temporal_error_norm() as the default
+    /// global_temporal_error_norm() (default)
+    void disable_dof_based_temporal_error_norm()
+    {
+      Use_dof_based_temporal_error_norm = false;
+    }
+
+    /// Set the weight of the i-th nodal value (e.g. zero for the
+    /// pressure in Taylor-Hood elements) in the dof-based temporal error
+    /// norm. Default: 1
+    void set_temporal_error_weight_for_nodal_value(const unsigned& i,
+                                                   const double& weight)
+    {
+      if (Temporal_error_nodal_value_weight.size() <= i)
+      {
+        Temporal_error_nodal_value_weight.resize(i + 1, 1.0);
+      }
+      Temporal_error_nodal_value_weight[i] = weight;
+    }
+
+    /// Set the weight of the (SolidNode) positions in the dof-based
+    /// temporal error norm. Default: 1
+    void set_temporal_error_weight_for_positions(const double& weight)
+    {
+      Temporal_error_position_weight = weight;
+    }
+
+    /// Set the weight of the values in global and internal Data (e.g.
+    /// discontinuous pressures) and of the spine heights in the dof-based
+    /// temporal error norm. Default: 1
+    void set_temporal_error_weight_for_non_nodal_values(const double& weight)
+    {
+      Temporal_error_non_nodal_value_weight = weight;
+    }
+
+    /// Temporal error norm evaluated in a single pass over the
+    /// (local) dofs: The weighted root-mean-square of
+    /// e_j / (absolute_tolerance + relative_tolerance |u_j|) over all
+    /// dofs j with non-zero weight, where e_j is the estimate of the
+    /// temporal error in dof u_j provided by its Data's timestepper. The
+    /// sums are reduced over all processors of distributed problems.
+    /// All dofs must be stored in Data numbered by assign_eqn_numbers()
+    /// (global Data, element internal Data, nodes and spine heights);
+    /// this is checked under PARANOID.
+    double dof_based_temporal_error_norm();
+
     /// Use Newton method to solve the problem
     void newton_solve();
 
@@ -2567,6 +3186,73 @@ namespace oomph
       First_jacobian_sign_change = false;
       Arc_length_step_taken = false;
       Dof_derivative.resize(0);
+      Continuation_curvature = -1.0;
+      discard_continuation_factorisation();
+    }
+
+    /// Compute the tangent to the solution branch (and hence the
+    /// predictor for the next arc-length step) from the secant through the
+    /// solutions at the beginning and the end of the last step, rather
+    /// than from the Jacobian. This requires no linear solves, even when
+    /// the step was taken without Newton iterations or after spatial
+    /// adaptation.
+    void enable_secant_continuation_predictor()
+    {
+      Use_finite_differences_for_continuation_derivatives = true;
+    }
+
+    /// Compute the tangent to the solution branch from the Jacobian
+    /// (default)
+    void disable_secant_continuation_predictor()
+    {
+      Use_finite_differences_for_continuation_derivatives = false;
+    }
+
+    /// Limit the arc-length step so that the tangents to the solution
+    /// branch at the beginning and the end of the step enclose
+    /// (approximately) the specified angle, in addition to the control
+    /// based on the number of Newton iterations. Each step changes by at
+    /// most a factor of two.
+    void enable_curvature_based_arc_length_control(
+      const double& desired_angle = 0.1)
+    {
+      Use_curvature_based_arc_length_control = true;
+      Desired_continuation_angle = desired_angle;
+    }
+
+    /// Only use the number of Newton iterations to control the
+    /// arc-length step (default)
+    void disable_curvature_based_arc_length_control()
+    {
+      Use_curvature_based_arc_length_control = false;
+    }
+
+    /// Estimate of the curvature of the solution branch from the last
+    /// arc-length step (angle between the tangents at its beginning and end,
+    /// divided by its length); negative if not available.
+    double continuation_curvature() const
+    {
+      return Continuation_curvature;
+    }
+
+    /// Retain the factorisation of the Jacobian from the last corrector
+    /// iteration of each arc-length step in the linear solver (requires
+    /// a linear solver that supports resolves), so that the tangent at
+    /// the converged solution can be computed by a resolve if it cannot
+    /// be obtained from the corrector iterations. The factorisation is
+    /// discarded (and the linear solver's resolve setting restored) once
+    /// it has been used, when the next continuation step starts, or when
+    /// any other Newton solve is performed.
+    void enable_continuation_factorisation_reuse()
+    {
+      Reuse_factorisation_for_continuation_tangent = true;
+    }
+
+    /// Don't retain the factorisation between arc-length steps (default)
+    void disable_continuation_factorisation_reuse()
+    {
+      Reuse_factorisation_for_continuation_tangent = false;
+      discard_continuation_factorisation();
     }
 
     /// Access function for the sign of the global jacobian matrix.
@@ -2707,6 +3393,16 @@ namespace oomph
     /// Calculate predictions
     void calculate_predictions();
 
+    /// Solve the nonlinear system(s) for the present implicit timestep
+    /// by Newton's method: One Newton solve for multistep timesteppers;
+    /// one for each stage of multi-stage timesteppers.
+    void implicit_timestep_newton_solve();
+
+    /// Extrapolate the initial guess for the Newton iteration at the
+    /// present time from the history values (see
+    /// enable_extrapolated_initial_guess(...))
+    void extrapolate_initial_guess();
+
     /// Enable recycling of the mass matrix in explicit timestepping
     /// schemes. Useful for timestepping on fixed meshes when you want
     /// to avoid the linear solve phase.
@@ -3036,6 +3732,28 @@ namespace oomph
       p_adapt(n_refined, n_unrefined);
     }
 
+    /// hp-adapt problem:
+    /// Perform hp-adaptation for (all) refineable (sub)mesh(es) for
+    /// which both h- and p-adaptation are enabled, based on their own
+    /// error estimates and the target errors specified in the mesh(es).
+    /// Elements whose error is too large are p-refined where the solution
+    /// is locally smooth (as judged by the decay of the Legendre
+    /// coefficients in the element) and p-refinement is predicted to
+    /// reduce the error at lower cost than h-refinement, and h-refined
+    /// elsewhere. Elements whose error is too small are p-unrefined.
+    /// Following mesh adaptation, update global mesh, and re-assign
+    /// equation numbers. Return # of refined/unrefined elements. On
+    /// return from this function, Problem can immediately be solved again.
+    void hp_adapt(unsigned& n_refined, unsigned& n_unrefined);
+
+    /// hp-adapt problem (see above).
+    /// [Argument-free wrapper]
+    void hp_adapt()
+    {
+      unsigned n_refined, n_unrefined;
+      hp_adapt(n_refined, n_unrefined);
+    }
+
 
     /// Adapt problem:
     /// Perform mesh adaptation for (all) refineable (sub)mesh(es),
@@ -3097,6 +3815,113 @@ namespace oomph
   };
 
 
+  //=======================================================================
+  /// Return the fully-assembled Jacobian (in row-compressed storage
+  /// format) and residuals for the problem, computing the contributions
+  /// of the elements whose dynamic type is exactly ELEMENT with a typed
+  /// kernel (see ElementTypeJacobianAssembler). Returns the number of
+  /// elements whose contributions were computed with the typed kernel.
+  //=======================================================================
+  template<class ELEMENT>
+  unsigned long Problem::get_jacobian_by_element_type(DoubleVector& residuals,
+                                                      CRDoubleMatrix& jacobian)
+  {
+#ifdef PARANOID
+    if (Assembly_handler_pt != Default_assembly_handler_pt)
+    {
+      throw OomphLibError("The typed assembly only works with the default "
+                          "assembly handler",
+                          OOMPH_CURRENT_FUNCTION,
+                          OOMPH_EXCEPTION_LOCATION);
+    }
+#ifdef OOMPH_HAS_MPI
+    if (Communicator_pt->nproc() > 1)
+    {
+      throw OomphLibError("The typed assembly only works on a single "
+                          "processor",
+                          OOMPH_CURRENT_FUNCTION,
+                          OOMPH_EXCEPTION_LOCATION);
+    }
+#endif
+#endif
+
+    // The elements' local-to-global equation numbers are taken from the
+    // global mesh's local equation table, which is kept until the
+    // equations are renumbered
+    Mesh* const global_mesh_pt = mesh_pt();
+    if (!global_mesh_pt->local_eqn_table_is_set_up())
+    {
+      global_mesh_pt->setup_local_eqn_table();
+    }
+
+    // (The assembler brings the element type groups up to date)
+    const unsigned long n_dof = ndof();
+    Vector<double> residuals_values(n_dof, 0.0);
+    Vector<std::map<unsigned, double>> jacobian_row(n_dof);
+    ElementTypeJacobianAssembler<ELEMENT> assembler(
+      global_mesh_pt,
+      residuals_values,
+      jacobian_row,
+      Numerical_zero_for_sparse_assembly);
+
+    // Elements of type ELEMENT: Typed kernel
+    const unsigned long n_typed =
+      global_mesh_pt->visit_elements_of_type<ELEMENT>(assembler);
+
+    // All other elements: Virtual interface
+    const unsigned n_group = global_mesh_pt->nelement_type_group();
+    for (unsigned i_group = 0; i_group < n_group; i_group++)
+    {
+      if (global_mesh_pt->element_type_in_group(i_group) != typeid(ELEMENT))
+      {
+        const unsigned long n_el =
+          global_mesh_pt->nelement_in_type_group(i_group);
+        for (unsigned long i = 0; i < n_el; i++)
+        {
+          assembler.add_contribution(
+            global_mesh_pt->element_number_in_type_group(i_group, i));
+        }
+      }
+    }
+
+    // Convert the rows to compressed row storage
+    unsigned long n_nz = 0;
+    for (unsigned long i = 0; i < n_dof; i++)
+    {
+      n_nz += jacobian_row[i].size();
+    }
+    Vector<double> value;
+    Vector<int> column_index;
+    Vector<int> row_start(n_dof + 1, 0);
+    value.reserve(n_nz);
+    column_index.reserve(n_nz);
+    for (unsigned long i = 0; i < n_dof; i++)
+    {
+      row_start[i] = value.size();
+      for (std::map<unsigned, double>::iterator it = jacobian_row[i].begin();
+           it != jacobian_row[i].end();
+           it++)
+      {
+        column_index.push_back(it->first);
+        value.push_back(it->second);
+      }
+    }
+    row_start[n_dof] = value.size();
+
+    LinearAlgebraDistribution* dist_pt = 0;
+    create_new_linear_algebra_distribution(dist_pt);
+    jacobian.build(dist_pt, n_dof, value, column_index, row_start);
+    residuals.build(dist_pt, 0.0);
+    for (unsigned long i = 0; i < n_dof; i++)
+    {
+      residuals[i] = residuals_values[i];
+    }
+    delete dist_pt;
+
+    return n_typed;
+  }
+
+
   //=======================================================================
   /// A class to handle errors in the Newton solver
   //=======================================================================
@@ -0,0 +1,1237 @@
+// LIC// ====================================================================
+// LIC// This file forms part of oomph-lib, the object-oriented,
+// LIC// multi-physics finite-element library, available
+// LIC// at http://www.oomph-lib.org.
+// LIC//
+// LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+// LIC//
+// LIC// This library is free software; you can redistribute it and/or
+// LIC// modify it under the terms of the GNU Lesser General Public
+// LIC// License as published by the Free Software Foundation; either
+// LIC// version 2.1 of the License, or (at your option) any later version.
+// LIC//
+// LIC// This library is distributed in the hope that it will be useful,
+// LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// LIC// Lesser General Public License for more details.
+// LIC//
+// LIC// You should have received a copy of the GNU Lesser General Public
+// LIC// License along with this library; if not, write to the Free Software
+// LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// LIC// 02110-1301  USA.
+// LIC//
+// LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+// LIC//
+// LIC//====================================================================
+// Non-inline member functions for the reduced-order model
+
+#include <random>
+#include <algorithm>
+
+#include "reduced_order_model.h"
+#include "assembly_handler.h"
+#include "mesh.h"
+
+namespace oomph
+{
+  //======================================================================
+  /// Add the specified vector of dofs as a snapshot
+  //======================================================================
+  void ReducedOrderModel::add_snapshot(const DoubleVector& dofs)
+  {
+    // Not a paranoid check: Snapshots with different distributions
+    // would be combined entry by entry
+    if (Snapshot.size() > 0)
+    {
+      if (*Snapshot[0].distribution_pt() != *dofs.distribution_pt())
+      {
+        std::ostringstream error_stream;
+        error_stream << "The distribution of the snapshot differs from that\n"
+                     << "of the previous snapshots. Has the Problem been\n"
+                     << "re-meshed or have its equations been renumbered?\n";
+        throw OomphLibError(
+          error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+      }
+    }
+    Snapshot.push_back(dofs);
+  }
+
+
+  //======================================================================
+  /// Build the POD basis from the snapshots by a randomised SVD of the
+  /// (centred) snapshot matrix S: The range of S is sampled with a
+  /// Gaussian random test matrix (plus N_power_iteration power
+  /// iterations), the samples are orthonormalised to Q, and the
+  /// left singular vectors of S are obtained from the eigenvectors
+  /// of the small matrix (Q^T S)(Q^T S)^T.
+  //======================================================================
+  void ReducedOrderModel::build_pod_basis(const unsigned& max_n_mode,
+                                          const double& energy_tolerance)
+  {
+    const unsigned n_snapshot = Snapshot.size();
+
+#ifdef PARANOID
+    if (n_snapshot == 0)
+    {
+      std::ostringstream error_stream;
+      error_stream << "No snapshots have been added!\n";
+      throw OomphLibError(
+        error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+#endif
+
+    const LinearAlgebraDistribution* const dist_pt =
+      Snapshot[0].distribution_pt();
+    const unsigned n_row_local = dist_pt->nrow_local();
+
+    // Reference state
+    Reference_dofs.build(dist_pt, 0.0);
+    if (Centre_snapshots)
+    {
+      for (unsigned s = 0; s < n_snapshot; s++)
+      {
+        Reference_dofs += Snapshot[s];
+      }
+      Reference_dofs /= double(n_snapshot);
+    }
+
+    // Assemble the centred snapshot matrix and its squared Frobenius norm
+    // (the total "energy")
+    DoubleMultiVector snapshot_matrix(n_snapshot, dist_pt, 0.0);
+    double total_energy = 0.0;
+    for (unsigned s = 0; s < n_snapshot; s++)
+    {
+      for (unsigned i = 0; i < n_row_local; i++)
+      {
+        snapshot_matrix(s, i) = Snapshot[s][i] - Reference_dofs[i];
+      }
+      total_energy += snapshot_matrix.doublevector(s).dot(
+        snapshot_matrix.doublevector(s));
+    }
+
+    // Number of random samples of the range of the snapshot matrix
+    const unsigned n_sample =
+      std::min(max_n_mode + N_oversample, n_snapshot);
+
+    // Gaussian random test matrix
+    std::mt19937 generator(Random_seed);
+    std::normal_distribution<double> normal_distribution(0.0, 1.0);
+    DenseMatrix<double> omega(n_snapshot, n_sample);
+    for (unsigned s = 0; s < n_snapshot; s++)
+    {
+      for (unsigned j = 0; j < n_sample; j++)
+      {
+        omega(s, j) = normal_distribution(generator);
+      }
+    }
+
+    // Sample the range: Q = S Omega
+    DoubleMultiVector q(n_sample, dist_pt, 0.0);
+    for (unsigned j = 0; j < n_sample; j++)
+    {
+      for (unsigned s = 0; s < n_snapshot; s++)
+      {
+        const double omega_sj = omega(s, j);
+        for (unsigned i = 0; i < n_row_local; i++)
+        {
+          q(j, i) += snapshot_matrix(s, i) * omega_sj;
+        }
+      }
+    }
+    orthonormalise(q);
+
+    // Power iterations: Q = S S^T Q
+    for (unsigned iter = 0; iter < N_power_iteration; iter++)
+    {
+      const unsigned n_q = q.nvector();
+      DenseMatrix<double> z(n_snapshot, n_q);
+      for (unsigned s = 0; s < n_snapshot; s++)
+      {
+        for (unsigned j = 0; j < n_q; j++)
+        {
+          z(s, j) = snapshot_matrix.doublevector(s).dot(q.doublevector(j));
+        }
+      }
+      q.initialise(0.0);
+      for (unsigned j = 0; j < n_q; j++)
+      {
+        for (unsigned s = 0; s < n_snapshot; s++)
+        {
+          const double z_sj = z(s, j);
+          for (unsigned i = 0; i < n_row_local; i++)
+          {
+            q(j, i) += snapshot_matrix(s, i) * z_sj;
+          }
+        }
+      }
+      orthonormalise(q);
+    }
+
+    // Project the snapshots onto the sampled range: B = Q^T S, and
+    // form C = B B^T
+    const unsigned n_q = q.nvector();
+    DenseMatrix<double> b(n_q, n_snapshot);
+    for (unsigned j = 0; j < n_q; j++)
+    {
+      for (unsigned s = 0; s < n_snapshot; s++)
+      {
+        b(j, s) = q.doublevector(j).dot(snapshot_matrix.doublevector(s));
+      }
+    }
+    DenseMatrix<double> c(n_q, n_q, 0.0);
+    for (unsigned j = 0; j < n_q; j++)
+    {
+      for (unsigned k = 0; k < n_q; k++)
+      {
+        for (unsigned s = 0; s < n_snapshot; s++)
+        {
+          c(j, k) += b(j, s) * b(k, s);
+        }
+      }
+    }
+
+    // Eigenvalues of C are the squared singular values of S
+    Vector<double> eigenvalue;
+    DenseMatrix<double> eigenvector;
+    symmetric_eigen_decomposition(c, eigenvalue, eigenvector);
+
+    // Singular values (eigenvalues are returned in decreasing order)
+    Singular_value.resize(n_q);
+    for (unsigned j = 0; j < n_q; j++)
+    {
+      Singular_value[j] = sqrt(std::max(eigenvalue[j], 0.0));
+    }
+
+    // Number of modes: Ignore singular values at round-off level
+    unsigned n_mode = std::min(max_n_mode, n_q);
+    const double sigma_min =
+      1.0e-12 * ((n_q > 0) ? Singular_value[0] : 0.0);
+    while ((n_mode > 0) && (Singular_value[n_mode - 1] <= sigma_min))
+    {
+      n_mode--;
+    }
+
+    // Retain only as many modes as are needed to capture the
+    // required fraction of the energy
+    if (energy_tolerance > 0.0)
+    {
+      double captured_energy = 0.0;
+      for (unsigned m = 0; m < n_mode; m++)
+      {
+        captured_energy += Singular_value[m] * Singular_value[m];
+        if (total_energy - captured_energy <= energy_tolerance * total_energy)
+        {
+          n_mode = m + 1;
+          break;
+        }
+      }
+    }
+
+    // The POD modes are Q times the eigenvectors of C (assign rather than
+    // build(...) the basis so that the modes can be accessed as
+    // DoubleVectors)
+    Basis = DoubleMultiVector(n_mode, dist_pt, 0.0);
+    for (unsigned m = 0; m < n_mode; m++)
+    {
+      for (unsigned j = 0; j < n_q; j++)
+      {
+        const double u_jm = eigenvector(j, m);
+        for (unsigned i = 0; i < n_row_local; i++)
+        {
+          Basis(m, i) += q(j, i) * u_jm;
+        }
+      }
+    }
+
+    // Any previous hyper-reduction is no longer valid
+    Use_hyper_reduction = false;
+    Sampled_element_pt.clear();
+    Sampled_element_weight.clear();
+    Sampled_eqn_number.clear();
+
+    if (Doc_info)
+    {
+      oomph_info << "Built POD basis with " << n_mode << " modes from "
+                 << n_snapshot << " snapshots.\nSingular values:";
+      for (unsigned j = 0; j < n_q; j++)
+      {
+        oomph_info << " " << Singular_value[j];
+      }
+      oomph_info << std::endl;
+    }
+  }
+
+
+  //======================================================================
+  /// Orthonormalise the vectors in q by modified Gram-Schmidt
+  /// (applied twice for robustness); (numerically) linearly dependent
+  /// vectors are removed.
+  //======================================================================
+  void ReducedOrderModel::orthonormalise(DoubleMultiVector& q)
+  {
+    const unsigned n_vector = q.nvector();
+    std::vector<int> independent;
+    for (unsigned j = 0; j < n_vector; j++)
+    {
+      DoubleVector& q_j = q.doublevector(j);
+      const double initial_norm = q_j.norm();
+      if (initial_norm == 0.0)
+      {
+        continue;
+      }
+      for (unsigned pass = 0; pass < 2; pass++)
+      {
+        const unsigned n_independent = independent.size();
+        for (unsigned k = 0; k < n_independent; k++)
+        {
+          DoubleVector& q_k = q.doublevector(independent[k]);
+          const double r = q_k.dot(q_j);
+          const unsigned n_row_local = q_j.nrow_local();
+          for (unsigned i = 0; i < n_row_local; i++)
+          {
+            q_j[i] -= r * q_k[i];
+          }
+        }
+      }
+      const double norm = q_j.norm();
+      if (norm > 1.0e-10 * initial_norm)
+      {
+        q_j /= norm;
+        independent.push_back(j);
+      }
+    }
+
+    // Drop the dependent vectors
+    if (independent.size() < n_vector)
+    {
+      DoubleMultiVector q_independent(q, independent);
+      q = q_independent;
+    }
+  }
+
+
+  //======================================================================
+  /// Eigen-decomposition of the symmetric matrix a by the cyclic Jacobi
+  /// method. The eigenvalues are returned in decreasing order; the
+  /// j-th column of eigenvector is the eigenvector for the j-th
+  /// eigenvalue. The matrix a is overwritten.
+  //======================================================================
+  void ReducedOrderModel::symmetric_eigen_decomposition(
+    DenseMatrix<double>& a,
+    Vector<double>& eigenvalue,
+    DenseMatrix<double>& eigenvector)
+  {
+    const unsigned n = a.nrow();
+
+    // Start from the identity
+    DenseMatrix<double> v(n, n, 0.0);
+    for (unsigned i = 0; i < n; i++)
+    {
+      v(i, i) = 1.0;
+    }
+
+    // Sweep until the off-diagonal entries are negligible
+    const unsigned max_sweep = 100;
+    for (unsigned sweep = 0; sweep < max_sweep; sweep++)
+    {
+      double off_diagonal = 0.0;
+      double diagonal = 0.0;
+      for (unsigned i = 0; i < n; i++)
+      {
+        diagonal += a(i, i) * a(i, i);
+        for (unsigned j = i + 1; j < n; j++)
+        {
+          off_diagonal += a(i, j) * a(i, j);
+        }
+      }
+      if (off_diagonal <= 1.0e-30 * diagonal)
+      {
+        break;
+      }
+
+      for (unsigned p = 0; p < n; p++)
+      {
+        for (unsigned r = p + 1; r < n; r++)
+        {
+          if (a(p, r) == 0.0)
+          {
+            continue;
+          }
+
+          // Rotation angle that annihilates a(p,r)
+          const double theta = 0.5 * (a(r, r) - a(p, p)) / a(p, r);
+          double t = 1.0 / (std::fabs(theta) + sqrt(theta * theta + 1.0));
+          if (theta < 0.0)
+          {
+            t = -t;
+          }
+          const double cos_phi = 1.0 / sqrt(t * t + 1.0);
+          const double sin_phi = t * cos_phi;
+
+          // Apply the rotation to the columns and rows
+          for (unsigned k = 0; k < n; k++)
+          {
+            const double a_kp = a(k, p);
+            const double a_kr = a(k, r);
+            a(k, p) = cos_phi * a_kp - sin_phi * a_kr;
+            a(k, r) = sin_phi * a_kp + cos_phi * a_kr;
+          }
+          for (unsigned k = 0; k < n; k++)
+          {
+            const double a_pk = a(p, k);
+            const double a_rk = a(r, k);
+            a(p, k) = cos_phi * a_pk - sin_phi * a_rk;
+            a(r, k) = sin_phi * a_pk + cos_phi * a_rk;
+          }
+
+          // Accumulate the eigenvectors
+          for (unsigned k = 0; k < n; k++)
+          {
+            const double v_kp = v(k, p);
+            const double v_kr = v(k, r);
+            v(k, p) = cos_phi * v_kp - sin_phi * v_kr;
+            v(k, r) = sin_phi * v_kp + cos_phi * v_kr;
+          }
+        }
+      }
+    }
+
+    // Sort the eigenvalues into decreasing order
+    std::vector<std::pair<double, unsigned>> sorted(n);
+    for (unsigned i = 0; i < n; i++)
+    {
+      sorted[i] = std::make_pair(-a(i, i), i);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    eigenvalue.resize(n);
+    eigenvector.resize(n, n);
+    for (unsigned j = 0; j < n; j++)
+    {
+      const unsigned index = sorted[j].second;
+      eigenvalue[j] = a(index, index);
+      for (unsigned i = 0; i < n; i++)
+      {
+        eigenvector(i, j) = v(i, index);
+      }
+    }
+  }
+
+
+  //======================================================================
+  /// Modal coefficients of the best approximation of the
+  /// specified dofs: a = Phi^T (x - x_ref)
+  //======================================================================
+  void ReducedOrderModel::project(const DoubleVector& dofs,
+                                  Vector<double>& coefficients) const
+  {
+    DoubleVector difference(dofs);
+    difference -= Reference_dofs;
+    const unsigned n_mode = nmode();
+    coefficients.resize(n_mode);
+    for (unsigned m = 0; m < n_mode; m++)
+    {
+      coefficients[m] = Basis.doublevector(m).dot(difference);
+    }
+  }
+
+
+  //======================================================================
+  /// Set the Problem's dofs to x_ref + Phi a
+  //======================================================================
+  void ReducedOrderModel::set_problem_dofs(const Vector<double>& coefficients)
+  {
+    DoubleVector dofs(Reference_dofs);
+    const unsigned n_row_local = dofs.nrow_local();
+    const unsigned n_mode = nmode();
+    for (unsigned m = 0; m < n_mode; m++)
+    {
+      const double a_m = coefficients[m];
+      for (unsigned i = 0; i < n_row_local; i++)
+      {
+        dofs[i] += a_m * Basis(m, i);
+      }
+    }
+    Problem_pt->set_dofs(dofs);
+  }
+
+
+  //======================================================================
+  /// Set the dofs of the sampled elements to x_ref + Phi a (the
+  /// other dofs are not changed)
+  //======================================================================
+  void ReducedOrderModel::set_sampled_dofs(const Vector<double>& coefficients)
+  {
+    const unsigned n_mode = nmode();
+    const unsigned long n_sampled_dof = Sampled_eqn_number.size();
+    for (unsigned long k = 0; k < n_sampled_dof; k++)
+    {
+      const unsigned long i = Sampled_eqn_number[k];
+      double x_i = Reference_dofs[i];
+      for (unsigned m = 0; m < n_mode; m++)
+      {
+        x_i += coefficients[m] * Basis(m, i);
+      }
+      Problem_pt->dof(i) = x_i;
+    }
+  }
+
+
+  //======================================================================
+  /// Get the reduced residuals Phi^T r at the Problem's current dofs
+  //======================================================================
+  void ReducedOrderModel::get_reduced_residuals(
+    Vector<double>& reduced_residuals)
+  {
+    const unsigned n_mode = nmode();
+    reduced_residuals.assign(n_mode, 0.0);
+
+    // Only assemble the sampled elements
+    if (Use_hyper_reduction)
+    {
+      DenseDoubleMatrix dummy;
+      get_hyper_reduced_residuals_and_jacobian(reduced_residuals, dummy, 0);
+      return;
+    }
+
+    DoubleVector residuals;
+    Problem_pt->get_residuals(residuals);
+    for (unsigned m = 0; m < n_mode; m++)
+    {
+      reduced_residuals[m] = Basis.doublevector(m).dot(residuals);
+    }
+  }
+
+
+  //======================================================================
+  /// Get the reduced residuals Phi^T r and the reduced Jacobian
+  /// Phi^T J Phi at the Problem's current dofs
+  //======================================================================
+  void ReducedOrderModel::get_reduced_jacobian(
+    Vector<double>& reduced_residuals, DenseDoubleMatrix& reduced_jacobian)
+  {
+    const unsigned n_mode = nmode();
+    reduced_residuals.assign(n_mode, 0.0);
+
+    // Note: resize(...) doesn't overwrite the entries if the size is
+    // unchanged, and the hyper-reduction adds to them
+    reduced_jacobian.resize(n_mode, n_mode);
+    reduced_jacobian.initialise(0.0);
+
+    // Only assemble the sampled elements
+    if (Use_hyper_reduction)
+    {
+      get_hyper_reduced_residuals_and_jacobian(
+        reduced_residuals, reduced_jacobian, 1);
+      return;
+    }
+
+    DoubleVector residuals;
+    CRDoubleMatrix jacobian;
+    Problem_pt->get_jacobian(residuals, jacobian);
+    for (unsigned m = 0; m < n_mode; m++)
+    {
+      reduced_residuals[m] = Basis.doublevector(m).dot(residuals);
+    }
+
+    // Phi^T (J Phi)
+    DoubleVector jacobian_times_mode;
+    for (unsigned n = 0; n < n_mode; n++)
+    {
+      jacobian.multiply(Basis.doublevector(n), jacobian_times_mode);
+      for (unsigned m = 0; m < n_mode; m++)
+      {
+        reduced_jacobian(m, n) =
+          Basis.doublevector(m).dot(jacobian_times_mode);
+      }
+    }
+  }
+
+
+  //======================================================================
+  /// Solve the reduced equations by Newton's method, starting from the
+  /// projection of the Problem's current dofs.
+  //======================================================================
+  void ReducedOrderModel::reduced_newton_solve()
+  {
+    const unsigned n_mode = nmode();
+
+    // Not paranoid checks: The basis is indexed by the equation numbers
+    // that were current when it was built
+    if (n_mode == 0)
+    {
+      std::ostringstream error_stream;
+      error_stream << "The POD basis is empty. Call build_pod_basis(...) "
+                   << "first.\n";
+      throw OomphLibError(
+        error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+    if (*Problem_pt->dof_distribution_pt() != *Basis.distribution_pt())
+    {
+      std::ostringstream error_stream;
+      error_stream << "The distribution of the Problem's dofs differs from\n"
+                   << "that of the POD basis. Has the Problem been\n"
+                   << "re-meshed or have its equations been renumbered?\n";
+      throw OomphLibError(
+        error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+
+    // Update anything that needs updating
+    Problem_pt->actions_before_newton_solve();
+
+    // Initial guess: Projection of the current dofs
+    Vector<double> coefficients;
+    DoubleVector dofs;
+    Problem_pt->get_dofs(dofs);
+    project(dofs, coefficients);
+    set_problem_dofs(coefficients);
+
+    const unsigned max_iter = Problem_pt->max_newton_iterations();
+    const double tolerance = Problem_pt->newton_solver_tolerance();
+    const double max_residuals = Problem_pt->max_residuals();
+
+    Vector<double> reduced_residuals(n_mode);
+    DenseDoubleMatrix reduced_jacobian(n_mode, n_mode, 0.0);
+
+    unsigned count = 0;
+    while (true)
+    {
+      // Get the reduced residuals and Jacobian
+      Problem_pt->actions_before_newton_convergence_check();
+      get_reduced_jacobian(reduced_residuals, reduced_jacobian);
+
+      double max_res = 0.0;
+      for (unsigned m = 0; m < n_mode; m++)
+      {
+        max_res = std::max(max_res, std::fabs(reduced_residuals[m]));
+      }
+
+      if (Doc_info)
+      {
+        oomph_info << "Reduced Newton iteration " << count
+                   << ": Maximum reduced residual: " << max_res << std::endl;
+      }
+
+      // Converged?
+      if (max_res <= tolerance)
+      {
+        break;
+      }
+
+      // Diverged?
+      if ((count == max_iter) || (max_res > max_residuals))
+      {
+        if (Use_hyper_reduction)
+        {
+          set_problem_dofs(coefficients);
+        }
+        throw NewtonSolverError(count, max_res);
+      }
+
+      // Newton step: With hyper-reduction only the sampled elements
+      // are assembled, so only their dofs need to be updated
+      Problem_pt->actions_before_newton_step();
+      reduced_jacobian.solve(reduced_residuals);
+      for (unsigned m = 0; m < n_mode; m++)
+      {
+        coefficients[m] -= reduced_residuals[m];
+      }
+      if (Use_hyper_reduction)
+      {
+        set_sampled_dofs(coefficients);
+      }
+      else
+      {
+        set_problem_dofs(coefficients);
+      }
+      Problem_pt->actions_after_newton_step();
+      count++;
+    }
+
+    // Reconstruct the remaining dofs
+    if (Use_hyper_reduction)
+    {
+      set_problem_dofs(coefficients);
+    }
+
+    Problem_pt->actions_after_newton_solve();
+  }
+
+
+  //======================================================================
+  /// Get the reduced contributions of the element to the residuals
+  /// and (if flag=1) the Jacobian. Returns the number of the element's dofs
+  //======================================================================
+  unsigned ReducedOrderModel::get_reduced_element_contribution(
+    GeneralisedElement* const& elem_pt,
+    Vector<double>& reduced_residuals,
+    DenseMatrix<double>& reduced_jacobian,
+    const unsigned& flag)
+  {
+    AssemblyHandler* const assembly_handler_pt =
+      Problem_pt->assembly_handler_pt();
+    const unsigned n_dof = assembly_handler_pt->ndof(elem_pt);
+    const unsigned n_mode = nmode();
+
+    // Get the element's residuals (and Jacobian)
+    Vector<double> el_residuals(n_dof);
+    DenseMatrix<double> el_jacobian;
+    if (flag)
+    {
+      el_jacobian.resize(n_dof, n_dof, 0.0);
+      assembly_handler_pt->get_jacobian(elem_pt, el_residuals, el_jacobian);
+    }
+    else
+    {
+      assembly_handler_pt->get_residuals(elem_pt, el_residuals);
+    }
+
+    // Restriction of the basis to the element's dofs
+    DenseMatrix<double> phi(n_dof, n_mode);
+    for (unsigned l = 0; l < n_dof; l++)
+    {
+      const unsigned long eqn_number =
+        assembly_handler_pt->eqn_number(elem_pt, l);
+      for (unsigned m = 0; m < n_mode; m++)
+      {
+        phi(l, m) = Basis(m, eqn_number);
+      }
+    }
+
+    // Project
+    reduced_residuals.assign(n_mode, 0.0);
+    for (unsigned l = 0; l < n_dof; l++)
+    {
+      for (unsigned m = 0; m < n_mode; m++)
+      {
+        reduced_residuals[m] += phi(l, m) * el_residuals[l];
+      }
+    }
+    if (flag)
+    {
+      // J Phi
+      DenseMatrix<double> jacobian_times_phi(n_dof, n_mode, 0.0);
+      for (unsigned l = 0; l < n_dof; l++)
+      {
+        for (unsigned k = 0; k < n_dof; k++)
+        {
+          const double j_lk = el_jacobian(l, k);
+          if (j_lk != 0.0)
+          {
+            for (unsigned n = 0; n < n_mode; n++)
+            {
+              jacobian_times_phi(l, n) += j_lk * phi(k, n);
+            }
+          }
+        }
+      }
+
+      // Phi^T J Phi
+      reduced_jacobian.resize(n_mode, n_mode, 0.0);
+      for (unsigned m = 0; m < n_mode; m++)
+      {
+        for (unsigned n = 0; n < n_mode; n++)
+        {
+          reduced_jacobian(m, n) = 0.0;
+          for (unsigned l = 0; l < n_dof; l++)
+          {
+            reduced_jacobian(m, n) += phi(l, m) * jacobian_times_phi(l, n);
+          }
+        }
+      }
+    }
+    return n_dof;
+  }
+
+
+  //======================================================================
+  /// Add the weighted contributions of the sampled elements to the
+  /// reduced residuals and (if flag=1) the reduced Jacobian
+  //======================================================================
+  void ReducedOrderModel::get_hyper_reduced_residuals_and_jacobian(
+    Vector<double>& reduced_residuals,
+    DenseDoubleMatrix& reduced_jacobian,
+    const unsigned& flag)
+  {
+    const unsigned n_mode = nmode();
+    Vector<double> el_reduced_residuals(n_mode);
+    DenseMatrix<double> el_reduced_jacobian(n_mode, n_mode);
+
+    const unsigned n_sampled = Sampled_element_pt.size();
+    for (unsigned e = 0; e < n_sampled; e++)
+    {
+      get_reduced_element_contribution(Sampled_element_pt[e],
+                                       el_reduced_residuals,
+                                       el_reduced_jacobian,
+                                       flag);
+      const double weight = Sampled_element_weight[e];
+      for (unsigned m = 0; m < n_mode; m++)
+      {
+        reduced_residuals[m] += weight * el_reduced_residuals[m];
+        if (flag)
+        {
+          for (unsigned n = 0; n < n_mode; n++)
+          {
+            reduced_jacobian(m, n) += weight * el_reduced_jacobian(m, n);
+          }
+        }
+      }
+    }
+  }
+
+
+  //======================================================================
+  /// Select the sampled elements and their weights by energy-conserving
+  /// sampling and weighting (ECSW), trained on the reduced residuals and
+  /// Jacobians at the snapshots. Only the columns of the training matrix
+  /// for the candidate elements (a random sample of at most
+  /// Max_n_training_element elements) are stored; the target (the
+  /// contributions of all elements) is accumulated on the fly.
+  //======================================================================
+  void ReducedOrderModel::setup_hyper_reduction(const double& tolerance)
+  {
+    const unsigned n_mode = nmode();
+    const unsigned n_snapshot = Snapshot.size();
+
+#ifdef PARANOID
+    if ((n_mode == 0) || (n_snapshot == 0))
+    {
+      std::ostringstream error_stream;
+      error_stream << "Hyper-reduction requires snapshots and a POD basis.\n"
+                   << "Call add_snapshot() and build_pod_basis(...) first.\n";
+      throw OomphLibError(
+        error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+#endif
+
+    // Not a paranoid check: The element's equation numbers are used
+    // to index the basis directly
+    if (Basis.distributed() &&
+        (Basis.distribution_pt()->communicator_pt()->nproc() > 1))
+    {
+      std::ostringstream error_stream;
+      error_stream << "Hyper-reduction is not implemented for distributed\n"
+                   << "dofs.\n";
+      throw OomphLibError(
+        error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+
+    // Back up the current dofs
+    DoubleVector dofs_backup;
+    Problem_pt->get_dofs(dofs_backup);
+
+    // Candidate elements: All elements, or a random sample of them
+    // (partial Fisher-Yates shuffle), in increasing order
+    Mesh* const mesh_pt = Problem_pt->mesh_pt();
+    const unsigned long n_element = mesh_pt->nelement();
+    Vector<unsigned long> candidate(n_element);
+    for (unsigned long e = 0; e < n_element; e++)
+    {
+      candidate[e] = e;
+    }
+    if ((Max_n_training_element > 0) && (n_element > Max_n_training_element))
+    {
+      std::mt19937 generator(Random_seed);
+      for (unsigned long k = 0; k < Max_n_training_element; k++)
+      {
+        std::uniform_int_distribution<unsigned long> distribution(
+          k, n_element - 1);
+        std::swap(candidate[k], candidate[distribution(generator)]);
+      }
+      candidate.resize(Max_n_training_element);
+      std::sort(candidate.begin(), candidate.end());
+    }
+    const unsigned long n_candidate = candidate.size();
+
+    // Training matrix G: One row for each entry in the reduced residuals
+    // and Jacobian at each snapshot, one column per candidate element.
+    // The target b: The contributions of all elements (unit weights)
+    const unsigned n_row_per_snapshot = n_mode * (n_mode + 1);
+    const unsigned n_row = n_snapshot * n_row_per_snapshot;
+    Vector<Vector<double>> g_column(n_candidate);
+    for (unsigned long k = 0; k < n_candidate; k++)
+    {
+      g_column[k].resize(n_row, 0.0);
+    }
+    Vector<double> b(n_row, 0.0);
+
+    Vector<double> el_reduced_residuals(n_mode);
+    DenseMatrix<double> el_reduced_jacobian(n_mode, n_mode);
+    for (unsigned s = 0; s < n_snapshot; s++)
+    {
+      Problem_pt->set_dofs(Snapshot[s]);
+      Problem_pt->actions_before_newton_convergence_check();
+      unsigned long k = 0;
+      for (unsigned long e = 0; e < n_element; e++)
+      {
+        get_reduced_element_contribution(mesh_pt->element_pt(e),
+                                         el_reduced_residuals,
+                                         el_reduced_jacobian,
+                                         1);
+        const bool is_candidate = (k < n_candidate) && (candidate[k] == e);
+        unsigned row = s * n_row_per_snapshot;
+        for (unsigned m = 0; m < n_mode; m++)
+        {
+          b[row] += el_reduced_residuals[m];
+          if (is_candidate)
+          {
+            g_column[k][row] = el_reduced_residuals[m];
+          }
+          row++;
+          for (unsigned n = 0; n < n_mode; n++)
+          {
+            b[row] += el_reduced_jacobian(m, n);
+            if (is_candidate)
+            {
+              g_column[k][row] = el_reduced_jacobian(m, n);
+            }
+            row++;
+          }
+        }
+        if (is_candidate)
+        {
+          k++;
+        }
+      }
+    }
+
+    // Restore the dofs
+    Problem_pt->set_dofs(dofs_backup);
+    Problem_pt->actions_before_newton_convergence_check();
+
+    // Get the sparse, non-negative weights
+    Vector<double> weight;
+    solve_nnls(g_column, b, tolerance, weight);
+
+    // Store the sampled elements and the equation numbers of their dofs
+    AssemblyHandler* const assembly_handler_pt =
+      Problem_pt->assembly_handler_pt();
+    Sampled_element_pt.clear();
+    Sampled_element_weight.clear();
+    Sampled_eqn_number.clear();
+    for (unsigned long k = 0; k < n_candidate; k++)
+    {
+      if (weight[k] > 0.0)
+      {
+        GeneralisedElement* const elem_pt =
+          mesh_pt->element_pt(candidate[k]);
+        Sampled_element_pt.push_back(elem_pt);
+        Sampled_element_weight.push_back(weight[k]);
+        const unsigned n_dof = assembly_handler_pt->ndof(elem_pt);
+        for (unsigned l = 0; l < n_dof; l++)
+        {
+          Sampled_eqn_number.push_back(
+            assembly_handler_pt->eqn_number(elem_pt, l));
+        }
+      }
+    }
+    std::sort(Sampled_eqn_number.begin(), Sampled_eqn_number.end());
+    Sampled_eqn_number.erase(
+      std::unique(Sampled_eqn_number.begin(), Sampled_eqn_number.end()),
+      Sampled_eqn_number.end());
+    Use_hyper_reduction = true;
+
+    if (Doc_info)
+    {
+      oomph_info << "Hyper-reduction samples " << Sampled_element_pt.size()
+                 << " of " << n_element << " elements (" << n_candidate
+                 << " candidates), which involve "
+                 << Sampled_eqn_number.size() << " dofs." << std::endl;
+    }
+  }
+
+
+  //======================================================================
+  /// Solve the non-negative least-squares problem min |G w - b|,
+  /// w >= 0, by the Lawson-Hanson active set algorithm, stopping as
+  /// soon as |G w - b| <= tolerance |b|. The unconstrained least-squares
+  /// problems for the passive set are solved with a thin QR
+  /// factorisation G_P = Q R of the passive columns, which is updated
+  /// (rather than recomputed) when columns enter or leave the passive set.
+  //======================================================================
+  void ReducedOrderModel::solve_nnls(const Vector<Vector<double>>& g_column,
+                                     const Vector<double>& b,
+                                     const double& tolerance,
+                                     Vector<double>& w)
+  {
+    const unsigned n_col = g_column.size();
+    const unsigned n_row = b.size();
+    w.assign(n_col, 0.0);
+
+    double b_norm = 0.0;
+    for (unsigned i = 0; i < n_row; i++)
+    {
+      b_norm += b[i] * b[i];
+    }
+    b_norm = sqrt(b_norm);
+    if (b_norm == 0.0)
+    {
+      return;
+    }
+
+    // The passive set (columns with non-zero weights)
+    Vector<unsigned> passive;
+    std::vector<bool> is_passive(n_col, false);
+
+    // Columns that are excluded for the rest of the run because their
+    // least-squares weight was non-positive when they entered the passive
+    // set (or because they are linearly dependent on the passive columns).
+    // This is Lawson and Hanson's guard against cycling.
+    std::vector<bool> is_excluded(n_col, false);
+
+    // Thin QR factorisation of the passive columns: q[k] is the k-th
+    // orthonormal column of Q; r_col[k] holds the entries R(0..k,k)
+    Vector<Vector<double>> q;
+    Vector<Vector<double>> r_col;
+
+    // Q^T b
+    Vector<double> qt_b;
+
+    // Residual r = b - G w
+    Vector<double> r(b);
+
+    const unsigned max_iter = 3 * n_col;
+    for (unsigned iter = 0; iter < max_iter; iter++)
+    {
+      // Converged?
+      double r_norm = 0.0;
+      for (unsigned i = 0; i < n_row; i++)
+      {
+        r_norm += r[i] * r[i];
+      }
+      if (sqrt(r_norm) <= tolerance * b_norm)
+      {
+        break;
+      }
+
+      // Find the column that reduces the residual most rapidly
+      double max_gradient = 0.0;
+      unsigned new_col = n_col;
+      for (unsigned j = 0; j < n_col; j++)
+      {
+        if ((!is_passive[j]) && (!is_excluded[j]))
+        {
+          double gradient = 0.0;
+          for (unsigned i = 0; i < n_row; i++)
+          {
+            gradient += g_column[j][i] * r[i];
+          }
+          if (gradient > max_gradient)
+          {
+            max_gradient = gradient;
+            new_col = j;
+          }
+        }
+      }
+
+      // No further improvement possible
+      if (new_col == n_col)
+      {
+        break;
+      }
+
+      // Append the new column to the QR factorisation: Orthogonalise it
+      // against the current columns of Q by modified Gram-Schmidt (twice,
+      // for stability)
+      const unsigned n_passive_old = passive.size();
+      const Vector<double>& g_new = g_column[new_col];
+      Vector<double> q_new(g_new);
+      Vector<double> r_new(n_passive_old + 1, 0.0);
+      double g_new_norm = 0.0;
+      for (unsigned i = 0; i < n_row; i++)
+      {
+        g_new_norm += g_new[i] * g_new[i];
+      }
+      g_new_norm = sqrt(g_new_norm);
+      for (unsigned sweep = 0; sweep < 2; sweep++)
+      {
+        for (unsigned k = 0; k < n_passive_old; k++)
+        {
+          double dot = 0.0;
+          for (unsigned i = 0; i < n_row; i++)
+          {
+            dot += q[k][i] * q_new[i];
+          }
+          for (unsigned i = 0; i < n_row; i++)
+          {
+            q_new[i] -= dot * q[k][i];
+          }
+          r_new[k] += dot;
+        }
+      }
+      double q_new_norm = 0.0;
+      for (unsigned i = 0; i < n_row; i++)
+      {
+        q_new_norm += q_new[i] * q_new[i];
+      }
+      q_new_norm = sqrt(q_new_norm);
+
+      // The column is (numerically) in the span of the passive columns
+      // and can't reduce the residual any further
+      if (q_new_norm <= 1.0e-12 * g_new_norm)
+      {
+        is_excluded[new_col] = true;
+        continue;
+      }
+      for (unsigned i = 0; i < n_row; i++)
+      {
+        q_new[i] /= q_new_norm;
+      }
+      r_new[n_passive_old] = q_new_norm;
+      double qt_b_new = 0.0;
+      for (unsigned i = 0; i < n_row; i++)
+      {
+        qt_b_new += q_new[i] * b[i];
+      }
+      q.push_back(q_new);
+      r_col.push_back(r_new);
+      qt_b.push_back(qt_b_new);
+      passive.push_back(new_col);
+      is_passive[new_col] = true;
+
+      // Inner loop: Solve the least-squares problem on the passive set and
+      // step back towards the feasible region if required
+      bool first_solve = true;
+      while (true)
+      {
+        const unsigned n_passive = passive.size();
+
+        // Solve R z = Q^T b by back substitution
+        Vector<double> z(qt_b);
+        for (int k = n_passive - 1; k >= 0; k--)
+        {
+          for (unsigned l = k + 1; l < n_passive; l++)
+          {
+            z[k] -= r_col[l][k] * z[l];
+          }
+          z[k] /= r_col[k][k];
+        }
+
+        // Lawson-Hanson guard: If the weight of the column that has just
+        // entered is not positive, remove it again (it's the last column
+        // so the QR factorisation is simply truncated) and exclude it
+        // from now on. The weights are unchanged.
+        if (first_solve && (z[n_passive - 1] <= 0.0))
+        {
+          q.pop_back();
+          r_col.pop_back();
+          qt_b.pop_back();
+          passive.pop_back();
+          is_passive[new_col] = false;
+          is_excluded[new_col] = true;
+          break;
+        }
+        first_solve = false;
+
+        // All positive? Accept the solution
+        bool feasible = true;
+        for (unsigned k = 0; k < n_passive; k++)
+        {
+          if (z[k] <= 0.0)
+          {
+            feasible = false;
+            break;
+          }
+        }
+        if (feasible)
+        {
+          for (unsigned k = 0; k < n_passive; k++)
+          {
+            w[passive[k]] = z[k];
+          }
+          break;
+        }
+
+        // Step from w towards z until the first weight becomes zero
+        double alpha = 1.0;
+        for (unsigned k = 0; k < n_passive; k++)
+        {
+          if (z[k] <= 0.0)
+          {
+            const double w_k = w[passive[k]];
+            alpha = std::min(alpha, w_k / (w_k - z[k]));
+          }
+        }
+        for (unsigned k = 0; k < n_passive; k++)
+        {
+          double& w_k = w[passive[k]];
+          w_k += alpha * (z[k] - w_k);
+        }
+
+        // Remove the columns whose weights have become zero from the
+        // passive set (in reverse order so that the indices of the
+        // columns that are still to be removed don't change)
+        for (int k = n_passive - 1; k >= 0; k--)
+        {
+          double& w_k = w[passive[k]];
+          if (w_k > 1.0e-14)
+          {
+            continue;
+          }
+          w_k = 0.0;
+          is_passive[passive[k]] = false;
+          passive.erase(passive.begin() + k);
+
+          // Delete column k of R, which leaves R upper Hessenberg from
+          // column k onwards; restore the triangular form by Givens
+          // rotations of the rows (and of the columns of Q and the
+          // entries of Q^T b)
+          r_col.erase(r_col.begin() + k);
+          const unsigned n_remaining = r_col.size();
+          for (unsigned l = k; l < n_remaining; l++)
+          {
+            const double a = r_col[l][l];
+            const double c = r_col[l][l + 1];
+            const double rho = sqrt(a * a + c * c);
+            const double cos_theta = a / rho;
+            const double sin_theta = c / rho;
+            for (unsigned m = l; m < n_remaining; m++)
+            {
+              const double upper = r_col[m][l];
+              const double lower = r_col[m][l + 1];
+              r_col[m][l] = cos_theta * upper + sin_theta * lower;
+              r_col[m][l + 1] = -sin_theta * upper + cos_theta * lower;
+            }
+            for (unsigned i = 0; i < n_row; i++)
+            {
+              const double upper = q[l][i];
+              const double lower = q[l + 1][i];
+              q[l][i] = cos_theta * upper + sin_theta * lower;
+              q[l + 1][i] = -sin_theta * upper + cos_theta * lower;
+            }
+            const double upper = qt_b[l];
+            const double lower = qt_b[l + 1];
+            qt_b[l] = cos_theta * upper + sin_theta * lower;
+            qt_b[l + 1] = -sin_theta * upper + cos_theta * lower;
+          }
+
+          // The last row of R is now zero: Drop it, together with the
+          // last column of Q
+          for (unsigned l = k; l < n_remaining; l++)
+          {
+            r_col[l].pop_back();
+          }
+          q.pop_back();
+          qt_b.pop_back();
+        }
+        if (passive.size() == 0)
+        {
+          break;
+        }
+      }
+
+      // Update the residual
+      r = b;
+      const unsigned n_passive = passive.size();
+      for (unsigned k = 0; k < n_passive; k++)
+      {
+        const Vector<double>& g_k = g_column[passive[k]];
+        const double w_k = w[passive[k]];
+        for (unsigned i = 0; i < n_row; i++)
+        {
+          r[i] -= w_k * g_k[i];
+        }
+      }
+    }
+  }
+
+} // namespace oomph
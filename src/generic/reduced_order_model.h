@@ -0,0 +1,356 @@
+// LIC// ====================================================================
+// LIC// This file forms part of oomph-lib, the object-oriented,
+// LIC// multi-physics finite-element library, available
+// LIC// at http://www.oomph-lib.org.
+// LIC//
+// LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+// LIC//
+// LIC// This library is free software; you can redistribute it and/or
+// LIC// modify it under the terms of the GNU Lesser General Public
+// LIC// License as published by the Free Software Foundation; either
+// LIC// version 2.1 of the License, or (at your option) any later version.
+// LIC//
+// LIC// This library is distributed in the hope that it will be useful,
+// LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// LIC// Lesser General Public License for more details.
+// LIC//
+// LIC// You should have received a copy of the GNU Lesser General Public
+// LIC// License along with this library; if not, write to the Free Software
+// LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// LIC// 02110-1301  USA.
+// LIC//
+// LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+// LIC//
+// LIC//====================================================================
+#ifndef OOMPH_REDUCED_ORDER_MODEL_HEADER
+#define OOMPH_REDUCED_ORDER_MODEL_HEADER
+
+// Config header generated by autoconfig
+#ifdef HAVE_CONFIG_H
+#include <oomph-lib-config.h>
+#endif
+
+// oomph-lib headers
+#include "Vector.h"
+#include "matrices.h"
+#include "double_vector.h"
+#include "double_multi_vector.h"
+#include "problem.h"
+
+namespace oomph
+{
+  //======================================================================
+  /// Proper orthogonal decomposition (POD) based reduced-order model
+  /// for a Problem. Usage:
+  /// - Solve the full Problem for a few representative parameter values
+  ///   (or at a few instants in a time integration) and call
+  ///   add_snapshot() after each solve to record the current dofs.
+  /// - Call build_pod_basis(...) to compute the POD modes from the
+  ///   (centred) snapshots using a randomised singular value
+  ///   decomposition.
+  /// - Optionally call setup_hyper_reduction(...) to select a
+  ///   small, weighted subset of the elements (energy-conserving sampling
+  ///   and weighting, ECSW) so that the reduced residuals and Jacobian can
+  ///   be assembled without looping over all elements.
+  /// - Change the parameters and call reduced_newton_solve() to solve the
+  ///   Galerkin-projected equations for the modal coefficients. On return
+  ///   the Problem's dofs contain the reduced-order approximation.
+  ///
+  /// The dofs are approximated by x = x_ref + Phi a where x_ref is the
+  /// reference state (the mean of the snapshots, unless centring is
+  /// disabled), Phi contains the POD modes and a are the modal
+  /// coefficients. The reduced residuals and Jacobian are
+  /// Phi^T r and Phi^T J Phi.
+  ///
+  /// The ReducedOrderModel works on the dofs and equation numbering
+  /// that are current when the snapshots are taken, so the Problem
+  /// must not be re-meshed (or have its equations renumbered) between
+  /// the collection of the snapshots and the use of the model.
+  /// Hyper-reduction is not available for distributed problems.
+  /// During the hyper-reduced Newton iterations only the dofs of the
+  /// sampled elements are updated; the remaining dofs are only set
+  /// (to x_ref + Phi a) once the iteration has finished.
+  //======================================================================
+  class ReducedOrderModel
+  {
+  public:
+    /// Constructor: Pass the Problem that is to be reduced
+    ReducedOrderModel(Problem* problem_pt)
+      : Problem_pt(problem_pt),
+        Centre_snapshots(true),
+        N_oversample(10),
+        N_power_iteration(1),
+        Random_seed(1),
+        Max_n_training_element(1000),
+        Use_hyper_reduction(false),
+        Doc_info(false)
+    {
+    }
+
+    /// Broken copy constructor
+    ReducedOrderModel(const ReducedOrderModel&) = delete;
+
+    /// Broken assignment operator
+    void operator=(const ReducedOrderModel&) = delete;
+
+    /// Empty destructor
+    virtual ~ReducedOrderModel() {}
+
+    /// Add the Problem's current dofs as a snapshot
+    void add_snapshot()
+    {
+      DoubleVector dofs;
+      Problem_pt->get_dofs(dofs);
+      add_snapshot(dofs);
+    }
+
+    /// Add the specified vector of dofs as a snapshot
+    void add_snapshot(const DoubleVector& dofs);
+
+    /// Number of snapshots
+    unsigned nsnapshot() const
+    {
+      return Snapshot.size();
+    }
+
+    /// Wipe the snapshots (the basis is retained)
+    void clear_snapshots()
+    {
+      Snapshot.clear();
+    }
+
+    /// Centre the snapshots about their mean before computing the
+    /// POD basis (default). The mean becomes the reference state.
+    void enable_centring()
+    {
+      Centre_snapshots = true;
+    }
+
+    /// Don't centre the snapshots; the reference state is zero
+    void disable_centring()
+    {
+      Centre_snapshots = false;
+    }
+
+    /// Number of additional random samples used in the randomised
+    /// SVD (default: 10)
+    unsigned& n_oversample()
+    {
+      return N_oversample;
+    }
+
+    /// Number of power (subspace) iterations used in the randomised
+    /// SVD to sharpen the decay of the singular values (default: 1)
+    unsigned& n_power_iteration()
+    {
+      return N_power_iteration;
+    }
+
+    /// Seed for the random test matrix in the randomised SVD and for
+    /// the random sample of the candidate elements in the
+    /// hyper-reduction
+    unsigned& random_seed()
+    {
+      return Random_seed;
+    }
+
+    /// Maximum number of elements that are considered as candidates
+    /// for the sampled elements in the hyper-reduction (default: 1000).
+    /// If the mesh has more elements, a random sample of this many
+    /// elements forms the candidates; zero means all elements.
+    unsigned& max_n_training_element()
+    {
+      return Max_n_training_element;
+    }
+
+    /// Build the POD basis from the snapshots, retaining at most
+    /// max_n_mode modes. If energy_tolerance is positive the number of
+    /// modes is reduced further to the smallest number for which the
+    /// fraction of the snapshots' "energy" (the sum of the squared
+    /// singular values) that is not captured by the basis is less than
+    /// energy_tolerance. Any previous hyper-reduction is discarded.
+    void build_pod_basis(const unsigned& max_n_mode,
+                         const double& energy_tolerance = 0.0);
+
+    /// Number of POD modes
+    unsigned nmode() const
+    {
+      return Basis.nvector();
+    }
+
+    /// The POD modes (one vector per mode)
+    const DoubleMultiVector& basis() const
+    {
+      return Basis;
+    }
+
+    /// The singular values of the (centred) snapshot matrix
+    /// computed by the randomised SVD, in decreasing order
+    const Vector<double>& singular_values() const
+    {
+      return Singular_value;
+    }
+
+    /// The reference state x_ref
+    const DoubleVector& reference_dofs() const
+    {
+      return Reference_dofs;
+    }
+
+    /// Modal coefficients of the best approximation of the
+    /// specified dofs: a = Phi^T (x - x_ref)
+    void project(const DoubleVector& dofs, Vector<double>& coefficients) const;
+
+    /// Set the Problem's dofs to x_ref + Phi a for the specified
+    /// modal coefficients
+    void set_problem_dofs(const Vector<double>& coefficients);
+
+    /// Get the reduced residuals Phi^T r at the Problem's current dofs
+    void get_reduced_residuals(Vector<double>& reduced_residuals);
+
+    /// Get the reduced residuals Phi^T r and the reduced Jacobian
+    /// Phi^T J Phi at the Problem's current dofs
+    void get_reduced_jacobian(Vector<double>& reduced_residuals,
+                              DenseDoubleMatrix& reduced_jacobian);
+
+    /// Solve the reduced (Galerkin-projected) equations by Newton's
+    /// method, starting from the projection of the Problem's current
+    /// dofs. Uses the Problem's Newton tolerance and maximum number of
+    /// iterations and calls the Problem's actions_before/after_newton_...
+    /// functions (with hyper-reduction, only the dofs of the sampled
+    /// elements are up to date in the actions_..._newton_step() and
+    /// actions_before_newton_convergence_check() functions). On return
+    /// the Problem's dofs contain the reduced-order solution. Throws a
+    /// NewtonSolverError if the iteration fails to converge.
+    void reduced_newton_solve();
+
+    /// Select the sampled elements and their weights for the
+    /// hyper-reduction by energy-conserving sampling and weighting
+    /// (ECSW): The weights are the non-negative least-squares solution
+    /// that reproduces the reduced residuals and Jacobians at the
+    /// snapshots to within the specified relative tolerance; most of
+    /// them are zero. Requires the snapshots used to build the basis.
+    /// Note: the training matrix has nsnapshot()*nmode()*(nmode()+1) rows
+    /// and one column per candidate element (see
+    /// max_n_training_element()).
+    void setup_hyper_reduction(const double& tolerance = 1.0e-4);
+
+    /// Switch off the hyper-reduction: assemble the reduced equations
+    /// from all elements
+    void disable_hyper_reduction()
+    {
+      Use_hyper_reduction = false;
+    }
+
+    /// Number of elements sampled by the hyper-reduction
+    unsigned nsampled_element() const
+    {
+      return Sampled_element_pt.size();
+    }
+
+    /// Enable documentation of the basis construction and the
+    /// reduced Newton iterations
+    void enable_doc_info()
+    {
+      Doc_info = true;
+    }
+
+    /// Disable documentation of the basis construction and the
+    /// reduced Newton iterations (default)
+    void disable_doc_info()
+    {
+      Doc_info = false;
+    }
+
+  private:
+    /// Set the dofs of the sampled elements to x_ref + Phi a for the
+    /// specified modal coefficients (the other dofs are not changed)
+    void set_sampled_dofs(const Vector<double>& coefficients);
+
+    /// Add the weighted contributions of the sampled elements to the
+    /// reduced residuals and (if flag=1) the reduced Jacobian
+    void get_hyper_reduced_residuals_and_jacobian(
+      Vector<double>& reduced_residuals,
+      DenseDoubleMatrix& reduced_jacobian,
+      const unsigned& flag);
+
+    /// Get the reduced contributions of element e (projected onto the
+    /// basis) to the residuals and (if flag=1) the Jacobian. Returns the
+    /// number of the element's dofs
+    unsigned get_reduced_element_contribution(
+      GeneralisedElement* const& elem_pt,
+      Vector<double>& reduced_residuals,
+      DenseMatrix<double>& reduced_jacobian,
+      const unsigned& flag);
+
+    /// Orthonormalise the vectors in q by modified Gram-Schmidt;
+    /// (numerically) linearly dependent vectors are removed
+    void orthonormalise(DoubleMultiVector& q);
+
+    /// Eigen-decomposition of the symmetric matrix a (which is
+    /// overwritten) by the cyclic Jacobi method; eigenvalues are returned
+    /// in decreasing order, eigenvectors are stored column-wise
+    void symmetric_eigen_decomposition(DenseMatrix<double>& a,
+                                       Vector<double>& eigenvalue,
+                                       DenseMatrix<double>& eigenvector);
+
+    /// Solve the non-negative least-squares problem
+    /// min |G w - b| subject to w >= 0 (Lawson-Hanson active set
+    /// algorithm), stopping as soon as |G w - b| <= tolerance |b|.
+    /// G is stored column-wise.
+    void solve_nnls(const Vector<Vector<double>>& g_column,
+                    const Vector<double>& b,
+                    const double& tolerance,
+                    Vector<double>& w);
+
+    /// Pointer to the Problem
+    Problem* Problem_pt;
+
+    /// The snapshots
+    Vector<DoubleVector> Snapshot;
+
+    /// The reference state
+    DoubleVector Reference_dofs;
+
+    /// The POD modes
+    DoubleMultiVector Basis;
+
+    /// Singular values of the (centred) snapshot matrix
+    Vector<double> Singular_value;
+
+    /// Centre the snapshots about their mean?
+    bool Centre_snapshots;
+
+    /// Oversampling in the randomised SVD
+    unsigned N_oversample;
+
+    /// Number of power iterations in the randomised SVD
+    unsigned N_power_iteration;
+
+    /// Seed for the random test matrix (and the random sample of the
+    /// candidate elements for the hyper-reduction)
+    unsigned Random_seed;
+
+    /// Maximum number of candidate elements for the hyper-reduction
+    unsigned Max_n_training_element;
+
+    /// Use the hyper-reduction?
+    bool Use_hyper_reduction;
+
+    /// The elements sampled by the hyper-reduction
+    Vector<GeneralisedElement*> Sampled_element_pt;
+
+    /// The weights of the sampled elements
+    Vector<double> Sampled_element_weight;
+
+    /// The (sorted) equation numbers of the dofs of the sampled elements
+    Vector<unsigned long> Sampled_eqn_number;
+
+    /// Doc the basis construction and the reduced Newton iterations?
+    bool Doc_info;
+  };
+
+} // namespace oomph
+
+#endif
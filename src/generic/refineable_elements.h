@@ -762,6 +762,18 @@ namespace oomph
                           Mesh* const& mesh_pt,
                           GeneralisedElement* const& clone_pt) = 0;
 
+    /// Smoothness indicator for the i_value-th nodal value, used to
+    /// choose between h- and p-refinement: An estimate of the rate sigma
+    /// at which the coefficients of its expansion in Legendre polynomials
+    /// decay, |a_k| ~ exp(-sigma k). Large values indicate a locally
+    /// smooth (analytic) solution, for which p-refinement is the most
+    /// efficient. Default: Return zero (no evidence of smoothness), so
+    /// hp-adaptation h-refines the element. Overload as required.
+    virtual double legendre_smoothness_indicator(const unsigned& /*i_value*/)
+    {
+      return 0.0;
+    }
+
     // Overload the nodes_built function to check every node
     bool nodes_built()
     {
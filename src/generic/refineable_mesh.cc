@@ -195,6 +195,40 @@ namespace oomph
   }
 
 
+  //========================================================================
+  /// Get the Morton keys of the leaves in all trees of the forest,
+  /// packed as in LinearTreeForest::get_leaf_keys(...)
+  //========================================================================
+  void TreeBasedRefineableMeshBase::get_refinement_pattern_as_leaf_keys(
+    Vector<unsigned long long>& packed_keys)
+  {
+    LinearTreeForest linear_forest(forest_pt());
+    linear_forest.get_leaf_keys(packed_keys);
+  }
+
+
+  //========================================================================
+  /// Refine base mesh such that its leaves are those specified by
+  /// their Morton keys, packed as in LinearTreeForest::get_leaf_keys(...)
+  //========================================================================
+  void TreeBasedRefineableMeshBase::refine_base_mesh_from_leaf_keys(
+    const Vector<unsigned long long>& packed_keys)
+  {
+    // Convert to refinement pattern (nothing to be refined if there
+    // are no trees; we still need to participate in the refinement)
+    Vector<Vector<unsigned>> to_be_refined;
+    if (forest_pt()->ntree() > 0)
+    {
+      unsigned dim = forest_pt()->tree_pt(0)->object_pt()->dim();
+      LinearTreeForest::get_refinement_pattern(
+        packed_keys, dim, to_be_refined);
+    }
+
+    // Refine
+    refine_base_mesh(to_be_refined);
+  }
+
+
   //========================================================================
   /// Refine base mesh according to refinement pattern in restart file
   //========================================================================
@@ -995,12 +1029,16 @@ namespace oomph
         // Pre-build must be performed before any elements are built
         leaf_nodes_pt[e]->object_pt()->pre_build(mesh_pt, new_node_pt);
       }
+      Refinement_node_hash_table.clear();
+      Refinement_node_hash_table_is_active = Use_refinement_node_hash_table;
       for (unsigned long e = 0; e < num_tree_nodes; e++)
       {
         // Now do the actual build of the new elements
         leaf_nodes_pt[e]->object_pt()->build(
           mesh_pt, new_node_pt, was_already_built, new_nodes_file);
       }
+      Refinement_node_hash_table_is_active = false;
+      Refinement_node_hash_table.clear();
 
 
       double t_end = 0.0;
@@ -1181,6 +1219,8 @@ namespace oomph
       // Copy the elements into the mesh Vector
       num_tree_nodes = tree_nodes_pt.size();
       Element_pt.resize(num_tree_nodes);
+      flush_element_type_groups();
+      flush_local_eqn_table();
       for (unsigned long e = 0; e < num_tree_nodes; e++)
       {
         Element_pt[e] = tree_nodes_pt[e]->object_pt();
@@ -4372,6 +4412,264 @@ namespace oomph
   }
 
 
+  //========================================================================
+  /// Do adaptive hp-refinement for mesh.
+  /// - Pass Vector of error estimates for all elements.
+  /// - Refine those whose errors exceeds the threshold: Elements in
+  ///   which the solution is (locally) smooth, i.e. whose
+  ///   legendre_smoothness_indicator() is at least
+  ///   smoothness_threshold_for_p_refinement(), are p-refined if
+  ///   that's predicted to reduce the error at lower cost than
+  ///   h-refinement; all others are h-refined.
+  /// - p-unrefine those whose errors is less than threshold.
+  ///   (h-unrefinement is left to adapt().)
+  ///
+  /// The choice between h- and p-refinement is based on the a-priori
+  /// error reduction per unit of added cost: p-refinement reduces the
+  /// error by a factor exp(-sigma), where sigma is the decay rate of the
+  /// Legendre coefficients; h-refinement of a smooth solution by (at
+  /// best) 2^{-(p-1)}, where p is the number of nodes along an edge. The
+  /// cost is either the number of nodes (~dofs) or, if
+  /// enable_hp_adapt_assembly_cost_model() has been called, the
+  /// predicted assembly cost (nnode^2 x nknot) of the element(s).
+  //========================================================================
+  void TreeBasedRefineableMeshBase::hp_adapt(
+    const Vector<double>& elemental_error)
+  {
+    // Set the refinement tolerance to be the max permissible error
+    double refine_tol = this->max_permitted_error();
+
+    // Set the unrefinement tolerance to be the min permissible error
+    double unrefine_tol = this->min_permitted_error();
+
+    // Setup doc info
+    DocInfo local_doc_info;
+    if (doc_info_pt() == 0)
+    {
+      local_doc_info.disable_doc();
+    }
+    else
+    {
+      local_doc_info = this->doc_info();
+    }
+
+    // Check that the errors make sense
+    if (refine_tol <= unrefine_tol)
+    {
+      std::ostringstream error_stream;
+      error_stream << "Refinement tolerance <= Unrefinement tolerance"
+                   << refine_tol << " " << unrefine_tol << std::endl
+                   << "doesn't make sense and will almost certainly crash"
+                   << std::endl
+                   << "this beautiful code!" << std::endl;
+
+      throw OomphLibError(
+        error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+
+    // Select elements for refinement and unrefinement
+    //================================================
+    // Reset counter for number of elements that would like to be
+    // refined further but can't
+    this->nrefinement_overruled() = 0;
+
+    unsigned n_h_refine = 0;
+    unsigned n_p_refine = 0;
+    unsigned n_p_unrefine = 0;
+
+    // Loop over all elements and mark them according to the error criterion
+    unsigned long Nelement = this->nelement();
+    for (unsigned long e = 0; e < Nelement; e++)
+    {
+      //(Cast) pointer to the element
+      PRefineableElement* el_pt =
+        dynamic_cast<PRefineableElement*>(this->element_pt(e));
+
+#ifdef PARANOID
+      if (el_pt == 0)
+      {
+        throw OomphLibError("hp-adaptation requires PRefineableElements",
+                            OOMPH_CURRENT_FUNCTION,
+                            OOMPH_EXCEPTION_LOCATION);
+      }
+#endif
+
+      // Initially element is not to be refined
+      el_pt->deselect_for_refinement();
+      el_pt->deselect_for_p_refinement();
+      el_pt->deselect_for_p_unrefinement();
+
+      // Don't merge any sons here
+      if (el_pt->tree_pt()->father_pt() != 0)
+      {
+        el_pt->tree_pt()
+          ->father_pt()
+          ->object_pt()
+          ->deselect_sons_for_unrefinement();
+      }
+
+      // If the element error exceeds the threshold ...
+      if (elemental_error[e] > refine_tol)
+      {
+        // Which kinds of refinement are permitted?
+        bool can_p_refine =
+          (el_pt->p_refinement_is_enabled()) &&
+          (el_pt->p_order() < this->max_p_refinement_level());
+        bool can_h_refine =
+          (el_pt->refinement_is_enabled()) &&
+          (el_pt->refinement_level() < this->max_refinement_level());
+
+        // Choose p-refinement if the solution is smooth enough and
+        // p-refinement is cheaper
+        bool p_refine = can_p_refine;
+        if (can_p_refine && can_h_refine)
+        {
+          double sigma = el_pt->legendre_smoothness_indicator(
+            Smoothness_indicator_value_index);
+          if (sigma < Smoothness_threshold_for_p_refinement)
+          {
+            p_refine = false;
+          }
+          else
+          {
+            // Cost of an element with p_order nodes along each edge
+            unsigned p_order = el_pt->p_order();
+            unsigned dim = el_pt->dim();
+            double exponent = double(dim);
+            if (Hp_adapt_minimises_assembly_cost)
+            {
+              exponent *= 3.0;
+            }
+            double cost = std::pow(double(p_order), exponent);
+            double added_cost_p =
+              std::pow(double(p_order + 1), exponent) - cost;
+            double added_cost_h = (std::pow(2.0, double(dim)) - 1.0) * cost;
+
+            // Predicted (log of the) error reduction per added cost
+            double gain_p = sigma / added_cost_p;
+            double gain_h =
+              double(p_order - 1) * std::log(2.0) / added_cost_h;
+            p_refine = (gain_p >= gain_h);
+          }
+        }
+
+        if (p_refine)
+        {
+          el_pt->select_for_p_refinement();
+          n_p_refine++;
+        }
+        else if (can_h_refine)
+        {
+          el_pt->select_for_refinement();
+          n_h_refine++;
+        }
+        // ... otherwise mark it as having been over-ruled
+        else
+        {
+          this->nrefinement_overruled() += 1;
+        }
+      }
+      else if (elemental_error[e] < unrefine_tol)
+      {
+        // p-unrefine if the element's p-order is more than the minimum
+        // desired level and its initial p-order
+        if ((el_pt->p_refinement_is_enabled()) &&
+            (el_pt->p_order() > this->min_p_refinement_level()) &&
+            (el_pt->p_order() > el_pt->initial_p_order()))
+        {
+          el_pt->select_for_p_unrefinement();
+          n_p_unrefine++;
+        }
+      }
+    }
+
+    oomph_info << " \n Number of elements to be h-refined: " << n_h_refine
+               << std::endl;
+    oomph_info << " \n Number of elements to be p-refined: " << n_p_refine
+               << std::endl;
+    oomph_info << " \n Number of elements whose refinement was overruled: "
+               << this->nrefinement_overruled() << std::endl;
+    oomph_info << " \n Number of elements to be p-unrefined : " << n_p_unrefine
+               << std::endl
+               << std::endl;
+
+    // All processes need to take part in the adaptation if ANY
+    // refinement is to take place anywhere (see adapt())
+    unsigned n_change[3] = {n_h_refine, n_p_refine, n_p_unrefine};
+    unsigned total_n_change[3] = {n_change[0], n_change[1], n_change[2]};
+#ifdef OOMPH_HAS_MPI
+    if (this->is_mesh_distributed())
+    {
+      MPI_Allreduce(n_change,
+                    total_n_change,
+                    3,
+                    MPI_UNSIGNED,
+                    MPI_SUM,
+                    Comm_pt->mpi_comm());
+    }
+#endif
+
+    oomph_info << "---> " << total_n_change[0] << " elements to be h-refined, "
+               << total_n_change[1] << " to be p-refined, and "
+               << total_n_change[2] << " to be p-unrefined, in total."
+               << std::endl;
+
+    bool do_p_adapt = ((total_n_change[1] > 0) ||
+                       (total_n_change[2] > this->max_keep_unrefined()));
+    bool do_h_adapt = (total_n_change[0] > 0);
+
+    // Do the p-refinement first: It doesn't change the elements, so the
+    // elements' selection for h-refinement is retained
+    if (do_p_adapt)
+    {
+      p_adapt_mesh(local_doc_info);
+    }
+    if (do_h_adapt)
+    {
+      adapt_mesh(local_doc_info);
+    }
+
+    if (do_p_adapt || do_h_adapt)
+    {
+      // The number of refineable elements is still local to each process
+      this->Nrefined = n_h_refine + n_p_refine;
+      this->Nunrefined = n_p_unrefine;
+    }
+    // If not worthwhile, say so but still reorder nodes and kill external
+    // storage for consistency in parallel computations
+    else
+    {
+#ifdef OOMPH_HAS_MPI
+      // Delete any external element storage - any interaction will still
+      // be set up on the fly again, so we need to get rid of old information.
+      this->delete_all_external_storage();
+#endif
+
+      // Reorder the nodes within the mesh's node vector
+      // to establish a standard ordering regardless of the sequence
+      // of mesh refinements -- this is required to allow dump/restart
+      // on refined meshes
+      this->reorder_nodes();
+
+#ifdef OOMPH_HAS_MPI
+      // Now (re-)classify halo and haloed nodes and synchronise hanging
+      // nodes
+      if (this->is_mesh_distributed())
+      {
+        DocInfo doc_info;
+        doc_info.disable_doc();
+        classify_halo_and_haloed_nodes(doc_info, doc_info.is_doc_enabled());
+      }
+#endif
+
+      oomph_info << "\n Not enough benefit in adapting mesh. " << std::endl
+                 << std::endl;
+      this->Nunrefined = 0;
+      this->Nrefined = 0;
+    }
+  }
+
+
   //================================================================
   /// p-adapt mesh, which exists in two representations,
   /// namely as:
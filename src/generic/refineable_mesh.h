@@ -32,6 +32,7 @@
 // Must be called after refineable_element.h
 #include "tree.template.cc"
 #include "error_estimator.h"
+#include "linear_tree.h"
 
 namespace oomph
 {
@@ -264,6 +265,23 @@ namespace oomph
         err_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
     }
 
+    /// hp-adapt mesh: Refine elements whose error is larger than err_max
+    /// (choosing h- or p-refinement for each element, based on the local
+    /// smoothness of the solution) and (try to) p-unrefine those whose
+    /// error is smaller than err_min
+    virtual void hp_adapt(const Vector<double>& /*elemental_error*/)
+    {
+      // Derived classes must implement this as required. Default throws an
+      // error.
+      std::ostringstream err_stream;
+      err_stream << "hp_adapt() called in base class RefineableMeshBase."
+                 << std::endl
+                 << "This needs to be implemented in the derived class."
+                 << std::endl;
+      throw OomphLibError(
+        err_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+
     /// Refine mesh uniformly and doc process
     virtual void refine_uniformly(DocInfo& doc_info) = 0;
 
@@ -386,6 +404,13 @@ namespace oomph
       Max_p_refinement_level = 7;
       Min_p_refinement_level = 2;
 
+      // hp-adaptation: p-refine elements in which the Legendre coefficients
+      // of the first nodal value decay at least like exp(-k), if that's
+      // the cheaper way of reducing the error in terms of dofs
+      Smoothness_threshold_for_p_refinement = 1.0;
+      Smoothness_indicator_value_index = 0;
+      Hp_adapt_minimises_assembly_cost = false;
+
       // Stats
       Nrefined = 0;
       Nunrefined = 0;
@@ -396,6 +421,10 @@ namespace oomph
       // Initialise the forest pointer to NULL
       Forest_pt = 0;
 
+      // Look up nodes created during the refinement in a hash table
+      Use_refinement_node_hash_table = true;
+      Refinement_node_hash_table_is_active = false;
+
       // Mesh hasn't been pruned yet
       Uniform_refinement_level_when_pruned = 0;
     }
@@ -427,6 +456,13 @@ namespace oomph
     /// and (try to) unrefine those whose error is smaller than err_min
     void p_adapt(const Vector<double>& elemental_error);
 
+    /// hp-adapt mesh: Refine elements whose error is larger than
+    /// err_max -- by p-refinement if the solution is locally smooth
+    /// enough and that's the cheaper way to reduce the error, by
+    /// h-refinement otherwise -- and (try to) p-unrefine those whose
+    /// error is smaller than err_min
+    void hp_adapt(const Vector<double>& elemental_error);
+
     /// Refine mesh uniformly and doc process
     void refine_uniformly(DocInfo& doc_info);
 
@@ -462,6 +498,36 @@ namespace oomph
       return Forest_pt;
     }
 
+    /// Pointer to the hash table of the nodes that have been created
+    /// while the new elements are built in adapt_mesh(...) (used to
+    /// avoid the search for nodes that have already been created by
+    /// neighbouring sons); NULL if we're not building elements or if
+    /// its use has been disabled.
+    RefinementNodeHashTable* refinement_node_hash_table_pt()
+    {
+      if (Refinement_node_hash_table_is_active)
+      {
+        return &Refinement_node_hash_table;
+      }
+      return 0;
+    }
+
+    /// Enable the use of a hash table to find the nodes that have been
+    /// created by neighbouring sons while building the new elements
+    /// during the refinement (default)
+    void enable_refinement_node_hash_table()
+    {
+      Use_refinement_node_hash_table = true;
+    }
+
+    /// Disable the use of the hash table: find all the nodes that have
+    /// been created by neighbouring sons during the refinement by
+    /// searching the neighbours
+    void disable_refinement_node_hash_table()
+    {
+      Use_refinement_node_hash_table = false;
+    }
+
 
     /// Doc the targets for mesh adaptation
     void doc_adaptivity_targets(std::ostream& outfile)
@@ -508,6 +574,37 @@ namespace oomph
       return Min_p_refinement_level;
     }
 
+    /// Access fct for the smoothness threshold used in hp_adapt(): Elements
+    /// in which the Legendre coefficients of the solution decay more slowly
+    /// than exp(-threshold*k) are h-refined.
+    double& smoothness_threshold_for_p_refinement()
+    {
+      return Smoothness_threshold_for_p_refinement;
+    }
+
+    /// Access fct for the index of the nodal value whose smoothness is
+    /// assessed in hp_adapt()
+    unsigned& smoothness_indicator_value_index()
+    {
+      return Smoothness_indicator_value_index;
+    }
+
+    /// In hp_adapt(), choose between h- and p-refinement of smooth
+    /// elements so as to minimise the predicted assembly cost (which
+    /// grows like nnode^2 x nknot per element) rather than the number of
+    /// dofs.
+    void enable_hp_adapt_assembly_cost_model()
+    {
+      Hp_adapt_minimises_assembly_cost = true;
+    }
+
+    /// In hp_adapt(), choose between h- and p-refinement of smooth
+    /// elements so as to minimise the number of dofs (default).
+    void disable_hp_adapt_assembly_cost_model()
+    {
+      Hp_adapt_minimises_assembly_cost = false;
+    }
+
     /// Perform the actual tree-based mesh adaptation,
     /// documenting the progress in the directory specified in DocInfo object.
     virtual void adapt_mesh(DocInfo& doc_info);
@@ -602,6 +699,17 @@ namespace oomph
     /// Refine base mesh according to specified refinement pattern
     void refine_base_mesh(Vector<Vector<unsigned>>& to_be_refined);
 
+    /// Get the Morton keys of the leaves in all trees of the forest,
+    /// packed as in LinearTreeForest::get_leaf_keys(...). A more compact
+    /// (and numbering-independent) alternative to the refinement pattern.
+    void get_refinement_pattern_as_leaf_keys(
+      Vector<unsigned long long>& packed_keys);
+
+    /// Refine base mesh such that its leaves are those specified by
+    /// their Morton keys, packed as in LinearTreeForest::get_leaf_keys(...)
+    void refine_base_mesh_from_leaf_keys(
+      const Vector<unsigned long long>& packed_keys);
+
     /// Refine mesh according to refinement pattern in restart file
     virtual void refine(std::ifstream& restart_file);
 
@@ -764,9 +872,32 @@ namespace oomph
     /// Min. permissible p-refinement level (relative to base mesh)
     unsigned Min_p_refinement_level;
 
+    /// Elements in which the Legendre coefficients of the solution decay
+    /// more slowly than exp(-Smoothness_threshold_for_p_refinement*k)
+    /// are h-refined by hp_adapt()
+    double Smoothness_threshold_for_p_refinement;
+
+    /// Index of the nodal value whose smoothness is assessed in hp_adapt()
+    unsigned Smoothness_indicator_value_index;
+
+    /// Does hp_adapt() minimise the predicted assembly cost (rather
+    /// than the number of dofs)?
+    bool Hp_adapt_minimises_assembly_cost;
+
     /// Forest representation of the mesh
     TreeForest* Forest_pt;
 
+    /// Hash table of the nodes that have been created while building
+    /// the new elements in adapt_mesh(...)
+    RefinementNodeHashTable Refinement_node_hash_table;
+
+    /// Use the hash table for the nodes created during the refinement?
+    bool Use_refinement_node_hash_table;
+
+    /// Is the hash table for the nodes currently being filled, i.e. are
+    /// we building the new elements in adapt_mesh(...)?
+    bool Refinement_node_hash_table_is_active;
+
   private:
 #ifdef OOMPH_HAS_MPI
 
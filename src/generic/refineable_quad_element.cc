@@ -28,6 +28,7 @@
 #include "mesh.h"
 #include "algebraic_elements.h"
 #include "macro_element_node_update_element.h"
+#include "refineable_mesh.h"
 #include "refineable_quad_element.h"
 
 namespace oomph
@@ -691,6 +692,16 @@ namespace oomph
       // Number of history values (incl. present)
       unsigned ntstorage = time_stepper_pt->ntstorage();
 
+      // Hash table of the nodes that have already been created by other
+      // sons during the current refinement (if the mesh provides one)
+      RefinementNodeHashTable* node_hash_table_pt = 0;
+      TreeBasedRefineableMeshBase* ref_mesh_pt =
+        dynamic_cast<TreeBasedRefineableMeshBase*>(mesh_pt);
+      if (ref_mesh_pt != 0)
+      {
+        node_hash_table_pt = ref_mesh_pt->refinement_node_hash_table_pt();
+      }
+
       // Currently we can't handle the case of generalised coordinates
       // since we haven't established how they should be interpolated
       // Buffer this case:
@@ -858,13 +869,25 @@ namespace oomph
             //-------------------------------------------
             else
             {
-              // Was the node created by one of its neighbours
+              // Has the node been created by another son in the same
+              // tree during the current refinement? (Such nodes are
+              // never periodic.)
+              bool is_periodic = false;
+              created_node_pt = 0;
+              if (node_hash_table_pt != 0)
+              {
+                created_node_pt =
+                  node_hash_table_pt->find(quadtree_pt(), s_fraction);
+              }
+
+              // If not, was the node created by one of its neighbours
               // Whether or not the node lies on an edge can be calculated
               // by from the fractional position
-              bool is_periodic = false;
-              ;
-              created_node_pt =
-                node_created_by_neighbour(s_fraction, is_periodic);
+              if (created_node_pt == 0)
+              {
+                created_node_pt =
+                  node_created_by_neighbour(s_fraction, is_periodic);
+              }
 
               // If the node was so created, assign the pointers
               if (created_node_pt != 0)
@@ -1326,6 +1349,13 @@ namespace oomph
                              << node_pt(jnod)->x(1) << std::endl;
             }
 
+            // Make the node available to the other sons in the tree
+            if (node_hash_table_pt != 0)
+            {
+              node_hash_table_pt->insert(
+                quadtree_pt(), s_fraction, node_pt(jnod));
+            }
+
           } // End of vertical loop over nodes in element
 
         } // End of horizontal loop over nodes in element
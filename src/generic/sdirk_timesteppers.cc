@@ -0,0 +1,328 @@
+// LIC// ====================================================================
+// LIC// This file forms part of oomph-lib, the object-oriented,
+// LIC// multi-physics finite-element library, available
+// LIC// at http://www.oomph-lib.org.
+// LIC//
+// LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+// LIC//
+// LIC// This library is free software; you can redistribute it and/or
+// LIC// modify it under the terms of the GNU Lesser General Public
+// LIC// License as published by the Free Software Foundation; either
+// LIC// version 2.1 of the License, or (at your option) any later version.
+// LIC//
+// LIC// This library is distributed in the hope that it will be useful,
+// LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// LIC// Lesser General Public License for more details.
+// LIC//
+// LIC// You should have received a copy of the GNU Lesser General Public
+// LIC// License along with this library; if not, write to the Free Software
+// LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// LIC// 02110-1301  USA.
+// LIC//
+// LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+// LIC//
+// LIC//====================================================================
+
+#include "sdirk_timesteppers.h"
+#include "problem.h"
+#include "mesh.h"
+#include "elements.h"
+#include "spines.h"
+
+namespace oomph
+{
+  //=======================================================================
+  /// Set the weights: The stage derivative is a combination of the
+  /// present value, the value at the beginning of the timestep and the
+  /// derivatives at the previous stages.
+  //=======================================================================
+  void SDIRKBase::set_weights()
+  {
+    const double gamma = Butcher_a(Stage, Stage);
+    const double dt = Time_pt->dt(0);
+
+    Weight(1, 0) = 1.0 / (gamma * dt);
+    Weight(1, 1) = -1.0 / (gamma * dt);
+    for (unsigned j = 0; j < Nstage; j++)
+    {
+      if (j < Stage)
+      {
+        Weight(1, j + 2) = -Butcher_a(Stage, j) / gamma;
+      }
+      else
+      {
+        Weight(1, j + 2) = 0.0;
+      }
+    }
+  }
+
+  //=======================================================================
+  /// Initialise the time-history for the Data values, corresponding to
+  /// an impulsive start.
+  //=======================================================================
+  void SDIRKBase::assign_initial_values_impulsive(Data* const& data_pt)
+  {
+    unsigned n_value = data_pt->nvalue();
+    for (unsigned j = 0; j < n_value; j++)
+    {
+      if (data_pt->is_a_copy(j) == false)
+      {
+        // The previous value is the present one; the stage derivatives
+        // are zero
+        data_pt->set_value(1, j, data_pt->value(j));
+        for (unsigned i = 0; i < Nstage; i++)
+        {
+          data_pt->set_value(i + 2, j, 0.0);
+        }
+      }
+    }
+  }
+
+  //=======================================================================
+  /// Initialise the time-history for the nodal positions corresponding
+  /// to an impulsive start.
+  //=======================================================================
+  void SDIRKBase::assign_initial_positions_impulsive(Node* const& node_pt)
+  {
+    unsigned n_dim = node_pt->ndim();
+    unsigned n_position_type = node_pt->nposition_type();
+    for (unsigned i = 0; i < n_dim; i++)
+    {
+      if (node_pt->position_is_a_copy(i) == false)
+      {
+        for (unsigned k = 0; k < n_position_type; k++)
+        {
+          node_pt->x_gen(1, k, i) = node_pt->x_gen(k, i);
+          for (unsigned l = 0; l < Nstage; l++)
+          {
+            node_pt->x_gen(l + 2, k, i) = 0.0;
+          }
+        }
+      }
+    }
+  }
+
+  //=======================================================================
+  /// Shift the values: The present value becomes the value at the
+  /// beginning of the next timestep. (The stage derivatives are
+  /// overwritten during the timestep.)
+  //=======================================================================
+  void SDIRKBase::shift_time_values(Data* const& data_pt)
+  {
+    unsigned n_value = data_pt->nvalue();
+    for (unsigned j = 0; j < n_value; j++)
+    {
+      if (data_pt->is_a_copy(j) == false)
+      {
+        data_pt->set_value(1, j, data_pt->value(j));
+      }
+    }
+  }
+
+  //=======================================================================
+  /// Shift the positions (see shift_time_values(...))
+  //=======================================================================
+  void SDIRKBase::shift_time_positions(Node* const& node_pt)
+  {
+    unsigned n_dim = node_pt->ndim();
+    unsigned n_position_type = node_pt->nposition_type();
+    for (unsigned i = 0; i < n_dim; i++)
+    {
+      if (node_pt->position_is_a_copy(i) == false)
+      {
+        for (unsigned k = 0; k < n_position_type; k++)
+        {
+          node_pt->x_gen(1, k, i) = node_pt->x_gen(k, i);
+        }
+      }
+    }
+  }
+
+  //=======================================================================
+  /// Set the error weights: The difference between the solutions of
+  /// the scheme and the embedded one is dt*sum_i (b_i-b_hat_i) F_i.
+  //=======================================================================
+  void SDIRKBase::set_error_weights()
+  {
+    const double dt = Time_pt->dt(0);
+    for (unsigned i = 0; i < Nstage; i++)
+    {
+      Error_weight[i] = dt * Error_coefficient[i];
+    }
+  }
+
+  //=======================================================================
+  /// Compute the error in the value i in a Data structure
+  //=======================================================================
+  double SDIRKBase::temporal_error_in_value(Data* const& data_pt,
+                                            const unsigned& i)
+  {
+    double error = 0.0;
+    for (unsigned l = 0; l < Nstage; l++)
+    {
+      error += Error_weight[l] * data_pt->value(l + 2, i);
+    }
+    return error;
+  }
+
+  //=======================================================================
+  /// Compute the error in the position i at a node
+  //=======================================================================
+  double SDIRKBase::temporal_error_in_position(Node* const& node_pt,
+                                               const unsigned& i)
+  {
+    double error = 0.0;
+    for (unsigned l = 0; l < Nstage; l++)
+    {
+      error += Error_weight[l] * node_pt->x(l + 2, i);
+    }
+    return error;
+  }
+
+  //=======================================================================
+  /// Record the time at the beginning of the timestep (the Problem has
+  /// already advanced the time to the end of the timestep) and set the
+  /// time and weights for the first stage. This is called before
+  /// Problem::actions_before_implicit_timestep(), so the boundary
+  /// conditions that the Problem sets there are those for the first
+  /// stage.
+  //=======================================================================
+  void SDIRKBase::actions_before_timestep(Problem* problem_pt)
+  {
+#ifdef PARANOID
+    if (problem_pt->ntime_stepper() != 1)
+    {
+      std::string error_message = "SDIRK timesteppers can only work with a ";
+      error_message += "single time stepper.";
+      throw OomphLibError(
+        error_message, OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+#endif
+    Time_at_start_of_timestep = Time_pt->time() - Time_pt->dt(0);
+    actions_before_stage(problem_pt, 0);
+  }
+
+  //=======================================================================
+  /// Set the time and the weights for stage i
+  //=======================================================================
+  void SDIRKBase::actions_before_stage(Problem* /*problem_pt*/,
+                                       const unsigned& i)
+  {
+    Stage = i;
+    Time_pt->time() =
+      Time_at_start_of_timestep + Butcher_c[i] * Time_pt->dt(0);
+    set_weights();
+  }
+
+  //=======================================================================
+  /// Store the derivatives for stage i for all Data and nodal positions
+  /// in the problem, i.e. for the Data whose values are numbered by
+  /// Problem::assign_eqn_numbers(): global Data, element internal Data,
+  /// nodes and spine heights. (External Data of elements is one of
+  /// these or does not contain any unknowns.)
+  //=======================================================================
+  void SDIRKBase::actions_after_stage(Problem* problem_pt,
+                                      const unsigned& /*i*/)
+  {
+    // Global data
+    unsigned n_global = problem_pt->nglobal_data();
+    for (unsigned l = 0; l < n_global; l++)
+    {
+      store_stage_derivatives(problem_pt->global_data_pt(l));
+    }
+
+    // Element internal data
+    Mesh* mesh_pt = problem_pt->mesh_pt();
+    unsigned n_element = mesh_pt->nelement();
+    for (unsigned e = 0; e < n_element; e++)
+    {
+      GeneralisedElement* el_pt = mesh_pt->element_pt(e);
+      unsigned n_internal = el_pt->ninternal_data();
+      for (unsigned l = 0; l < n_internal; l++)
+      {
+        store_stage_derivatives(el_pt->internal_data_pt(l));
+      }
+    }
+
+    // Nodal values and positions
+    unsigned n_node = mesh_pt->nnode();
+    for (unsigned n = 0; n < n_node; n++)
+    {
+      Node* nod_pt = mesh_pt->node_pt(n);
+      store_stage_derivatives(nod_pt);
+      store_stage_position_derivatives(nod_pt);
+    }
+
+    // Spine heights, which are stored in the spine meshes
+    const unsigned n_sub_mesh = problem_pt->nsub_mesh();
+    const unsigned n_mesh = (n_sub_mesh == 0) ? 1 : n_sub_mesh;
+    for (unsigned m = 0; m < n_mesh; m++)
+    {
+      SpineMesh* const spine_mesh_pt = dynamic_cast<SpineMesh*>(
+        (n_sub_mesh == 0) ? mesh_pt : problem_pt->mesh_pt(m));
+      if (spine_mesh_pt != 0)
+      {
+        const unsigned long n_spine = spine_mesh_pt->nspine();
+        for (unsigned long s = 0; s < n_spine; s++)
+        {
+          store_stage_derivatives(
+            spine_mesh_pt->spine_pt(s)->spine_height_pt());
+        }
+      }
+    }
+  }
+
+  //=======================================================================
+  /// Store the derivatives at the present stage for the Data's values
+  /// (if the Data is timestepped by this timestepper)
+  //=======================================================================
+  void SDIRKBase::store_stage_derivatives(Data* const& data_pt)
+  {
+    if (data_pt->time_stepper_pt() != this)
+    {
+      return;
+    }
+
+    unsigned n_value = data_pt->nvalue();
+    for (unsigned j = 0; j < n_value; j++)
+    {
+      if (data_pt->is_a_copy(j) == false)
+      {
+        data_pt->set_value(Stage + 2, j, time_derivative(1, data_pt, j));
+      }
+    }
+  }
+
+  //=======================================================================
+  /// Store the derivatives at the present stage for the Node's
+  /// positions (if they are timestepped by this timestepper)
+  //=======================================================================
+  void SDIRKBase::store_stage_position_derivatives(Node* const& node_pt)
+  {
+    if (node_pt->position_time_stepper_pt() != this)
+    {
+      return;
+    }
+
+    unsigned n_dim = node_pt->ndim();
+    unsigned n_position_type = node_pt->nposition_type();
+    for (unsigned i = 0; i < n_dim; i++)
+    {
+      if (node_pt->position_is_a_copy(i) == false)
+      {
+        for (unsigned k = 0; k < n_position_type; k++)
+        {
+          double derivative = 0.0;
+          unsigned n_tstorage = ntstorage();
+          for (unsigned t = 0; t < n_tstorage; t++)
+          {
+            derivative += Weight(1, t) * node_pt->x_gen(t, k, i);
+          }
+          node_pt->x_gen(Stage + 2, k, i) = derivative;
+        }
+      }
+    }
+  }
+
+} // namespace oomph
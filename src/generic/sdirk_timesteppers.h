@@ -0,0 +1,344 @@
+// LIC// ====================================================================
+// LIC// This file forms part of oomph-lib, the object-oriented,
+// LIC// multi-physics finite-element library, available
+// LIC// at http://www.oomph-lib.org.
+// LIC//
+// LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+// LIC//
+// LIC// This library is free software; you can redistribute it and/or
+// LIC// modify it under the terms of the GNU Lesser General Public
+// LIC// License as published by the Free Software Foundation; either
+// LIC// version 2.1 of the License, or (at your option) any later version.
+// LIC//
+// LIC// This library is distributed in the hope that it will be useful,
+// LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// LIC// Lesser General Public License for more details.
+// LIC//
+// LIC// You should have received a copy of the GNU Lesser General Public
+// LIC// License along with this library; if not, write to the Free Software
+// LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// LIC// 02110-1301  USA.
+// LIC//
+// LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+// LIC//
+// LIC//====================================================================
+#ifndef OOMPH_SDIRK_TIMESTEPPERS_HEADER
+#define OOMPH_SDIRK_TIMESTEPPERS_HEADER
+
+// Config header generated by autoconfig
+#ifdef HAVE_CONFIG_H
+#include <oomph-lib-config.h>
+#endif
+
+// oomph-lib headers
+#include "Vector.h"
+#include "nodes.h"
+#include "matrices.h"
+#include "timesteppers.h"
+
+namespace oomph
+{
+  // Forward decl. so that we can have function of Problem*
+  class Problem;
+
+
+  //=======================================================================
+  /// Base class for singly diagonally implicit Runge-Kutta (SDIRK)
+  /// timesteppers with Butcher tableau A (lower triangular with constant
+  /// diagonal gamma), c and b. The schemes are stiffly accurate (b is the
+  /// last row of A), so the value at the end of the last stage is the
+  /// solution at the end of the timestep.
+  ///
+  /// Stage i requires the solution of
+  /// \f[ Y_i = y_n + dt \sum_{j<i} a_{ij} F_j + dt \ \gamma F_i \f]
+  /// where F_i = f(t_n + c_i dt, Y_i) is the time derivative at the
+  /// stage, i.e. the stage derivative is discretised as
+  /// \f[ F_i = (Y_i - y_n)/(\gamma dt) - \sum_{j<i} a_{ij}/\gamma F_j. \f]
+  /// The previous value y_n and the stage derivatives F_j are stored in
+  /// the history values 1 and 2,...,nstage()+1 of the Data, so the
+  /// elements' residuals and Jacobians need no modification. The Problem
+  /// performs one Newton solve per stage (see
+  /// Problem::implicit_timestep_newton_solve()); because the weight of the
+  /// present value, 1/(gamma dt), is the same for all stages, the Jacobian
+  /// of the first stage (and its factorisation or preconditioner) is
+  /// re-used for the remaining ones by default.
+  ///
+  /// In adaptive mode the error is estimated by the difference between
+  /// the solution and that of an embedded lower-order scheme with
+  /// weights b_hat. The schemes are self-starting.
+  ///
+  /// Currently this only works for problems with a single timestepper
+  /// and time-dependent boundary conditions have to be set in
+  /// Problem::actions_before_implicit_timestep(), which is called once
+  /// before every stage.
+  ///
+  /// Only orders three and four are provided. A stiffly accurate,
+  /// L-stable SDIRK scheme of order five needs at least six stages and
+  /// its stage order is still one, so for stiff problems (where the
+  /// Jacobian re-use pays off) it suffers from order reduction and is
+  /// rarely more efficient than SDIRK4; use BDF<NSTEPS> or the
+  /// variable-order BDF timestepper if higher order is required.
+  //=======================================================================
+  class SDIRKBase : public TimeStepper
+  {
+  public:
+    /// Constructor: Pass the number of stages and the flag that
+    /// indicates if the timestepper is adaptive. The Butcher tableau is
+    /// set up by the derived class.
+    SDIRKBase(const unsigned& n_stage, const bool& adaptive = false)
+      : TimeStepper(n_stage + 2, 1)
+    {
+      Adaptive_Flag = adaptive;
+      Nstage = n_stage;
+      Stage = 0;
+      Time_at_start_of_timestep = 0.0;
+      Reuse_jacobian_across_stages = true;
+
+      // Storage for the tableau
+      Butcher_a.resize(n_stage, n_stage, 0.0);
+      Butcher_c.resize(n_stage, 0.0);
+      Error_coefficient.resize(n_stage, 0.0);
+      Error_weight.resize(n_stage, 0.0);
+    }
+
+    /// Broken copy constructor
+    SDIRKBase(const SDIRKBase&) = delete;
+
+    /// Broken assignment operator
+    void operator=(const SDIRKBase&) = delete;
+
+    /// Destructor (empty)
+    virtual ~SDIRKBase() {}
+
+    /// Number of stages
+    unsigned nstage() const
+    {
+      return Nstage;
+    }
+
+    /// The stage that is (or was last) being solved for
+    unsigned stage() const
+    {
+      return Stage;
+    }
+
+    /// Number of previous values available: only the one at the
+    /// beginning of the timestep (the remaining history values store
+    /// the stage derivatives).
+    unsigned nprev_values() const
+    {
+      return 1;
+    }
+
+    /// Number of timestep increments that need to be stored by the scheme
+    unsigned ndt() const
+    {
+      return 1;
+    }
+
+    /// Re-use the Jacobian of the first stage for all stages of a
+    /// timestep (default)
+    void enable_jacobian_reuse_across_stages()
+    {
+      Reuse_jacobian_across_stages = true;
+    }
+
+    /// Recompute the Jacobian for each stage (full Newton method)
+    void disable_jacobian_reuse_across_stages()
+    {
+      Reuse_jacobian_across_stages = false;
+    }
+
+    /// The weight of the present value in the stage derivative is the
+    /// same for all stages.
+    bool jacobian_is_shared_by_stages() const
+    {
+      return Reuse_jacobian_across_stages;
+    }
+
+    /// Set the weights for the stage derivative of the present stage
+    void set_weights();
+
+    /// Initialise the time-history for the Data values,
+    /// corresponding to an impulsive start.
+    void assign_initial_values_impulsive(Data* const& data_pt);
+
+    /// Initialise the time-history for the nodal positions
+    /// corresponding to an impulsive start.
+    void assign_initial_positions_impulsive(Node* const& node_pt);
+
+    /// This function updates the Data's time history so that
+    /// we can advance to the next timestep.
+    void shift_time_values(Data* const& data_pt);
+
+    /// This function advances the time history of the positions
+    /// at a node.
+    void shift_time_positions(Node* const& node_pt);
+
+    /// Set the error weights
+    void set_error_weights();
+
+    /// Compute the error in the value i in a Data structure
+    double temporal_error_in_value(Data* const& data_pt, const unsigned& i);
+
+    /// Compute the error in the position i at a node
+    double temporal_error_in_position(Node* const& node_pt, const unsigned& i);
+
+    /// Record the time at the beginning of the timestep and set up
+    /// the first stage
+    void actions_before_timestep(Problem* problem_pt);
+
+    /// Set the time and the weights for stage i
+    void actions_before_stage(Problem* problem_pt, const unsigned& i);
+
+    /// Store the derivatives for stage i
+    void actions_after_stage(Problem* problem_pt, const unsigned& i);
+
+  protected:
+    /// Number of stages
+    unsigned Nstage;
+
+    /// Butcher tableau: A
+    DenseMatrix<double> Butcher_a;
+
+    /// Butcher tableau: c
+    Vector<double> Butcher_c;
+
+    /// Difference between the weights b of the scheme and b_hat of the
+    /// embedded scheme
+    Vector<double> Error_coefficient;
+
+  private:
+    /// Store the derivatives at the present stage for the Data's values
+    void store_stage_derivatives(Data* const& data_pt);
+
+    /// Store the derivatives at the present stage for the Node's
+    /// positions
+    void store_stage_position_derivatives(Node* const& node_pt);
+
+    /// The stage that is (or was last) being solved for
+    unsigned Stage;
+
+    /// Time at the beginning of the present timestep
+    double Time_at_start_of_timestep;
+
+    /// Re-use the Jacobian across stages?
+    bool Reuse_jacobian_across_stages;
+
+    /// Error weights for the stage derivatives: dt*(b-b_hat)
+    Vector<double> Error_weight;
+  };
+
+
+  //=======================================================================
+  /// Three-stage, third-order, L-stable SDIRK scheme (Alexander, 1977)
+  /// with a second-order embedded scheme for the error estimate.
+  //=======================================================================
+  class SDIRK3 : public SDIRKBase
+  {
+  public:
+    /// Constructor: Pass the flag that indicates if the timestepper is
+    /// adaptive
+    SDIRK3(const bool& adaptive = false) : SDIRKBase(3, adaptive)
+    {
+      Type = "SDIRK3";
+
+      // gamma is the root of x^3-3x^2+3x/2-1/6=0 in (1/6,1/2)
+      const double gamma = 0.43586652150845899941601945;
+      const double c2 = 0.5 * (1.0 + gamma);
+      const double b1 = -0.25 * (6.0 * gamma * gamma - 16.0 * gamma + 1.0);
+      const double b2 = 0.25 * (6.0 * gamma * gamma - 20.0 * gamma + 5.0);
+
+      Butcher_a(0, 0) = gamma;
+      Butcher_a(1, 0) = c2 - gamma;
+      Butcher_a(1, 1) = gamma;
+      Butcher_a(2, 0) = b1;
+      Butcher_a(2, 1) = b2;
+      Butcher_a(2, 2) = gamma;
+
+      Butcher_c[0] = gamma;
+      Butcher_c[1] = c2;
+      Butcher_c[2] = 1.0;
+
+      // Embedded second-order scheme based on the first two stages
+      const double b_hat2 = (0.5 - gamma) / (c2 - gamma);
+      const double b_hat1 = 1.0 - b_hat2;
+      Error_coefficient[0] = b1 - b_hat1;
+      Error_coefficient[1] = b2 - b_hat2;
+      Error_coefficient[2] = gamma;
+    }
+
+    /// Order of the scheme
+    unsigned order() const
+    {
+      return 3;
+    }
+
+    /// Order of the embedded scheme whose error is estimated
+    unsigned error_order() const
+    {
+      return 2;
+    }
+  };
+
+
+  //=======================================================================
+  /// Five-stage, fourth-order, L-stable SDIRK scheme with a third-order
+  /// embedded scheme for the error estimate (Hairer & Wanner, Solving
+  /// Ordinary Differential Equations II, Table IV.6.5).
+  //=======================================================================
+  class SDIRK4 : public SDIRKBase
+  {
+  public:
+    /// Constructor: Pass the flag that indicates if the timestepper is
+    /// adaptive
+    SDIRK4(const bool& adaptive = false) : SDIRKBase(5, adaptive)
+    {
+      Type = "SDIRK4";
+
+      for (unsigned i = 0; i < 5; i++)
+      {
+        Butcher_a(i, i) = 0.25;
+      }
+      Butcher_a(1, 0) = 0.5;
+      Butcher_a(2, 0) = 17.0 / 50.0;
+      Butcher_a(2, 1) = -1.0 / 25.0;
+      Butcher_a(3, 0) = 371.0 / 1360.0;
+      Butcher_a(3, 1) = -137.0 / 2720.0;
+      Butcher_a(3, 2) = 15.0 / 544.0;
+      Butcher_a(4, 0) = 25.0 / 24.0;
+      Butcher_a(4, 1) = -49.0 / 48.0;
+      Butcher_a(4, 2) = 125.0 / 16.0;
+      Butcher_a(4, 3) = -85.0 / 12.0;
+
+      Butcher_c[0] = 0.25;
+      Butcher_c[1] = 0.75;
+      Butcher_c[2] = 11.0 / 20.0;
+      Butcher_c[3] = 0.5;
+      Butcher_c[4] = 1.0;
+
+      // Embedded third-order scheme
+      Error_coefficient[0] = 25.0 / 24.0 - 59.0 / 48.0;
+      Error_coefficient[1] = -49.0 / 48.0 + 17.0 / 96.0;
+      Error_coefficient[2] = 125.0 / 16.0 - 225.0 / 32.0;
+      Error_coefficient[3] = 0.0;
+      Error_coefficient[4] = 0.25;
+    }
+
+    /// Order of the scheme
+    unsigned order() const
+    {
+      return 4;
+    }
+
+    /// Order of the embedded scheme whose error is estimated
+    unsigned error_order() const
+    {
+      return 3;
+    }
+  };
+
+} // namespace oomph
+
+#endif
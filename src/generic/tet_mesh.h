@@ -2560,7 +2560,7 @@ namespace oomph
     }
 
     // Flush element storage
-    Element_pt.clear();
+    flush_element_storage();
 
     // Copy across
     nel = new_or_retained_el_pt.size();
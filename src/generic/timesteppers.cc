@@ -952,12 +952,6 @@ namespace oomph
     // Find number of values stored
     unsigned n_value = data_pt->nvalue();
 
-    Vector<double> veloc(n_value);
-    time_derivative(1, data_pt, veloc);
-
-    Vector<double> accel(n_value);
-    time_derivative(2, data_pt, accel);
-
     // Loop over values
     for (unsigned j = 0; j < n_value; j++)
     {
@@ -965,12 +959,26 @@ namespace oomph
       // if not a copy
       if (data_pt->is_a_copy(j) == false)
       {
-        for (unsigned t = NSTEPS; t > 0; t--)
+        // Get the present veloc/accel before the history is shifted
+        const double veloc = time_derivative(1, data_pt, j);
+        const double accel = time_derivative(2, data_pt, j);
+
+        // Indexed history: Overwrite the oldest previous value by the
+        // present one; it becomes the previous value once the ring buffer
+        // has been rotated
+        if (this->indexed_history())
+        {
+          data_pt->set_value(NSTEPS, j, data_pt->value(j));
+        }
+        else
         {
-          data_pt->set_value(t, j, data_pt->value(t - 1, j));
+          for (unsigned t = NSTEPS; t > 0; t--)
+          {
+            data_pt->set_value(t, j, data_pt->value(t - 1, j));
+          }
         }
-        data_pt->set_value(NSTEPS + 1, j, veloc[j]);
-        data_pt->set_value(NSTEPS + 2, j, accel[j]);
+        data_pt->set_value(NSTEPS + 1, j, veloc);
+        data_pt->set_value(NSTEPS + 2, j, accel);
       }
     }
   }
@@ -1020,9 +1028,18 @@ namespace oomph
         {
           // Set previous values/veloc/accel to present values/veloc/accel,
           // if not a copy
-          for (unsigned t = NSTEPS; t > 0; t--)
+          // Indexed history: Overwrite the oldest previous position by the
+          // present one (see shift_time_values(...))
+          if (this->indexed_history())
           {
-            node_pt->x_gen(t, k, i) = node_pt->x_gen(t - 1, k, i);
+            node_pt->x_gen(NSTEPS, k, i) = node_pt->x_gen(k, i);
+          }
+          else
+          {
+            for (unsigned t = NSTEPS; t > 0; t--)
+            {
+              node_pt->x_gen(t, k, i) = node_pt->x_gen(t - 1, k, i);
+            }
           }
 
           node_pt->x_gen(NSTEPS + 1, k, i) = veloc[k][i];
@@ -1084,25 +1101,9 @@ namespace oomph
     // Find number of values stored
     unsigned n_value = data_pt->nvalue();
 
-    // Storage for the velocity and acceleration
-    Vector<double> veloc(n_value, 0.0);
-    Vector<double> accel(n_value, 0.0);
-
     // Find number of stored time values
     unsigned n_tstorage = this->ntstorage();
 
-    // Loop over the variables
-    for (unsigned i = 0; i < n_value; i++)
-    {
-      // Loop over all the history data
-      for (unsigned t = 0; t < n_tstorage; t++)
-      {
-        veloc[i] += Newmark_veloc_weight[t] * data_pt->value(t, i);
-        accel[i] += this->weight(2, t) * data_pt->value(t, i);
-      }
-    }
-
-
     // Loop over values
     for (unsigned j = 0; j < n_value; j++)
     {
@@ -1110,12 +1111,31 @@ namespace oomph
       // if not a copy
       if (data_pt->is_a_copy(j) == false)
       {
-        for (unsigned t = NSTEPS; t > 0; t--)
+        // Get the present veloc/accel before the history is shifted
+        double veloc = 0.0;
+        double accel = 0.0;
+        for (unsigned t = 0; t < n_tstorage; t++)
         {
-          data_pt->set_value(t, j, data_pt->value(t - 1, j));
+          veloc += Newmark_veloc_weight[t] * data_pt->value(t, j);
+          accel += this->weight(2, t) * data_pt->value(t, j);
         }
-        data_pt->set_value(NSTEPS + 1, j, veloc[j]);
-        data_pt->set_value(NSTEPS + 2, j, accel[j]);
+
+        // Indexed history: Overwrite the oldest previous value by the
+        // present one; it becomes the previous value once the ring buffer
+        // has been rotated
+        if (this->indexed_history())
+        {
+          data_pt->set_value(NSTEPS, j, data_pt->value(j));
+        }
+        else
+        {
+          for (unsigned t = NSTEPS; t > 0; t--)
+          {
+            data_pt->set_value(t, j, data_pt->value(t - 1, j));
+          }
+        }
+        data_pt->set_value(NSTEPS + 1, j, veloc);
+        data_pt->set_value(NSTEPS + 2, j, accel);
       }
     }
   }
@@ -1165,9 +1185,18 @@ namespace oomph
         {
           // Set previous values/veloc/accel to present values/veloc/accel,
           // if not a copy
-          for (unsigned t = NSTEPS; t > 0; t--)
+          // Indexed history: Overwrite the oldest previous position by the
+          // present one (see shift_time_values(...))
+          if (this->indexed_history())
+          {
+            node_pt->x_gen(NSTEPS, k, i) = node_pt->x_gen(k, i);
+          }
+          else
           {
-            node_pt->x_gen(t, k, i) = node_pt->x_gen(t - 1, k, i);
+            for (unsigned t = NSTEPS; t > 0; t--)
+            {
+              node_pt->x_gen(t, k, i) = node_pt->x_gen(t - 1, k, i);
+            }
           }
 
           node_pt->x_gen(NSTEPS + 1, k, i) = veloc[k][i];
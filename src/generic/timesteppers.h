@@ -272,6 +272,10 @@ namespace oomph
     /// stored. -1 if not set.
     int Predictor_storage_index;
 
+    /// Map from the logical time levels to the storage slots of the
+    /// history values in the Data and Nodes that use this timestepper
+    TimeHistoryIndex History_index;
+
   public:
     /// Constructor. Pass the amount of storage required by
     /// timestepper (present value + history values) and the
@@ -326,6 +330,16 @@ namespace oomph
       return 0;
     }
 
+    /// Order of the scheme whose local error is estimated by
+    /// temporal_error_in_value(...) and temporal_error_in_position(...),
+    /// i.e. the estimated error scales like dt^(error_order()+1). This
+    /// determines the timestep for a given target error. Default: the
+    /// order of the scheme itself (as for predictor-corrector estimates).
+    virtual unsigned error_order() const
+    {
+      return order();
+    }
+
     /// Return current value of continous time
     // (can't have a paranoid test for null pointers because this could be
     // used as a set function)
@@ -625,6 +639,77 @@ namespace oomph
       return Adaptive_Flag;
     }
 
+    /// Pointer to the map from logical time levels to the storage
+    /// slots of the history values (used by Data and Nodes)
+    const TimeHistoryIndex* history_index_pt() const
+    {
+      return &History_index;
+    }
+
+    /// Can the previous values be stored in a ring buffer, i.e. do
+    /// shift_time_values(...) and shift_time_positions(...) implement
+    /// indexed history? (False by default)
+    virtual bool indexed_history_is_supported() const
+    {
+      return false;
+    }
+
+    /// Store the nprev_values() previous values in a ring buffer:
+    /// shift_time_values(...) and shift_time_positions(...) then only
+    /// copy the present values; the remaining history values are
+    /// "shifted" by rotate_history() which must be called once all
+    /// Data and Nodes that use this timestepper have been shifted.
+    /// (This is done automatically in Problem::shift_time_values()).
+    void enable_indexed_history()
+    {
+#ifdef PARANOID
+      if (!indexed_history_is_supported())
+      {
+        std::ostringstream error_stream;
+        error_stream << "Indexed history is not implemented for "
+                     << "timesteppers of type " << Type << std::endl;
+        throw OomphLibError(
+          error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+      }
+#endif
+      if (History_index.nring() == 0)
+      {
+        History_index.set_nring(nprev_values());
+      }
+    }
+
+    /// Store the previous values in the order of their time levels
+    /// (default). Can only be called while the ring buffer is not rotated
+    /// since the history values are not re-ordered.
+    void disable_indexed_history()
+    {
+      if (History_index.is_rotated())
+      {
+        std::ostringstream error_stream;
+        error_stream << "Cannot disable indexed history because the history\n"
+                     << "values are not stored in the order of their time\n"
+                     << "levels. This is only the case after multiples of\n"
+                     << "nprev_values() timesteps.\n";
+        throw OomphLibError(
+          error_stream.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+      }
+      History_index.set_nring(0);
+    }
+
+    /// Are the previous values stored in a ring buffer?
+    bool indexed_history() const
+    {
+      return (History_index.nring() > 0);
+    }
+
+    /// Complete the shift of the history values of all Data and Nodes
+    /// that use this timestepper by rotating the ring buffer (if the
+    /// history is indexed; otherwise do nothing).
+    void rotate_history()
+    {
+      History_index.rotate();
+    }
+
     /// Set the weights for the predictor
     /// previous timestep (currently empty -- overwrite for specific scheme)
     virtual void set_predictor_weights() {}
@@ -657,6 +742,38 @@ namespace oomph
       return 0.0;
     }
 
+    /// Interface for timesteppers that adapt their order: Called once
+    /// a timestep has been taken and its error has been estimated;
+    /// step_accepted is false if the problem rejects the step because
+    /// the error exceeds the tolerance. Return the orders (other than the
+    /// present one) whose error estimates are needed to choose the order
+    /// for the next timestep. Default: none.
+    virtual void setup_order_adaptation(const bool& /*step_accepted*/,
+                                        Vector<unsigned>& candidate_order)
+    {
+      candidate_order.clear();
+    }
+
+    /// Interface for timesteppers that adapt their order: Make
+    /// temporal_error_in_value(...) and temporal_error_in_position(...)
+    /// estimate the error of one of the candidate orders returned by
+    /// setup_order_adaptation(...). Default: nothing to do.
+    virtual void set_error_order(const unsigned& /*order*/) {}
+
+    /// Interface for timesteppers that adapt their order: Given the
+    /// error for the present order and the errors candidate_error[i]
+    /// for the orders candidate_order[i], choose the order for the next
+    /// timestep and return the corresponding error estimate (used to
+    /// pick the next timestep). Default: keep the order and return
+    /// error.
+    virtual double adapt_order(const double& error,
+                               const double& /*target_error*/,
+                               const Vector<unsigned>& /*candidate_order*/,
+                               const Vector<double>& /*candidate_error*/)
+    {
+      return error;
+    }
+
     /// Interface for any actions that need to be performed before a time
     /// step.
     virtual void actions_before_timestep(Problem* problem_pt) {}
@@ -664,6 +781,42 @@ namespace oomph
     /// Interface for any actions that need to be performed after a time
     /// step.
     virtual void actions_after_timestep(Problem* problem_pt) {}
+
+    /// Number of implicit stages (i.e. Newton solves) per timestep.
+    /// One for all multistep methods; overload for multi-stage
+    /// (diagonally implicit Runge-Kutta) methods.
+    virtual unsigned nstage() const
+    {
+      return 1;
+    }
+
+    /// Interface for any actions that need to be performed before the
+    /// Newton solve for stage i>0 of a multi-stage timestep (e.g. set the
+    /// time and the weights for this stage). Only called if nstage()>1.
+    /// The first stage must be set up in actions_before_timestep(...),
+    /// which precedes Problem::actions_before_implicit_timestep().
+    virtual void actions_before_stage(Problem* /*problem_pt*/,
+                                      const unsigned& /*i*/)
+    {
+    }
+
+    /// Interface for any actions that need to be performed after the
+    /// Newton solve for stage i of a multi-stage timestep (e.g. store the
+    /// stage derivatives). Only called if nstage()>1.
+    virtual void actions_after_stage(Problem* /*problem_pt*/,
+                                     const unsigned& /*i*/)
+    {
+    }
+
+    /// Is the Jacobian of the stages of a multi-stage timestep the same
+    /// (apart from the point at which it is evaluated)? If so, the
+    /// Problem re-uses the Jacobian (and hence its factorisation or
+    /// preconditioner) of the first stage for all stages of the
+    /// timestep.
+    virtual bool jacobian_is_shared_by_stages() const
+    {
+      return false;
+    }
   };
 
 
@@ -799,10 +952,20 @@ namespace oomph
         // Set previous values to the previous value, if not a copy
         if (data_pt->is_a_copy(j) == false)
         {
-          // Loop over times, in reverse order
-          for (unsigned t = NSTEPS; t > 0; t--)
+          // Indexed history: Overwrite the oldest previous value by the
+          // present one; it becomes the previous value once the ring buffer
+          // has been rotated
+          if (indexed_history())
           {
-            data_pt->set_value(t, j, data_pt->value(t - 1, j));
+            data_pt->set_value(NSTEPS, j, data_pt->value(j));
+          }
+          else
+          {
+            // Loop over times, in reverse order
+            for (unsigned t = NSTEPS; t > 0; t--)
+            {
+              data_pt->set_value(t, j, data_pt->value(t - 1, j));
+            }
           }
         }
       }
@@ -825,10 +988,19 @@ namespace oomph
         {
           for (unsigned k = 0; k < n_position_type; k++)
           {
-            // Loop over stored times, and set values to previous values
-            for (unsigned t = NSTEPS; t > 0; t--)
+            // Indexed history: Overwrite the oldest previous position by the
+            // present one (see shift_time_values(...))
+            if (indexed_history())
+            {
+              node_pt->x_gen(NSTEPS, k, i) = node_pt->x_gen(k, i);
+            }
+            else
             {
-              node_pt->x_gen(t, k, i) = node_pt->x_gen(t - 1, k, i);
+              // Loop over stored times, and set values to previous values
+              for (unsigned t = NSTEPS; t > 0; t--)
+              {
+                node_pt->x_gen(t, k, i) = node_pt->x_gen(t - 1, k, i);
+              }
             }
           }
         }
@@ -858,6 +1030,12 @@ namespace oomph
       return NSTEPS;
     }
 
+    /// The previous values can be stored in a ring buffer
+    bool indexed_history_is_supported() const
+    {
+      return true;
+    }
+
     /// Number of timestep increments that need to be stored by the scheme
     unsigned ndt() const
     {
@@ -1034,6 +1212,12 @@ namespace oomph
       return NSTEPS;
     }
 
+    /// The previous values can be stored in a ring buffer
+    bool indexed_history_is_supported() const
+    {
+      return true;
+    }
+
     /// Number of timestep increments that need to be stored by the scheme
     unsigned ndt() const
     {
@@ -1334,35 +1518,44 @@ namespace oomph
     {
       // Find number of values stored
       unsigned n_value = data_pt->nvalue();
-      // Storage for velocity need to be here to be in scope
-      Vector<double> velocity(n_value);
 
       // Find the number of history values that are stored
       const unsigned nt_value = nprev_values();
 
-      // If adaptive, find the velocities
-      if (adaptive_flag())
-      {
-        time_derivative(1, data_pt, velocity);
-      }
-
       // Loop over the values
       for (unsigned j = 0; j < n_value; j++)
       {
         // Set previous values to the previous value, if not a copy
         if (data_pt->is_a_copy(j) == false)
         {
-          // Loop over times, in reverse order
-          for (unsigned t = nt_value; t > 0; t--)
+          // If adaptive, find the velocity before the history is shifted
+          double velocity = 0.0;
+          if (adaptive_flag())
           {
-            data_pt->set_value(t, j, data_pt->value(t - 1, j));
+            velocity = time_derivative(1, data_pt, j);
+          }
+
+          // Indexed history: Overwrite the oldest previous value by the
+          // present one; it becomes the previous value once the ring buffer
+          // has been rotated
+          if (indexed_history())
+          {
+            data_pt->set_value(nt_value, j, data_pt->value(j));
+          }
+          else
+          {
+            // Loop over times, in reverse order
+            for (unsigned t = nt_value; t > 0; t--)
+            {
+              data_pt->set_value(t, j, data_pt->value(t - 1, j));
+            }
           }
 
           // If we are using the adaptive scheme
           if (adaptive_flag())
           {
             // Set the velocity
-            data_pt->set_value(nt_value + 1, j, velocity[j]);
+            data_pt->set_value(nt_value + 1, j, velocity);
           }
         }
       }
@@ -1411,10 +1604,19 @@ namespace oomph
           // Loop over the position types
           for (unsigned k = 0; k < n_position_type; k++)
           {
-            // Loop over stored times, and set values to previous values
-            for (unsigned t = NSTEPS; t > 0; t--)
+            // Indexed history: Overwrite the oldest previous position by the
+            // present one (see shift_time_values(...))
+            if (indexed_history())
             {
-              node_pt->x_gen(t, k, i) = node_pt->x_gen(t - 1, k, i);
+              node_pt->x_gen(NSTEPS, k, i) = node_pt->x_gen(k, i);
+            }
+            else
+            {
+              // Loop over stored times, and set values to previous values
+              for (unsigned t = NSTEPS; t > 0; t--)
+              {
+                node_pt->x_gen(t, k, i) = node_pt->x_gen(t - 1, k, i);
+              }
             }
 
             // If we are using the adaptive scheme, set the velocity
@@ -1436,6 +1638,12 @@ namespace oomph
       return NSTEPS;
     }
 
+    /// The previous values can be stored in a ring buffer
+    bool indexed_history_is_supported() const
+    {
+      return true;
+    }
+
     /// Number of timestep increments that need to be stored by the scheme
     unsigned ndt() const
     {
@@ -0,0 +1,527 @@
+// LIC// ====================================================================
+// LIC// This file forms part of oomph-lib, the object-oriented,
+// LIC// multi-physics finite-element library, available
+// LIC// at http://www.oomph-lib.org.
+// LIC//
+// LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+// LIC//
+// LIC// This library is free software; you can redistribute it and/or
+// LIC// modify it under the terms of the GNU Lesser General Public
+// LIC// License as published by the Free Software Foundation; either
+// LIC// version 2.1 of the License, or (at your option) any later version.
+// LIC//
+// LIC// This library is distributed in the hope that it will be useful,
+// LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// LIC// Lesser General Public License for more details.
+// LIC//
+// LIC// You should have received a copy of the GNU Lesser General Public
+// LIC// License along with this library; if not, write to the Free Software
+// LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// LIC// 02110-1301  USA.
+// LIC//
+// LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+// LIC//
+// LIC//====================================================================
+
+#include "variable_order_bdf.h"
+#include "problem.h"
+
+namespace oomph
+{
+  //=======================================================================
+  /// Get the times of the present and the n previous values, relative
+  /// to the present time.
+  //=======================================================================
+  void VariableOrderBDF::get_relative_times(const unsigned& n,
+                                            Vector<double>& tau) const
+  {
+    tau.resize(n + 1);
+    tau[0] = 0.0;
+    for (unsigned t = 1; t <= n; t++)
+    {
+      tau[t] = tau[t - 1] - Time_pt->dt(t - 1);
+    }
+  }
+
+  //=======================================================================
+  /// Set the weights: The weight of the t-th history value is the
+  /// derivative of the t-th Lagrange polynomial through the present and
+  /// the Order previous values, evaluated at the present time.
+  //=======================================================================
+  void VariableOrderBDF::set_weights()
+  {
+    // Times of the values used by the present order
+    Vector<double> tau;
+    get_relative_times(Order, tau);
+
+    // Derivative of the Lagrange polynomial associated with the present
+    // value
+    double weight = 0.0;
+    for (unsigned m = 1; m <= Order; m++)
+    {
+      weight -= 1.0 / tau[m];
+    }
+    Weight(1, 0) = weight;
+
+    // Derivatives of the Lagrange polynomials associated with the
+    // previous values (these vanish at the present time)
+    for (unsigned t = 1; t <= Order; t++)
+    {
+      double numerator = 1.0;
+      double denominator = tau[t];
+      for (unsigned m = 1; m <= Order; m++)
+      {
+        if (m != t)
+        {
+          numerator *= -tau[m];
+          denominator *= tau[t] - tau[m];
+        }
+      }
+      Weight(1, t) = numerator / denominator;
+    }
+
+    // The remaining history values (and the predictor) are not used
+    unsigned n_tstorage = ntstorage();
+    for (unsigned t = Order + 1; t < n_tstorage; t++)
+    {
+      Weight(1, t) = 0.0;
+    }
+  }
+
+  //=======================================================================
+  /// Initialise the time-history for the Data values,
+  /// corresponding to an impulsive start.
+  //=======================================================================
+  void VariableOrderBDF::assign_initial_values_impulsive(Data* const& data_pt)
+  {
+    // The computation restarts at first order
+    Order = 1;
+    Error_order = 1;
+    Nstep = 0;
+    Nstep_at_present_order = 0;
+
+    // Set all previous values (and the prediction) to the present value
+    unsigned n_tstorage = ntstorage();
+    unsigned n_value = data_pt->nvalue();
+    for (unsigned j = 0; j < n_value; j++)
+    {
+      if (data_pt->is_a_copy(j) == false)
+      {
+        for (unsigned t = 1; t < n_tstorage; t++)
+        {
+          data_pt->set_value(t, j, data_pt->value(j));
+        }
+      }
+    }
+  }
+
+  //=======================================================================
+  /// Initialise the time-history for the nodal positions
+  /// corresponding to an impulsive start.
+  //=======================================================================
+  void VariableOrderBDF::assign_initial_positions_impulsive(
+    Node* const& node_pt)
+  {
+    // The computation restarts at first order
+    Order = 1;
+    Error_order = 1;
+    Nstep = 0;
+    Nstep_at_present_order = 0;
+
+    // Set all previous positions (and the prediction) to the present one
+    unsigned n_tstorage = ntstorage();
+    unsigned n_dim = node_pt->ndim();
+    unsigned n_position_type = node_pt->nposition_type();
+    for (unsigned i = 0; i < n_dim; i++)
+    {
+      if (node_pt->position_is_a_copy(i) == false)
+      {
+        for (unsigned k = 0; k < n_position_type; k++)
+        {
+          for (unsigned t = 1; t < n_tstorage; t++)
+          {
+            node_pt->x_gen(t, k, i) = node_pt->x_gen(k, i);
+          }
+        }
+      }
+    }
+  }
+
+  //=======================================================================
+  /// Push the values backwards. All previous values are retained
+  /// (whatever the present order) so the order can be raised later.
+  //=======================================================================
+  void VariableOrderBDF::shift_time_values(Data* const& data_pt)
+  {
+    unsigned n_value = data_pt->nvalue();
+    const unsigned nt_value = nprev_values();
+    for (unsigned j = 0; j < n_value; j++)
+    {
+      if (data_pt->is_a_copy(j) == false)
+      {
+        // Indexed history: Overwrite the oldest previous value by the
+        // present one; it becomes the previous value once the ring buffer
+        // has been rotated
+        if (indexed_history())
+        {
+          data_pt->set_value(nt_value, j, data_pt->value(j));
+        }
+        else
+        {
+          for (unsigned t = nt_value; t > 0; t--)
+          {
+            data_pt->set_value(t, j, data_pt->value(t - 1, j));
+          }
+        }
+      }
+    }
+  }
+
+  //=======================================================================
+  /// Push the positions backwards.
+  //=======================================================================
+  void VariableOrderBDF::shift_time_positions(Node* const& node_pt)
+  {
+    unsigned n_dim = node_pt->ndim();
+    unsigned n_position_type = node_pt->nposition_type();
+    const unsigned nt_value = nprev_values();
+    for (unsigned i = 0; i < n_dim; i++)
+    {
+      if (node_pt->position_is_a_copy(i) == false)
+      {
+        for (unsigned k = 0; k < n_position_type; k++)
+        {
+          // Indexed history (see shift_time_values(...))
+          if (indexed_history())
+          {
+            node_pt->x_gen(nt_value, k, i) = node_pt->x_gen(k, i);
+          }
+          else
+          {
+            for (unsigned t = nt_value; t > 0; t--)
+            {
+              node_pt->x_gen(t, k, i) = node_pt->x_gen(t - 1, k, i);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  //=======================================================================
+  /// Set the predictor weights: The order-q predictor extrapolates the
+  /// polynomial through the q+1 previous values to the present time.
+  //=======================================================================
+  void VariableOrderBDF::set_predictor_weights()
+  {
+    // Only needed in adaptive mode
+    if (!adaptive_flag())
+    {
+      return;
+    }
+
+    Vector<double> tau;
+    get_relative_times(Max_order + 1, tau);
+
+    for (unsigned q = 1; q <= Max_order; q++)
+    {
+      Predictor_weight[q].resize(q + 2, 0.0);
+      for (unsigned t = 1; t <= q + 1; t++)
+      {
+        double weight = 1.0;
+        for (unsigned m = 1; m <= q + 1; m++)
+        {
+          if (m != t)
+          {
+            weight *= tau[m] / (tau[m] - tau[t]);
+          }
+        }
+        Predictor_weight[q][t] = weight;
+      }
+    }
+  }
+
+  //=======================================================================
+  /// Calculate the predicted values for the present order and store
+  /// them in the predictor slot.
+  //=======================================================================
+  void VariableOrderBDF::calculate_predicted_values(Data* const& data_pt)
+  {
+    if (adaptive_flag())
+    {
+      unsigned n_value = data_pt->nvalue();
+      for (unsigned j = 0; j < n_value; j++)
+      {
+        if (data_pt->is_a_copy(j) == false)
+        {
+          double predicted_value = 0.0;
+          for (unsigned t = 1; t <= Order + 1; t++)
+          {
+            predicted_value +=
+              Predictor_weight[Order][t] * data_pt->value(t, j);
+          }
+          data_pt->set_value(Predictor_storage_index, j, predicted_value);
+        }
+      }
+    }
+  }
+
+  //=======================================================================
+  /// Calculate the predicted positions for the present order and store
+  /// them in the predictor slot.
+  //=======================================================================
+  void VariableOrderBDF::calculate_predicted_positions(Node* const& node_pt)
+  {
+    if (adaptive_flag())
+    {
+      unsigned n_dim = node_pt->ndim();
+      unsigned n_position_type = node_pt->nposition_type();
+      for (unsigned i = 0; i < n_dim; i++)
+      {
+        if (node_pt->position_is_a_copy(i) == false)
+        {
+          for (unsigned k = 0; k < n_position_type; k++)
+          {
+            double predicted_value = 0.0;
+            for (unsigned t = 1; t <= Order + 1; t++)
+            {
+              predicted_value +=
+                Predictor_weight[Order][t] * node_pt->x_gen(t, k, i);
+            }
+            node_pt->x_gen(Predictor_storage_index, k, i) = predicted_value;
+          }
+        }
+      }
+    }
+  }
+
+  //=======================================================================
+  /// Set the error weights: With T_m = dt_0+...+dt_{m-1}, the leading
+  /// terms in the local truncation error of the order-q scheme and in
+  /// the error of the order-q predictor are proportional to
+  /// T_1*...*T_q/W_q and T_1*...*T_{q+1}, where W_q = 1/T_1+...+1/T_q is
+  /// the weight of the present value in the approximation of the time
+  /// derivative. The local truncation error is therefore
+  /// 1/(1+W_q*T_{q+1}) times the difference between the computed and the
+  /// predicted value.
+  ///
+  /// The error of order k+1 (k being the present order) is estimated
+  /// from the (k+2)-nd backward difference of the present and the k+2
+  /// previous values: With the divided difference y[t_0,...,t_{k+2}]
+  /// (approximating the (k+2)-nd derivative divided by (k+2)!) it is
+  /// T_1*...*T_{k+1}/W_{k+1} * y[t_0,...,t_{k+2}].
+  //=======================================================================
+  void VariableOrderBDF::set_error_weights()
+  {
+    // By default, estimate the error for the present order
+    Error_order = Order;
+
+    // Only needed in adaptive mode
+    if (!adaptive_flag())
+    {
+      return;
+    }
+
+    Vector<double> tau;
+    get_relative_times(Max_order + 1, tau);
+    double present_weight = 0.0;
+    for (unsigned q = 1; q <= Max_order; q++)
+    {
+      present_weight -= 1.0 / tau[q];
+      Error_weight[q] = 1.0 / (1.0 - present_weight * tau[q + 1]);
+    }
+
+    // Backward difference weights for the error of order k+1 (only
+    // needed if the order can be raised)
+    if (Order < Max_order)
+    {
+      const unsigned q = Order + 1;
+      double scale = 1.0;
+      double higher_order_present_weight = 0.0;
+      for (unsigned m = 1; m <= q; m++)
+      {
+        scale *= -tau[m];
+        higher_order_present_weight -= 1.0 / tau[m];
+      }
+      scale /= higher_order_present_weight;
+
+      // Weights of the divided difference through q+2 values
+      for (unsigned t = 0; t <= q + 1; t++)
+      {
+        double denominator = 1.0;
+        for (unsigned m = 0; m <= q + 1; m++)
+        {
+          if (m != t)
+          {
+            denominator *= tau[t] - tau[m];
+          }
+        }
+        Higher_order_error_weight[t] = scale / denominator;
+      }
+    }
+  }
+
+  //=======================================================================
+  /// Compute the error in the value i in a Data structure for the
+  /// order Error_order.
+  //=======================================================================
+  double VariableOrderBDF::temporal_error_in_value(Data* const& data_pt,
+                                                   const unsigned& i)
+  {
+    // Order k+1: backward difference
+    if (Error_order > Order)
+    {
+      double error = 0.0;
+      for (unsigned t = 0; t <= Order + 2; t++)
+      {
+        error += Higher_order_error_weight[t] * data_pt->value(t, i);
+      }
+      return error;
+    }
+
+    double predicted_value = 0.0;
+    for (unsigned t = 1; t <= Error_order + 1; t++)
+    {
+      predicted_value +=
+        Predictor_weight[Error_order][t] * data_pt->value(t, i);
+    }
+    return Error_weight[Error_order] * (data_pt->value(i) - predicted_value);
+  }
+
+  //=======================================================================
+  /// Compute the error in the position i at a node for the
+  /// order Error_order.
+  //=======================================================================
+  double VariableOrderBDF::temporal_error_in_position(Node* const& node_pt,
+                                                      const unsigned& i)
+  {
+    // Order k+1: backward difference
+    if (Error_order > Order)
+    {
+      double error = 0.0;
+      for (unsigned t = 0; t <= Order + 2; t++)
+      {
+        error += Higher_order_error_weight[t] * node_pt->x(t, i);
+      }
+      return error;
+    }
+
+    double predicted_value = 0.0;
+    for (unsigned t = 1; t <= Error_order + 1; t++)
+    {
+      predicted_value += Predictor_weight[Error_order][t] * node_pt->x(t, i);
+    }
+    return Error_weight[Error_order] * (node_pt->x(i) - predicted_value);
+  }
+
+  //=======================================================================
+  /// Update the step counters and return the orders that may be chosen
+  /// for the next timestep: k-1 (if k>1) and k+1, provided the step was
+  /// accepted, the present order has been used for long enough and
+  /// there are sufficiently many previous values for the order k+1
+  /// error estimate.
+  //=======================================================================
+  void VariableOrderBDF::setup_order_adaptation(
+    const bool& step_accepted, Vector<unsigned>& candidate_order)
+  {
+    candidate_order.clear();
+
+    // Only accepted timesteps extend the usable time history
+    if (step_accepted)
+    {
+      Nstep++;
+      Nstep_at_present_order++;
+    }
+
+    // Nothing to do if the order is fixed
+    if (!(adaptive_flag() && Order_adaptation))
+    {
+      return;
+    }
+
+    if (Order > 1)
+    {
+      candidate_order.push_back(Order - 1);
+    }
+    if (step_accepted && (Order < Max_order) &&
+        (Nstep_at_present_order >= Order + 1) && (Nstep >= Order + 2))
+    {
+      candidate_order.push_back(Order + 1);
+    }
+  }
+
+  //=======================================================================
+  /// Estimate the error of the given order (k-1, k or k+1) in
+  /// temporal_error_in_value(...) and temporal_error_in_position(...)
+  //=======================================================================
+  void VariableOrderBDF::set_error_order(const unsigned& order)
+  {
+#ifdef PARANOID
+    if ((order == 0) || (order + 1 < Order) || (order > Order + 1) ||
+        (order > Max_order))
+    {
+      std::ostringstream error_message;
+      error_message << "Cannot estimate the error of order " << order
+                    << " when the present order is " << Order << std::endl;
+      throw OomphLibError(error_message.str(),
+                          OOMPH_CURRENT_FUNCTION,
+                          OOMPH_EXCEPTION_LOCATION);
+    }
+#endif
+    Error_order = order;
+  }
+
+  //=======================================================================
+  /// Choose the order for the next timestep: Each of the orders
+  /// q = k-1, k, k+1 would allow the next timestep to be rescaled by
+  /// (target_error/(bias_q * error_q))^(1/(q+1)). Pick the order that
+  /// permits the largest timestep (keeping the present one in case of a
+  /// tie) and return its error estimate.
+  //=======================================================================
+  double VariableOrderBDF::adapt_order(const double& error,
+                                       const double& target_error,
+                                       const Vector<unsigned>& candidate_order,
+                                       const Vector<double>& candidate_error)
+  {
+    // Rescaling factor for the timestep permitted by the present order
+    unsigned new_order = Order;
+    double new_order_error = error;
+    double best_factor = std::pow(target_error / std::max(error, 1.0e-12),
+                                  1.0 / double(Order + 1));
+
+    // Try the candidate orders (with a bias against raising the order)
+    const unsigned n_candidate = candidate_order.size();
+    for (unsigned i = 0; i < n_candidate; i++)
+    {
+      const unsigned order = candidate_order[i];
+      const double bias = (order > Order) ? Order_increase_bias : 1.0;
+      const double candidate = std::max(candidate_error[i], 1.0e-12);
+      double factor =
+        std::pow(target_error / (bias * candidate), 1.0 / double(order + 1));
+      if (factor > best_factor)
+      {
+        new_order = order;
+        new_order_error = candidate;
+        best_factor = factor;
+      }
+    }
+
+    // Switch order if required
+    Error_order = Order;
+    if (new_order != Order)
+    {
+      if (Doc_order_changes)
+      {
+        oomph_info << "VariableOrderBDF: changing order from " << Order
+                   << " to " << new_order << std::endl;
+      }
+      Order = new_order;
+      Error_order = new_order;
+      Nstep_at_present_order = 0;
+    }
+
+    return new_order_error;
+  }
+
+} // namespace oomph
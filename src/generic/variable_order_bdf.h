@@ -0,0 +1,324 @@
+// LIC// ====================================================================
+// LIC// This file forms part of oomph-lib, the object-oriented,
+// LIC// multi-physics finite-element library, available
+// LIC// at http://www.oomph-lib.org.
+// LIC//
+// LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+// LIC//
+// LIC// This library is free software; you can redistribute it and/or
+// LIC// modify it under the terms of the GNU Lesser General Public
+// LIC// License as published by the Free Software Foundation; either
+// LIC// version 2.1 of the License, or (at your option) any later version.
+// LIC//
+// LIC// This library is distributed in the hope that it will be useful,
+// LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// LIC// Lesser General Public License for more details.
+// LIC//
+// LIC// You should have received a copy of the GNU Lesser General Public
+// LIC// License along with this library; if not, write to the Free Software
+// LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// LIC// 02110-1301  USA.
+// LIC//
+// LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+// LIC//
+// LIC//====================================================================
+#ifndef OOMPH_VARIABLE_ORDER_BDF_HEADER
+#define OOMPH_VARIABLE_ORDER_BDF_HEADER
+
+// Config header generated by autoconfig
+#ifdef HAVE_CONFIG_H
+#include <oomph-lib-config.h>
+#endif
+
+// oomph-lib headers
+#include "Vector.h"
+#include "nodes.h"
+#include "matrices.h"
+#include "timesteppers.h"
+
+namespace oomph
+{
+  // Forward decl. so that we can have function of Problem*
+  class Problem;
+
+
+  //=======================================================================
+  /// Variable-order, variable-step BDF timestepper. The weights of the
+  /// order-k scheme (1 <= k <= max_order <= 5) are obtained by
+  /// differentiating the Lagrange polynomial through the present value and
+  /// the k previous ones at the (possibly non-uniformly spaced) times at
+  /// which they were computed, so the scheme retains its order when the
+  /// timestep changes.
+  ///
+  /// In adaptive mode the local truncation error of the present order k
+  /// (and of order k-1) is estimated from the difference between the
+  /// computed value and an extrapolating predictor through k+1 (or k)
+  /// previous values. The error of order k+1 is estimated from the
+  /// (k+2)-nd backward (divided) difference of the solution, as in DASSL
+  /// and CVODE. After each timestep
+  /// adapt_order(...) compares the estimates for orders k-1, k and k+1
+  /// and switches to the order that permits the largest next timestep
+  /// (with a bias against increasing the order, as in CVODE). Orders are
+  /// raised at most one at a time and only after k+1 steps at the present
+  /// order. The computation starts at first order, so this timestepper
+  /// is self-starting.
+  ///
+  /// The history storage is sized for max_order when the timestepper is
+  /// constructed so changing the order never reallocates the Data.
+  ///
+  /// Note: Problem::adaptive_unsteady_newton_solve(...) only adapts the
+  /// order of the Problem's first timestepper, time_stepper_pt(); any
+  /// other VariableOrderBDF timesteppers keep their order.
+  //=======================================================================
+  class VariableOrderBDF : public TimeStepper
+  {
+  public:
+    /// Constructor: Pass the maximum order (between 1 and 5) and
+    /// the flag that indicates if the timestepper is adaptive (the order
+    /// is only adapted in adaptive mode). The initial order is one.
+    VariableOrderBDF(const unsigned& max_order = 5,
+                     const bool& adaptive = false)
+      : TimeStepper(max_order + 1, 1)
+    {
+#ifdef PARANOID
+      if ((max_order == 0) || (max_order > 5))
+      {
+        std::ostringstream error_message;
+        error_message << "The maximum order of VariableOrderBDF must be "
+                      << "between 1 and 5, not " << max_order << std::endl;
+        throw OomphLibError(error_message.str(),
+                            OOMPH_CURRENT_FUNCTION,
+                            OOMPH_EXCEPTION_LOCATION);
+      }
+#endif
+
+      Type = "VariableOrderBDF";
+      Max_order = max_order;
+      Order = 1;
+      Error_order = 1;
+      Order_adaptation = true;
+      Doc_order_changes = false;
+      Nstep = 0;
+      Nstep_at_present_order = 0;
+
+      // Bias against increasing the order when choosing the order
+      // for the next timestep (ratio of CVODE's biases)
+      Order_increase_bias = 10.0 / 6.0;
+
+      // Storage for the predictor and error weights for all orders
+      Predictor_weight.resize(Max_order + 1);
+      Error_weight.resize(Max_order + 1, 0.0);
+      Higher_order_error_weight.resize(Max_order + 2, 0.0);
+
+      // If it's adaptive we need one more previous value (for the
+      // error estimate of the order max_order scheme) and
+      // storage for the predicted value
+      Adaptive_Flag = adaptive;
+      if (adaptive)
+      {
+        Weight.resize(2, Max_order + 3, 0.0);
+        Predictor_storage_index = Max_order + 2;
+      }
+
+      // Set the weight for the zero-th derivative
+      Weight(0, 0) = 1.0;
+    }
+
+    /// Broken copy constructor
+    VariableOrderBDF(const VariableOrderBDF&) = delete;
+
+    /// Broken assignment operator
+    void operator=(const VariableOrderBDF&) = delete;
+
+    /// Present order of the scheme
+    unsigned order() const
+    {
+      return Order;
+    }
+
+    /// Maximum order of the scheme
+    unsigned max_order() const
+    {
+      return Max_order;
+    }
+
+    /// Set the order of the scheme (call before the next timestep;
+    /// the time history must contain enough previous values)
+    void set_order(const unsigned& order)
+    {
+#ifdef PARANOID
+      if ((order == 0) || (order > Max_order))
+      {
+        std::ostringstream error_message;
+        error_message << "Order " << order << " is outside the range "
+                      << "[1," << Max_order << "] of this VariableOrderBDF"
+                      << std::endl;
+        throw OomphLibError(error_message.str(),
+                            OOMPH_CURRENT_FUNCTION,
+                            OOMPH_EXCEPTION_LOCATION);
+      }
+#endif
+      Order = order;
+      Error_order = order;
+      Nstep_at_present_order = 0;
+    }
+
+    /// Allow the order to be changed after each timestep in adaptive
+    /// mode (default)
+    void enable_order_adaptation()
+    {
+      Order_adaptation = true;
+    }
+
+    /// Keep the order fixed
+    void disable_order_adaptation()
+    {
+      Order_adaptation = false;
+    }
+
+    /// Report changes of order in adapt_order(...)
+    void enable_doc_order_changes()
+    {
+      Doc_order_changes = true;
+    }
+
+    /// Don't report changes of order (default)
+    void disable_doc_order_changes()
+    {
+      Doc_order_changes = false;
+    }
+
+    /// Access to the bias against increasing the order: The larger
+    /// it is, the larger the reduction in the error has to be before
+    /// the order is increased.
+    double& order_increase_bias()
+    {
+      return Order_increase_bias;
+    }
+
+    /// Number of previous values available (max_order, plus one in
+    /// adaptive mode).
+    unsigned nprev_values() const
+    {
+      return Weight.ncol() - (adaptive_flag() ? 2 : 1);
+    }
+
+    /// Number of timestep increments that need to be stored by the scheme
+    unsigned ndt() const
+    {
+      return nprev_values();
+    }
+
+    /// The previous values can be stored in a ring buffer
+    bool indexed_history_is_supported() const
+    {
+      return true;
+    }
+
+    /// Set the weights for the present order and timestep history
+    void set_weights();
+
+    /// Initialise the time-history for the Data values,
+    /// corresponding to an impulsive start. This restarts the
+    /// order adaptation at first order.
+    void assign_initial_values_impulsive(Data* const& data_pt);
+
+    /// Initialise the time-history for the nodal positions
+    /// corresponding to an impulsive start. This restarts the
+    /// order adaptation at first order.
+    void assign_initial_positions_impulsive(Node* const& node_pt);
+
+    /// This function updates the Data's time history so that
+    /// we can advance to the next timestep.
+    void shift_time_values(Data* const& data_pt);
+
+    /// This function advances the time history of the positions
+    /// at a node.
+    void shift_time_positions(Node* const& node_pt);
+
+    /// Set the predictor weights for all orders
+    void set_predictor_weights();
+
+    /// Calculate the predicted data values (for the present order)
+    void calculate_predicted_values(Data* const& data_pt);
+
+    /// Calculate the predicted positions (for the present order)
+    void calculate_predicted_positions(Node* const& node_pt);
+
+    /// Set the error weights for all orders (and the backward
+    /// difference weights for the error of order k+1)
+    void set_error_weights();
+
+    /// Compute the error in the value i in a Data structure
+    double temporal_error_in_value(Data* const& data_pt, const unsigned& i);
+
+    /// Compute the error in the position i at a node
+    double temporal_error_in_position(Node* const& node_pt, const unsigned& i);
+
+    /// Update the step counters (if the step has been accepted) and
+    /// return the orders k-1 and/or k+1 that may be chosen for the next
+    /// timestep
+    void setup_order_adaptation(const bool& step_accepted,
+                                Vector<unsigned>& candidate_order);
+
+    /// Estimate the error of the given order (k-1, k or k+1) in
+    /// temporal_error_in_value(...) and temporal_error_in_position(...)
+    void set_error_order(const unsigned& order);
+
+    /// Choose the order for the next timestep from the problem's error
+    /// norms for orders k-1, k and k+1 and return the error estimate for
+    /// the chosen order.
+    double adapt_order(const double& error,
+                       const double& target_error,
+                       const Vector<unsigned>& candidate_order,
+                       const Vector<double>& candidate_error);
+
+  private:
+    /// Get the times of the present and the n previous values, relative
+    /// to the present time (i.e. tau[0]=0, tau[1]=-dt(0), ...)
+    void get_relative_times(const unsigned& n, Vector<double>& tau) const;
+
+    /// Maximum order
+    unsigned Max_order;
+
+    /// Present order
+    unsigned Order;
+
+    /// Order for which temporal_error_in_value(...) and
+    /// temporal_error_in_position(...) estimate the error
+    unsigned Error_order;
+
+    /// Is the order adapted?
+    bool Order_adaptation;
+
+    /// Report changes of order?
+    bool Doc_order_changes;
+
+    /// Number of accepted timesteps since the impulsive start
+    unsigned Nstep;
+
+    /// Number of accepted timesteps since the last change of order
+    unsigned Nstep_at_present_order;
+
+    /// Bias against increasing the order
+    double Order_increase_bias;
+
+    /// Predictor weights: Predictor_weight[q][t] is the weight of the
+    /// t-th previous value (t=1,...,q+1) in the order-q predictor
+    Vector<Vector<double>> Predictor_weight;
+
+    /// Error weights: Error_weight[q] scales the difference between the
+    /// computed and the order-q predicted value
+    Vector<double> Error_weight;
+
+    /// Weights of the present value and the k+2 previous values in the
+    /// estimate of the local truncation error of order k+1 (where k is
+    /// the present order), i.e. the suitably scaled (k+2)-nd backward
+    /// divided difference
+    Vector<double> Higher_order_error_weight;
+  };
+
+} // namespace oomph
+
+#endif
@@ -44,6 +44,79 @@ namespace oomph
   /// //////////////////////////////////////////////////////////////////////
 
 
+  //======================================================================
+  /// Helper namespace for the (refineable) Boussinesq elements
+  //======================================================================
+  namespace BoussinesqHelper
+  {
+    //====================================================================
+    /// Classify the unknowns of the Boussinesq element pointed to by
+    /// el_pt for use in block preconditioners: Create a list of pairs
+    /// whose first entries contain the global equation numbers of the
+    /// unknowns and whose second entries contain their "DOF types":
+    /// Velocities=0,...,DIM-1; Pressure=DIM; Temperature=DIM+1
+    //====================================================================
+    template<unsigned DIM, class ELEMENT>
+    void get_dof_numbers_for_unknowns(
+      const ELEMENT* el_pt,
+      std::list<std::pair<unsigned long, unsigned>>& dof_lookup_list)
+    {
+      // temporary pair (used to store dof lookup prior to being added to list)
+      std::pair<unsigned long, unsigned> dof_lookup;
+
+      // loop over the pressure values
+      const unsigned n_press = el_pt->npres_nst();
+      for (unsigned n = 0; n < n_press; n++)
+      {
+        // ignore pinned values
+        int local_eqn_number = el_pt->p_local_eqn(n);
+        if (local_eqn_number >= 0)
+        {
+          dof_lookup.first = el_pt->eqn_number(local_eqn_number);
+          dof_lookup.second = DIM;
+          dof_lookup_list.push_front(dof_lookup);
+        }
+      }
+
+      // Nodal indices of the temperature
+      const unsigned u_nodal_adv_diff = el_pt->u_index_adv_diff();
+
+      // loop over the nodes
+      const unsigned n_node = el_pt->nnode();
+      for (unsigned n = 0; n < n_node; n++)
+      {
+        // Velocities
+        for (unsigned i = 0; i < DIM; i++)
+        {
+          int local_eqn_number =
+            el_pt->nodal_local_eqn(n, el_pt->u_index_nst(i));
+          if (local_eqn_number >= 0)
+          {
+            dof_lookup.first = el_pt->eqn_number(local_eqn_number);
+            dof_lookup.second = i;
+            dof_lookup_list.push_front(dof_lookup);
+          }
+        }
+
+        // Temperature
+        int local_eqn_number = el_pt->nodal_local_eqn(n, u_nodal_adv_diff);
+        if (local_eqn_number >= 0)
+        {
+          dof_lookup.first = el_pt->eqn_number(local_eqn_number);
+          dof_lookup.second = DIM + 1;
+          dof_lookup_list.push_front(dof_lookup);
+        }
+      }
+    }
+
+  } // namespace BoussinesqHelper
+
+
+  /// //////////////////////////////////////////////////////////////////////
+  /// //////////////////////////////////////////////////////////////////////
+  /// //////////////////////////////////////////////////////////////////////
+
+
   //======================class definition==============================
   /// A class that solves the Boussinesq approximation of the Navier--Stokes
   /// and energy equations by coupling two pre-existing classes.
@@ -110,6 +183,27 @@ namespace oomph
       return Ra_pt;
     }
 
+    /// The number of "DOF types" that degrees of freedom in this element
+    /// are sub-divided into: Velocities, pressure and temperature.
+    unsigned ndof_types() const
+    {
+      return DIM + 2;
+    }
+
+    /// Create a list of pairs for all unknowns in this element,
+    /// so that the first entry in each pair contains the global equation
+    /// number of the unknown, while the second one contains the number
+    /// of the "DOF type" that this unknown is associated with.
+    /// (Function can obviously only be called if the equation numbering
+    /// scheme has been set up.) Velocities=0,...,DIM-1; Pressure=DIM;
+    /// Temperature=DIM+1
+    void get_dof_numbers_for_unknowns(
+      std::list<std::pair<unsigned long, unsigned>>& dof_lookup_list) const
+    {
+      BoussinesqHelper::get_dof_numbers_for_unknowns<DIM>(this,
+                                                          dof_lookup_list);
+    }
+
     /// Final override for disable ALE
     void disable_ALE()
     {
@@ -840,6 +934,27 @@ namespace oomph
       return Ra_pt;
     }
 
+    /// The number of "DOF types" that degrees of freedom in this element
+    /// are sub-divided into: Velocities, pressure and temperature.
+    unsigned ndof_types() const
+    {
+      return DIM + 2;
+    }
+
+    /// Create a list of pairs for all unknowns in this element,
+    /// so that the first entry in each pair contains the global equation
+    /// number of the unknown, while the second one contains the number
+    /// of the "DOF type" that this unknown is associated with.
+    /// (Function can obviously only be called if the equation numbering
+    /// scheme has been set up.) Velocities=0,...,DIM-1; Pressure=DIM;
+    /// Temperature=DIM+1
+    void get_dof_numbers_for_unknowns(
+      std::list<std::pair<unsigned long, unsigned>>& dof_lookup_list) const
+    {
+      BoussinesqHelper::get_dof_numbers_for_unknowns<DIM>(this,
+                                                          dof_lookup_list);
+    }
+
 
     /// Final override for disable ALE
     void disable_ALE()
@@ -0,0 +1,85 @@
+// LIC// ====================================================================
+// LIC// This file forms part of oomph-lib, the object-oriented,
+// LIC// multi-physics finite-element library, available
+// LIC// at http://www.oomph-lib.org.
+// LIC//
+// LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+// LIC//
+// LIC// This library is free software; you can redistribute it and/or
+// LIC// modify it under the terms of the GNU Lesser General Public
+// LIC// License as published by the Free Software Foundation; either
+// LIC// version 2.1 of the License, or (at your option) any later version.
+// LIC//
+// LIC// This library is distributed in the hope that it will be useful,
+// LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// LIC// Lesser General Public License for more details.
+// LIC//
+// LIC// You should have received a copy of the GNU Lesser General Public
+// LIC// License along with this library; if not, write to the Free Software
+// LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// LIC// 02110-1301  USA.
+// LIC//
+// LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+// LIC//
+// LIC//====================================================================
+
+#include "boussinesq_preconditioner.h"
+
+namespace oomph
+{
+  //=============================================================================
+  /// Setup the preconditioner: Map all but the last DOF type onto the
+  /// flow field and the last one onto the temperature field, then
+  /// set up the field-split preconditioner.
+  //=============================================================================
+  void BoussinesqPreconditioner::setup()
+  {
+#ifdef PARANOID
+    if (Navier_stokes_mesh_pt == 0)
+    {
+      std::ostringstream error_message;
+      error_message << "Pointer to Navier-Stokes mesh hasn't been set!\n";
+      throw OomphLibError(
+        error_message.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+#endif
+
+    // Determine the total number of DOF types
+    unsigned n_dof = 0;
+    if (this->is_master_block_preconditioner())
+    {
+      // (Re-)specify the meshes: The flow mesh comes first
+      this->clear_meshes();
+      this->add_mesh(Navier_stokes_mesh_pt,
+                     Allow_multiple_element_type_in_navier_stokes_mesh);
+      if (Temperature_mesh_pt != 0)
+      {
+        this->add_mesh(Temperature_mesh_pt);
+      }
+      this->gp_preconditioner_set_all_meshes();
+      unsigned n_mesh = this->nmesh();
+      for (unsigned m = 0; m < n_mesh; m++)
+      {
+        n_dof += this->ndof_types_in_mesh(m);
+      }
+    }
+    else
+    {
+      n_dof = this->ndof_types();
+    }
+
+    // The last DOF type is the temperature
+    Vector<unsigned> dof_to_block_map(n_dof, 0);
+    dof_to_block_map[n_dof - 1] = 1;
+    this->set_dof_to_block_map(dof_to_block_map);
+
+    // Tell the Navier-Stokes preconditioner about its mesh
+    Navier_stokes_preconditioner_pt->set_navier_stokes_mesh(
+      Navier_stokes_mesh_pt, Allow_multiple_element_type_in_navier_stokes_mesh);
+
+    // Now set up the fields
+    FieldSplitPreconditioner<CRDoubleMatrix>::setup();
+  }
+
+} // namespace oomph
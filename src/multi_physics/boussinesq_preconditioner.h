@@ -0,0 +1,145 @@
+// LIC// ====================================================================
+// LIC// This file forms part of oomph-lib, the object-oriented,
+// LIC// multi-physics finite-element library, available
+// LIC// at http://www.oomph-lib.org.
+// LIC//
+// LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+// LIC//
+// LIC// This library is free software; you can redistribute it and/or
+// LIC// modify it under the terms of the GNU Lesser General Public
+// LIC// License as published by the Free Software Foundation; either
+// LIC// version 2.1 of the License, or (at your option) any later version.
+// LIC//
+// LIC// This library is distributed in the hope that it will be useful,
+// LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// LIC// Lesser General Public License for more details.
+// LIC//
+// LIC// You should have received a copy of the GNU Lesser General Public
+// LIC// License along with this library; if not, write to the Free Software
+// LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// LIC// 02110-1301  USA.
+// LIC//
+// LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+// LIC//
+// LIC//====================================================================
+#ifndef OOMPH_BOUSSINESQ_PRECONDITIONER_HEADER
+#define OOMPH_BOUSSINESQ_PRECONDITIONER_HEADER
+
+// includes
+#include "../generic/problem.h"
+#include "../generic/general_purpose_block_preconditioners.h"
+#include "../navier_stokes/navier_stokes_preconditioners.h"
+
+namespace oomph
+{
+  //============================================================================
+  /// Field-split preconditioner for monolithically-discretised
+  /// Boussinesq (or, more generally, heat transfer) problems. The
+  /// unknowns are split into two fields: the flow (all but the last
+  /// DOF type: the fluid velocities and pressure) and the temperature
+  /// (the last DOF type). This is the DOF type ordering provided
+  /// by BuoyantQCrouzeixRaviartElements and, for multi-domain problems,
+  /// by meshes of NavierStokesBoussinesqElements and
+  /// AdvectionDiffusionBoussinesqElements, added in that order.
+  /// NavierStokesSchurComplementPreconditioner is used for the flow
+  /// field; SuperLU is used for the temperature field by default, but
+  /// this can (and for large problems should) be replaced by an AMG solver.
+  /// The fields are combined by a block Gauss-Seidel sweep by default;
+  /// see FieldSplitPreconditioner for the other outer iterations.
+  //============================================================================
+  class BoussinesqPreconditioner
+    : public FieldSplitPreconditioner<CRDoubleMatrix>
+  {
+  public:
+    /// Constructor: A problem pointer is required for the underlying
+    /// NavierStokesSchurComplementPreconditioner.
+    BoussinesqPreconditioner(Problem* problem_pt)
+      : FieldSplitPreconditioner<CRDoubleMatrix>()
+    {
+      // Null the meshes
+      Navier_stokes_mesh_pt = 0;
+      Temperature_mesh_pt = 0;
+      Allow_multiple_element_type_in_navier_stokes_mesh = false;
+
+      // Create the Navier Stokes Schur complement preconditioner for the
+      // flow field (deleted by the base class)
+      Navier_stokes_preconditioner_pt =
+        new NavierStokesSchurComplementPreconditioner(problem_pt);
+      this->set_subsidiary_preconditioner_pt(Navier_stokes_preconditioner_pt,
+                                             0);
+
+      // The temperature field uses the default (SuperLU) preconditioner
+      // unless another one is specified
+      this->set_subsidiary_preconditioner_pt(0, 1);
+    }
+
+    /// Destructor (the subsidiary preconditioners are deleted by the
+    /// base class)
+    virtual ~BoussinesqPreconditioner() {}
+
+    /// Broken copy constructor
+    BoussinesqPreconditioner(const BoussinesqPreconditioner&) = delete;
+
+    /// Broken assignment operator
+    void operator=(const BoussinesqPreconditioner&) = delete;
+
+    /// Setup the preconditioner
+    void setup();
+
+    /// Specify the mesh that contains the elements that classify the
+    /// flow unknowns. For monolithic Boussinesq elements this mesh
+    /// also classifies the temperature. The optional argument indicates
+    /// if there are more than one type of elements in the mesh.
+    /// (The meshes are passed to the block preconditioning framework
+    /// in setup(), so this may be called repeatedly.)
+    void set_navier_stokes_mesh(
+      Mesh* mesh_pt,
+      const bool& allow_multiple_element_type_in_navier_stokes_mesh = false)
+    {
+      Navier_stokes_mesh_pt = mesh_pt;
+      Allow_multiple_element_type_in_navier_stokes_mesh =
+        allow_multiple_element_type_in_navier_stokes_mesh;
+    }
+
+    /// Specify the mesh that contains the advection-diffusion elements
+    /// in multi-domain problems
+    void set_temperature_mesh(Mesh* mesh_pt)
+    {
+      Temperature_mesh_pt = mesh_pt;
+    }
+
+    /// Specify a non-default preconditioner (e.g. an AMG solver) for the
+    /// temperature field. This must have been created with new; it will be
+    /// deleted by this preconditioner.
+    void set_temperature_preconditioner_pt(Preconditioner* prec_pt)
+    {
+      this->set_subsidiary_preconditioner_pt(prec_pt, 1);
+    }
+
+    /// Access function to the Navier Stokes preconditioner
+    NavierStokesSchurComplementPreconditioner* navier_stokes_preconditioner_pt()
+      const
+    {
+      return Navier_stokes_preconditioner_pt;
+    }
+
+  private:
+    /// Pointer to the Navier Stokes preconditioner (owned by the base class)
+    NavierStokesSchurComplementPreconditioner* Navier_stokes_preconditioner_pt;
+
+    /// Pointer to the mesh that classifies the flow unknowns
+    Mesh* Navier_stokes_mesh_pt;
+
+    /// Pointer to the mesh of advection-diffusion elements (only used
+    /// in multi-domain problems; null otherwise)
+    Mesh* Temperature_mesh_pt;
+
+    /// Flag to indicate if there are multiple element types in the
+    /// Navier-Stokes mesh.
+    bool Allow_multiple_element_type_in_navier_stokes_mesh;
+  };
+
+} // namespace oomph
+
+#endif
@@ -0,0 +1,267 @@
+// LIC// ====================================================================
+// LIC// This file forms part of oomph-lib, the object-oriented,
+// LIC// multi-physics finite-element library, available
+// LIC// at http://www.oomph-lib.org.
+// LIC//
+// LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+// LIC//
+// LIC// This library is free software; you can redistribute it and/or
+// LIC// modify it under the terms of the GNU Lesser General Public
+// LIC// License as published by the Free Software Foundation; either
+// LIC// version 2.1 of the License, or (at your option) any later version.
+// LIC//
+// LIC// This library is distributed in the hope that it will be useful,
+// LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// LIC// Lesser General Public License for more details.
+// LIC//
+// LIC// You should have received a copy of the GNU Lesser General Public
+// LIC// License along with this library; if not, write to the Free Software
+// LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// LIC// 02110-1301  USA.
+// LIC//
+// LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+// LIC//
+// LIC//====================================================================
+
+#include "free_surface_preconditioner.h"
+
+namespace oomph
+{
+  //=============================================================================
+  /// clean up memory method
+  //=============================================================================
+  void FreeSurfacePreconditioner::clean_up_memory()
+  {
+    // wipe the subsidiary preconditioners
+    Navier_stokes_preconditioner_pt->clean_up_memory();
+    Interface_preconditioner_pt->clean_up_memory();
+    Mesh_motion_preconditioner_pt->clean_up_memory();
+
+    // clean the subsidiary matvec operators
+    Fluid_onto_interface_matvec_pt->clean_up_memory();
+    Interface_onto_mesh_motion_matvec_pt->clean_up_memory();
+  }
+
+
+  //=============================================================================
+  /// Setup the preconditioner. Note: Matrix must be a CRDoubleMatrix.
+  //=============================================================================
+  void FreeSurfacePreconditioner::setup()
+  {
+    // clean the memory
+    this->clean_up_memory();
+
+#ifdef PARANOID
+    // check the meshes have been set
+    if (Bulk_fluid_mesh_pt == 0)
+    {
+      std::ostringstream error_message;
+      error_message << "Pointer to bulk fluid mesh hasn't been set!\n";
+      throw OomphLibError(
+        error_message.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+    if (Interface_mesh_pt == 0)
+    {
+      std::ostringstream error_message;
+      error_message << "Pointer to interface mesh hasn't been set!\n";
+      throw OomphLibError(
+        error_message.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+    if (N_fluid_dof_type == 0)
+    {
+      std::ostringstream error_message;
+      error_message << "Number of fluid DOF types must be non-zero.\n"
+                    << "Specify it with set_bulk_fluid_mesh(...)\n";
+      throw OomphLibError(
+        error_message.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+#endif
+
+    // setup the meshes
+    this->set_mesh(
+      0, Bulk_fluid_mesh_pt, Allow_multiple_element_type_in_bulk_fluid_mesh);
+    this->set_mesh(
+      1, Interface_mesh_pt, Allow_multiple_element_type_in_interface_mesh);
+
+    // determine the number of DOF types in the bulk elements
+    unsigned n_bulk_dof = this->ndof_types_in_mesh(0);
+
+#ifdef PARANOID
+    if (N_fluid_dof_type > n_bulk_dof)
+    {
+      std::ostringstream error_message;
+      error_message << "Number of fluid DOF types (" << N_fluid_dof_type
+                    << ") exceeds the number of DOF types in the\n"
+                    << "bulk fluid elements (" << n_bulk_dof << ")\n";
+      throw OomphLibError(
+        error_message.str(), OOMPH_CURRENT_FUNCTION, OOMPH_EXCEPTION_LOCATION);
+    }
+#endif
+
+    // The remaining bulk DOF types are mesh motion DOFs
+    unsigned n_mesh_motion_dof = n_bulk_dof - N_fluid_dof_type;
+
+    // determine the number of interface DOF types
+    unsigned n_interface_dof = this->ndof_types_in_mesh(1);
+
+    // Spine meshes have no separate mesh-motion block
+    Have_mesh_motion_block = (n_mesh_motion_dof > 0);
+    if (Have_mesh_motion_block)
+    {
+      Interface_block = 2;
+    }
+    else
+    {
+      Interface_block = 1;
+    }
+
+    // setup the block lookup scheme
+    // block 0 - fluid
+    //       1 - mesh motion (if any)
+    //       Interface_block - interface
+    unsigned n_dof = n_bulk_dof + n_interface_dof;
+    Vector<unsigned> dof_to_block_map(n_dof, 0);
+    for (unsigned i = N_fluid_dof_type; i < n_bulk_dof; i++)
+    {
+      dof_to_block_map[i] = 1;
+    }
+    for (unsigned i = n_bulk_dof; i < n_dof; i++)
+    {
+      dof_to_block_map[i] = Interface_block;
+    }
+
+    // Call block setup for this preconditioner
+    this->block_setup(dof_to_block_map);
+
+    // Block mapping for the subsidiary Navier Stokes preconditioner:
+    // The fluid DOF types in this preconditioner are also the DOF types
+    // in the subsidiary Navier Stokes one.
+    Vector<unsigned> ns_dof_lookup(N_fluid_dof_type);
+    for (unsigned i = 0; i < N_fluid_dof_type; i++)
+    {
+      ns_dof_lookup[i] = i;
+    }
+
+    // Turn the Navier Stokes Schur complement preconditioner into a
+    // subsidiary preconditioner of this preconditioner
+    Navier_stokes_preconditioner_pt->turn_into_subsidiary_block_preconditioner(
+      this, ns_dof_lookup);
+
+    // Setup the navier stokes preconditioner: Tell it about the
+    // Navier Stokes mesh and set it up.
+    Navier_stokes_preconditioner_pt->set_navier_stokes_mesh(
+      Bulk_fluid_mesh_pt, Allow_multiple_element_type_in_bulk_fluid_mesh);
+    Navier_stokes_preconditioner_pt->setup(matrix_pt());
+
+    // Setup the (direct) interface solver
+    double t_start = TimingHelpers::timer();
+    CRDoubleMatrix* interface_matrix_pt = new CRDoubleMatrix;
+    this->get_block(Interface_block, Interface_block, *interface_matrix_pt);
+    Interface_preconditioner_pt->setup(interface_matrix_pt);
+    delete interface_matrix_pt;
+    interface_matrix_pt = 0;
+    double t_end = TimingHelpers::timer();
+    double interface_setup_time = t_end - t_start;
+
+    // Setup the mesh motion preconditioner
+    double mesh_motion_setup_time = 0.0;
+    if (Have_mesh_motion_block)
+    {
+      t_start = TimingHelpers::timer();
+      CRDoubleMatrix* mesh_motion_matrix_pt = new CRDoubleMatrix;
+      this->get_block(1, 1, *mesh_motion_matrix_pt);
+      Mesh_motion_preconditioner_pt->setup(mesh_motion_matrix_pt);
+      delete mesh_motion_matrix_pt;
+      mesh_motion_matrix_pt = 0;
+      t_end = TimingHelpers::timer();
+      mesh_motion_setup_time = t_end - t_start;
+
+      // Interface onto mesh motion terms
+      CRDoubleMatrix* im_matrix_pt = new CRDoubleMatrix;
+      this->get_block(1, Interface_block, *im_matrix_pt);
+      this->setup_matrix_vector_product(
+        Interface_onto_mesh_motion_matvec_pt, im_matrix_pt, Interface_block);
+      delete im_matrix_pt;
+      im_matrix_pt = 0;
+    }
+
+    // Fluid onto interface terms (if needed)
+    if (Retain_fluid_onto_interface_terms)
+    {
+      CRDoubleMatrix* fi_matrix_pt = new CRDoubleMatrix;
+      this->get_block(Interface_block, 0, *fi_matrix_pt);
+      this->setup_matrix_vector_product(
+        Fluid_onto_interface_matvec_pt, fi_matrix_pt, 0);
+      delete fi_matrix_pt;
+      fi_matrix_pt = 0;
+    }
+
+    // Output times
+    if (Doc_time)
+    {
+      oomph_info << "Interface sub-preconditioner setup time [sec]: "
+                 << interface_setup_time << "\n";
+      if (Have_mesh_motion_block)
+      {
+        oomph_info << "Mesh motion sub-preconditioner setup time [sec]: "
+                   << mesh_motion_setup_time << "\n";
+      }
+    }
+  }
+
+
+  //======================================================================
+  /// Apply preconditioner to Vector r
+  //======================================================================
+  void FreeSurfacePreconditioner::preconditioner_solve(const DoubleVector& r,
+                                                       DoubleVector& z)
+  {
+    // if z is not setup then give it the same distribution
+    if (!z.built())
+    {
+      z.build(r.distribution_pt(), 0.0);
+    }
+
+    // Call fluid preconditioner for fluid block
+    Navier_stokes_preconditioner_pt->preconditioner_solve(r, z);
+
+    // Get the interface residual
+    DoubleVector interface_vec;
+    this->get_block_vector(Interface_block, r, interface_vec);
+
+    // Subtract the action of the fluid onto the interface equations
+    if (Retain_fluid_onto_interface_terms)
+    {
+      DoubleVector fluid_vec;
+      this->get_block_vector(0, z, fluid_vec);
+      DoubleVector aux_vec;
+      Fluid_onto_interface_matvec_pt->multiply(fluid_vec, aux_vec);
+      interface_vec -= aux_vec;
+    }
+
+    // Direct solve for the interface unknowns
+    DoubleVector interface_vec2;
+    Interface_preconditioner_pt->preconditioner_solve(interface_vec,
+                                                      interface_vec2);
+    interface_vec.clear();
+    this->return_block_vector(Interface_block, interface_vec2, z);
+
+    // The updated interface drives the mesh motion
+    if (Have_mesh_motion_block)
+    {
+      DoubleVector mesh_motion_vec;
+      this->get_block_vector(1, r, mesh_motion_vec);
+      DoubleVector aux_vec;
+      Interface_onto_mesh_motion_matvec_pt->multiply(interface_vec2, aux_vec);
+      mesh_motion_vec -= aux_vec;
+      aux_vec.clear();
+
+      DoubleVector mesh_motion_vec2;
+      Mesh_motion_preconditioner_pt->preconditioner_solve(mesh_motion_vec,
+                                                          mesh_motion_vec2);
+      this->return_block_vector(1, mesh_motion_vec2, z);
+    }
+  }
+
+} // namespace oomph
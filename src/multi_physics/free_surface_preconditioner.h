@@ -0,0 +1,286 @@
+// LIC// ====================================================================
+// LIC// This file forms part of oomph-lib, the object-oriented,
+// LIC// multi-physics finite-element library, available
+// LIC// at http://www.oomph-lib.org.
+// LIC//
+// LIC// Copyright (C) 2006-2024 Matthias Heil and Andrew Hazel
+// LIC//
+// LIC// This library is free software; you can redistribute it and/or
+// LIC// modify it under the terms of the GNU Lesser General Public
+// LIC// License as published by the Free Software Foundation; either
+// LIC// version 2.1 of the License, or (at your option) any later version.
+// LIC//
+// LIC// This library is distributed in the hope that it will be useful,
+// LIC// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// LIC// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// LIC// Lesser General Public License for more details.
+// LIC//
+// LIC// You should have received a copy of the GNU Lesser General Public
+// LIC// License along with this library; if not, write to the Free Software
+// LIC// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// LIC// 02110-1301  USA.
+// LIC//
+// LIC// The authors may be contacted at oomph-lib@maths.man.ac.uk.
+// LIC//
+// LIC//====================================================================
+#ifndef OOMPH_FREE_SURFACE_PRECONDITIONER_HEADER
+#define OOMPH_FREE_SURFACE_PRECONDITIONER_HEADER
+
+// includes
+#include "../generic/problem.h"
+#include "../generic/block_preconditioner.h"
+#include "../generic/preconditioner.h"
+#include "../generic/SuperLU_preconditioner.h"
+#include "../generic/matrix_vector_product.h"
+#include "../navier_stokes/navier_stokes_preconditioners.h"
+
+namespace oomph
+{
+  //============================================================================
+  /// Block preconditioner for monolithically-discretised free-surface
+  /// problems in which the nodes are moved either by spines (SpineMesh)
+  /// or by a pseudo-solid node update. The unknowns are split into
+  /// three blocks:
+  /// - the fluid velocities and pressure (classified by the bulk
+  ///   elements in the bulk fluid mesh),
+  /// - the mesh-motion unknowns away from the free surface (the remaining
+  ///   DOF types of the bulk elements; there are none for spine meshes),
+  /// - the interface unknowns (everything classified by the interface
+  ///   elements in the interface mesh: spine heights for spine-based
+  ///   interface elements; the positions of the interface nodes and the
+  ///   Lagrange multipliers that enforce the kinematic condition for
+  ///   elastic interface elements).
+  ///
+  /// The preconditioner is block lower triangular:
+  /// NavierStokesSchurComplementPreconditioner is applied to the fluid
+  /// block, the interface block (which is small) is solved directly with
+  /// SuperLU and the mesh-motion block is solved with a user-specifiable
+  /// preconditioner (e.g. an AMG solver; SuperLU by default) after the
+  /// updated interface position has been fed into its right-hand side.
+  /// By default the action of the fluid onto the interface equations
+  /// is retained.
+  //============================================================================
+  class FreeSurfacePreconditioner : public BlockPreconditioner<CRDoubleMatrix>
+  {
+  public:
+    /// Constructor: A problem pointer is required for the underlying
+    /// NavierStokesSchurComplementPreconditioner.
+    FreeSurfacePreconditioner(Problem* problem_pt)
+    {
+      // set the number of meshes
+      this->set_nmesh(2);
+
+      // null pointers
+      Bulk_fluid_mesh_pt = 0;
+      Interface_mesh_pt = 0;
+
+      // Number of fluid DOF types in the bulk elements has to be specified
+      // together with the bulk mesh
+      N_fluid_dof_type = 0;
+
+      // Initially assume that there are no multiple element types in the
+      // meshes.
+      Allow_multiple_element_type_in_bulk_fluid_mesh = false;
+      Allow_multiple_element_type_in_interface_mesh = false;
+
+      // Default setting: Retain the fluid onto interface terms
+      Retain_fluid_onto_interface_terms = true;
+
+      // Create the Navier Stokes Schur complement preconditioner
+      Navier_stokes_preconditioner_pt =
+        new NavierStokesSchurComplementPreconditioner(problem_pt);
+
+      // The (small) interface block is solved directly
+      Interface_preconditioner_pt = new SuperLUPreconditioner;
+
+      // Default mesh motion preconditioner
+      Mesh_motion_preconditioner_pt = new SuperLUPreconditioner;
+      Using_default_mesh_motion_preconditioner = true;
+
+      // No mesh motion block until we've done the block setup
+      Have_mesh_motion_block = false;
+
+      // Create the matrix vector product operators
+      Fluid_onto_interface_matvec_pt = new MatrixVectorProduct;
+      Interface_onto_mesh_motion_matvec_pt = new MatrixVectorProduct;
+
+      // set Doc_time to false
+      Doc_time = false;
+    }
+
+    /// Destructor: Clean up.
+    ~FreeSurfacePreconditioner()
+    {
+      // clean the memory
+      this->clean_up_memory();
+
+      // Delete the subsidiary preconditioners
+      delete Navier_stokes_preconditioner_pt;
+      delete Interface_preconditioner_pt;
+      if (Using_default_mesh_motion_preconditioner)
+      {
+        delete Mesh_motion_preconditioner_pt;
+      }
+
+      // delete the matrix vector product operators
+      delete Fluid_onto_interface_matvec_pt;
+      delete Interface_onto_mesh_motion_matvec_pt;
+    }
+
+    /// Broken copy constructor
+    FreeSurfacePreconditioner(const FreeSurfacePreconditioner&) = delete;
+
+    /// Broken assignment operator
+    // Commented out broken assignment operator because this can lead to a
+    // conflict warning when used in the virtual inheritence hierarchy.
+    // Essentially the compiler doesn't realise that two separate
+    // implementations of the broken function are the same and so, quite
+    // rightly, it shouts.
+    /*void operator=(const FreeSurfacePreconditioner&) =
+      delete;*/
+
+    /// clean up memory method
+    void clean_up_memory();
+
+    /// Setup the preconditioner
+    void setup();
+
+    /// Apply preconditioner to r
+    void preconditioner_solve(const DoubleVector& r, DoubleVector& z);
+
+    /// Setter function for the mesh containing the bulk fluid elements.
+    /// The first n_fluid_dof_type DOF types of these elements are the
+    /// fluid velocities and the pressure (e.g. DIM+1 for
+    /// Navier-Stokes elements); any remaining ones are mesh-motion
+    /// DOF types (e.g. the positional DOFs of
+    /// PseudoSolidNodeUpdateElements). The optional argument
+    /// indicates if there are more than one type of elements in same mesh.
+    void set_bulk_fluid_mesh(
+      Mesh* mesh_pt,
+      const unsigned& n_fluid_dof_type,
+      const bool& allow_multiple_element_type_in_bulk_fluid_mesh = false)
+    {
+      Bulk_fluid_mesh_pt = mesh_pt;
+      N_fluid_dof_type = n_fluid_dof_type;
+      Allow_multiple_element_type_in_bulk_fluid_mesh =
+        allow_multiple_element_type_in_bulk_fluid_mesh;
+    }
+
+    /// Setter function for the mesh containing the free-surface
+    /// elements. The optional argument indicates if there are more than one
+    /// type of elements in the same mesh.
+    void set_interface_mesh(
+      Mesh* mesh_pt,
+      const bool& allow_multiple_element_type_in_interface_mesh = false)
+    {
+      Interface_mesh_pt = mesh_pt;
+      Allow_multiple_element_type_in_interface_mesh =
+        allow_multiple_element_type_in_interface_mesh;
+    }
+
+    /// Specify a non-default preconditioner for the mesh-motion block
+    /// (e.g. an AMG solver). This preconditioner will not delete it.
+    void set_mesh_motion_preconditioner(Preconditioner* prec_pt)
+    {
+      if (Using_default_mesh_motion_preconditioner)
+      {
+        delete Mesh_motion_preconditioner_pt;
+      }
+      Mesh_motion_preconditioner_pt = prec_pt;
+      Using_default_mesh_motion_preconditioner = false;
+    }
+
+    /// Read-only access to mesh-motion preconditioner (use set_... to
+    /// set it)
+    Preconditioner* mesh_motion_preconditioner_pt() const
+    {
+      return Mesh_motion_preconditioner_pt;
+    }
+
+    /// Access function to the Navier Stokes preconditioner (inexact solver)
+    NavierStokesSchurComplementPreconditioner* navier_stokes_preconditioner_pt()
+      const
+    {
+      return Navier_stokes_preconditioner_pt;
+    }
+
+    /// Switch to block-diagonal preconditioner for the fluid/interface
+    /// coupling (the interface motion still drives the mesh motion).
+    void disable_fluid_onto_interface_terms()
+    {
+      Retain_fluid_onto_interface_terms = false;
+    }
+
+    /// Retain the action of the fluid unknowns onto the interface
+    /// equations (default).
+    void enable_fluid_onto_interface_terms()
+    {
+      Retain_fluid_onto_interface_terms = true;
+    }
+
+    /// Enable documentation of time
+    void enable_doc_time()
+    {
+      Doc_time = true;
+    }
+
+    /// Disable documentation of time
+    void disable_doc_time()
+    {
+      Doc_time = false;
+    }
+
+  private:
+    /// Pointer the Navier Stokes preconditioner (inexact solver)
+    NavierStokesSchurComplementPreconditioner* Navier_stokes_preconditioner_pt;
+
+    /// Pointer to the (direct) interface solver
+    Preconditioner* Interface_preconditioner_pt;
+
+    /// Pointer to the mesh-motion preconditioner
+    Preconditioner* Mesh_motion_preconditioner_pt;
+
+    /// Boolean flag to indicate whether default mesh-motion
+    /// preconditioner is used
+    bool Using_default_mesh_motion_preconditioner;
+
+    /// Fluid onto interface matrix vector product operator
+    MatrixVectorProduct* Fluid_onto_interface_matvec_pt;
+
+    /// Interface onto mesh motion matrix vector product operator
+    MatrixVectorProduct* Interface_onto_mesh_motion_matvec_pt;
+
+    /// Boolean flag used to indicate that the fluid onto interface
+    /// terms are to be retained
+    bool Retain_fluid_onto_interface_terms;
+
+    /// Is there a mesh-motion block? (False for spine meshes)
+    bool Have_mesh_motion_block;
+
+    /// Block number of the interface unknowns
+    unsigned Interface_block;
+
+    /// Set Doc_time to true for outputting results of timings
+    bool Doc_time;
+
+    /// Pointer to the mesh containing the bulk fluid elements
+    Mesh* Bulk_fluid_mesh_pt;
+
+    /// Pointer to the mesh containing the free-surface elements
+    Mesh* Interface_mesh_pt;
+
+    /// Number of fluid DOF types in the bulk elements
+    unsigned N_fluid_dof_type;
+
+    /// Flag to indicate if there are multiple element types in the
+    /// bulk fluid mesh.
+    bool Allow_multiple_element_type_in_bulk_fluid_mesh;
+
+    /// Flag to indicate if there are multiple element types in the
+    /// interface mesh.
+    bool Allow_multiple_element_type_in_interface_mesh;
+  };
+
+} // namespace oomph
+
+#endif
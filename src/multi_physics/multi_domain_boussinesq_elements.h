@@ -991,6 +991,20 @@ namespace oomph
         }
       }
     }
+
+    /// Classify dof numbers as in underlying element
+    void get_dof_numbers_for_unknowns(
+      std::list<std::pair<unsigned long, unsigned>>& dof_lookup_list) const
+    {
+      // Call the underlying function
+      NST_ELEMENT::get_dof_numbers_for_unknowns(dof_lookup_list);
+    }
+
+    /// Get number of dof types from underlying element
+    unsigned ndof_types() const
+    {
+      return NST_ELEMENT::ndof_types();
+    }
   };
 
 
@@ -1307,6 +1321,51 @@ namespace oomph
         }
       }
     }
+
+    /// Classify dofs for use in block preconditioner
+    void get_dof_numbers_for_unknowns(
+      std::list<std::pair<unsigned long, unsigned>>& dof_lookup_list) const
+    {
+      // number of nodes
+      unsigned n_node = this->nnode();
+
+      // temporary pair (used to store dof lookup prior to being added to list)
+      std::pair<unsigned, unsigned> dof_lookup;
+
+      // loop over the nodes
+      for (unsigned n = 0; n < n_node; n++)
+      {
+        // find the number of values at this node
+        unsigned nv = this->node_pt(n)->nvalue();
+
+        // loop over these values
+        for (unsigned v = 0; v < nv; v++)
+        {
+          // determine local eqn number
+          int local_eqn_number = this->nodal_local_eqn(n, v);
+
+          // ignore pinned values
+          if (local_eqn_number >= 0)
+          {
+            // store dof lookup in temporary pair: Global equation number
+            // is the first entry in pair
+            dof_lookup.first = this->eqn_number(local_eqn_number);
+
+            // set dof numbers: Dof number is the second entry in pair
+            dof_lookup.second = 0;
+
+            // add to list
+            dof_lookup_list.push_front(dof_lookup);
+          }
+        }
+      }
+    }
+
+    /// Specify number of dof types for use in block preconditioner
+    unsigned ndof_types() const
+    {
+      return 1;
+    }
   };
 
 
@@ -352,10 +352,18 @@ namespace oomph
 
 
   //====================================================================
-  /// Return the residuals for the equations of KL shell theory
+  /// Return the residuals for the equations of KL shell theory and,
+  /// if flag=1, the Jacobian matrix w.r.t. the nodal positions.
+  /// The derivatives of the load vector w.r.t. the position and the
+  /// normal vector are evaluated by finite differences at the
+  /// integration points; derivatives w.r.t. any external Data have to
+  /// be added separately.
   //====================================================================
-  void KirchhoffLoveShellEquations::fill_in_contribution_to_residuals_shell(
-    Vector<double>& residuals)
+  void KirchhoffLoveShellEquations::
+    fill_in_generic_contribution_to_residuals_shell(
+      Vector<double>& residuals,
+      DenseMatrix<double>& jacobian,
+      const unsigned& flag)
   {
     // Set the dimension of the coordinates
     const unsigned n_dim = 3;
@@ -385,11 +393,51 @@ namespace oomph
     const double h_cached = h();
     const double lambda_sq_cached = lambda_sq();
 
-    // Integers used to store the local equation numbers
-    int local_eqn = 0;
+    // Integers used to store the local equation and unknown numbers
+    int local_eqn = 0, local_unknown = 0;
 
     const double bending_scale = (1.0 / 12.0) * h_cached * h_cached;
 
+    // Time factor for the inertia terms in the Jacobian
+    double time_factor = 0.0;
+    if ((flag) && (lambda_sq_cached > 0.0))
+    {
+      time_factor = node_pt(0)->position_time_stepper_pt()->weight(2, 0);
+    }
+
+    // Total number of positional dofs (pinned or not): The dof
+    // associated with position type k of node l in direction i
+    // is labelled by (l*n_position_type+k)*n_dim+i
+    const unsigned n_shape_dof = n_node * n_position_type * n_dim;
+
+    // Variations of the deformed normal vector w.r.t. the positional dofs
+    DenseMatrix<double> normal_var(n_shape_dof, n_dim);
+
+    // Variations of sqrt(Adet), divided by sqrt(Adet)
+    Vector<double> sqrt_Adet_var(n_shape_dof);
+
+    // Variations of the normal, dotted into the second derivatives of
+    // the deformed position vector (mixed derivatives stored in [2])
+    DenseMatrix<double> normal_var_dot_dAdxi(n_shape_dof, 3);
+
+    // Variations of the deformed curvature tensor
+    // (mixed derivatives stored in [2])
+    DenseMatrix<double> curvature_var(n_shape_dof, 3);
+
+    // Variations of the membrane stress and bending moment tensors
+    // (only needed for the Jacobian). The bending moment is stored
+    // in the mixed form, with the sum of the off-diagonal terms in [2]
+    RankThreeTensor<double> membrane_stress_var;
+    DenseMatrix<double> bending_moment_var;
+    if (flag)
+    {
+      membrane_stress_var.resize(n_shape_dof, 2, 2);
+      bending_moment_var.resize(n_shape_dof, 3);
+    }
+
+    // Little tensor to handle the mixed derivative terms
+    unsigned mix[2][2] = {{0, 2}, {2, 1}};
+
     // Loop over the integration points
     for (unsigned ipt = 0; ipt < n_intpt; ipt++)
     {
@@ -424,7 +472,6 @@ namespace oomph
           interpolated_dAdxi(i, j) = 0.0;
         }
       }
-
       // Calculate displacements and derivatives
       for (unsigned l = 0; l < n_node; l++)
       {
@@ -617,14 +664,69 @@ namespace oomph
       // for(unsigned i=0;i<3;i++){f[i] *=
       // bending_scale/(1.0-nu_cached*nu_cached);}
 
-      // Allocate storage for variations of the the normal vector
-      double normal_var[3][3];
+      // Derivatives of the load vector w.r.t. the Eulerian position and
+      // the normal vector (by finite differences)
+      DenseMatrix<double> dfdx(3, 3, 0.0), dfdN(3, 3, 0.0);
+      if (flag)
+      {
+        const double fd_step = GeneralisedElement::Default_fd_jacobian_step;
+        Vector<double> f_plus(3);
+        for (unsigned j = 0; j < 3; j++)
+        {
+          // Perturb the position
+          double backup = interpolated_x[j];
+          interpolated_x[j] += fd_step;
+          load_vector(ipt, interpolated_xi, interpolated_x, N, f_plus);
+          interpolated_x[j] = backup;
+          for (unsigned i = 0; i < 3; i++)
+          {
+            dfdx(i, j) = (f_plus[i] - f[i]) / fd_step;
+          }
 
-      //=====EQUATIONS OF ELASTICITY FROM PRINCIPLE OF VIRTUAL
-      // DISPLACEMENTS========
+          // Perturb the normal
+          backup = N[j];
+          N[j] += fd_step;
+          load_vector(ipt, interpolated_xi, interpolated_x, N, f_plus);
+          N[j] = backup;
+          for (unsigned i = 0; i < 3; i++)
+          {
+            dfdN(i, j) = (f_plus[i] - f[i]) / fd_step;
+          }
+        }
+      }
 
-      // Little tensor to handle the mixed derivative terms
-      unsigned mix[2][2] = {{0, 2}, {2, 1}};
+      // Contract the plane stress stiffness tensor with the strain
+      // and bending tensors to get the membrane stress and the bending
+      // moment tensors
+      double membrane_stress[2][2], bending_moment[2][2];
+      for (unsigned ga = 0; ga < 2; ga++)
+      {
+        for (unsigned de = 0; de < 2; de++)
+        {
+          membrane_stress[ga][de] = 0.0;
+          bending_moment[ga][de] = 0.0;
+          for (unsigned al = 0; al < 2; al++)
+          {
+            for (unsigned be = 0; be < 2; be++)
+            {
+              if (!Ignore_membrane_terms)
+              {
+                membrane_stress[ga][de] += Et[al][be][ga][de] * gamma[al][be];
+              }
+              bending_moment[ga][de] += Et[al][be][ga][de] * kappa[al][be];
+            }
+          }
+        }
+      }
+
+      // The bending moment only ever multiplies (variations of) the
+      // symmetric curvature tensor, so collect the mixed terms
+      double bending_moment_mix[3];
+      bending_moment_mix[0] = bending_moment[0][0];
+      bending_moment_mix[1] = bending_moment[1][1];
+      bending_moment_mix[2] = bending_moment[0][1] + bending_moment[1][0];
+
+      //=====VARIATIONS OF THE NORMAL AND CURVATURE TENSOR==========
 
       // Loop over the number of nodes
       for (unsigned l = 0; l < n_node; l++)
@@ -632,31 +734,114 @@ namespace oomph
         // Loop over the type of degree of freedom
         for (unsigned k = 0; k < n_position_type; k++)
         {
-          // Setup components of variations in the normal vector
-          normal_var[0][0] = 0.0;
-          normal_var[0][1] = (-interpolated_A(1, 2) * dpsidxi(l, k, 0) +
-                              interpolated_A(0, 2) * dpsidxi(l, k, 1)) /
-                             sqrt_Adet;
-          normal_var[0][2] = (interpolated_A(1, 1) * dpsidxi(l, k, 0) -
-                              interpolated_A(0, 1) * dpsidxi(l, k, 1)) /
-                             sqrt_Adet;
-
-          normal_var[1][0] = (interpolated_A(1, 2) * dpsidxi(l, k, 0) -
-                              interpolated_A(0, 2) * dpsidxi(l, k, 1)) /
-                             sqrt_Adet;
-          normal_var[1][1] = 0.0;
-          normal_var[1][2] = (-interpolated_A(1, 0) * dpsidxi(l, k, 0) +
-                              interpolated_A(0, 0) * dpsidxi(l, k, 1)) /
-                             sqrt_Adet;
-
-          normal_var[2][0] = (-interpolated_A(1, 1) * dpsidxi(l, k, 0) +
-                              interpolated_A(0, 1) * dpsidxi(l, k, 1)) /
-                             sqrt_Adet;
-          normal_var[2][1] = (interpolated_A(1, 0) * dpsidxi(l, k, 0) -
-                              interpolated_A(0, 0) * dpsidxi(l, k, 1)) /
-                             sqrt_Adet;
-          normal_var[2][2] = 0.0;
+          // The variation of A_0 x A_1 w.r.t. the position in direction i
+          // is e_i x cross_var_base
+          double cross_var_base[3];
+          for (unsigned i2 = 0; i2 < 3; i2++)
+          {
+            cross_var_base[i2] = dpsidxi(l, k, 0) * interpolated_A(1, i2) -
+                                 dpsidxi(l, k, 1) * interpolated_A(0, i2);
+          }
+
+          // Loop over the coordinate direction
+          for (unsigned i = 0; i < 3; i++)
+          {
+            const unsigned p = (l * n_position_type + k) * n_dim + i;
+
+            // Variation of A_0 x A_1, divided by sqrt(Adet)
+            double cross_var[3];
+            cross_var[i] = 0.0;
+            cross_var[(i + 1) % 3] = -cross_var_base[(i + 2) % 3] / sqrt_Adet;
+            cross_var[(i + 2) % 3] = cross_var_base[(i + 1) % 3] / sqrt_Adet;
+
+            // Variation of sqrt(Adet), divided by sqrt(Adet)
+            sqrt_Adet_var[p] = N[0] * cross_var[0] + N[1] * cross_var[1] +
+                               N[2] * cross_var[2];
+
+            // Combine the cross and dot product terms
+            for (unsigned i2 = 0; i2 < 3; i2++)
+            {
+              normal_var(p, i2) = cross_var[i2] - N[i2] * sqrt_Adet_var[p];
+            }
+
+            // Variation of the curvature tensor
+            for (unsigned mu = 0; mu < 3; mu++)
+            {
+              normal_var_dot_dAdxi(p, mu) =
+                normal_var(p, 0) * interpolated_dAdxi(mu, 0) +
+                normal_var(p, 1) * interpolated_dAdxi(mu, 1) +
+                normal_var(p, 2) * interpolated_dAdxi(mu, 2);
+              curvature_var(p, mu) =
+                N[i] * d2psidxi(l, k, mu) + normal_var_dot_dAdxi(p, mu);
+            }
+
+            // Variations of the membrane stress and bending moment
+            if (flag)
+            {
+              for (unsigned ga = 0; ga < 2; ga++)
+              {
+                for (unsigned de = 0; de < 2; de++)
+                {
+                  membrane_stress_var(p, ga, de) = 0.0;
+                }
+              }
+              for (unsigned mu = 0; mu < 3; mu++)
+              {
+                bending_moment_var(p, mu) = 0.0;
+              }
+              for (unsigned al = 0; al < 2; al++)
+              {
+                for (unsigned be = 0; be < 2; be++)
+                {
+                  // Variation of the strain tensor
+                  double gamma_var =
+                    0.5 * (dpsidxi(l, k, al) * interpolated_A(be, i) +
+                           interpolated_A(al, i) * dpsidxi(l, k, be));
+                  for (unsigned ga = 0; ga < 2; ga++)
+                  {
+                    for (unsigned de = 0; de < 2; de++)
+                    {
+                      if (!Ignore_membrane_terms)
+                      {
+                        membrane_stress_var(p, ga, de) +=
+                          Et[al][be][ga][de] * gamma_var;
+                      }
+                      // The change of curvature decreases when
+                      // the curvature increases
+                      bending_moment_var(p, mix[ga][de]) -=
+                        Et[al][be][ga][de] * curvature_var(p, mix[al][be]);
+                    }
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+
+      // Deformed curvature tensor in the mixed form
+      double B_mix[3] = {B[0][0], B[1][1], B[0][1]};
+
+      // Tangential part of the second derivatives of the deformed
+      // position vector
+      double dAdxi_tang[3][3];
+      for (unsigned mu = 0; mu < 3; mu++)
+      {
+        for (unsigned i2 = 0; i2 < 3; i2++)
+        {
+          dAdxi_tang[mu][i2] = interpolated_dAdxi(mu, i2) - B_mix[mu] * N[i2];
+        }
+      }
 
+      //=====EQUATIONS OF ELASTICITY FROM PRINCIPLE OF VIRTUAL
+      // DISPLACEMENTS========
+
+      // Loop over the number of nodes
+      for (unsigned l = 0; l < n_node; l++)
+      {
+        // Loop over the type of degree of freedom
+        for (unsigned k = 0; k < n_position_type; k++)
+        {
           // Loop over the coordinate direction
           for (unsigned i = 0; i < 3; i++)
           {
@@ -666,21 +851,7 @@ namespace oomph
             // If it's not a boundary condition
             if (local_eqn >= 0)
             {
-              // Temporary to hold a common part of the bending terms
-              double bending_dot_product_multiplier =
-                ((A[1][1] * interpolated_A(0, i) -
-                  A[1][0] * interpolated_A(1, i)) *
-                   dpsidxi(l, k, 0) +
-                 (A[0][0] * interpolated_A(1, i) -
-                  A[0][1] * interpolated_A(0, i)) *
-                   dpsidxi(l, k, 1)) /
-                Adet;
-
-              // Combine the cross and dot product bending terms
-              for (unsigned i2 = 0; i2 < 3; i2++)
-              {
-                normal_var[i][i2] -= N[i2] * bending_dot_product_multiplier;
-              }
+              const unsigned p = (l * n_position_type + k) * n_dim + i;
 
               // Add in external forcing
               residuals[local_eqn] -=
@@ -697,39 +868,139 @@ namespace oomph
               {
                 for (unsigned be = 0; be < 2; be++)
                 {
-                  // Membrane prestress
-                  other_residual_terms += *Prestress_pt(al, be) *
-                                          interpolated_A(al, i) *
-                                          dpsidxi(l, k, be);
+                  // Membrane prestress and pure membrane term
+                  other_residual_terms +=
+                    (*Prestress_pt(al, be) + membrane_stress[al][be]) *
+                    interpolated_A(al, i) * dpsidxi(l, k, be);
+                }
+              }
 
-                  // Remaining terms
-                  for (unsigned ga = 0; ga < 2; ga++)
+              // Bending terms
+              for (unsigned mu = 0; mu < 3; mu++)
+              {
+                other_residual_terms -= bending_scale * bending_moment_mix[mu] *
+                                        curvature_var(p, mu);
+              }
+
+              residuals[local_eqn] += other_residual_terms * W * sqrt_adet;
+
+              // Calculate the jacobian
+              //-----------------------
+              if (flag)
+              {
+                // Loop over the nodes again
+                for (unsigned ll = 0; ll < n_node; ll++)
+                {
+                  // Loop over the type of degree of freedom again
+                  for (unsigned kk = 0; kk < n_position_type; kk++)
                   {
-                    for (unsigned de = 0; de < 2; de++)
+                    // Cross term that arises from the second variation
+                    // of A_0 x A_1
+                    const double cross_var2 =
+                      (dpsidxi(l, k, 0) * dpsidxi(ll, kk, 1) -
+                       dpsidxi(ll, kk, 0) * dpsidxi(l, k, 1)) /
+                      sqrt_Adet;
+
+                    // Loop over the coordinate direction again
+                    for (unsigned ii = 0; ii < 3; ii++)
                     {
-                      if (!Ignore_membrane_terms)
+                      local_unknown = position_local_eqn(ll, kk, ii);
+
+                      // If it's not a boundary condition
+                      if (local_unknown >= 0)
                       {
-                        // Pure membrane term
-                        other_residual_terms +=
-                          Et[al][be][ga][de] * gamma[al][be] *
-                          interpolated_A(ga, i) * dpsidxi(l, k, de);
+                        const unsigned q =
+                          (ll * n_position_type + kk) * n_dim + ii;
+
+                        double jac_sum = 0.0;
+
+                        // Terms that only arise in the same coordinate
+                        // direction: Inertia, geometric stiffness of
+                        // (pre-)stress
+                        if (i == ii)
+                        {
+                          jac_sum += lambda_sq_cached * time_factor *
+                                     psi(ll, kk) * psi(l, k);
+                          for (unsigned al = 0; al < 2; al++)
+                          {
+                            for (unsigned be = 0; be < 2; be++)
+                            {
+                              jac_sum +=
+                                (*Prestress_pt(al, be) +
+                                 membrane_stress[al][be]) *
+                                dpsidxi(ll, kk, al) * dpsidxi(l, k, be);
+                            }
+                          }
+                        }
+
+                        // Material stiffness of the membrane terms
+                        for (unsigned al = 0; al < 2; al++)
+                        {
+                          for (unsigned be = 0; be < 2; be++)
+                          {
+                            jac_sum += membrane_stress_var(q, al, be) *
+                                       interpolated_A(al, i) *
+                                       dpsidxi(l, k, be);
+                          }
+                        }
+
+                        // Dot product of the variations of the normal
+                        double normal_var_dot = 0.0;
+                        for (unsigned i2 = 0; i2 < 3; i2++)
+                        {
+                          normal_var_dot +=
+                            normal_var(p, i2) * normal_var(q, i2);
+                        }
+
+                        // Sign of e_i x e_ii . e_(third direction)
+                        double cross_sign = 0.0;
+                        unsigned third = 0;
+                        if (i != ii)
+                        {
+                          third = 3 - i - ii;
+                          cross_sign = ((ii == (i + 1) % 3) ? 1.0 : -1.0);
+                        }
+
+                        // Bending terms
+                        for (unsigned mu = 0; mu < 3; mu++)
+                        {
+                          // Second variation of the curvature tensor
+                          double curvature_var2 =
+                            normal_var(q, i) * d2psidxi(l, k, mu) +
+                            normal_var(p, ii) * d2psidxi(ll, kk, mu) -
+                            sqrt_Adet_var[p] * normal_var_dot_dAdxi(q, mu) -
+                            sqrt_Adet_var[q] * normal_var_dot_dAdxi(p, mu) -
+                            B_mix[mu] * normal_var_dot;
+                          if (i != ii)
+                          {
+                            curvature_var2 +=
+                              cross_sign * cross_var2 * dAdxi_tang[mu][third];
+                          }
+
+                          jac_sum -=
+                            bending_scale *
+                            (bending_moment_var(q, mu) * curvature_var(p, mu) +
+                             bending_moment_mix[mu] * curvature_var2);
+                        }
+
+                        jacobian(local_eqn, local_unknown) +=
+                          jac_sum * W * sqrt_adet;
+
+                        // Variation of the load term (the load depends
+                        // on the position and the normal)
+                        double load_var = dfdx(i, ii) * psi(ll, kk) +
+                                          f[i] * sqrt_Adet_var[q];
+                        for (unsigned i2 = 0; i2 < 3; i2++)
+                        {
+                          load_var += dfdN(i, i2) * normal_var(q, i2);
+                        }
+                        jacobian(local_eqn, local_unknown) -=
+                          load_var / h_cached * psi(l, k) * W * sqrt_Adet;
                       }
-
-                      // Bending terms
-                      other_residual_terms -=
-                        bending_scale * Et[al][be][ga][de] * kappa[al][be] *
-                        (N[i] * d2psidxi(l, k, mix[ga][de])
-                         // Cross and dot product terms
-                         +
-                         normal_var[i][0] * interpolated_dAdxi(mix[ga][de], 0) +
-                         normal_var[i][1] * interpolated_dAdxi(mix[ga][de], 1) +
-                         normal_var[i][2] * interpolated_dAdxi(mix[ga][de], 2));
                     }
                   }
                 }
-              }
-
-              residuals[local_eqn] += other_residual_terms * W * sqrt_adet;
+              } // End of Jacobian calculation
             }
           }
         }
@@ -739,21 +1010,48 @@ namespace oomph
   }
 
   //=========================================================================
-  /// Return the jacobian is calculated by finite differences by default,
+  /// Return the jacobian: By default it is computed analytically,
+  /// apart from the contributions from any external Data, which are
+  /// obtained by finite differences. Call enable_evaluate_jacobian_by_fd()
+  /// to revert to a fully finite-differenced Jacobian.
   //=========================================================================
   void KirchhoffLoveShellEquations::fill_in_contribution_to_jacobian(
     Vector<double>& residuals, DenseMatrix<double>& jacobian)
   {
-    // Call the element's residuals vector
-    fill_in_contribution_to_residuals_shell(residuals);
-
     // Solve for the consistent acceleration in Newmark scheme?
     if (Solve_for_consistent_newmark_accel_flag)
     {
+      // Call the element's residuals vector
+      fill_in_contribution_to_residuals_shell(residuals);
+
       fill_in_jacobian_for_newmark_accel(jacobian);
       return;
     }
 
+    // Get the analytic Jacobian
+    if (!Evaluate_jacobian_by_fd)
+    {
+      fill_in_generic_contribution_to_residuals_shell(residuals, jacobian, 1);
+
+      // Get the entries from the external data, usually load terms
+      if (nexternal_data() > 0)
+      {
+        // Allocate storage for the full residuals of the element
+        unsigned n_dof = ndof();
+        Vector<double> full_residuals(n_dof);
+
+        // Call the full residuals
+        get_residuals(full_residuals);
+
+        SolidFiniteElement::fill_in_jacobian_from_external_by_fd(
+          full_residuals, jacobian);
+      }
+      return;
+    }
+
+    // Call the element's residuals vector
+    fill_in_contribution_to_residuals_shell(residuals);
+
     // Allocate storage for the full residuals of the element
     unsigned n_dof = ndof();
     Vector<double> full_residuals(n_dof);
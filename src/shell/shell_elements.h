@@ -60,6 +60,9 @@ namespace oomph
     /// Boolean flag to ignore membrane terms
     bool Ignore_membrane_terms;
 
+    /// Use FD to evaluate Jacobian
+    bool Evaluate_jacobian_by_fd;
+
     /// Pointer to Poisson's ratio
     double* Nu_pt;
 
@@ -108,7 +111,19 @@ namespace oomph
     /// the function fill_in_contribution_to_jacobian that can
     /// lead to virtual inheritance woes if this element is ever
     /// used as part of a multi-physics element.
-    void fill_in_contribution_to_residuals_shell(Vector<double>& residuals);
+    void fill_in_contribution_to_residuals_shell(Vector<double>& residuals)
+    {
+      fill_in_generic_contribution_to_residuals_shell(
+        residuals, GeneralisedElement::Dummy_matrix, 0);
+    }
+
+    /// Return the residuals for the equations of KL shell theory
+    /// and, if flag=1, the (analytic) Jacobian w.r.t. the nodal positions.
+    /// Derivatives w.r.t. external Data are not included.
+    void fill_in_generic_contribution_to_residuals_shell(
+      Vector<double>& residuals,
+      DenseMatrix<double>& jacobian,
+      const unsigned& flag);
 
     /// Get the load vector for the computation of the rate of work
     /// done by the load. Here we simply forward this to
@@ -143,6 +158,9 @@ namespace oomph
       // Don't ignore membrane terms
       Ignore_membrane_terms = false;
 
+      // Evaluate the Jacobian analytically
+      Evaluate_jacobian_by_fd = false;
+
       // Default load is zero traction
       Load_vector_fct_pt = &Zero_traction_fct;
 
@@ -209,6 +227,24 @@ namespace oomph
       Ignore_membrane_terms = false;
     }
 
+    /// Set Jacobian to be evaluated by FD? Else: Analytically.
+    void enable_evaluate_jacobian_by_fd()
+    {
+      Evaluate_jacobian_by_fd = true;
+    }
+
+    /// Set Jacobian to be evaluated analytically (default). Else: by FD
+    void disable_evaluate_jacobian_by_fd()
+    {
+      Evaluate_jacobian_by_fd = false;
+    }
+
+    /// Return the flag indicating whether the jacobian is evaluated by fd
+    bool is_jacobian_evaluated_by_fd() const
+    {
+      return Evaluate_jacobian_by_fd;
+    }
+
     /// Return the Poisson's ratio
     const double& nu() const
     {
@@ -262,7 +298,11 @@ namespace oomph
       fill_in_contribution_to_residuals_shell(residuals);
     }
 
-    /// Return the jacobian is calculated by finite differences by default,
+    /// Return the jacobian. By default the derivatives w.r.t. the nodal
+    /// positions are calculated analytically (with the derivatives of
+    /// the load vector w.r.t. position and normal obtained by finite
+    /// differences at the integration points); those w.r.t. external
+    /// Data are always calculated by finite differences.
     void fill_in_contribution_to_jacobian(Vector<double>& residuals,
                                           DenseMatrix<double>& jacobian);
 
@@ -340,7 +380,14 @@ namespace oomph
   /// using Hermite interpolation (displacements
   /// and slopes are interpolated separately. The local and global
   /// (Lagrangian) coordinates  are not assumed to be aligned.
-  /// N.B. It will be DOG SLOW.
+  /// N.B. The evaluation of the Hermite shape functions and their
+  /// derivatives w.r.t. the Lagrangian coordinates is expensive. If
+  /// the element's Lagrangian coordinates do not change, they can be
+  /// pre-computed at the integration points by using the element
+  /// in the form StorableShapeSolidElement<HermiteShellElement>
+  /// (or similar for the derived classes) and calling
+  /// pre_compute_d2shape_lagrangian_at_knots() once the mesh
+  /// has been built.
   //=======================================================================
   class HermiteShellElement : public virtual SolidQHermiteElement<2>,
                               public KirchhoffLoveShellEquations